@@ -23,7 +23,7 @@
  \file indigo_agent_lx200_server.c
  */
 
-#define DRIVER_VERSION 0x0002
+#define DRIVER_VERSION 0x0003
 #define DRIVER_NAME	"indigo_agent_lx200_server"
 
 #include <stdio.h>
@@ -88,6 +88,14 @@
 #define MOUNT_PARK_PARKED_ITEM								(MOUNT_PARK_PROPERTY->items+0)
 #define MOUNT_PARK_UNPARKED_ITEM							(MOUNT_PARK_PROPERTY->items+1)
 
+#define LX200_BUFFER_SIZE											1024
+#define LX200_COMMAND_SIZE										128
+
+typedef struct {
+	unsigned sequence;
+	double ra, dec;
+} mount_snapshot;
+
 typedef struct {
 	indigo_property *lx200_devices_property;
 	indigo_property *lx200_configuration_property;
@@ -102,7 +110,8 @@ typedef struct {
 	indigo_device *device;
 	indigo_client *client;
 	bool unparked;
-	double ra, dec;
+	mount_snapshot snapshot;
+	pthread_mutex_t snapshot_mutex;
 	int server_socket;
 	pthread_t listener;
 } agent_private_data;
@@ -116,18 +125,40 @@ static indigo_result agent_enumerate_properties(indigo_device *device, indigo_cl
 
 // -------------------------------------------------------------------------------- LX200 server implementation
 
-static char * doubleToSexa(double value, char *format) {
-	static char buffer[128];
+static char *doubleToSexa(double value, char *format, char *buffer, int size) {
 	double d = fabs(value);
 	double m = 60.0 * (d - floor(d));
 	double s = 60.0 * (m - floor(m));
 	if (value < 0) {
 		d = -d;
 	}
-	snprintf(buffer, sizeof(buffer), format, (int)d, (int)m, s);
+	snprintf(buffer, size, format, (int)d, (int)m, s);
 	return buffer;
 }
 
+static void store_snapshot(indigo_device *device, double ra, double dec) {
+	mount_snapshot *snapshot = &DEVICE_PRIVATE_DATA->snapshot;
+	pthread_mutex_lock(&DEVICE_PRIVATE_DATA->snapshot_mutex);
+	__atomic_add_fetch(&snapshot->sequence, 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	__atomic_store(&snapshot->ra, &ra, __ATOMIC_RELAXED);
+	__atomic_store(&snapshot->dec, &dec, __ATOMIC_RELAXED);
+	__atomic_add_fetch(&snapshot->sequence, 1, __ATOMIC_RELEASE);
+	pthread_mutex_unlock(&DEVICE_PRIVATE_DATA->snapshot_mutex);
+}
+
+static void load_snapshot(indigo_device *device, double *ra, double *dec) {
+	mount_snapshot *snapshot = &DEVICE_PRIVATE_DATA->snapshot;
+	unsigned begin, end;
+	do {
+		begin = __atomic_load_n(&snapshot->sequence, __ATOMIC_ACQUIRE);
+		__atomic_load(&snapshot->ra, ra, __ATOMIC_RELAXED);
+		__atomic_load(&snapshot->dec, dec, __ATOMIC_RELAXED);
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		end = __atomic_load_n(&snapshot->sequence, __ATOMIC_RELAXED);
+	} while ((begin & 1) || begin != end);
+}
+
 static void unpark(indigo_device *device) {
 	if (!DEVICE_PRIVATE_DATA->unparked) {
 		indigo_set_switch(MOUNT_PARK_PROPERTY, MOUNT_PARK_UNPARKED_ITEM, true);
@@ -142,141 +173,161 @@ static void unpark(indigo_device *device) {
 	}
 }
 
+static void process_command(indigo_device *device, int client_socket, char *buffer_in, char *buffer_out) {
+	*buffer_out = 0;
+	if (strcmp(buffer_in, "GVP") == 0) {
+		strcpy(buffer_out, "indigo#");
+	} else if (strcmp(buffer_in, "GR") == 0) {
+		double ra, dec;
+		load_snapshot(device, &ra, &dec);
+		doubleToSexa(ra, "%02d:%02d:%02.0f#", buffer_out, LX200_COMMAND_SIZE);
+	} else if (strcmp(buffer_in, "GD") == 0) {
+		double ra, dec;
+		load_snapshot(device, &ra, &dec);
+		doubleToSexa(dec, "%02d*%02d'%02.0f#", buffer_out, LX200_COMMAND_SIZE);
+	} else if (strncmp(buffer_in, "Sr", 2) == 0) {
+		int h = 0, m = 0;
+		double s = 0;
+		char c;
+		if (sscanf(buffer_in + 2, "%d%c%d%c%lf", &h, &c, &m, &c, &s) == 5) {
+			MOUNT_EQUATORIAL_COORDINATES_RA_ITEM->number.value = h + m/60.0 + s/3600.0;
+			strcpy(buffer_out, "1");
+		} else if (sscanf(buffer_in + 2, "%d%c%d", &h, &c, &m) == 3) {
+			MOUNT_EQUATORIAL_COORDINATES_RA_ITEM->number.value = h + m/60.0;
+			strcpy(buffer_out, "1");
+		} else {
+			strcpy(buffer_out, "0");
+		}
+	} else if (strncmp(buffer_in, "Sd", 2) == 0) {
+		int d = 0, m = 0;
+		double s = 0;
+		char c;
+		if (sscanf(buffer_in + 2, "%d%c%d%c%lf", &d, &c, &m, &c, &s) == 5) {
+			MOUNT_EQUATORIAL_COORDINATES_DEC_ITEM->number.value = d > 0 ? d + m/60.0 + s/3600.0 : d - m/60.0 - s/3600.0;
+			strcpy(buffer_out, "1");
+		} else if (sscanf(buffer_in + 2, "%d%c%d", &d, &c, &m) == 3) {
+			MOUNT_EQUATORIAL_COORDINATES_DEC_ITEM->number.value = d > 0 ? d + m/60.0 : d - m/60.0;
+			strcpy(buffer_out, "1");
+		} else {
+			strcpy(buffer_out, "0");
+		}
+	} else if (strncmp(buffer_in, "MS", 2) == 0) {
+		unpark(device);
+		indigo_set_switch(MOUNT_ON_COORDINATES_SET_PROPERTY, MOUNT_ON_COORDINATES_SET_TRACK_ITEM, true);
+		indigo_change_property(DEVICE_PRIVATE_DATA->client, MOUNT_ON_COORDINATES_SET_PROPERTY);
+		indigo_change_property(DEVICE_PRIVATE_DATA->client, MOUNT_EQUATORIAL_COORDINATES_PROPERTY);
+		strcpy(buffer_out, "0");
+	} else if (strncmp(buffer_in, "CM", 2) == 0) {
+		unpark(device);
+		indigo_set_switch(MOUNT_ON_COORDINATES_SET_PROPERTY, MOUNT_ON_COORDINATES_SET_SYNC_ITEM, true);
+		indigo_change_property(DEVICE_PRIVATE_DATA->client, MOUNT_ON_COORDINATES_SET_PROPERTY);
+		indigo_change_property(DEVICE_PRIVATE_DATA->client, MOUNT_EQUATORIAL_COORDINATES_PROPERTY);
+		strcpy(buffer_out, "OK#");
+	} else if (strcmp(buffer_in, "RG") == 0) {
+		indigo_set_switch(MOUNT_SLEW_RATE_PROPERTY, MOUNT_SLEW_RATE_GUIDE_ITEM, true);
+		indigo_change_property(DEVICE_PRIVATE_DATA->client, MOUNT_SLEW_RATE_PROPERTY);
+	} else if (strcmp(buffer_in, "RC") == 0) {
+		indigo_set_switch(MOUNT_SLEW_RATE_PROPERTY, MOUNT_SLEW_RATE_CENTERING_ITEM, true);
+		indigo_change_property(DEVICE_PRIVATE_DATA->client, MOUNT_SLEW_RATE_PROPERTY);
+	} else if (strcmp(buffer_in, "RM") == 0) {
+		indigo_set_switch(MOUNT_SLEW_RATE_PROPERTY, MOUNT_SLEW_RATE_FIND_ITEM, true);
+		indigo_change_property(DEVICE_PRIVATE_DATA->client, MOUNT_SLEW_RATE_PROPERTY);
+	} else if (strcmp(buffer_in, "RS") == 0) {
+		indigo_set_switch(MOUNT_SLEW_RATE_PROPERTY, MOUNT_SLEW_RATE_MAX_ITEM, true);
+		indigo_change_property(DEVICE_PRIVATE_DATA->client, MOUNT_SLEW_RATE_PROPERTY);
+	} else if (strcmp(buffer_in, "Mn") == 0) {
+		unpark(device);
+		indigo_set_switch(MOUNT_MOTION_DEC_PROPERTY, MOUNT_MOTION_NORTH_ITEM, true);
+		indigo_change_property(DEVICE_PRIVATE_DATA->client, MOUNT_MOTION_DEC_PROPERTY);
+	} else if (strcmp(buffer_in, "Qn") == 0) {
+		indigo_set_switch(MOUNT_MOTION_DEC_PROPERTY, MOUNT_MOTION_NORTH_ITEM, false);
+		indigo_change_property(DEVICE_PRIVATE_DATA->client, MOUNT_MOTION_DEC_PROPERTY);
+	} else if (strcmp(buffer_in, "Ms") == 0) {
+		unpark(device);
+		indigo_set_switch(MOUNT_MOTION_DEC_PROPERTY, MOUNT_MOTION_SOUTH_ITEM, true);
+		indigo_change_property(DEVICE_PRIVATE_DATA->client, MOUNT_MOTION_DEC_PROPERTY);
+	} else if (strcmp(buffer_in, "Qs") == 0) {
+		indigo_set_switch(MOUNT_MOTION_DEC_PROPERTY, MOUNT_MOTION_SOUTH_ITEM, false);
+		indigo_change_property(DEVICE_PRIVATE_DATA->client, MOUNT_MOTION_DEC_PROPERTY);
+	} else if (strcmp(buffer_in, "Mw") == 0) {
+		unpark(device);
+		indigo_set_switch(MOUNT_MOTION_RA_PROPERTY, MOUNT_MOTION_WEST_ITEM, true);
+		indigo_change_property(DEVICE_PRIVATE_DATA->client, MOUNT_MOTION_RA_PROPERTY);
+	} else if (strcmp(buffer_in, "Qw") == 0) {
+		indigo_set_switch(MOUNT_MOTION_RA_PROPERTY, MOUNT_MOTION_WEST_ITEM, false);
+		indigo_change_property(DEVICE_PRIVATE_DATA->client, MOUNT_MOTION_RA_PROPERTY);
+	} else if (strcmp(buffer_in, "Me") == 0) {
+		unpark(device);
+		indigo_set_switch(MOUNT_MOTION_RA_PROPERTY, MOUNT_MOTION_EAST_ITEM, true);
+		indigo_change_property(DEVICE_PRIVATE_DATA->client, MOUNT_MOTION_RA_PROPERTY);
+	} else if (strcmp(buffer_in, "Qe") == 0) {
+		indigo_set_switch(MOUNT_MOTION_RA_PROPERTY, MOUNT_MOTION_EAST_ITEM, false);
+		indigo_change_property(DEVICE_PRIVATE_DATA->client, MOUNT_MOTION_RA_PROPERTY);
+	} else if (strcmp(buffer_in, "Q") == 0) {
+		indigo_set_switch(MOUNT_ABORT_MOTION_PROPERTY, MOUNT_ABORT_MOTION_ITEM, true);
+		indigo_change_property(DEVICE_PRIVATE_DATA->client, MOUNT_ABORT_MOTION_PROPERTY);
+	} else if (strncmp(buffer_in, "SC", 2) == 0) {
+		strcpy(buffer_out, "1Updating        planetary data. #                              #");
+	} else if (strncmp(buffer_in, "S", 1) == 0) {
+		strcpy(buffer_out, "1");
+	}
+	if (*buffer_out) {
+		if (*buffer_in == 'G')
+			INDIGO_DRIVER_TRACE(LX200_SERVER_AGENT_NAME, "%d: '%s' -> '%s'", client_socket, buffer_in, buffer_out);
+		else
+			INDIGO_DRIVER_DEBUG(LX200_SERVER_AGENT_NAME, "%d: '%s' -> '%s'", client_socket, buffer_in, buffer_out);
+	} else {
+		INDIGO_DRIVER_DEBUG(LX200_SERVER_AGENT_NAME, "%d: '%s' -> ", client_socket, buffer_in);
+	}
+}
+
 static void start_worker_thread(handler_data *data) {
 	indigo_device *device = data->device;
 	int client_socket = data->client_socket;
-	char buffer_in[128];
-	char buffer_out[128];
-	long result = 1;
+	char buffer_in[LX200_BUFFER_SIZE];
+	char buffer_out[LX200_BUFFER_SIZE];
+	char command[LX200_COMMAND_SIZE];
+	char response[LX200_COMMAND_SIZE];
+	int command_length = -1;
 
 	INDIGO_DRIVER_TRACE(LX200_SERVER_AGENT_NAME, "%d: CONNECTED", client_socket);
 
 	while (true) {
-		*buffer_in = 0;
-		*buffer_out = 0;
-		result = read(client_socket, buffer_in, 1);
-		if (result <= 0)
+		long count = read(client_socket, buffer_in, sizeof(buffer_in));
+		if (count <= 0)
 			break;
-		if (*buffer_in == 6) {
-			strcpy(buffer_out, "P");
-		} else if (*buffer_in == '#') {
-			continue;
-		} else if (*buffer_in == ':') {
-			int i = 0;
-			while (i < sizeof(buffer_in)) {
-				result = read(client_socket, buffer_in + i, 1);
-				if (result <= 0)
-					break;
-				if (buffer_in[i] == '#') {
-					buffer_in[i] = 0;
-					break;
-				}
-				i++;
+		int out_length = 0;
+		bool failed = false;
+		for (int i = 0; i < count && !failed; i++) {
+			char c = buffer_in[i];
+			*response = 0;
+			if (command_length < 0) {
+				if (c == 6)
+					strcpy(response, "P");
+				else if (c == ':')
+					command_length = 0;
+			} else if (c == '#') {
+				command[command_length] = 0;
+				command_length = -1;
+				process_command(device, client_socket, command, response);
+			} else if (command_length < LX200_COMMAND_SIZE - 1) {
+				command[command_length++] = c;
 			}
-			if (result == -1)
-				break;
-			if (strcmp(buffer_in, "GVP") == 0) {
-				strcpy(buffer_out, "indigo#");
-			} else if (strcmp(buffer_in, "GR") == 0) {
-				strcpy(buffer_out, doubleToSexa(DEVICE_PRIVATE_DATA->ra, "%02d:%02d:%02.0f#"));
-			} else if (strcmp(buffer_in, "GD") == 0) {
-				strcpy(buffer_out, doubleToSexa(DEVICE_PRIVATE_DATA->dec, "%02d*%02d'%02.0f#"));
-			} else if (strncmp(buffer_in, "Sr", 2) == 0) {
-				int h = 0, m = 0;
-				double s = 0;
-				char c;
-				if (sscanf(buffer_in + 2, "%d%c%d%c%lf", &h, &c, &m, &c, &s) == 5) {
-					MOUNT_EQUATORIAL_COORDINATES_RA_ITEM->number.value = h + m/60.0 + s/3600.0;
-					strcpy(buffer_out, "1");
-				} else if (sscanf(buffer_in + 2, "%d%c%d", &h, &c, &m) == 3) {
-					MOUNT_EQUATORIAL_COORDINATES_RA_ITEM->number.value = h + m/60.0;
-					strcpy(buffer_out, "1");
-				} else {
-					strcpy(buffer_out, "0");
-				}
-			} else if (strncmp(buffer_in, "Sd", 2) == 0) {
-				int d = 0, m = 0;
-				double s = 0;
-				char c;
-				if (sscanf(buffer_in + 2, "%d%c%d%c%lf", &d, &c, &m, &c, &s) == 5) {
-					MOUNT_EQUATORIAL_COORDINATES_DEC_ITEM->number.value = d > 0 ? d + m/60.0 + s/3600.0 : d - m/60.0 - s/3600.0;
-					strcpy(buffer_out, "1");
-				} else if (sscanf(buffer_in + 2, "%d%c%d", &d, &c, &m) == 3) {
-					MOUNT_EQUATORIAL_COORDINATES_DEC_ITEM->number.value = d > 0 ? d + m/60.0 : d - m/60.0;
-					strcpy(buffer_out, "1");
-				} else {
-					strcpy(buffer_out, "0");
+			int length = (int)strlen(response);
+			if (length > 0) {
+				if (out_length + length > sizeof(buffer_out)) {
+					if (!indigo_write(client_socket, buffer_out, out_length)) {
+						failed = true;
+						break;
+					}
+					out_length = 0;
 				}
-			} else if (strncmp(buffer_in, "MS", 2) == 0) {
-				unpark(device);
-				indigo_set_switch(MOUNT_ON_COORDINATES_SET_PROPERTY, MOUNT_ON_COORDINATES_SET_TRACK_ITEM, true);
-				indigo_change_property(DEVICE_PRIVATE_DATA->client, MOUNT_ON_COORDINATES_SET_PROPERTY);
-				indigo_change_property(DEVICE_PRIVATE_DATA->client, MOUNT_EQUATORIAL_COORDINATES_PROPERTY);
-				strcpy(buffer_out, "0");
-			} else if (strncmp(buffer_in, "CM", 2) == 0) {
-				unpark(device);
-				indigo_set_switch(MOUNT_ON_COORDINATES_SET_PROPERTY, MOUNT_ON_COORDINATES_SET_SYNC_ITEM, true);
-				indigo_change_property(DEVICE_PRIVATE_DATA->client, MOUNT_ON_COORDINATES_SET_PROPERTY);
-				indigo_change_property(DEVICE_PRIVATE_DATA->client, MOUNT_EQUATORIAL_COORDINATES_PROPERTY);
-				strcpy(buffer_out, "OK#");
-			} else if (strcmp(buffer_in, "RG") == 0) {
-				indigo_set_switch(MOUNT_SLEW_RATE_PROPERTY, MOUNT_SLEW_RATE_GUIDE_ITEM, true);
-				indigo_change_property(DEVICE_PRIVATE_DATA->client, MOUNT_SLEW_RATE_PROPERTY);
-			} else if (strcmp(buffer_in, "RC") == 0) {
-				indigo_set_switch(MOUNT_SLEW_RATE_PROPERTY, MOUNT_SLEW_RATE_CENTERING_ITEM, true);
-				indigo_change_property(DEVICE_PRIVATE_DATA->client, MOUNT_SLEW_RATE_PROPERTY);
-			} else if (strcmp(buffer_in, "RM") == 0) {
-				indigo_set_switch(MOUNT_SLEW_RATE_PROPERTY, MOUNT_SLEW_RATE_FIND_ITEM, true);
-				indigo_change_property(DEVICE_PRIVATE_DATA->client, MOUNT_SLEW_RATE_PROPERTY);
-			} else if (strcmp(buffer_in, "RS") == 0) {
-				indigo_set_switch(MOUNT_SLEW_RATE_PROPERTY, MOUNT_SLEW_RATE_MAX_ITEM, true);
-				indigo_change_property(DEVICE_PRIVATE_DATA->client, MOUNT_SLEW_RATE_PROPERTY);
-			} else if (strcmp(buffer_in, "Mn") == 0) {
-				unpark(device);
-				indigo_set_switch(MOUNT_MOTION_DEC_PROPERTY, MOUNT_MOTION_NORTH_ITEM, true);
-				indigo_change_property(DEVICE_PRIVATE_DATA->client, MOUNT_MOTION_DEC_PROPERTY);
-			} else if (strcmp(buffer_in, "Qn") == 0) {
-				indigo_set_switch(MOUNT_MOTION_DEC_PROPERTY, MOUNT_MOTION_NORTH_ITEM, false);
-				indigo_change_property(DEVICE_PRIVATE_DATA->client, MOUNT_MOTION_DEC_PROPERTY);
-			} else if (strcmp(buffer_in, "Ms") == 0) {
-				unpark(device);
-				indigo_set_switch(MOUNT_MOTION_DEC_PROPERTY, MOUNT_MOTION_SOUTH_ITEM, true);
-				indigo_change_property(DEVICE_PRIVATE_DATA->client, MOUNT_MOTION_DEC_PROPERTY);
-			} else if (strcmp(buffer_in, "Qs") == 0) {
-				indigo_set_switch(MOUNT_MOTION_DEC_PROPERTY, MOUNT_MOTION_SOUTH_ITEM, false);
-				indigo_change_property(DEVICE_PRIVATE_DATA->client, MOUNT_MOTION_DEC_PROPERTY);
-			} else if (strcmp(buffer_in, "Mw") == 0) {
-				unpark(device);
-				indigo_set_switch(MOUNT_MOTION_RA_PROPERTY, MOUNT_MOTION_WEST_ITEM, true);
-				indigo_change_property(DEVICE_PRIVATE_DATA->client, MOUNT_MOTION_RA_PROPERTY);
-			} else if (strcmp(buffer_in, "Qw") == 0) {
-				indigo_set_switch(MOUNT_MOTION_RA_PROPERTY, MOUNT_MOTION_WEST_ITEM, false);
-				indigo_change_property(DEVICE_PRIVATE_DATA->client, MOUNT_MOTION_RA_PROPERTY);
-			} else if (strcmp(buffer_in, "Me") == 0) {
-				unpark(device);
-				indigo_set_switch(MOUNT_MOTION_RA_PROPERTY, MOUNT_MOTION_EAST_ITEM, true);
-				indigo_change_property(DEVICE_PRIVATE_DATA->client, MOUNT_MOTION_RA_PROPERTY);
-			} else if (strcmp(buffer_in, "Qe") == 0) {
-				indigo_set_switch(MOUNT_MOTION_RA_PROPERTY, MOUNT_MOTION_EAST_ITEM, false);
-				indigo_change_property(DEVICE_PRIVATE_DATA->client, MOUNT_MOTION_RA_PROPERTY);
-			} else if (strcmp(buffer_in, "Q") == 0) {
-				indigo_set_switch(MOUNT_ABORT_MOTION_PROPERTY, MOUNT_ABORT_MOTION_ITEM, true);
-				indigo_change_property(DEVICE_PRIVATE_DATA->client, MOUNT_ABORT_MOTION_PROPERTY);
-			} else if (strncmp(buffer_in, "SC", 2) == 0) {
-				strcpy(buffer_out, "1Updating        planetary data. #                              #");
-			} else if (strncmp(buffer_in, "S", 1) == 0) {
-				strcpy(buffer_out, "1");
-			}
-			if (*buffer_out) {
-				indigo_write(client_socket, buffer_out, strlen(buffer_out));
-				if (*buffer_in == 'G')
-					INDIGO_DRIVER_TRACE(LX200_SERVER_AGENT_NAME, "%d: '%s' -> '%s'", client_socket, buffer_in, buffer_out);
-				else
-					INDIGO_DRIVER_DEBUG(LX200_SERVER_AGENT_NAME, "%d: '%s' -> '%s'", client_socket, buffer_in, buffer_out);
-			} else {
-				INDIGO_DRIVER_DEBUG(LX200_SERVER_AGENT_NAME, "%d: '%s' -> ", client_socket, buffer_in);
+				memcpy(buffer_out + out_length, response, length);
+				out_length += length;
 			}
 		}
+		if (failed || (out_length > 0 && !indigo_write(client_socket, buffer_out, out_length)))
+			break;
 	}
 	INDIGO_DRIVER_TRACE(LX200_SERVER_AGENT_NAME, "%d: DISCONNECTED", client_socket);
 
@@ -520,10 +571,13 @@ static indigo_result agent_update_property(indigo_client *client, indigo_device
 	if (strcmp(device->name, CLIENT_PRIVATE_DATA->lx200_devices_property->items[0].text.value) == 0) {
 		indigo_item *item;
 		if (strcmp(property->name, MOUNT_EQUATORIAL_COORDINATES_PROPERTY_NAME) == 0) {
+			double ra, dec;
+			load_snapshot(CLIENT_PRIVATE_DATA->device, &ra, &dec);
 			if ((item = indigo_get_item(property, MOUNT_EQUATORIAL_COORDINATES_RA_ITEM_NAME)))
-				CLIENT_PRIVATE_DATA->ra = item->number.value;
+				ra = item->number.value;
 			if ((item = indigo_get_item(property, MOUNT_EQUATORIAL_COORDINATES_DEC_ITEM_NAME)))
-				CLIENT_PRIVATE_DATA->dec = item->number.value;
+				dec = item->number.value;
+			store_snapshot(CLIENT_PRIVATE_DATA->device, ra, dec);
 		} else if (strcmp(property->name, MOUNT_PARK_PROPERTY_NAME) == 0) {
 			if ((item = indigo_get_item(property, MOUNT_PARK_UNPARKED_ITEM_NAME)))
 				CLIENT_PRIVATE_DATA->unparked = (property->state == INDIGO_OK_STATE) && item->sw.value;
@@ -592,6 +646,7 @@ indigo_result indigo_agent_lx200_server(indigo_driver_action action, indigo_driv
 			private_data = malloc(sizeof(agent_private_data));
 			assert(private_data != NULL);
 			memset(private_data, 0, sizeof(agent_private_data));
+			pthread_mutex_init(&private_data->snapshot_mutex, NULL);
 			agent_device = malloc(sizeof(indigo_device));
 			assert(agent_device != NULL);
 			private_data->device = agent_device;
@@ -620,6 +675,7 @@ indigo_result indigo_agent_lx200_server(indigo_driver_action action, indigo_driv
 				agent_client = NULL;
 			}
 			if (private_data != NULL) {
+				pthread_mutex_destroy(&private_data->snapshot_mutex);
 				free(private_data);
 				private_data = NULL;
 			}
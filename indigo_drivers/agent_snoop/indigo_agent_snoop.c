@@ -23,10 +23,11 @@
  \file indigo_agent_snoop.c
  */
 
-#define DRIVER_VERSION 0x0001
+#define DRIVER_VERSION 0x0002
 #define DRIVER_NAME	"indigo_agent_snoop"
 
 #include <stdlib.h>
+#include <stdint.h>
 #include <string.h>
 #include <unistd.h>
 #include <math.h>
@@ -53,6 +54,9 @@
 
 #define SNOOP_RULES_PROPERTY										(DEVICE_PRIVATE_DATA->rules_property)
 
+#define RULE_HASH_SIZE													64
+#define RULE_HASH(property)											((((uintptr_t)(property)) >> 4) % RULE_HASH_SIZE)
+
 typedef struct rule {
 	char source_device_name[INDIGO_NAME_SIZE];
 	char source_property_name[INDIGO_NAME_SIZE];
@@ -62,8 +66,15 @@ typedef struct rule {
 	char target_property_name[INDIGO_NAME_SIZE];
 	indigo_device *target_device;
 	indigo_property *target_property;
+	pthread_mutex_t lock;
+	indigo_property *scratch_property;
+	int *item_map;
+	int item_capacity;
+	int item_count;
+	int source_count;
 	indigo_property_state state;
 	struct rule *next;
+	struct rule *next_source;
 } rule;
 
 typedef struct {
@@ -73,10 +84,98 @@ typedef struct {
 	indigo_device *device;
 	indigo_client *client;
 	rule *rules;
+	rule *source_hash[RULE_HASH_SIZE];
 } agent_private_data;
 
 static indigo_result agent_enumerate_properties(indigo_device *device, indigo_client *client, indigo_property *property);
 
+static void hash_rule(agent_private_data *private_data, rule *r) {
+	rule **bucket = private_data->source_hash + RULE_HASH(r->source_property);
+	r->next_source = *bucket;
+	*bucket = r;
+}
+
+static void unhash_rule(agent_private_data *private_data, rule *r) {
+	if (r->source_property == NULL)
+		return;
+	rule **bucket = private_data->source_hash + RULE_HASH(r->source_property);
+	while (*bucket) {
+		if (*bucket == r) {
+			*bucket = r->next_source;
+			break;
+		}
+		bucket = &(*bucket)->next_source;
+	}
+	r->next_source = NULL;
+}
+
+static void release_rule(rule *r) {
+	pthread_mutex_lock(&r->lock);
+	r->item_count = 0;
+	r->source_count = 0;
+	pthread_mutex_unlock(&r->lock);
+}
+
+static void free_rule(rule *r) {
+	pthread_mutex_lock(&r->lock);
+	if (r->scratch_property)
+		free(r->scratch_property);
+	if (r->item_map)
+		free(r->item_map);
+	pthread_mutex_unlock(&r->lock);
+	pthread_mutex_destroy(&r->lock);
+	free(r);
+}
+
+static int map_items(indigo_property *source_property, indigo_property *target_property, int *item_map) {
+	int count = 0;
+	for (int j = 0; j < target_property->count; j++) {
+		for (int i = 0; i < source_property->count; i++) {
+			if (!strcmp(target_property->items[j].name, source_property->items[i].name)) {
+				item_map[count++] = i;
+				break;
+			}
+		}
+	}
+	return count;
+}
+
+// must be called with rule lock held, buffers only grow so forwarding never allocates for a stable target
+static void remap_rule(rule *r) {
+	int capacity = r->target_property->count + 1;
+	if (capacity > r->item_capacity) {
+		r->item_map = realloc(r->item_map, capacity * sizeof(int));
+		assert(r->item_map != NULL);
+		r->scratch_property = realloc(r->scratch_property, sizeof(indigo_property) + capacity * sizeof(indigo_item));
+		assert(r->scratch_property != NULL);
+		r->item_capacity = capacity;
+	}
+	r->item_count = map_items(r->source_property, r->target_property, r->item_map);
+	r->source_count = r->source_property->count;
+}
+
+static void compile_rule(rule *r) {
+	pthread_mutex_lock(&r->lock);
+	remap_rule(r);
+	pthread_mutex_unlock(&r->lock);
+}
+
+static void bind_source(agent_private_data *private_data, rule *r, indigo_device *device, indigo_property *property) {
+	if (r->source_property != property) {
+		unhash_rule(private_data, r);
+		r->source_property = property;
+		hash_rule(private_data, r);
+	}
+	r->source_device = device;
+}
+
+static void unbind_source(agent_private_data *private_data, rule *r) {
+	unhash_rule(private_data, r);
+	release_rule(r);
+	r->source_device = NULL;
+	r->source_property = NULL;
+}
+
 static indigo_result forward_property(indigo_device *device, indigo_client *client, rule *r) {
 	assert(client != NULL);
 	assert(r != NULL);
@@ -97,16 +196,24 @@ static indigo_result forward_property(indigo_device *device, indigo_client *clie
 		if (!any_set)
 			return INDIGO_OK;
 	}
-	int size = sizeof(indigo_property) + source_property->count * sizeof(indigo_item);
-	indigo_property *property = malloc(size);
-	assert(property != NULL);
-	memcpy(property, source_property, size);
+	pthread_mutex_lock(&r->lock);
+	if (r->scratch_property == NULL || r->source_count != source_property->count) {
+		// source redefined with different items since the rule was compiled
+		remap_rule(r);
+	}
+	int count = r->item_count;
+	indigo_property *property = r->scratch_property;
+	memcpy(property, source_property, sizeof(indigo_property));
 	strncpy(property->device, r->target_device_name, INDIGO_NAME_SIZE);
 	strncpy(property->name, r->target_property_name, INDIGO_NAME_SIZE);
+	property->count = count;
+	for (int k = 0; k < count; k++)
+		memcpy(property->items + k, source_property->items + r->item_map[k], sizeof(indigo_item));
 	indigo_trace_property("Property set by rule", property, false, true);
+	// scratch property stays locked until the target is done with it
 	indigo_result result = r->target_device->last_result = r->target_device->change_property(r->target_device, client, property);
+	pthread_mutex_unlock(&r->lock);
 	INDIGO_DRIVER_LOG(DRIVER_NAME, "Forward: '%s'.%s > '%s'.%s", r->source_device_name, r->source_property_name, r->target_device_name, r->target_property_name);
-	free(property);
 	return result;
 }
 
@@ -192,6 +299,8 @@ static indigo_result agent_change_property(indigo_device *device, indigo_client
 		}
 		r = malloc(sizeof(rule));
 		assert(r != NULL);
+		memset(r, 0, sizeof(rule));
+		pthread_mutex_init(&r->lock, NULL);
 		strncpy(r->source_device_name, SNOOP_ADD_RULE_SOURCE_DEVICE_ITEM->text.value, INDIGO_NAME_SIZE);
 		strncpy(r->source_property_name, SNOOP_ADD_RULE_SOURCE_PROPERTY_ITEM->text.value, INDIGO_NAME_SIZE);
 		r->source_device = NULL;
@@ -233,6 +342,8 @@ static indigo_result agent_change_property(indigo_device *device, indigo_client
 				rr->next = r->next;
 			else
 				DEVICE_PRIVATE_DATA->rules = r->next;
+			unbind_source(DEVICE_PRIVATE_DATA, r);
+			free_rule(r);
 			SNOOP_RULES_PROPERTY = indigo_resize_property(SNOOP_RULES_PROPERTY, SNOOP_RULES_PROPERTY->count - 1);
 			sync_rules(device);
 			SNOOP_REMOVE_RULE_PROPERTY->state = INDIGO_OK_STATE;
@@ -265,14 +376,22 @@ static indigo_result agent_define_property(indigo_client *client, indigo_device
 	int index = 0;
 	while (r) {
 		bool changed = false;
+		bool matched = false;
 		if (!strcmp(r->source_device_name, property->device) && !strcmp(r->source_property_name, property->name)) {
 			changed = r->source_device == NULL;
-			r->source_device = device;
-			r->source_property = property;
+			bind_source(CLIENT_PRIVATE_DATA, r, device, property);
+			matched = true;
 		} else if (!strcmp(r->target_device_name, property->device) && !strcmp(r->target_property_name, property->name)) {
 			changed = r->target_device == NULL;
 			r->target_device = device;
 			r->target_property = property;
+			matched = true;
+		}
+		if (matched) {
+			if (r->source_property && r->target_property)
+				compile_rule(r);
+			else
+				release_rule(r);
 		}
 		if (changed) {
 			if (r->source_property && r->target_property) {
@@ -296,19 +415,16 @@ static indigo_result agent_update_property(indigo_client *client, indigo_device
 		return INDIGO_OK;
 	if (property->state == INDIGO_ALERT_STATE)
 		return INDIGO_OK;
-	rule *r = CLIENT_PRIVATE_DATA->rules;
+	indigo_result result = INDIGO_OK;
+	rule *r = CLIENT_PRIVATE_DATA->source_hash[RULE_HASH(property)];
 	while (r) {
-		if (r->source_property == property) {
-			if (r->target_property) {
-				INDIGO_DRIVER_LOG(DRIVER_NAME, "Rule '%s'.%s > '%s'.%s used", r->source_device_name, r->source_property_name, r->target_device_name, r->target_property_name);
-				return forward_property(device, client, r);
-			}
-			break;
-		} else {
-			r = r->next;
+		if (r->source_property == property && r->target_property) {
+			INDIGO_DRIVER_LOG(DRIVER_NAME, "Rule '%s'.%s > '%s'.%s used", r->source_device_name, r->source_property_name, r->target_device_name, r->target_property_name);
+			result = forward_property(device, client, r);
 		}
+		r = r->next_source;
 	}
-	return INDIGO_OK;
+	return result;
 }
 
 static indigo_result agent_delete_property(indigo_client *client, indigo_device *device, indigo_property *property, const char *message) {
@@ -318,8 +434,7 @@ static indigo_result agent_delete_property(indigo_client *client, indigo_device
 	int index = 0;
 	while (r) {
 		if (!strcmp(r->source_device_name, property->device) && !strcmp(r->source_property_name, property->name)) {
-			r->source_device = NULL;
-			r->source_property = NULL;
+			unbind_source(CLIENT_PRIVATE_DATA, r);
 			if (r->target_property) {
 				CLIENT_PRIVATE_DATA->rules_property->items[index].light.value = r->state = INDIGO_BUSY_STATE;
 				indigo_update_property(CLIENT_PRIVATE_DATA->device, CLIENT_PRIVATE_DATA->rules_property, "Rule '%s'.%s > '%s'.%s isn't active", r->source_device_name, r->source_property_name, r->target_device_name, r->target_property_name);
@@ -328,6 +443,7 @@ static indigo_result agent_delete_property(indigo_client *client, indigo_device
 				indigo_update_property(CLIENT_PRIVATE_DATA->device, CLIENT_PRIVATE_DATA->rules_property, NULL);
 			}
 		} else if (!strcmp(r->target_device_name, property->device) && !strcmp(r->target_property_name, property->name)) {
+			release_rule(r);
 			r->target_device = NULL;
 			r->target_property = NULL;
 			if (r->source_property) {
@@ -348,9 +464,11 @@ static indigo_result agent_client_detach(indigo_client *client) {
 	rule *r = CLIENT_PRIVATE_DATA->rules;
 	while (r) {
 		rule *rr = r->next;
-		free(r);
+		free_rule(r);
 		r = rr;
 	}
+	CLIENT_PRIVATE_DATA->rules = NULL;
+	memset(CLIENT_PRIVATE_DATA->source_hash, 0, sizeof(CLIENT_PRIVATE_DATA->source_hash));
 	return INDIGO_OK;
 }
 
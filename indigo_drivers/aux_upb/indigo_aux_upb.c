@@ -23,7 +23,7 @@
  \file indigo_aux_upb.c
  */
 
-#define DRIVER_VERSION 0x0009
+#define DRIVER_VERSION 0x000A
 #define DRIVER_NAME "indigo_aux_upb"
 
 #include <stdlib.h>
@@ -136,11 +136,17 @@
 #define X_AUX_REBOOT_PROPERTY								(PRIVATE_DATA->reboot_property)
 #define X_AUX_REBOOT_ITEM										(X_AUX_REBOOT_PROPERTY->items + 0)
 
+#define X_AUX_PORT_STATISTICS_PROPERTY			(PRIVATE_DATA->port_statistics_property)
+#define X_AUX_PORT_QUEUE_DEPTH_ITEM					(X_AUX_PORT_STATISTICS_PROPERTY->items + 0)
+#define X_AUX_PORT_AVERAGE_LATENCY_ITEM			(X_AUX_PORT_STATISTICS_PROPERTY->items + 1)
+#define X_AUX_PORT_MAX_LATENCY_ITEM					(X_AUX_PORT_STATISTICS_PROPERTY->items + 2)
+#define X_AUX_PORT_MERGED_ITEM							(X_AUX_PORT_STATISTICS_PROPERTY->items + 3)
+
 #define AUX_GROUP															"Powerbox"
 
 typedef struct {
 	int handle;
-	pthread_mutex_t port_mutex;
+	indigo_port *port;
 	indigo_timer *aux_timer;
 	indigo_timer *focuser_timer;
 	indigo_property *outlet_names_property;
@@ -157,27 +163,31 @@ typedef struct {
 	indigo_property *info_property;
 	indigo_property *hub_property;
 	indigo_property *reboot_property;
+	indigo_property *port_statistics_property;
 	int count;
 	libusb_device_handle *smart_hub;
 } upb_private_data;
 
-static bool upb_command(indigo_device *device, char *command, char *response, int max) {
-	pthread_mutex_lock(&PRIVATE_DATA->port_mutex);
-	tcflush(PRIVATE_DATA->handle, TCIOFLUSH);
-	indigo_write(PRIVATE_DATA->handle, command, strlen(command));
-	indigo_write(PRIVATE_DATA->handle, "\n", 1);
-	if (response != NULL) {
-		if (indigo_read_line(PRIVATE_DATA->handle, response, max) == -1) {
-			pthread_mutex_unlock(&PRIVATE_DATA->port_mutex);
-			INDIGO_DRIVER_DEBUG(DRIVER_NAME, "Command %s -> no response", command);
-			return false;
-		}
+#define UPB_TIMEOUT		3000000L
+
+static bool upb_transaction(indigo_device *device, indigo_priority priority, char *command, char *response, int max) {
+	char buffer[128];
+	snprintf(buffer, sizeof(buffer), "%s\n", command);
+	indigo_transaction transaction = { buffer, response, max - 1, '\n', UPB_TIMEOUT, 0 };
+	if (!indigo_port_execute(PRIVATE_DATA->port, priority, &transaction, 1) || (response != NULL && transaction.length <= 0)) {
+		INDIGO_DRIVER_DEBUG(DRIVER_NAME, "Command %s -> no response", command);
+		return false;
 	}
-	pthread_mutex_unlock(&PRIVATE_DATA->port_mutex);
+	if (response != NULL && response[transaction.length - 1] == '\r')
+		response[transaction.length - 1] = 0;
 	INDIGO_DRIVER_DEBUG(DRIVER_NAME, "Command %s -> %s", command, response != NULL ? response : "NULL");
 	return true;
 }
 
+static bool upb_command(indigo_device *device, char *command, char *response, int max) {
+	return upb_transaction(device, INDIGO_PRIORITY_MOVE, command, response, max);
+}
+
 // -------------------------------------------------------------------------------- INDIGO aux device implementation
 
 static void aux_timer_callback(indigo_device *device) {
@@ -193,7 +203,7 @@ static void aux_timer_callback(indigo_device *device) {
 	bool updateAutoHeater = false;
 	bool updateHub = false;
 	bool updateUSBPorts = false;
-	if (upb_command(device, "PA", response, sizeof(response))) {
+	if (upb_transaction(device, INDIGO_PRIORITY_STATUS, "PA", response, sizeof(response))) {
 		char *token = strtok(response, ":");
 		if ((token = strtok(NULL, ":"))) { // Voltage
 			double value = atof(token);
@@ -362,7 +372,7 @@ static void aux_timer_callback(indigo_device *device) {
 			}
 		}
 	}
-	if (upb_command(device, "PC", response, sizeof(response))) {
+	if (upb_transaction(device, INDIGO_PRIORITY_STATUS, "PC", response, sizeof(response))) {
 		char *token = strtok(response, ":");
 		if (token) {
 			double value = atof(token);
@@ -461,6 +471,13 @@ static void aux_timer_callback(indigo_device *device) {
 		AUX_USB_PORT_STATE_PROPERTY->state = INDIGO_OK_STATE;
 		indigo_update_property(device, AUX_USB_PORT_STATE_PROPERTY, NULL);
 	}
+	indigo_port_statistics statistics;
+	indigo_port_get_statistics(PRIVATE_DATA->port, &statistics);
+	X_AUX_PORT_QUEUE_DEPTH_ITEM->number.value = statistics.queue_depth;
+	X_AUX_PORT_AVERAGE_LATENCY_ITEM->number.value = round(statistics.average_latency * 1000);
+	X_AUX_PORT_MAX_LATENCY_ITEM->number.value = round(statistics.max_latency * 1000);
+	X_AUX_PORT_MERGED_ITEM->number.value = statistics.merged;
+	indigo_update_property(device, X_AUX_PORT_STATISTICS_PROPERTY, NULL);
 	indigo_reschedule_timer(device, 2, &PRIVATE_DATA->aux_timer);
 }
 
@@ -578,6 +595,13 @@ static indigo_result aux_attach(indigo_device *device) {
 		if (X_AUX_REBOOT_PROPERTY == NULL)
 			return INDIGO_FAILED;
 		indigo_init_switch_item(X_AUX_REBOOT_ITEM, "REBOOT", "Reboot", false);
+		X_AUX_PORT_STATISTICS_PROPERTY = indigo_init_number_property(NULL, device->name, "X_AUX_PORT_STATISTICS", AUX_GROUP, "Port statistics", INDIGO_OK_STATE, INDIGO_RO_PERM, 4);
+		if (X_AUX_PORT_STATISTICS_PROPERTY == NULL)
+			return INDIGO_FAILED;
+		indigo_init_number_item(X_AUX_PORT_QUEUE_DEPTH_ITEM, "QUEUE_DEPTH", "Queue depth", 0, 100, 0, 0);
+		indigo_init_number_item(X_AUX_PORT_AVERAGE_LATENCY_ITEM, "AVERAGE_LATENCY", "Average latency [ms]", 0, 100000, 0, 0);
+		indigo_init_number_item(X_AUX_PORT_MAX_LATENCY_ITEM, "MAX_LATENCY", "Max latency [ms]", 0, 100000, 0, 0);
+		indigo_init_number_item(X_AUX_PORT_MERGED_ITEM, "MERGED", "Merged polls", 0, 1000000000, 0, 0);
 		// -------------------------------------------------------------------------------- DEVICE_PORT, DEVICE_PORTS
 		DEVICE_PORT_PROPERTY->hidden = false;
 		DEVICE_PORTS_PROPERTY->hidden = false;
@@ -593,7 +617,6 @@ static indigo_result aux_attach(indigo_device *device) {
 		strcpy(DEVICE_PORT_ITEM->text.value, "/dev/ttyUPB");
 #endif
 		// --------------------------------------------------------------------------------
-		pthread_mutex_init(&PRIVATE_DATA->port_mutex, NULL);
 		INDIGO_DEVICE_ATTACH_LOG(DRIVER_NAME, device->name);
 		return aux_enumerate_properties(device, NULL, NULL);
 	}
@@ -628,6 +651,8 @@ static indigo_result aux_enumerate_properties(indigo_device *device, indigo_clie
 			indigo_define_property(device, X_AUX_HUB_PROPERTY, NULL);
 		if (indigo_property_match(X_AUX_REBOOT_PROPERTY, property))
 			indigo_define_property(device, X_AUX_REBOOT_PROPERTY, NULL);
+		if (indigo_property_match(X_AUX_PORT_STATISTICS_PROPERTY, property))
+			indigo_define_property(device, X_AUX_PORT_STATISTICS_PROPERTY, NULL);
 	}
 	if (indigo_property_match(AUX_OUTLET_NAMES_PROPERTY, property))
 		indigo_define_property(device, AUX_OUTLET_NAMES_PROPERTY, NULL);
@@ -648,11 +673,13 @@ static indigo_result aux_change_property(indigo_device *device, indigo_client *c
 			if (PRIVATE_DATA->count++ == 0) {
 				PRIVATE_DATA->handle = indigo_open_serial(DEVICE_PORT_ITEM->text.value);
 				if (PRIVATE_DATA->handle > 0) {
+					PRIVATE_DATA->port = indigo_port_open(PRIVATE_DATA->handle);
 					if (upb_command(device, "P#", response, sizeof(response)) && !strcmp(response, "UPB_OK")) {
 						INDIGO_DRIVER_LOG(DRIVER_NAME, "Connected to %s", DEVICE_PORT_ITEM->text.value);
 					} else {
 						INDIGO_DRIVER_ERROR(DRIVER_NAME, "UPB not detected");
-						close(PRIVATE_DATA->handle);
+						indigo_port_close(PRIVATE_DATA->port);
+						PRIVATE_DATA->port = NULL;
 						PRIVATE_DATA->handle = 0;
 					}
 				}
@@ -723,12 +750,14 @@ static indigo_result aux_change_property(indigo_device *device, indigo_client *c
 						indigo_set_switch(AUX_DEW_CONTROL_PROPERTY, atoi(token) == 1 ? AUX_DEW_CONTROL_AUTOMATIC_ITEM : AUX_DEW_CONTROL_MANUAL_ITEM, true);
 					} else {
 						INDIGO_DRIVER_ERROR(DRIVER_NAME, "Failed to parse 'SA' response");
-						close(PRIVATE_DATA->handle);
+						indigo_port_close(PRIVATE_DATA->port);
+						PRIVATE_DATA->port = NULL;
 						PRIVATE_DATA->handle = 0;
 					}
 				} else {
 					INDIGO_DRIVER_ERROR(DRIVER_NAME, "Failed to read 'SA' response");
-					close(PRIVATE_DATA->handle);
+					indigo_port_close(PRIVATE_DATA->port);
+					PRIVATE_DATA->port = NULL;
 					PRIVATE_DATA->handle = 0;
 				}
 			}
@@ -751,6 +780,7 @@ static indigo_result aux_change_property(indigo_device *device, indigo_client *c
 				indigo_set_switch(X_AUX_HUB_PROPERTY, X_AUX_HUB_ENABLED_ITEM, true);
 				indigo_define_property(device, X_AUX_HUB_PROPERTY, NULL);
 				indigo_define_property(device, X_AUX_REBOOT_PROPERTY, NULL);
+				indigo_define_property(device, X_AUX_PORT_STATISTICS_PROPERTY, NULL);
 				
 				libusb_context *ctx = NULL;
 				libusb_device **usb_devices;
@@ -830,6 +860,7 @@ static indigo_result aux_change_property(indigo_device *device, indigo_client *c
 			indigo_delete_property(device, AUX_INFO_PROPERTY, NULL);
 			indigo_delete_property(device, X_AUX_HUB_PROPERTY, NULL);
 			indigo_delete_property(device, X_AUX_REBOOT_PROPERTY, NULL);
+			indigo_delete_property(device, X_AUX_PORT_STATISTICS_PROPERTY, NULL);
 			strcpy(INFO_DEVICE_MODEL_ITEM->text.value, "Unknown");
 			strcpy(INFO_DEVICE_FW_REVISION_ITEM->text.value, "Unknown");
 			indigo_update_property(device, INFO_PROPERTY, NULL);
@@ -841,7 +872,8 @@ static indigo_result aux_change_property(indigo_device *device, indigo_client *c
 				if (PRIVATE_DATA->handle > 0) {
 					upb_command(device, "PL:0", response, sizeof(response));
 					INDIGO_DRIVER_LOG(DRIVER_NAME, "Disconnected");
-					close(PRIVATE_DATA->handle);
+					indigo_port_close(PRIVATE_DATA->port);
+					PRIVATE_DATA->port = NULL;
 					PRIVATE_DATA->handle = 0;
 				}
 			}
@@ -1018,6 +1050,7 @@ static indigo_result aux_detach(indigo_device *device) {
 	indigo_release_property(AUX_INFO_PROPERTY);
 	indigo_release_property(X_AUX_HUB_PROPERTY);
 	indigo_release_property(X_AUX_REBOOT_PROPERTY);
+	indigo_release_property(X_AUX_PORT_STATISTICS_PROPERTY);
 	indigo_release_property(AUX_OUTLET_NAMES_PROPERTY);
 	INDIGO_DEVICE_DETACH_LOG(DRIVER_NAME, device->name);
 	return indigo_aux_detach(device);
@@ -1027,7 +1060,7 @@ static indigo_result aux_detach(indigo_device *device) {
 
 static void focuser_timer_callback(indigo_device *device) {
 	char response[128];
-	if (upb_command(device, "ST", response, sizeof(response))) {
+	if (upb_transaction(device, INDIGO_PRIORITY_STATUS, "ST", response, sizeof(response))) {
 		double temp = atof(response);
 		if (FOCUSER_TEMPERATURE_ITEM->number.value != temp) {
 			FOCUSER_TEMPERATURE_ITEM->number.value = temp;
@@ -1036,14 +1069,14 @@ static void focuser_timer_callback(indigo_device *device) {
 		}
 	}
 	bool update = false;
-	if (upb_command(device, "SP", response, sizeof(response))) {
+	if (upb_transaction(device, INDIGO_PRIORITY_STATUS, "SP", response, sizeof(response))) {
 		int pos = atoi(response);
 		if (FOCUSER_POSITION_ITEM->number.value != pos) {
 			FOCUSER_POSITION_ITEM->number.value = pos;
 			update = true;
 		}
 	}
-	if (upb_command(device, "SI", response, sizeof(response))) {
+	if (upb_transaction(device, INDIGO_PRIORITY_STATUS, "SI", response, sizeof(response))) {
 		if (*response == '0') {
 			if (FOCUSER_POSITION_PROPERTY->state != INDIGO_OK_STATE) {
 				FOCUSER_STEPS_PROPERTY->state = INDIGO_OK_STATE;
@@ -1110,7 +1143,6 @@ static indigo_result focuser_attach(indigo_device *device) {
 		FOCUSER_POSITION_ITEM->number.max = 9999999;
 		FOCUSER_POSITION_ITEM->number.step = 1;
 		// --------------------------------------------------------------------------------
-		pthread_mutex_init(&PRIVATE_DATA->port_mutex, NULL);
 		INDIGO_DEVICE_ATTACH_LOG(DRIVER_NAME, device->name);
 		return indigo_focuser_enumerate_properties(device, NULL, NULL);
 	}
@@ -1135,11 +1167,13 @@ static indigo_result focuser_change_property(indigo_device *device, indigo_clien
 			if (PRIVATE_DATA->count++ == 0) {
 				PRIVATE_DATA->handle = indigo_open_serial(DEVICE_PORT_ITEM->text.value);
 				if (PRIVATE_DATA->handle > 0) {
+					PRIVATE_DATA->port = indigo_port_open(PRIVATE_DATA->handle);
 					if (upb_command(device, "P#", response, sizeof(response)) && !strcmp(response, "UPB_OK")) {
 						INDIGO_DRIVER_LOG(DRIVER_NAME, "Connected to %s", DEVICE_PORT_ITEM->text.value);
 					} else {
 						INDIGO_DRIVER_ERROR(DRIVER_NAME, "UPB not detected");
-						close(PRIVATE_DATA->handle);
+						indigo_port_close(PRIVATE_DATA->port);
+						PRIVATE_DATA->port = NULL;
 						PRIVATE_DATA->handle = 0;
 					}
 				}
@@ -1160,12 +1194,14 @@ static indigo_result focuser_change_property(indigo_device *device, indigo_clien
 						FOCUSER_BACKLASH_ITEM->number.value = FOCUSER_BACKLASH_ITEM->number.target = atoi(token);
 					} else {
 						INDIGO_DRIVER_ERROR(DRIVER_NAME, "Failed to parse 'SA' response");
-						close(PRIVATE_DATA->handle);
+						indigo_port_close(PRIVATE_DATA->port);
+						PRIVATE_DATA->port = NULL;
 						PRIVATE_DATA->handle = 0;
 					}
 				} else {
 					INDIGO_DRIVER_ERROR(DRIVER_NAME, "Failed to read 'SA' response");
-					close(PRIVATE_DATA->handle);
+					indigo_port_close(PRIVATE_DATA->port);
+					PRIVATE_DATA->port = NULL;
 					PRIVATE_DATA->handle = 0;
 				}
 			}
@@ -1193,7 +1229,8 @@ static indigo_result focuser_change_property(indigo_device *device, indigo_clien
 				if (PRIVATE_DATA->handle > 0) {
 					upb_command(device, "PL:0", response, sizeof(response));
 					INDIGO_DRIVER_LOG(DRIVER_NAME, "Disconnected");
-					close(PRIVATE_DATA->handle);
+					indigo_port_close(PRIVATE_DATA->port);
+					PRIVATE_DATA->port = NULL;
 					PRIVATE_DATA->handle = 0;
 				}
 			}
@@ -1255,7 +1292,7 @@ static indigo_result focuser_change_property(indigo_device *device, indigo_clien
 		indigo_property_copy_values(FOCUSER_ABORT_MOTION_PROPERTY, property, false);
 		if (FOCUSER_ABORT_MOTION_ITEM->sw.value) {
 			FOCUSER_ABORT_MOTION_ITEM->sw.value = false;
-			if (upb_command(device, "SH", response, sizeof(response))) {
+			if (upb_transaction(device, INDIGO_PRIORITY_ABORT, "SH", response, sizeof(response))) {
 				FOCUSER_ABORT_MOTION_PROPERTY->state = INDIGO_OK_STATE;
 				FOCUSER_POSITION_PROPERTY->state = INDIGO_ALERT_STATE;
 				FOCUSER_STEPS_PROPERTY->state = INDIGO_ALERT_STATE;
@@ -23,7 +23,7 @@
  \file indigo_ccd_simulator.c
  */
 
-#define DRIVER_VERSION 0x0005
+#define DRIVER_VERSION 0x0006
 #define DRIVER_NAME	"indigo_ccd_simulator"
 
 #include <stdlib.h>
@@ -31,6 +31,7 @@
 #include <unistd.h>
 #include <math.h>
 #include <assert.h>
+#include <stdint.h>
 #include <pthread.h>
 
 #include "indigo_driver_xml.h"
@@ -44,6 +45,8 @@
 #define ECLIPSE							360
 #define SIN									0.8414709848078965
 #define COS									0.5403023058681398
+#define MAX_PIXELS					100000000
+#define MAX_RENDER_THREADS	16
 
 // gp_bits is used as boolean
 #define is_connected                     gp_bits
@@ -61,6 +64,10 @@
 #define GUIDER_MODE_SUN_ITEM				(GUIDER_MODE_PROPERTY->items + 1)
 #define GUIDER_MODE_ECLIPSE_ITEM		(GUIDER_MODE_PROPERTY->items + 2)
 
+#define IMAGER_RESOLUTION_PROPERTY				PRIVATE_DATA->imager_resolution_property
+#define IMAGER_RESOLUTION_WIDTH_ITEM			(IMAGER_RESOLUTION_PROPERTY->items + 0)
+#define IMAGER_RESOLUTION_HEIGHT_ITEM			(IMAGER_RESOLUTION_PROPERTY->items + 1)
+
 extern unsigned short indigo_ccd_simulator_raw_image[];
 extern unsigned char indigo_ccd_simulator_rgb_image[];
 
@@ -73,9 +80,10 @@ typedef struct {
 	indigo_property *dslr_compression_property;
 	indigo_property *dslr_iso_property;
 	indigo_property *guider_mode_property;
+	indigo_property *imager_resolution_property;
 
 	int star_x[STARS], star_y[STARS], star_a[STARS];
-	char imager_image[FITS_HEADER_SIZE + 3 * WIDTH * HEIGHT + 2880];
+	char *imager_image;
 	char guider_image[FITS_HEADER_SIZE + 3 * WIDTH * HEIGHT + 2880];
 	char dslr_image[FITS_HEADER_SIZE + 3 * WIDTH * HEIGHT + 2880];
 	pthread_mutex_t image_mutex;
@@ -86,8 +94,26 @@ typedef struct {
 	double ra_offset, dec_offset;
 	int eclipse;
 	double guide_rate;
+	unsigned short *blur_buffer;
+	int blur_buffer_size;
+	unsigned short transfer_lut[65536];
+	int lut_gain, lut_offset;
+	double lut_gamma;
+	bool lut_valid;
+	uint32_t frame_seed;
 } simulator_private_data;
 
+typedef struct {
+	simulator_private_data *private_data;
+	unsigned short *raw;
+	const unsigned short *source;
+	int first_row, last_row;
+	int frame_left, frame_top, frame_width;
+	int horizontal_bin, vertical_bin;
+	bool fill, transfer;
+	uint32_t seed;
+} render_task;
+
 // -------------------------------------------------------------------------------- INDIGO CCD device implementation
 
 // gausian blur algorithm is based on the paper http://blog.ivank.net/fastest-gaussian-blur.html by Ivan Kuckir
@@ -167,6 +193,105 @@ static void gauss_blur(unsigned short *scl, unsigned short *tcl, int w, int h, d
 	box_blur(scl, tcl, w, h, (sizes[2] - 1) / 2);
 }
 
+// xorshift32 is good enough for sensor noise and much cheaper than rand(), single call yields noise for 4 pixels
+
+static inline uint32_t xorshift32(uint32_t *state) {
+	uint32_t x = *state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	return *state = x;
+}
+
+static void update_transfer_lut(simulator_private_data *private_data, int gain, int offset, double gamma) {
+	if (private_data->lut_valid && private_data->lut_gain == gain && private_data->lut_offset == offset && private_data->lut_gamma == gamma)
+		return;
+	for (int i = 0; i < 65536; i++) {
+		double value = i - offset;
+		if (value < 0)
+			value = 0;
+		value = gain * pow(value, gamma);
+		if (value > 65535)
+			value = 65535;
+		private_data->transfer_lut[i] = (unsigned short)value;
+	}
+	private_data->lut_gain = gain;
+	private_data->lut_offset = offset;
+	private_data->lut_gamma = gamma;
+	private_data->lut_valid = true;
+}
+
+static void *render_worker(void *data) {
+	render_task *task = data;
+	uint32_t state = task->seed ? task->seed : 1;
+	int frame_width = task->frame_width;
+	int horizontal_bin = task->horizontal_bin;
+	const unsigned short *lut = task->private_data->transfer_lut;
+	for (int j = task->first_row; j < task->last_row; j++) {
+		unsigned short *row = task->raw + (size_t)j * frame_width;
+		if (task->fill) {
+			uint32_t noise = 0;
+			if (task->source) {
+				const unsigned short *source_row = task->source + (size_t)(((task->frame_top + j) * task->vertical_bin) % HEIGHT) * WIDTH;
+				int x = (task->frame_left * horizontal_bin) % WIDTH;
+				for (int i = 0; i < frame_width; i++) {
+					if ((i & 3) == 0)
+						noise = xorshift32(&state);
+					row[i] = source_row[x] + (noise & 0x7F);
+					noise >>= 8;
+					x += horizontal_bin;
+					if (x >= WIDTH)
+						x -= WIDTH;
+				}
+			} else {
+				for (int i = 0; i < frame_width; i++) {
+					if ((i & 3) == 0)
+						noise = xorshift32(&state);
+					row[i] = noise & 0x7F;
+					noise >>= 8;
+				}
+			}
+		}
+		if (task->transfer) {
+			for (int i = 0; i < frame_width; i++)
+				row[i] = lut[row[i]];
+		}
+	}
+	return NULL;
+}
+
+static void render_frame(render_task *frame, int frame_height) {
+	static int cpu_count = 0;
+	if (cpu_count == 0) {
+		long count = sysconf(_SC_NPROCESSORS_ONLN);
+		cpu_count = count < 1 ? 1 : count > MAX_RENDER_THREADS ? MAX_RENDER_THREADS : (int)count;
+	}
+	int thread_count = (int)(((long)frame->frame_width * frame_height) >> 18);
+	if (thread_count > cpu_count)
+		thread_count = cpu_count;
+	if (thread_count < 1)
+		thread_count = 1;
+	render_task tasks[MAX_RENDER_THREADS];
+	pthread_t threads[MAX_RENDER_THREADS];
+	bool started[MAX_RENDER_THREADS];
+	int rows = (frame_height + thread_count - 1) / thread_count;
+	for (int i = 0; i < thread_count; i++) {
+		tasks[i] = *frame;
+		tasks[i].first_row = i * rows;
+		tasks[i].last_row = (i + 1) * rows < frame_height ? (i + 1) * rows : frame_height;
+		tasks[i].seed = frame->seed + i * 0x9E3779B9;
+	}
+	for (int i = 1; i < thread_count; i++)
+		started[i] = pthread_create(&threads[i], NULL, render_worker, &tasks[i]) == 0;
+	render_worker(&tasks[0]);
+	for (int i = 1; i < thread_count; i++) {
+		if (started[i])
+			pthread_join(threads[i], NULL);
+		else
+			render_worker(&tasks[i]);
+	}
+}
+
 static void exposure_timer_callback(indigo_device *device) {
 	pthread_mutex_lock(&PRIVATE_DATA->image_mutex);
 	if (CCD_EXPOSURE_PROPERTY->state == INDIGO_BUSY_STATE) {
@@ -176,12 +301,19 @@ static void exposure_timer_callback(indigo_device *device) {
 		if (device == PRIVATE_DATA->dslr) {
 			unsigned char *raw = (unsigned char *)(private_data->dslr_image+FITS_HEADER_SIZE);
 			int size = WIDTH * HEIGHT * 3;
+			uint32_t state = private_data->frame_seed = private_data->frame_seed * 1664525 + 1013904223;
+			uint32_t noise = 0;
+			if (state == 0)
+				state = 1;
 			for (int i = 0; i < size; i++) {
 				int rgb = indigo_ccd_simulator_rgb_image[i];
+				if ((i & 7) == 0)
+					noise = xorshift32(&state);
 				if (rgb < 0xF0)
-					raw[i] = rgb  + (rand() & 0x0F);
+					raw[i] = rgb  + (noise & 0x0F);
 				else
 					raw[i] = rgb;
+				noise >>= 4;
 			}
 			indigo_process_image(device, private_data->dslr_image, WIDTH, HEIGHT, 24, true, true, NULL);
 		} else {
@@ -197,18 +329,15 @@ static void exposure_timer_callback(indigo_device *device) {
 			int offset = (int)CCD_OFFSET_ITEM->number.value;
 			double gamma = CCD_GAMMA_ITEM->number.value;
 			bool light_frame = CCD_FRAME_TYPE_LIGHT_ITEM->sw.value || CCD_FRAME_TYPE_FLAT_ITEM->sw.value;
-
-			if (device == PRIVATE_DATA->imager && light_frame) {
-				for (int j = 0; j < frame_height; j++) {
-					int jj = (frame_top + j) * vertical_bin;
-					for (int i = 0; i < frame_width; i++) {
-						raw[j * frame_width + i] = indigo_ccd_simulator_raw_image[jj * WIDTH + (frame_left + i) * horizontal_bin] + (rand() & 0x7F);
-					}
-				}
-			} else {
-				for (int i = 0; i < size; i++)
-					raw[i] = (rand() & 0x7F);
-			}
+			update_transfer_lut(private_data, gain, offset, gamma);
+			render_task frame = { private_data, raw, NULL, 0, 0, frame_left, frame_top, frame_width, horizontal_bin, vertical_bin, true, true, 0 };
+			frame.seed = private_data->frame_seed = private_data->frame_seed * 1664525 + 1013904223;
+			if (device == PRIVATE_DATA->imager && light_frame)
+				frame.source = indigo_ccd_simulator_raw_image;
+			// stars are rendered over the noise, so transfer curve is applied in separate pass for guider light frames
+			if (device == PRIVATE_DATA->guider && light_frame)
+				frame.transfer = false;
+			render_frame(&frame, frame_height);
 
 			if (device == PRIVATE_DATA->guider && light_frame) {
 				double x_offset = PRIVATE_DATA->ra_offset * COS - PRIVATE_DATA->dec_offset * SIN + rand() / (double)RAND_MAX/10 - 0.1;
@@ -276,21 +405,20 @@ static void exposure_timer_callback(indigo_device *device) {
 					}
 
 				}
-			}
-			for (int i = 0; i < size; i++) {
-				double value = raw[i] - offset;
-				if (value < 0)
-					value = 0;
-				value = gain * pow(value, gamma);
-				if (value > 65535)
-					value = 65535;
-				raw[i] = (unsigned short)value;
+				frame.fill = false;
+				frame.transfer = true;
+				render_frame(&frame, frame_height);
 			}
 			if (private_data->current_position != 0) {
-				unsigned short *tmp = malloc(2 * size);
-				gauss_blur(raw, tmp, frame_width, frame_height, private_data->current_position);
-				memcpy(raw, tmp, 2 * size);
-				free(tmp);
+				if (private_data->blur_buffer_size < size) {
+					free(private_data->blur_buffer);
+					private_data->blur_buffer = malloc(2 * (size_t)size);
+					private_data->blur_buffer_size = private_data->blur_buffer ? size : 0;
+				}
+				if (private_data->blur_buffer) {
+					gauss_blur(raw, private_data->blur_buffer, frame_width, frame_height, private_data->current_position);
+					memcpy(raw, private_data->blur_buffer, 2 * (size_t)size);
+				}
 			}
 			indigo_process_image(device, device == PRIVATE_DATA->guider ? private_data->guider_image : private_data->imager_image, frame_width, frame_height, 16, true, true, NULL);
 		}
@@ -343,6 +471,27 @@ static void ccd_temperature_callback(indigo_device *device) {
 	indigo_reschedule_timer(device, TEMP_UPDATE, &PRIVATE_DATA->temperature_timer);
 }
 
+static bool set_imager_resolution(indigo_device *device) {
+	int width = (int)IMAGER_RESOLUTION_WIDTH_ITEM->number.value;
+	int height = (int)IMAGER_RESOLUTION_HEIGHT_ITEM->number.value;
+	if ((long)width * height > MAX_PIXELS)
+		return false;
+	pthread_mutex_lock(&PRIVATE_DATA->image_mutex);
+	char *image = realloc(PRIVATE_DATA->imager_image, FITS_HEADER_SIZE + 2 * (size_t)width * height + 2880);
+	if (image != NULL)
+		PRIVATE_DATA->imager_image = image;
+	pthread_mutex_unlock(&PRIVATE_DATA->image_mutex);
+	if (image == NULL)
+		return false;
+	CCD_INFO_WIDTH_ITEM->number.value = CCD_FRAME_WIDTH_ITEM->number.max = CCD_FRAME_LEFT_ITEM->number.max = CCD_FRAME_WIDTH_ITEM->number.value = width;
+	CCD_INFO_HEIGHT_ITEM->number.value = CCD_FRAME_HEIGHT_ITEM->number.max = CCD_FRAME_TOP_ITEM->number.max = CCD_FRAME_HEIGHT_ITEM->number.value = height;
+	CCD_FRAME_LEFT_ITEM->number.value = CCD_FRAME_TOP_ITEM->number.value = 0;
+	sprintf(CCD_MODE_ITEM->label, "RAW %dx%d", width, height);
+	sprintf((CCD_MODE_ITEM+1)->label, "RAW %dx%d", width/2, height/2);
+	sprintf((CCD_MODE_ITEM+2)->label, "RAW %dx%d", width/4, height/4);
+	return true;
+}
+
 static indigo_result ccd_enumerate_properties(indigo_device *device, indigo_client *client, indigo_property *property);
 
 static indigo_result ccd_attach(indigo_device *device) {
@@ -423,6 +572,15 @@ static indigo_result ccd_attach(indigo_device *device) {
 			CCD_INFO_PIXEL_WIDTH_ITEM->number.value = 5.2;
 			CCD_INFO_PIXEL_HEIGHT_ITEM->number.value = 5.2;
 			CCD_INFO_BITS_PER_PIXEL_ITEM->number.value = 16;
+			if (device == PRIVATE_DATA->imager) {
+				IMAGER_RESOLUTION_PROPERTY = indigo_init_number_property(NULL, device->name, "IMAGER_RESOLUTION", MAIN_GROUP, "Simulated resolution", INDIGO_OK_STATE, INDIGO_RW_PERM, 2);
+				if (IMAGER_RESOLUTION_PROPERTY == NULL)
+					return INDIGO_FAILED;
+				indigo_init_number_item(IMAGER_RESOLUTION_WIDTH_ITEM, "WIDTH", "Width", 64, 20000, 1, WIDTH);
+				indigo_init_number_item(IMAGER_RESOLUTION_HEIGHT_ITEM, "HEIGHT", "Height", 64, 20000, 1, HEIGHT);
+				if (!set_imager_resolution(device))
+					return INDIGO_FAILED;
+			}
 			// -------------------------------------------------------------------------------- CCD_GAIN, CCD_OFFSET, CCD_GAMMA
 			CCD_GAIN_PROPERTY->hidden = CCD_OFFSET_PROPERTY->hidden = CCD_GAMMA_PROPERTY->hidden = false;
 			// -------------------------------------------------------------------------------- CCD_IMAGE
@@ -473,6 +631,10 @@ indigo_result ccd_enumerate_properties(indigo_device *device, indigo_client *cli
 			if (indigo_property_match(GUIDER_MODE_PROPERTY, property))
 				indigo_define_property(device, GUIDER_MODE_PROPERTY, NULL);
 		}
+		if (device == PRIVATE_DATA->imager) {
+			if (indigo_property_match(IMAGER_RESOLUTION_PROPERTY, property))
+				indigo_define_property(device, IMAGER_RESOLUTION_PROPERTY, NULL);
+		}
 	}
 	return result;
 }
@@ -528,6 +690,34 @@ static indigo_result ccd_change_property(indigo_device *device, indigo_client *c
 		CCD_EXPOSURE_PROPERTY->state = INDIGO_BUSY_STATE;
 		indigo_update_property(device, CCD_EXPOSURE_PROPERTY, NULL);
 		PRIVATE_DATA->exposure_timer = indigo_set_timer(device, CCD_EXPOSURE_ITEM->number.value > 0 ? CCD_EXPOSURE_ITEM->number.value : 0.1, exposure_timer_callback);
+	} else if (device == PRIVATE_DATA->imager && indigo_property_match(IMAGER_RESOLUTION_PROPERTY, property)) {
+		// -------------------------------------------------------------------------------- IMAGER_RESOLUTION
+		if (CCD_EXPOSURE_PROPERTY->state == INDIGO_BUSY_STATE) {
+			IMAGER_RESOLUTION_PROPERTY->state = INDIGO_ALERT_STATE;
+			indigo_update_property(device, IMAGER_RESOLUTION_PROPERTY, "Resolution can't be changed during exposure");
+			return INDIGO_OK;
+		}
+		double width = IMAGER_RESOLUTION_WIDTH_ITEM->number.value;
+		double height = IMAGER_RESOLUTION_HEIGHT_ITEM->number.value;
+		indigo_property_copy_values(IMAGER_RESOLUTION_PROPERTY, property, false);
+		if (!set_imager_resolution(device)) {
+			IMAGER_RESOLUTION_WIDTH_ITEM->number.value = width;
+			IMAGER_RESOLUTION_HEIGHT_ITEM->number.value = height;
+			IMAGER_RESOLUTION_PROPERTY->state = INDIGO_ALERT_STATE;
+			indigo_update_property(device, IMAGER_RESOLUTION_PROPERTY, "Resolution is limited to %d pixels", MAX_PIXELS);
+			return INDIGO_OK;
+		}
+		if (IS_CONNECTED) {
+			indigo_delete_property(device, CCD_INFO_PROPERTY, NULL);
+			indigo_define_property(device, CCD_INFO_PROPERTY, NULL);
+			indigo_delete_property(device, CCD_FRAME_PROPERTY, NULL);
+			indigo_define_property(device, CCD_FRAME_PROPERTY, NULL);
+			indigo_delete_property(device, CCD_MODE_PROPERTY, NULL);
+			indigo_define_property(device, CCD_MODE_PROPERTY, NULL);
+		}
+		IMAGER_RESOLUTION_PROPERTY->state = INDIGO_OK_STATE;
+		indigo_update_property(device, IMAGER_RESOLUTION_PROPERTY, NULL);
+		return INDIGO_OK;
 	} else if (indigo_property_match(CCD_ABORT_EXPOSURE_PROPERTY, property)) {
 		// -------------------------------------------------------------------------------- CCD_ABORT_EXPOSURE
 		indigo_property_copy_values(CCD_ABORT_EXPOSURE_PROPERTY, property, false);
@@ -617,6 +807,8 @@ static indigo_result ccd_detach(indigo_device *device) {
 		indigo_release_property(DSLR_ISO_PROPERTY);
 	} else if (device == PRIVATE_DATA->guider) {
 		indigo_release_property(GUIDER_MODE_PROPERTY);
+	} else if (device == PRIVATE_DATA->imager) {
+		indigo_release_property(IMAGER_RESOLUTION_PROPERTY);
 	}
 	INDIGO_DEVICE_DETACH_LOG(DRIVER_NAME, device->name);
 	return indigo_ccd_detach(device);
@@ -1051,6 +1243,8 @@ indigo_result indigo_ccd_simulator(indigo_driver_action action, indigo_driver_in
 			}
 			if (private_data != NULL) {
 				pthread_mutex_destroy(&private_data->image_mutex);
+				free(private_data->imager_image);
+				free(private_data->blur_buffer);
 				free(private_data);
 				private_data = NULL;
 			}
@@ -23,7 +23,7 @@
  \file indigo_ccd_sx.c
  */
 
-#define DRIVER_VERSION 0x0006
+#define DRIVER_VERSION 0x0007
 #define DRIVER_NAME "indigo_ccd_sx"
 
 #include <stdlib.h>
@@ -136,7 +136,8 @@
 #define BULK_COMMAND_TIMEOUT          2000
 #define BULK_DATA_TIMEOUT             10000
 
-#define CHUNK_SIZE                    (4*1024*1024)
+#define CHUNK_SIZE                    (256*1024)
+#define CHUNK_COUNT                   8
 
 #define PRIVATE_DATA        ((sx_private_data *)device->private_data)
 
@@ -400,21 +401,10 @@ static bool sx_clear_regs(indigo_device *device) {
 }
 
 static bool sx_download_pixels(indigo_device *device, unsigned char *pixels, unsigned long count) {
-	libusb_device_handle *handle = PRIVATE_DATA->handle;
-	int transferred;
-	unsigned long read = 0;
-	int rc=0;
-	while (read < count && rc >= 0) {
-		int size = (int)(count - read);
-		if (size > CHUNK_SIZE)
-			size = CHUNK_SIZE;
-		rc = libusb_bulk_transfer(handle, BULK_IN, pixels + read, size, &transferred, BULK_DATA_TIMEOUT);
-		INDIGO_DRIVER_DEBUG(DRIVER_NAME, "libusb_bulk_transfer -> %lu bytes %s", transferred, rc < 0 ? libusb_error_name(rc) : "OK");
-		if (transferred >= 0) {
-			read += transferred;
-		}
-	}
-	return rc >= 0;
+	double duration;
+	bool result = indigo_usb_bulk_read(PRIVATE_DATA->handle, BULK_IN, pixels, count, CHUNK_SIZE, CHUNK_COUNT, BULK_DATA_TIMEOUT, &duration);
+	INDIGO_DRIVER_DEBUG(DRIVER_NAME, "indigo_usb_bulk_read -> %lu bytes in %gs (%.1f MB/s) %s", count, duration, duration > 0 ? count / duration / 1048576 : 0, result ? "OK" : "Failed");
+	return result;
 }
 
 static bool sx_read_pixels(indigo_device *device) {
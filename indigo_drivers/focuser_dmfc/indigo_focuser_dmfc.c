@@ -23,7 +23,7 @@
  \file indigo_focuser_dmfc.c
  */
 
-#define DRIVER_VERSION 0x0004
+#define DRIVER_VERSION 0x0005
 #define DRIVER_NAME "indigo_focuser_dmfc"
 
 #include <stdlib.h>
@@ -52,37 +52,53 @@
 #define X_FOCUSER_ENCODER_ENABLED_ITEM				(X_FOCUSER_ENCODER_PROPERTY->items+0)
 #define X_FOCUSER_ENCODER_DISABLED_ITEM				(X_FOCUSER_ENCODER_PROPERTY->items+1)
 
+#define X_FOCUSER_PORT_STATISTICS_PROPERTY		(PRIVATE_DATA->port_statistics_property)
+#define X_FOCUSER_PORT_QUEUE_DEPTH_ITEM				(X_FOCUSER_PORT_STATISTICS_PROPERTY->items+0)
+#define X_FOCUSER_PORT_AVERAGE_LATENCY_ITEM		(X_FOCUSER_PORT_STATISTICS_PROPERTY->items+1)
+#define X_FOCUSER_PORT_MAX_LATENCY_ITEM				(X_FOCUSER_PORT_STATISTICS_PROPERTY->items+2)
+#define X_FOCUSER_PORT_MERGED_ITEM						(X_FOCUSER_PORT_STATISTICS_PROPERTY->items+3)
+
 typedef struct {
 	int handle;
-	pthread_mutex_t port_mutex;
+	indigo_port *port;
 	indigo_timer *timer;
 	indigo_property *motor_type_property;
 	indigo_property *encoder_property;
 	indigo_property *backlash_property;
+	indigo_property *port_statistics_property;
 } dmfc_private_data;
 
-static bool dmfc_command(indigo_device *device, char *command, char *response, int max) {
-	pthread_mutex_lock(&PRIVATE_DATA->port_mutex);
-	tcflush(PRIVATE_DATA->handle, TCIOFLUSH);
-	indigo_write(PRIVATE_DATA->handle, command, strlen(command));
-	indigo_write(PRIVATE_DATA->handle, "\n", 1);
-	if (response != NULL) {
-		if (indigo_read_line(PRIVATE_DATA->handle, response, max) == 0) {
-			pthread_mutex_unlock(&PRIVATE_DATA->port_mutex);
-			INDIGO_DRIVER_DEBUG(DRIVER_NAME, "Command %s -> no response", command);
-			return false;
-		}
+#define DMFC_TIMEOUT		3000000L
+
+static bool dmfc_transaction(indigo_device *device, indigo_priority priority, char *command, char *response, int max) {
+	char buffer[64];
+	snprintf(buffer, sizeof(buffer), "%s\n", command);
+	indigo_transaction transaction = { buffer, response, max - 1, '\n', DMFC_TIMEOUT, 0 };
+	if (!indigo_port_execute(PRIVATE_DATA->port, priority, &transaction, 1) || (response != NULL && transaction.length <= 0)) {
+		INDIGO_DRIVER_DEBUG(DRIVER_NAME, "Command %s -> no response", command);
+		return false;
 	}
-	pthread_mutex_unlock(&PRIVATE_DATA->port_mutex);
+	if (response != NULL && response[transaction.length - 1] == '\r')
+		response[transaction.length - 1] = 0;
 	INDIGO_DRIVER_DEBUG(DRIVER_NAME, "Command %s -> %s", command, response != NULL ? response : "NULL");
 	return true;
 }
 
+static bool dmfc_command(indigo_device *device, char *command, char *response, int max) {
+	return dmfc_transaction(device, INDIGO_PRIORITY_MOVE, command, response, max);
+}
+
+static void dmfc_close(indigo_device *device) {
+	indigo_port_close(PRIVATE_DATA->port);
+	PRIVATE_DATA->port = NULL;
+	PRIVATE_DATA->handle = 0;
+}
+
 // -------------------------------------------------------------------------------- INDIGO focuser device implementation
 
 static void timer_callback(indigo_device *device) {
 	char response[16];
-	if (dmfc_command(device, "T", response, sizeof(response))) {
+	if (dmfc_transaction(device, INDIGO_PRIORITY_STATUS, "T", response, sizeof(response))) {
 		double temp = atof(response);
 		if (FOCUSER_TEMPERATURE_ITEM->number.value != temp) {
 			FOCUSER_TEMPERATURE_ITEM->number.value = temp;
@@ -91,14 +107,14 @@ static void timer_callback(indigo_device *device) {
 		}
 	}
 	bool update = false;
-	if (dmfc_command(device, "P", response, sizeof(response))) {
+	if (dmfc_transaction(device, INDIGO_PRIORITY_STATUS, "P", response, sizeof(response))) {
 		int pos = atoi(response);
 		if (FOCUSER_POSITION_ITEM->number.value != pos) {
 			FOCUSER_POSITION_ITEM->number.value = pos;
 			update = true;
 		}
 	}
-	if (dmfc_command(device, "I", response, sizeof(response))) {
+	if (dmfc_transaction(device, INDIGO_PRIORITY_STATUS, "I", response, sizeof(response))) {
 		if (*response == '0') {
 			if (FOCUSER_POSITION_PROPERTY->state != INDIGO_OK_STATE) {
 				FOCUSER_STEPS_PROPERTY->state = INDIGO_OK_STATE;
@@ -117,6 +133,15 @@ static void timer_callback(indigo_device *device) {
 		indigo_update_property(device, FOCUSER_POSITION_PROPERTY, NULL);
 		indigo_update_property(device, FOCUSER_STEPS_PROPERTY, NULL);
 	}
+	indigo_port_statistics statistics;
+	indigo_port_get_statistics(PRIVATE_DATA->port, &statistics);
+	if (X_FOCUSER_PORT_QUEUE_DEPTH_ITEM->number.value != statistics.queue_depth || X_FOCUSER_PORT_MERGED_ITEM->number.value != statistics.merged || X_FOCUSER_PORT_MAX_LATENCY_ITEM->number.value != round(statistics.max_latency * 1000)) {
+		X_FOCUSER_PORT_QUEUE_DEPTH_ITEM->number.value = statistics.queue_depth;
+		X_FOCUSER_PORT_AVERAGE_LATENCY_ITEM->number.value = round(statistics.average_latency * 1000);
+		X_FOCUSER_PORT_MAX_LATENCY_ITEM->number.value = round(statistics.max_latency * 1000);
+		X_FOCUSER_PORT_MERGED_ITEM->number.value = statistics.merged;
+		indigo_update_property(device, X_FOCUSER_PORT_STATISTICS_PROPERTY, NULL);
+	}
 	indigo_reschedule_timer(device, 0.5, &PRIVATE_DATA->timer);
 }
 
@@ -134,6 +159,13 @@ static indigo_result focuser_attach(indigo_device *device) {
 			return INDIGO_FAILED;
 		indigo_init_switch_item(X_FOCUSER_ENCODER_ENABLED_ITEM, "ENABLED", "Enabled", false);
 		indigo_init_switch_item(X_FOCUSER_ENCODER_DISABLED_ITEM, "DISABLED", "Enabled", false);
+		X_FOCUSER_PORT_STATISTICS_PROPERTY = indigo_init_number_property(NULL, device->name, "X_FOCUSER_PORT_STATISTICS", FOCUSER_MAIN_GROUP, "Port statistics", INDIGO_OK_STATE, INDIGO_RO_PERM, 4);
+		if (X_FOCUSER_PORT_STATISTICS_PROPERTY == NULL)
+			return INDIGO_FAILED;
+		indigo_init_number_item(X_FOCUSER_PORT_QUEUE_DEPTH_ITEM, "QUEUE_DEPTH", "Queue depth", 0, 100, 0, 0);
+		indigo_init_number_item(X_FOCUSER_PORT_AVERAGE_LATENCY_ITEM, "AVERAGE_LATENCY", "Average latency [ms]", 0, 100000, 0, 0);
+		indigo_init_number_item(X_FOCUSER_PORT_MAX_LATENCY_ITEM, "MAX_LATENCY", "Max latency [ms]", 0, 100000, 0, 0);
+		indigo_init_number_item(X_FOCUSER_PORT_MERGED_ITEM, "MERGED", "Merged polls", 0, 1000000000, 0, 0);
 		// -------------------------------------------------------------------------------- FOCUSER_BACKLASH
 		FOCUSER_BACKLASH_PROPERTY->hidden = false;
 		FOCUSER_BACKLASH_ITEM->number.min = 0;
@@ -175,7 +207,6 @@ static indigo_result focuser_attach(indigo_device *device) {
 		FOCUSER_POSITION_ITEM->number.max = 9999999;
 		FOCUSER_POSITION_ITEM->number.step = 1;
 		// --------------------------------------------------------------------------------
-		pthread_mutex_init(&PRIVATE_DATA->port_mutex, NULL);
 		INDIGO_DEVICE_ATTACH_LOG(DRIVER_NAME, device->name);
 		return indigo_focuser_enumerate_properties(device, NULL, NULL);
 	}
@@ -188,6 +219,8 @@ static indigo_result focuser_enumerate_properties(indigo_device *device, indigo_
 			indigo_define_property(device, X_FOCUSER_MOTOR_TYPE_PROPERTY, NULL);
 		if (indigo_property_match(X_FOCUSER_ENCODER_PROPERTY, property))
 			indigo_define_property(device, X_FOCUSER_ENCODER_PROPERTY, NULL);
+		if (indigo_property_match(X_FOCUSER_PORT_STATISTICS_PROPERTY, property))
+			indigo_define_property(device, X_FOCUSER_PORT_STATISTICS_PROPERTY, NULL);
 	}
 	return indigo_focuser_enumerate_properties(device, NULL, NULL);
 }
@@ -205,12 +238,12 @@ static indigo_result focuser_change_property(indigo_device *device, indigo_clien
 			indigo_update_property(device, CONNECTION_PROPERTY, NULL);
 			PRIVATE_DATA->handle = indigo_open_serial_with_speed(DEVICE_PORT_ITEM->text.value, 19200);
 			if (PRIVATE_DATA->handle > 0) {
+				PRIVATE_DATA->port = indigo_port_open(PRIVATE_DATA->handle);
 				if (dmfc_command(device, "#", response, sizeof(response)) && !strncmp(response, "OK_", 3)) {
 					INDIGO_DRIVER_LOG(DRIVER_NAME, "%s OK", response + 3);
 				} else {
 					INDIGO_DRIVER_ERROR(DRIVER_NAME, "Focuser not detected");
-					close(PRIVATE_DATA->handle);
-					PRIVATE_DATA->handle = 0;
+					dmfc_close(device);
 				}
 			}
 			if (PRIVATE_DATA->handle > 0) {
@@ -251,19 +284,18 @@ static indigo_result focuser_change_property(indigo_device *device, indigo_clien
 						FOCUSER_BACKLASH_ITEM->number.value = FOCUSER_BACKLASH_ITEM->number.target = atoi(token);
 					} else {
 						INDIGO_DRIVER_ERROR(DRIVER_NAME, "Failed to parse 'A' response");
-						close(PRIVATE_DATA->handle);
-						PRIVATE_DATA->handle = 0;
+						dmfc_close(device);
 					}
 				} else {
 					INDIGO_DRIVER_ERROR(DRIVER_NAME, "Failed to read 'A' response");
-					close(PRIVATE_DATA->handle);
-					PRIVATE_DATA->handle = 0;
+					dmfc_close(device);
 				}
 			}
 			if (PRIVATE_DATA->handle > 0) {
 				indigo_update_property(device, INFO_PROPERTY, NULL);
 				indigo_define_property(device, X_FOCUSER_MOTOR_TYPE_PROPERTY, NULL);
 				indigo_define_property(device, X_FOCUSER_ENCODER_PROPERTY, NULL);
+				indigo_define_property(device, X_FOCUSER_PORT_STATISTICS_PROPERTY, NULL);
 				dmfc_command(device, "L:2", response, sizeof(response));
 				INDIGO_DRIVER_LOG(DRIVER_NAME, "Connected to %s", DEVICE_PORT_ITEM->text.value);
 				PRIVATE_DATA->timer = indigo_set_timer(device, 0, timer_callback);
@@ -279,11 +311,11 @@ static indigo_result focuser_change_property(indigo_device *device, indigo_clien
 				dmfc_command(device, "L:1", response, sizeof(response));
 				indigo_delete_property(device, X_FOCUSER_MOTOR_TYPE_PROPERTY, NULL);
 				indigo_delete_property(device, X_FOCUSER_ENCODER_PROPERTY, NULL);
+				indigo_delete_property(device, X_FOCUSER_PORT_STATISTICS_PROPERTY, NULL);
 				strcpy(INFO_DEVICE_MODEL_ITEM->text.value, "Undefined");
 				indigo_update_property(device, INFO_PROPERTY, NULL);
 				INDIGO_DRIVER_LOG(DRIVER_NAME, "Disconnected");
-				close(PRIVATE_DATA->handle);
-				PRIVATE_DATA->handle = 0;
+				dmfc_close(device);
 			}
 			CONNECTION_PROPERTY->state = INDIGO_OK_STATE;
 		}
@@ -343,7 +375,7 @@ static indigo_result focuser_change_property(indigo_device *device, indigo_clien
 		indigo_property_copy_values(FOCUSER_ABORT_MOTION_PROPERTY, property, false);
 		if (FOCUSER_ABORT_MOTION_ITEM->sw.value) {
 			FOCUSER_ABORT_MOTION_ITEM->sw.value = false;
-			if (dmfc_command(device, "H", response, sizeof(response))) {
+			if (dmfc_transaction(device, INDIGO_PRIORITY_ABORT, "H", response, sizeof(response))) {
 				FOCUSER_ABORT_MOTION_PROPERTY->state = INDIGO_OK_STATE;
 				FOCUSER_POSITION_PROPERTY->state = INDIGO_ALERT_STATE;
 				FOCUSER_STEPS_PROPERTY->state = INDIGO_ALERT_STATE;
@@ -411,6 +443,7 @@ static indigo_result focuser_detach(indigo_device *device) {
 		indigo_device_disconnect(NULL, device->name);
 	indigo_release_property(X_FOCUSER_MOTOR_TYPE_PROPERTY);
 	indigo_release_property(X_FOCUSER_ENCODER_PROPERTY);
+	indigo_release_property(X_FOCUSER_PORT_STATISTICS_PROPERTY);
 	INDIGO_DEVICE_DETACH_LOG(DRIVER_NAME, device->name);
 	return indigo_focuser_detach(device);
 }
@@ -63,58 +63,19 @@ typedef struct {
 } ioptron_private_data;
 
 static bool ieq_command(indigo_device *device, char *command, char *response, int max) {
+	indigo_transaction transaction = { command, response, max, '#', 500000L, 500000L, 0 };
 	pthread_mutex_lock(&PRIVATE_DATA->port_mutex);
-	char c;
-	struct timeval tv;
-	tv.tv_sec = 0;
-	tv.tv_usec = 10000;
-		// flush
-	while (true) {
-		fd_set readout;
-		FD_ZERO(&readout);
-		FD_SET(PRIVATE_DATA->handle, &readout);
-		long result = select(PRIVATE_DATA->handle+1, &readout, NULL, NULL, &tv);
-		if (result == 0)
-			break;
-		if (result < 0) {
-			pthread_mutex_unlock(&PRIVATE_DATA->port_mutex);
-			return false;
-		}
-		result = read(PRIVATE_DATA->handle, &c, 1);
-		if (result < 1) {
-			pthread_mutex_unlock(&PRIVATE_DATA->port_mutex);
-			return false;
-		}
+	bool result = indigo_execute_transactions(PRIVATE_DATA->handle, &transaction, 1);
+	pthread_mutex_unlock(&PRIVATE_DATA->port_mutex);
+	if (!result) {
+		INDIGO_DRIVER_ERROR(DRIVER_NAME, "Failed to communicate with %s -> %s (%d)", DEVICE_PORT_ITEM->text.value, strerror(errno), errno);
+		return false;
 	}
-		// write command
-	indigo_write(PRIVATE_DATA->handle, command, strlen(command));
-		// read response
 	if (response != NULL) {
-		int index = 0;
-		while (index < max) {
-			tv.tv_usec = 500000;
-			tv.tv_sec = 0;
-			fd_set readout;
-			FD_ZERO(&readout);
-			FD_SET(PRIVATE_DATA->handle, &readout);
-			long result = select(PRIVATE_DATA->handle+1, &readout, NULL, NULL, &tv);
-			if (result <= 0)
-				break;
-			result = read(PRIVATE_DATA->handle, &c, 1);
-			if (result < 1) {
-				INDIGO_DRIVER_ERROR(DRIVER_NAME, "Failed to read from %s -> %s (%d)", DEVICE_PORT_ITEM->text.value, strerror(errno), errno);
-				pthread_mutex_unlock(&PRIVATE_DATA->port_mutex);
-				return false;
-			}
-			if (c < 0)
-				c = ':';
-			if (c == '#')
-				break;
-			response[index++] = c;
-		}
-		response[index] = 0;
+		for (char *c = response; *c; c++)
+			if (*c < 0)
+				*c = ':';
 	}
-	pthread_mutex_unlock(&PRIVATE_DATA->port_mutex);
 	INDIGO_DRIVER_DEBUG(DRIVER_NAME, "Command '%s' -> '%s'", command, response != NULL ? response : "NULL");
 	return true;
 }
@@ -123,14 +84,14 @@ static void ieq_get_coords(indigo_device *device) {
 	char response[128];
 	MOUNT_EQUATORIAL_COORDINATES_PROPERTY->state = INDIGO_ALERT_STATE;
 	if (PRIVATE_DATA->protocol == 0x0100 || PRIVATE_DATA->protocol == 0x0104) {
-		if (ieq_command(device, ":GR#", response, sizeof(response)))
+		if (ieq_command(device, ":GR#", response, sizeof(response) - 1))
 			PRIVATE_DATA->currentRA = indigo_stod(response);
-		if (ieq_command(device, ":GD#", response, sizeof(response)))
+		if (ieq_command(device, ":GD#", response, sizeof(response) - 1))
 			PRIVATE_DATA->currentDec = indigo_stod(response);
 		MOUNT_EQUATORIAL_COORDINATES_PROPERTY->state = INDIGO_OK_STATE;
 	} else if (PRIVATE_DATA->protocol == 0x0200) {
 		long ra, dec;
-		if (ieq_command(device, ":GEC#", response, sizeof(response)) && sscanf(response, "%9ld%8ld", &dec, &ra) == 2) {
+		if (ieq_command(device, ":GEC#", response, sizeof(response) - 1) && sscanf(response, "%9ld%8ld", &dec, &ra) == 2) {
 			PRIVATE_DATA->currentDec = dec / 100.0 / 60.0 / 60.0;
 			PRIVATE_DATA->currentRA = ra / 1000.0 / 60.0 / 60.0;
 			MOUNT_EQUATORIAL_COORDINATES_PROPERTY->state = INDIGO_OK_STATE;
@@ -144,11 +105,11 @@ static void ieq_get_utc(indigo_device *device) {
 	memset(&tm, 0, sizeof(tm));
 	MOUNT_UTC_TIME_PROPERTY->state = INDIGO_ALERT_STATE;
 	if (PRIVATE_DATA->protocol == 0x0100 || PRIVATE_DATA->protocol == 0x0104) {
-		if (ieq_command(device, ":GC#", response, sizeof(response)) && sscanf(response, "%02d/%02d/%02d", &tm.tm_mon, &tm.tm_mday, &tm.tm_year) == 3) {
-			if (ieq_command(device, ":GL#", response, sizeof(response)) && sscanf(response, "%02d:%02d:%02d", &tm.tm_hour, &tm.tm_min, &tm.tm_sec) == 3) {
+		if (ieq_command(device, ":GC#", response, sizeof(response) - 1) && sscanf(response, "%02d/%02d/%02d", &tm.tm_mon, &tm.tm_mday, &tm.tm_year) == 3) {
+			if (ieq_command(device, ":GL#", response, sizeof(response) - 1) && sscanf(response, "%02d:%02d:%02d", &tm.tm_hour, &tm.tm_min, &tm.tm_sec) == 3) {
 				tm.tm_year += 100; // TODO: To be fixed in year 2100 :)
 				tm.tm_mon -= 1;
-				if (ieq_command(device, ":GG#", response, sizeof(response))) {
+				if (ieq_command(device, ":GG#", response, sizeof(response) - 1)) {
 					tm.tm_isdst = -1;
 					tm.tm_gmtoff = atoi(response) * 60;
 					time_t secs = mktime(&tm);
@@ -160,7 +121,7 @@ static void ieq_get_utc(indigo_device *device) {
 		}
 	} else if (PRIVATE_DATA->protocol == 0x0200) {
 		int tz;
-		if (ieq_command(device, ":GLT#", response, sizeof(response)) && sscanf(response, "%4d%1d%2d%2d%2d%2d%2d%2d", &tz, &tm.tm_isdst, &tm.tm_year, &tm.tm_mon, &tm.tm_mday, &tm.tm_hour, &tm.tm_min, &tm.tm_sec) == 8) {
+		if (ieq_command(device, ":GLT#", response, sizeof(response) - 1) && sscanf(response, "%4d%1d%2d%2d%2d%2d%2d%2d", &tz, &tm.tm_isdst, &tm.tm_year, &tm.tm_mon, &tm.tm_mday, &tm.tm_hour, &tm.tm_min, &tm.tm_sec) == 8) {
 			tm.tm_year += 100; // TODO: To be fixed in year 2100 :)
 			tm.tm_mon -= 1;
 			tm.tm_gmtoff = tz * 60;
@@ -192,7 +153,7 @@ static bool ieq_open(indigo_device *device) {
 	if (PRIVATE_DATA->handle >= 0) {
 		char response[128] = "";
 		INDIGO_DRIVER_LOG(DRIVER_NAME, "connected to %s", name);
-		if (ieq_command(device, ":V#", response, sizeof(response))) {
+		if (ieq_command(device, ":V#", response, sizeof(response) - 1)) {
 			INDIGO_DRIVER_LOG(DRIVER_NAME, "version:  %s", response);
 		}
 		strcpy(MOUNT_INFO_VENDOR_ITEM->text.value, "iOptron");
@@ -267,10 +228,10 @@ static bool ieq_open(indigo_device *device) {
 		}
 		INDIGO_DRIVER_LOG(DRIVER_NAME, "product:  %s (%s) %d.%d", MOUNT_INFO_MODEL_ITEM->text.value, PRIVATE_DATA->product, PRIVATE_DATA->protocol >> 8, PRIVATE_DATA->protocol & 0xFF);
 		if (PRIVATE_DATA->protocol > 0x0100) {
-			if (ieq_command(device, ":FW1#", response, sizeof(response))) {
+			if (ieq_command(device, ":FW1#", response, sizeof(response) - 1)) {
 				INDIGO_DRIVER_LOG(DRIVER_NAME, "firmware #1:  %s", response);
 				strcpy(MOUNT_INFO_FIRMWARE_ITEM->text.value, response);
-				if (ieq_command(device, ":FW2#", response, sizeof(response))) {
+				if (ieq_command(device, ":FW2#", response, sizeof(response) - 1)) {
 					INDIGO_DRIVER_LOG(DRIVER_NAME, "firmware #2:  %s", response);
 					strcat(MOUNT_INFO_FIRMWARE_ITEM->text.value, " / ");
 					strcat(MOUNT_INFO_FIRMWARE_ITEM->text.value, response);
@@ -331,7 +292,7 @@ static bool ieq_open(indigo_device *device) {
 				}
 			}
 		} else if (PRIVATE_DATA->protocol == 0x0200) {
-			if (ieq_command(device, ":GAS#", response, sizeof(response))) {
+			if (ieq_command(device, ":GAS#", response, sizeof(response) - 1)) {
 				indigo_set_switch(MOUNT_TRACKING_PROPERTY, MOUNT_TRACKING_OFF_ITEM, true);
 				indigo_set_switch(MOUNT_PARK_PROPERTY, MOUNT_PARK_UNPARKED_ITEM, true);
 				switch (response[1]) {
@@ -401,7 +362,7 @@ static void position_timer_callback(indigo_device *device) {
 				MOUNT_EQUATORIAL_COORDINATES_PROPERTY->state = INDIGO_BUSY_STATE;
 			}
 		} else if (PRIVATE_DATA->protocol == 0x0200) {
-			if (ieq_command(device, ":GAS#", response, sizeof(response))) {
+			if (ieq_command(device, ":GAS#", response, sizeof(response) - 1)) {
 				switch (response[1]) {
 					case '0': // stopped (not at zero position)
 						if (MOUNT_TRACKING_ON_ITEM->sw.value) {
@@ -453,14 +414,14 @@ static void position_timer_callback(indigo_device *device) {
 				}
 				if (response[0] == '2') {
 					bool update = MOUNT_GEOGRAPHIC_COORDINATES_PROPERTY->state == INDIGO_BUSY_STATE;
-					if (ieq_command(device, ":Gt#", response, sizeof(response))) {
+					if (ieq_command(device, ":Gt#", response, sizeof(response) - 1)) {
 						double latitude = atol(response) / 60.0 / 60.0;
 						if (latitude != MOUNT_GEOGRAPHIC_COORDINATES_LATITUDE_ITEM->number.value) {
 							MOUNT_GEOGRAPHIC_COORDINATES_LATITUDE_ITEM->number.target = MOUNT_GEOGRAPHIC_COORDINATES_LATITUDE_ITEM->number.value = latitude;
 							update = true;
 						}
 					}
-					if (ieq_command(device, ":Gg#", response, sizeof(response))) {
+					if (ieq_command(device, ":Gg#", response, sizeof(response) - 1)) {
 						double longitude = atol(response) / 60.0 / 60.0;
 						if (longitude < 0)
 							longitude += 360;
@@ -532,9 +493,9 @@ static indigo_result mount_change_property(indigo_device *device, indigo_client
 			}
 			if (result) {
 				if (PRIVATE_DATA->protocol == 0x0100 || PRIVATE_DATA->protocol == 0x0104) {
-					if (ieq_command(device, ":Gt#", response, sizeof(response)))
+					if (ieq_command(device, ":Gt#", response, sizeof(response) - 1))
 						MOUNT_GEOGRAPHIC_COORDINATES_LATITUDE_ITEM->number.target = MOUNT_GEOGRAPHIC_COORDINATES_LATITUDE_ITEM->number.value = indigo_stod(response);
-					if (ieq_command(device, ":Gg#", response, sizeof(response))) {
+					if (ieq_command(device, ":Gg#", response, sizeof(response) - 1)) {
 						double  longitude = indigo_stod(response);
 						if (longitude < 0)
 							longitude += 360;
@@ -544,9 +505,9 @@ static indigo_result mount_change_property(indigo_device *device, indigo_client
 					MOUNT_HOME_PROPERTY->hidden = false;
 					MOUNT_PARK_SET_PROPERTY->hidden = false;
 					MOUNT_PARK_SET_PROPERTY->count = 1;
-					if (ieq_command(device, ":Gt#", response, sizeof(response)))
+					if (ieq_command(device, ":Gt#", response, sizeof(response) - 1))
 						MOUNT_GEOGRAPHIC_COORDINATES_LATITUDE_ITEM->number.target = MOUNT_GEOGRAPHIC_COORDINATES_LATITUDE_ITEM->number.value = atol(response) / 60.0 / 60.0;
-					if (ieq_command(device, ":Gg#", response, sizeof(response))) {
+					if (ieq_command(device, ":Gg#", response, sizeof(response) - 1)) {
 						double longitude = atol(response) / 60.0 / 60.0;
 						if (longitude < 0)
 							longitude += 360;
@@ -1006,7 +967,7 @@ static indigo_result guider_change_property(indigo_device *device, indigo_client
 				result = ieq_open(device->master_device);
 			}
 			if (result) {
-				if (ieq_command(device, ":AG#", response, sizeof(response)))
+				if (ieq_command(device, ":AG#", response, sizeof(response) - 1))
 					GUIDER_RATE_ITEM->number.value = atoi(response);
 				CONNECTION_PROPERTY->state = INDIGO_OK_STATE;
 			} else {
@@ -46,6 +46,9 @@
 
 #define PRIVATE_DATA        ((lx200_private_data *)device->private_data)
 
+#define MEADE_TIMEOUT				3000000L
+#define MEADE_GAP						100000L
+
 #define ALIGNMENT_MODE_PROPERTY					(PRIVATE_DATA->alignment_mode_property)
 #define POLAR_MODE_ITEM                 (ALIGNMENT_MODE_PROPERTY->items+0)
 #define ALTAZ_MODE_ITEM                 (ALIGNMENT_MODE_PROPERTY->items+1)
@@ -72,7 +75,7 @@ typedef struct {
 	bool isAvalon;
 } lx200_private_data;
 
-static bool meade_command(indigo_device *device, char *command, char *response, int max, int sleep);
+static bool meade_command(indigo_device *device, char *command, char *response, int max);
 
 static bool meade_open(indigo_device *device) {
 	char *name = DEVICE_PORT_ITEM->text.value;
@@ -100,67 +103,31 @@ static bool meade_open(indigo_device *device) {
 	}
 }
 
-static bool meade_command(indigo_device *device, char *command, char *response, int max, int sleep) {
+static bool meade_transactions(indigo_device *device, indigo_transaction *transactions, int count) {
 	pthread_mutex_lock(&PRIVATE_DATA->port_mutex);
-	char c;
-	struct timeval tv;
-	// flush
-	while (true) {
-		fd_set readout;
-		FD_ZERO(&readout);
-		FD_SET(PRIVATE_DATA->handle, &readout);
-		tv.tv_sec = 0;
-		tv.tv_usec = 100000;
-		long result = select(PRIVATE_DATA->handle+1, &readout, NULL, NULL, &tv);
-		if (result == 0)
-			break;
-		if (result < 0) {
-			pthread_mutex_unlock(&PRIVATE_DATA->port_mutex);
-			return false;
-		}
-		result = read(PRIVATE_DATA->handle, &c, 1);
-		if (result < 1) {
-			pthread_mutex_unlock(&PRIVATE_DATA->port_mutex);
-			return false;
-		}
+	bool result = indigo_execute_transactions(PRIVATE_DATA->handle, transactions, count);
+	pthread_mutex_unlock(&PRIVATE_DATA->port_mutex);
+	if (!result) {
+		INDIGO_DRIVER_ERROR(DRIVER_NAME, "Failed to communicate with %s -> %s (%d)", DEVICE_PORT_ITEM->text.value, strerror(errno), errno);
+		return false;
 	}
-	// write command
-	indigo_write(PRIVATE_DATA->handle, command, strlen(command));
-	if (sleep > 0)
-		usleep(sleep);
-	// read response
-	if (response != NULL) {
-		int index = 0;
-		int timeout = 3;
-		while (index < max) {
-			fd_set readout;
-			FD_ZERO(&readout);
-			FD_SET(PRIVATE_DATA->handle, &readout);
-			tv.tv_sec = timeout;
-			tv.tv_usec = 100000;
-			timeout = 0;
-			long result = select(PRIVATE_DATA->handle+1, &readout, NULL, NULL, &tv);
-			if (result <= 0)
-				break;
-			result = read(PRIVATE_DATA->handle, &c, 1);
-			if (result < 1) {
-				INDIGO_DRIVER_ERROR(DRIVER_NAME, "Failed to read from %s -> %s (%d)", DEVICE_PORT_ITEM->text.value, strerror(errno), errno);
-				pthread_mutex_unlock(&PRIVATE_DATA->port_mutex);
-				return false;
-			}
-			if (c < 0)
-				c = ':';
-			if (c == '#')
-				break;
-			response[index++] = c;
+	for (int i = 0; i < count; i++) {
+		char *response = transactions[i].response;
+		if (response != NULL) {
+			for (char *c = response; *c; c++)
+				if (*c < 0)
+					*c = ':';
 		}
-		response[index] = 0;
+		INDIGO_DRIVER_DEBUG(DRIVER_NAME, "Command %s -> %s", transactions[i].command, response != NULL ? response : "NULL");
 	}
-	pthread_mutex_unlock(&PRIVATE_DATA->port_mutex);
-	INDIGO_DRIVER_DEBUG(DRIVER_NAME, "Command %s -> %s", command, response != NULL ? response : "NULL");
 	return true;
 }
 
+static bool meade_command(indigo_device *device, char *command, char *response, int max) {
+	indigo_transaction transaction = { command, response, max, '#', MEADE_TIMEOUT, MEADE_GAP, 0 };
+	return meade_transactions(device, &transaction, 1);
+}
+
 //static bool gemini_command(indigo_device *device, char *command, char *response, int max) {
 //	char buffer[128];
 //	uint8_t checksum = command[0];
@@ -169,7 +136,7 @@ static bool meade_command(indigo_device *device, char *command, char *response,
 //	checksum = checksum % 128;
 //	checksum += 64;
 //	snprintf(buffer, sizeof(buffer), "%s%c#", command, checksum);
-//	return meade_command(device, buffer, response, max, 0);
+//	return meade_command(device, buffer, response, max);
 //}
 
 static void meade_close(indigo_device *device) {
@@ -181,29 +148,34 @@ static void meade_close(indigo_device *device) {
 }
 
 static void meade_get_coords(indigo_device *device) {
-	char response[128];
-	if (meade_command(device, ":GR#", response, sizeof(response), 0)) {
-		if (strlen(response) < 8) {
+	char response[128], ra[128], dec[128];
+	indigo_transaction transactions[] = {
+		{ ":GR#", ra, sizeof(ra) - 1, '#', MEADE_TIMEOUT, MEADE_GAP, 0 },
+		{ ":GD#", dec, sizeof(dec) - 1, '#', MEADE_TIMEOUT, MEADE_GAP, 0 }
+	};
+	if (meade_transactions(device, transactions, 2)) {
+		if (strlen(ra) < 8) {
 			if (PRIVATE_DATA->is10Microns)
-				meade_command(device, ":U1#", NULL, 0, 0);
+				meade_command(device, ":U1#", NULL, 0);
 			else if (PRIVATE_DATA->isGemini)
-				meade_command(device, ":U#", NULL, 0, 0);
+				meade_command(device, ":U#", NULL, 0);
 			else
-				meade_command(device, ":P#", response, sizeof(response), 0);
-			meade_command(device, ":GR#", response, sizeof(response), 0);
+				meade_command(device, ":P#", response, sizeof(response) - 1);
+			meade_transactions(device, transactions, 2);
 		}
-		MOUNT_EQUATORIAL_COORDINATES_RA_ITEM->number.value = indigo_stod(response);
+		if (transactions[0].length > 0)
+			MOUNT_EQUATORIAL_COORDINATES_RA_ITEM->number.value = indigo_stod(ra);
+		if (transactions[1].length > 0)
+			MOUNT_EQUATORIAL_COORDINATES_DEC_ITEM->number.value = indigo_stod(dec);
 	}
-	if (meade_command(device, ":GD#", response, sizeof(response), 0))
-		MOUNT_EQUATORIAL_COORDINATES_DEC_ITEM->number.value = indigo_stod(response);
 	if (PRIVATE_DATA->isMeade || PRIVATE_DATA->is10Microns) {
-		if (meade_command(device, ":D#", response, sizeof(response), 0))
+		if (meade_command(device, ":D#", response, sizeof(response) - 1))
 			MOUNT_EQUATORIAL_COORDINATES_PROPERTY->state = *response ? INDIGO_BUSY_STATE : INDIGO_OK_STATE;
 	} else if (PRIVATE_DATA->isGemini) {
-		if (meade_command(device, ":Gv#", response, sizeof(response), 0))
+		if (meade_command(device, ":Gv#", response, sizeof(response) - 1))
 			MOUNT_EQUATORIAL_COORDINATES_PROPERTY->state = (*response == 'S' || *response == 'C') ? INDIGO_BUSY_STATE : INDIGO_OK_STATE;
 	} else if (PRIVATE_DATA->isAvalon) {
-		if (meade_command(device, ":X34#", response, sizeof(response), 0))
+		if (meade_command(device, ":X34#", response, sizeof(response) - 1))
 			MOUNT_EQUATORIAL_COORDINATES_PROPERTY->state = (response[1] == '5' || response[2] == '5') ? INDIGO_BUSY_STATE : INDIGO_OK_STATE;
 	} else {
 		if (fabs(MOUNT_EQUATORIAL_COORDINATES_RA_ITEM->number.value - MOUNT_EQUATORIAL_COORDINATES_RA_ITEM->number.target) < 1.0/3600.0 && fabs(MOUNT_EQUATORIAL_COORDINATES_DEC_ITEM->number.value - MOUNT_EQUATORIAL_COORDINATES_DEC_ITEM->number.target) < 1.0/3600.0)
@@ -219,11 +191,11 @@ static void meade_get_utc(indigo_device *device) {
 		char response[128];
 		memset(&tm, 0, sizeof(tm));
 		MOUNT_UTC_TIME_PROPERTY->state = INDIGO_ALERT_STATE;
-		if (meade_command(device, ":GC#", response, sizeof(response), 0) && sscanf(response, "%02d/%02d/%02d", &tm.tm_mon, &tm.tm_mday, &tm.tm_year) == 3) {
-			if (meade_command(device, ":GL#", response, sizeof(response), 0) && sscanf(response, "%02d:%02d:%02d", &tm.tm_hour, &tm.tm_min, &tm.tm_sec) == 3) {
+		if (meade_command(device, ":GC#", response, sizeof(response) - 1) && sscanf(response, "%02d/%02d/%02d", &tm.tm_mon, &tm.tm_mday, &tm.tm_year) == 3) {
+			if (meade_command(device, ":GL#", response, sizeof(response) - 1) && sscanf(response, "%02d:%02d:%02d", &tm.tm_hour, &tm.tm_min, &tm.tm_sec) == 3) {
 				tm.tm_year += 100; // TODO: To be fixed in year 2100 :)
 				tm.tm_mon -= 1;
-				if (meade_command(device, ":GG#", response, sizeof(response), 0)) {
+				if (meade_command(device, ":GG#", response, sizeof(response) - 1)) {
 					tm.tm_isdst = -1;
 					tm.tm_gmtoff = atoi(response) * 3600;
 					time_t secs = mktime(&tm);
@@ -244,7 +216,7 @@ static void position_timer_callback(indigo_device *device) {
 		indigo_update_coordinates(device, NULL);
 		meade_get_utc(device);
 		indigo_update_property(device, MOUNT_UTC_TIME_PROPERTY, NULL);
-		indigo_reschedule_timer(device, MOUNT_EQUATORIAL_COORDINATES_PROPERTY->state == INDIGO_BUSY_STATE ? 0.5 : 1, &PRIVATE_DATA->position_timer);
+		indigo_reschedule_timer(device, MOUNT_EQUATORIAL_COORDINATES_PROPERTY->state == INDIGO_BUSY_STATE ? 0.1 : 1, &PRIVATE_DATA->position_timer);
 	}
 }
 
@@ -299,7 +271,7 @@ static indigo_result mount_change_property(indigo_device *device, indigo_client
 				result = meade_open(device);
 			}
 			if (result) {
-				if (meade_command(device, ":GVP#", response, sizeof(response), 0)) {
+				if (meade_command(device, ":GVP#", response, sizeof(response) - 1)) {
 					INDIGO_DRIVER_LOG(DRIVER_NAME, "product:  %s", response);
 					strncpy(PRIVATE_DATA->product, response, 64);
 				}
@@ -313,7 +285,7 @@ static indigo_result mount_change_property(indigo_device *device, indigo_client
 					MOUNT_PARK_PARKED_ITEM->sw.value = false;
 					PRIVATE_DATA->parked = false;
 					strcpy(MOUNT_INFO_VENDOR_ITEM->text.value, "Meade");
-					if (meade_command(device, ":GVF#", response, sizeof(response), 0)) {
+					if (meade_command(device, ":GVF#", response, sizeof(response) - 1)) {
 						INDIGO_DRIVER_LOG(DRIVER_NAME, "version:  %s", response);
 						char *sep = strchr(response, '|');
 						if (sep != NULL)
@@ -322,11 +294,11 @@ static indigo_result mount_change_property(indigo_device *device, indigo_client
 					} else {
 						strncpy(MOUNT_INFO_MODEL_ITEM->text.value, PRIVATE_DATA->product, INDIGO_VALUE_SIZE);
 					}
-					if (meade_command(device, ":GVN#", response, sizeof(response), 0)) {
+					if (meade_command(device, ":GVN#", response, sizeof(response) - 1)) {
 						INDIGO_DRIVER_LOG(DRIVER_NAME, "firmware: %s", response);
 						strncpy(MOUNT_INFO_FIRMWARE_ITEM->text.value, response, INDIGO_VALUE_SIZE);
 					}
-					if (meade_command(device, ":GW#", response, sizeof(response), 0)) {
+					if (meade_command(device, ":GW#", response, sizeof(response) - 1)) {
 						INDIGO_DRIVER_LOG(DRIVER_NAME, "status:   %s", response);
 						ALIGNMENT_MODE_PROPERTY->hidden = false;
 						if (*response == 'P') {
@@ -341,9 +313,9 @@ static indigo_result mount_change_property(indigo_device *device, indigo_client
 						}
 						indigo_define_property(device, ALIGNMENT_MODE_PROPERTY, NULL);
 					}
-					if (meade_command(device, ":Gt#", response, sizeof(response), 0))
+					if (meade_command(device, ":Gt#", response, sizeof(response) - 1))
 						MOUNT_GEOGRAPHIC_COORDINATES_LATITUDE_ITEM->number.target = MOUNT_GEOGRAPHIC_COORDINATES_LATITUDE_ITEM->number.value = indigo_stod(response);
-					if (meade_command(device, ":Gg#", response, sizeof(response), 0)) {
+					if (meade_command(device, ":Gg#", response, sizeof(response) - 1)) {
 						double longitude = indigo_stod(response);
 						if (longitude < 0)
 							longitude += 360;
@@ -379,7 +351,7 @@ static indigo_result mount_change_property(indigo_device *device, indigo_client
 					PRIVATE_DATA->parked = false;
 					indigo_set_switch(MOUNT_TRACKING_PROPERTY, MOUNT_TRACKING_OFF_ITEM, true);
 					indigo_set_switch(MOUNT_PARK_PROPERTY, MOUNT_PARK_UNPARKED_ITEM, true);
-					if (meade_command(device, ":Gstat#", response, sizeof(response), 0)) {
+					if (meade_command(device, ":Gstat#", response, sizeof(response) - 1)) {
 						if (*response == '0') {
 							indigo_set_switch(MOUNT_TRACKING_PROPERTY, MOUNT_TRACKING_ON_ITEM, true);
 						} else if (*response == '5') {
@@ -387,9 +359,9 @@ static indigo_result mount_change_property(indigo_device *device, indigo_client
 							PRIVATE_DATA->parked = true;
 						}
 					}
-					if (meade_command(device, ":Gt#", response, sizeof(response), 0))
+					if (meade_command(device, ":Gt#", response, sizeof(response) - 1))
 						MOUNT_GEOGRAPHIC_COORDINATES_LATITUDE_ITEM->number.target = MOUNT_GEOGRAPHIC_COORDINATES_LATITUDE_ITEM->number.value = indigo_stod(response);
-					if (meade_command(device, ":Gg#", response, sizeof(response), 0)) {
+					if (meade_command(device, ":Gg#", response, sizeof(response) - 1)) {
 						double longitude = indigo_stod(response);
 						if (longitude < 0)
 							longitude += 360;
@@ -409,7 +381,7 @@ static indigo_result mount_change_property(indigo_device *device, indigo_client
 					PRIVATE_DATA->parked = false;
 					indigo_set_switch(MOUNT_TRACKING_PROPERTY, MOUNT_TRACKING_OFF_ITEM, true);
 					indigo_set_switch(MOUNT_PARK_PROPERTY, MOUNT_PARK_UNPARKED_ITEM, true);
-					if (meade_command(device, ":Gv#", response, 1, 0)) {
+					if (meade_command(device, ":Gv#", response, 1)) {
 						if (*response == 'T' || *response == 'G') {
 							indigo_set_switch(MOUNT_TRACKING_PROPERTY, MOUNT_TRACKING_ON_ITEM, true);
 						} else if (*response == 'N') {
@@ -417,9 +389,9 @@ static indigo_result mount_change_property(indigo_device *device, indigo_client
 							PRIVATE_DATA->parked = true;
 						}
 					}
-					if (meade_command(device, ":Gt#", response, sizeof(response), 0))
+					if (meade_command(device, ":Gt#", response, sizeof(response) - 1))
 						MOUNT_GEOGRAPHIC_COORDINATES_LATITUDE_ITEM->number.target = MOUNT_GEOGRAPHIC_COORDINATES_LATITUDE_ITEM->number.value = indigo_stod(response);
-					if (meade_command(device, ":Gg#", response, sizeof(response), 0)) {
+					if (meade_command(device, ":Gg#", response, sizeof(response) - 1)) {
 						double longitude = indigo_stod(response);
 						if (longitude < 0)
 							longitude += 360;
@@ -439,7 +411,7 @@ static indigo_result mount_change_property(indigo_device *device, indigo_client
 					PRIVATE_DATA->parked = false;
 					indigo_set_switch(MOUNT_TRACKING_PROPERTY, MOUNT_TRACKING_OFF_ITEM, true);
 					indigo_set_switch(MOUNT_PARK_PROPERTY, MOUNT_PARK_UNPARKED_ITEM, true);
-					if (meade_command(device, ":X34#", response, sizeof(response), 0)) {
+					if (meade_command(device, ":X34#", response, sizeof(response) - 1)) {
 						if (response[1] == '1') {
 							indigo_set_switch(MOUNT_TRACKING_PROPERTY, MOUNT_TRACKING_ON_ITEM, true);
 						} else {
@@ -447,9 +419,9 @@ static indigo_result mount_change_property(indigo_device *device, indigo_client
 							PRIVATE_DATA->parked = true;
 						}
 					}
-					if (meade_command(device, ":Gt#", response, sizeof(response), 0))
+					if (meade_command(device, ":Gt#", response, sizeof(response) - 1))
 						MOUNT_GEOGRAPHIC_COORDINATES_LATITUDE_ITEM->number.target = MOUNT_GEOGRAPHIC_COORDINATES_LATITUDE_ITEM->number.value = indigo_stod(response);
-					if (meade_command(device, ":Gg#", response, sizeof(response), 0)) {
+					if (meade_command(device, ":Gg#", response, sizeof(response) - 1)) {
 						double longitude = indigo_stod(response);
 						if (longitude < 0)
 							longitude += 360;
@@ -487,23 +459,23 @@ static indigo_result mount_change_property(indigo_device *device, indigo_client
 		indigo_property_copy_values(MOUNT_PARK_PROPERTY, property, false);
 		if (!PRIVATE_DATA->parked && MOUNT_PARK_PARKED_ITEM->sw.value) {
 			if (PRIVATE_DATA->isGemini)
-				meade_command(device, ":hC#", NULL, 0, 0);
+				meade_command(device, ":hC#", NULL, 0);
 			else if (PRIVATE_DATA->isAvalon)
-				meade_command(device, ":X362#", NULL, 0, 0);
+				meade_command(device, ":X362#", NULL, 0);
 			else
-				meade_command(device, ":hP#", NULL, 0, 0);
+				meade_command(device, ":hP#", NULL, 0);
 			PRIVATE_DATA->parked = true;
 			indigo_update_property(device, MOUNT_PARK_PROPERTY, "Parked");
 		}
 		if (PRIVATE_DATA->parked && MOUNT_PARK_UNPARKED_ITEM->sw.value) {
 			if (PRIVATE_DATA->isEQMac)
-				meade_command(device, ":hU#", NULL, 0, 0);
+				meade_command(device, ":hU#", NULL, 0);
 			else if (PRIVATE_DATA->isGemini)
-				meade_command(device, ":hW#", NULL, 0, 0);
+				meade_command(device, ":hW#", NULL, 0);
 			else if (PRIVATE_DATA->is10Microns)
-				meade_command(device, ":PO#", NULL, 0, 0);
+				meade_command(device, ":PO#", NULL, 0);
 			else if (PRIVATE_DATA->isAvalon)
-				meade_command(device, ":X370#", NULL, 0, 0);
+				meade_command(device, ":X370#", NULL, 0);
 			PRIVATE_DATA->parked = false;
 			indigo_update_property(device, MOUNT_PARK_PROPERTY, "Unparked");
 		}
@@ -516,13 +488,13 @@ static indigo_result mount_change_property(indigo_device *device, indigo_client
 				MOUNT_GEOGRAPHIC_COORDINATES_LONGITUDE_ITEM->number.value += 360;
 			MOUNT_GEOGRAPHIC_COORDINATES_PROPERTY->state = INDIGO_OK_STATE;
 			sprintf(command, ":St%s#", indigo_dtos(MOUNT_GEOGRAPHIC_COORDINATES_LATITUDE_ITEM->number.value, "%+03d*%02d"));
-			if (!meade_command(device, command, response, 1, 0) || *response != '1') {
+			if (!meade_command(device, command, response, 1) || *response != '1') {
 				INDIGO_DRIVER_ERROR(DRIVER_NAME, "%s failed", command);
 				MOUNT_GEOGRAPHIC_COORDINATES_PROPERTY->state = INDIGO_ALERT_STATE;
 			} else {
 				double longitude = fmod((360 - MOUNT_GEOGRAPHIC_COORDINATES_LONGITUDE_ITEM->number.value), 360);
 				sprintf(command, ":Sg%s#", indigo_dtos(longitude, "%03d*%02d"));
-				if (!meade_command(device, command, response, 1, 0) || *response != '1') {
+				if (!meade_command(device, command, response, 1) || *response != '1') {
 					INDIGO_DRIVER_ERROR(DRIVER_NAME, "%s failed", command);
 					MOUNT_GEOGRAPHIC_COORDINATES_PROPERTY->state = INDIGO_ALERT_STATE;
 				}
@@ -540,37 +512,37 @@ static indigo_result mount_change_property(indigo_device *device, indigo_client
 			if (MOUNT_ON_COORDINATES_SET_TRACK_ITEM->sw.value) {
 				if (MOUNT_TRACK_RATE_SIDEREAL_ITEM->sw.value && PRIVATE_DATA->lastTrackRate != 'q') {
 					if (PRIVATE_DATA->isGemini)
-						meade_command(device, ">130:131E#", NULL, 0, 0);
+						meade_command(device, ">130:131E#", NULL, 0);
 					else
-						meade_command(device, ":TQ#", NULL, 0, 0);
+						meade_command(device, ":TQ#", NULL, 0);
 					PRIVATE_DATA->lastTrackRate = 'q';
 				} else if (MOUNT_TRACK_RATE_SOLAR_ITEM->sw.value && PRIVATE_DATA->lastTrackRate != 's') {
 					if (PRIVATE_DATA->isGemini)
-						meade_command(device, ">130:134@", NULL, 0, 0);
+						meade_command(device, ">130:134@", NULL, 0);
 					else if (PRIVATE_DATA->is10Microns)
-						meade_command(device, ":TSOLAR#", NULL, 0, 0);
+						meade_command(device, ":TSOLAR#", NULL, 0);
 					else
-						meade_command(device, ":TS#", NULL, 0, 0);
+						meade_command(device, ":TS#", NULL, 0);
 					PRIVATE_DATA->lastTrackRate = 's';
 				} else if (MOUNT_TRACK_RATE_LUNAR_ITEM->sw.value && PRIVATE_DATA->lastTrackRate != 'l') {
 					if (PRIVATE_DATA->isGemini)
-						meade_command(device, ">130:133G#", NULL, 0, 0);
+						meade_command(device, ">130:133G#", NULL, 0);
 					else
-						meade_command(device, ":TL#", NULL, 0, 0);
+						meade_command(device, ":TL#", NULL, 0);
 					PRIVATE_DATA->lastTrackRate = 'l';
 				}
 				MOUNT_EQUATORIAL_COORDINATES_PROPERTY->state = INDIGO_OK_STATE;
 				sprintf(command, ":Sr%s#", indigo_dtos(MOUNT_EQUATORIAL_COORDINATES_RA_ITEM->number.target, "%02d:%02d:%02.0f"));
-				if (!meade_command(device, command, response, 1, 0) || *response != '1') {
+				if (!meade_command(device, command, response, 1) || *response != '1') {
 					INDIGO_DRIVER_ERROR(DRIVER_NAME, "%s failed", command);
 					MOUNT_EQUATORIAL_COORDINATES_PROPERTY->state = INDIGO_ALERT_STATE;
 				} else {
 					sprintf(command, ":Sd%s#", indigo_dtos(MOUNT_EQUATORIAL_COORDINATES_DEC_ITEM->number.target, "%+03d*%02d:%02.0f"));
-					if (!meade_command(device, command, response, 1, 0) || *response != '1') {
+					if (!meade_command(device, command, response, 1) || *response != '1') {
 						INDIGO_DRIVER_ERROR(DRIVER_NAME, "%s failed", command);
 						MOUNT_EQUATORIAL_COORDINATES_PROPERTY->state = INDIGO_ALERT_STATE;
 					} else {
-						if (!meade_command(device, ":MS#", response, 1, 100000) || *response != '0') {
+						if (!meade_command(device, ":MS#", response, 1) || *response != '0') {
 							INDIGO_DRIVER_ERROR(DRIVER_NAME, ":MS# failed");
 							MOUNT_EQUATORIAL_COORDINATES_PROPERTY->state = INDIGO_ALERT_STATE;
 						}
@@ -578,16 +550,16 @@ static indigo_result mount_change_property(indigo_device *device, indigo_client
 				}
 			} else if (MOUNT_ON_COORDINATES_SET_SYNC_ITEM->sw.value) {
 				sprintf(command, ":Sr%s#", indigo_dtos(MOUNT_EQUATORIAL_COORDINATES_RA_ITEM->number.target, "%02d:%02d:%02.0f"));
-				if (!meade_command(device, command, response, 1, 0) || *response != '1') {
+				if (!meade_command(device, command, response, 1) || *response != '1') {
 					INDIGO_DRIVER_ERROR(DRIVER_NAME, "%s failed", command);
 					MOUNT_EQUATORIAL_COORDINATES_PROPERTY->state = INDIGO_ALERT_STATE;
 				} else {
 					sprintf(command, ":Sd%s#", indigo_dtos(MOUNT_EQUATORIAL_COORDINATES_DEC_ITEM->number.target, "%+03d*%02d:%02.0f"));
-					if (!meade_command(device, command, response, 1, 0) || *response != '1') {
+					if (!meade_command(device, command, response, 1) || *response != '1') {
 						INDIGO_DRIVER_ERROR(DRIVER_NAME, "%s failed", command);
 						MOUNT_EQUATORIAL_COORDINATES_PROPERTY->state = INDIGO_ALERT_STATE;
 					} else {
-						if (!meade_command(device, ":CM#", response, sizeof(response), 100000) || *response == 0) {
+						if (!meade_command(device, ":CM#", response, sizeof(response) - 1) || *response == 0) {
 							INDIGO_DRIVER_ERROR(DRIVER_NAME, ":CM# failed");
 							MOUNT_EQUATORIAL_COORDINATES_PROPERTY->state = INDIGO_ALERT_STATE;
 						}
@@ -606,7 +578,7 @@ static indigo_result mount_change_property(indigo_device *device, indigo_client
 			indigo_property_copy_values(MOUNT_ABORT_MOTION_PROPERTY, property, false);
 			if (MOUNT_ABORT_MOTION_ITEM->sw.value) {
 				PRIVATE_DATA->position_timer = NULL;
-				meade_command(device, ":Q#", NULL, 0, 0);
+				meade_command(device, ":Q#", NULL, 0);
 				MOUNT_MOTION_NORTH_ITEM->sw.value = false;
 				MOUNT_MOTION_SOUTH_ITEM->sw.value = false;
 				MOUNT_MOTION_DEC_PROPERTY->state = INDIGO_OK_STATE;
@@ -633,35 +605,35 @@ static indigo_result mount_change_property(indigo_device *device, indigo_client
 		} else {
 			indigo_property_copy_values(MOUNT_MOTION_DEC_PROPERTY, property, false);
 			if (MOUNT_SLEW_RATE_GUIDE_ITEM->sw.value && PRIVATE_DATA->lastSlewRate != 'g') {
-				meade_command(device, ":RG#", NULL, 0, 0);
+				meade_command(device, ":RG#", NULL, 0);
 				PRIVATE_DATA->lastSlewRate = 'g';
 			} else if (MOUNT_SLEW_RATE_CENTERING_ITEM->sw.value && PRIVATE_DATA->lastSlewRate != 'c') {
-				meade_command(device, ":RC#", NULL, 0, 0);
+				meade_command(device, ":RC#", NULL, 0);
 				PRIVATE_DATA->lastSlewRate = 'c';
 			} else if (MOUNT_SLEW_RATE_FIND_ITEM->sw.value && PRIVATE_DATA->lastSlewRate != 'm') {
-				meade_command(device, ":RM#", NULL, 0, 0);
+				meade_command(device, ":RM#", NULL, 0);
 				PRIVATE_DATA->lastSlewRate = 'm';
 			} else if (MOUNT_SLEW_RATE_MAX_ITEM->sw.value && PRIVATE_DATA->lastSlewRate != 's') {
-				meade_command(device, ":RS#", NULL, 0, 0);
+				meade_command(device, ":RS#", NULL, 0);
 				PRIVATE_DATA->lastSlewRate = 's';
 			}
 			if (PRIVATE_DATA->isAvalon) {
 				if (PRIVATE_DATA->lastMotionNS == 'n' || PRIVATE_DATA->lastMotionNS == 's') {
-					meade_command(device, ":Q#", NULL, 0, 0);
+					meade_command(device, ":Q#", NULL, 0);
 				}
 			} else {
 				if (PRIVATE_DATA->lastMotionNS == 'n') {
-					meade_command(device, ":Qn#", NULL, 0, 0);
+					meade_command(device, ":Qn#", NULL, 0);
 				} else if (PRIVATE_DATA->lastMotionNS == 's') {
-					meade_command(device, ":Qs#", NULL, 0, 0);
+					meade_command(device, ":Qs#", NULL, 0);
 				}
 			}
 			if (MOUNT_MOTION_NORTH_ITEM->sw.value) {
 				PRIVATE_DATA->lastMotionNS = 'n';
-				meade_command(device, ":Mn#", NULL, 0, 0);
+				meade_command(device, ":Mn#", NULL, 0);
 			} else if (MOUNT_MOTION_SOUTH_ITEM->sw.value) {
 				PRIVATE_DATA->lastMotionNS = 's';
-				meade_command(device, ":Ms#", NULL, 0, 0);
+				meade_command(device, ":Ms#", NULL, 0);
 			} else {
 				PRIVATE_DATA->lastMotionNS = 0;
 			}
@@ -677,35 +649,35 @@ static indigo_result mount_change_property(indigo_device *device, indigo_client
 		} else {
 			indigo_property_copy_values(MOUNT_MOTION_RA_PROPERTY, property, false);
 			if (MOUNT_SLEW_RATE_GUIDE_ITEM->sw.value && PRIVATE_DATA->lastSlewRate != 'g') {
-				meade_command(device, ":RG#", NULL, 0, 0);
+				meade_command(device, ":RG#", NULL, 0);
 				PRIVATE_DATA->lastSlewRate = 'g';
 			} else if (MOUNT_SLEW_RATE_CENTERING_ITEM->sw.value && PRIVATE_DATA->lastSlewRate != 'c') {
-				meade_command(device, ":RC#", NULL, 0, 0);
+				meade_command(device, ":RC#", NULL, 0);
 				PRIVATE_DATA->lastSlewRate = 'c';
 			} else if (MOUNT_SLEW_RATE_FIND_ITEM->sw.value && PRIVATE_DATA->lastSlewRate != 'm') {
-				meade_command(device, ":RM#", NULL, 0, 0);
+				meade_command(device, ":RM#", NULL, 0);
 				PRIVATE_DATA->lastSlewRate = 'm';
 			} else if (MOUNT_SLEW_RATE_MAX_ITEM->sw.value && PRIVATE_DATA->lastSlewRate != 's') {
-				meade_command(device, ":RS#", NULL, 0, 0);
+				meade_command(device, ":RS#", NULL, 0);
 				PRIVATE_DATA->lastSlewRate = 's';
 			}
 			if (PRIVATE_DATA->isAvalon) {
 				if (PRIVATE_DATA->lastMotionWE == 'w' || PRIVATE_DATA->lastMotionWE == 'e') {
-					meade_command(device, ":Q#", NULL, 0, 0);
+					meade_command(device, ":Q#", NULL, 0);
 				}
 			} else {
 				if (PRIVATE_DATA->lastMotionWE == 'w') {
-					meade_command(device, ":Qw#", NULL, 0, 0);
+					meade_command(device, ":Qw#", NULL, 0);
 				} else if (PRIVATE_DATA->lastMotionWE == 'e') {
-					meade_command(device, ":Qe#", NULL, 0, 0);
+					meade_command(device, ":Qe#", NULL, 0);
 				}
 			}
 			if (MOUNT_MOTION_WEST_ITEM->sw.value) {
 				PRIVATE_DATA->lastMotionWE = 'w';
-				meade_command(device, ":Mw#", NULL, 0, 0);
+				meade_command(device, ":Mw#", NULL, 0);
 			} else if (MOUNT_MOTION_EAST_ITEM->sw.value) {
 				PRIVATE_DATA->lastMotionWE = 'e';
-				meade_command(device, ":Me#", NULL, 0, 0);
+				meade_command(device, ":Me#", NULL, 0);
 			} else {
 				PRIVATE_DATA->lastMotionWE = 0;
 			}
@@ -720,15 +692,15 @@ static indigo_result mount_change_property(indigo_device *device, indigo_client
 			time_t secs = time(NULL);
 			struct tm tm = *localtime(&secs);
 			sprintf(command, ":SL%02d:%02d:%02d#", tm.tm_hour, tm.tm_min, tm.tm_sec);
-			if (!meade_command(device, command, response, 1, 0) || *response != '1') {
+			if (!meade_command(device, command, response, 1) || *response != '1') {
 				MOUNT_SET_HOST_TIME_PROPERTY->state = INDIGO_ALERT_STATE;
 			} else {
 				sprintf(command, ":SC%02d/%02d/%02d#", tm.tm_mon + 1, tm.tm_mday, tm.tm_year % 100);
-				if (!meade_command(device, command, response, 1, 0) || *response != '1') {
+				if (!meade_command(device, command, response, 1) || *response != '1') {
 					MOUNT_SET_HOST_TIME_PROPERTY->state = INDIGO_ALERT_STATE;
 				} else {
 					sprintf(command, ":SG%02ld#", tm.tm_gmtoff / 3600);
-					if (!meade_command(device, command, response, 1, 0) || *response != '1') {
+					if (!meade_command(device, command, response, 1) || *response != '1') {
 						MOUNT_SET_HOST_TIME_PROPERTY->state = INDIGO_ALERT_STATE;
 					} else {
 						MOUNT_SET_HOST_TIME_PROPERTY->state = INDIGO_OK_STATE;
@@ -754,15 +726,15 @@ static indigo_result mount_change_property(indigo_device *device, indigo_client
 			struct tm tm = *localtime(&secs);
 			char command[20], response[2];
 			sprintf(command, ":SL%02d:%02d:%02d#", tm.tm_hour, tm.tm_min, tm.tm_sec);
-			if (!meade_command(device, command, response, 1, 0) || *response != '1') {
+			if (!meade_command(device, command, response, 1) || *response != '1') {
 				MOUNT_UTC_TIME_PROPERTY->state = INDIGO_ALERT_STATE;
 			} else {
 					sprintf(command, ":SC%02d/%02d/%02d#", tm.tm_mon + 1, tm.tm_mday, tm.tm_year % 100);
-					if (!meade_command(device, command, response, 1, 0) || *response != '1') {
+					if (!meade_command(device, command, response, 1) || *response != '1') {
 						MOUNT_SET_HOST_TIME_PROPERTY->state = INDIGO_ALERT_STATE;
 					} else {
 						sprintf(command, ":SG%02ld#", tm.tm_gmtoff / 3600);
-						if (!meade_command(device, command, response, 1, 0) || *response != '1') {
+						if (!meade_command(device, command, response, 1) || *response != '1') {
 							MOUNT_SET_HOST_TIME_PROPERTY->state = INDIGO_ALERT_STATE;
 						} else {
 						MOUNT_UTC_TIME_PROPERTY->state = INDIGO_OK_STATE;
@@ -776,20 +748,20 @@ static indigo_result mount_change_property(indigo_device *device, indigo_client
 		indigo_property_copy_values(MOUNT_TRACKING_PROPERTY, property, false);
 		if (MOUNT_TRACKING_ON_ITEM->sw.value) {
 			if (PRIVATE_DATA->is10Microns) {
-				meade_command(device, ":AP#", NULL, 0, 0);
+				meade_command(device, ":AP#", NULL, 0);
 				MOUNT_TRACKING_PROPERTY->state = INDIGO_OK_STATE;
 			} else if (PRIVATE_DATA->isGemini) {
-				meade_command(device, ">190:192F#", NULL, 0, 0);
+				meade_command(device, ">190:192F#", NULL, 0);
 				MOUNT_TRACKING_PROPERTY->state = INDIGO_OK_STATE;
 			} else if (PRIVATE_DATA->isAvalon) {
-				meade_command(device, ":X122#", NULL, 0, 0);
+				meade_command(device, ":X122#", NULL, 0);
 				MOUNT_TRACKING_PROPERTY->state = INDIGO_OK_STATE;
 			} else {
 				if (ALTAZ_MODE_ITEM->sw.value) {
-					meade_command(device, ":AA#", NULL, 0, 0);
+					meade_command(device, ":AA#", NULL, 0);
 					MOUNT_TRACKING_PROPERTY->state = INDIGO_OK_STATE;
 				} else if (POLAR_MODE_ITEM->sw.value) {
-					meade_command(device, ":AP#", NULL, 0, 0);
+					meade_command(device, ":AP#", NULL, 0);
 					MOUNT_TRACKING_PROPERTY->state = INDIGO_OK_STATE;
 				} else {
 					MOUNT_TRACKING_PROPERTY->state = INDIGO_ALERT_STATE;
@@ -797,13 +769,13 @@ static indigo_result mount_change_property(indigo_device *device, indigo_client
 			}
 		} else {
 			if (PRIVATE_DATA->isGemini) {
-				meade_command(device, ">190:191E#", NULL, 0, 0);
+				meade_command(device, ">190:191E#", NULL, 0);
 				MOUNT_TRACKING_PROPERTY->state = INDIGO_OK_STATE;
 			} else if (PRIVATE_DATA->isAvalon) {
-				meade_command(device, ":X120#", NULL, 0, 0);
+				meade_command(device, ":X120#", NULL, 0);
 				MOUNT_TRACKING_PROPERTY->state = INDIGO_OK_STATE;
 			} else {
-				meade_command(device, ":AL#", NULL, 0, 0);
+				meade_command(device, ":AL#", NULL, 0);
 			}
 			MOUNT_TRACKING_PROPERTY->state = INDIGO_OK_STATE;
 		}
@@ -813,9 +785,9 @@ static indigo_result mount_change_property(indigo_device *device, indigo_client
 		// -------------------------------------------------------------------------------- ALIGNMENT_MODE
 		indigo_property_copy_values(ALIGNMENT_MODE_PROPERTY, property, false);
 		if (ALTAZ_MODE_ITEM->sw.value) {
-			meade_command(device, ":AA#", NULL, 0, 0);
+			meade_command(device, ":AA#", NULL, 0);
 		} else if (POLAR_MODE_ITEM->sw.value) {
-			meade_command(device, ":AP#", NULL, 0, 0);
+			meade_command(device, ":AP#", NULL, 0);
 		}
 		ALIGNMENT_MODE_PROPERTY->state = INDIGO_OK_STATE;
 		indigo_update_property(device, ALIGNMENT_MODE_PROPERTY, NULL);
@@ -879,10 +851,10 @@ static indigo_result guider_change_property(indigo_device *device, indigo_client
 		char command[128];
 		if (GUIDER_GUIDE_NORTH_ITEM->number.value > 0) {
 			sprintf(command, ":Mgn%4.0f#", GUIDER_GUIDE_NORTH_ITEM->number.value);
-			meade_command(device, command, NULL, 0, 0);
+			meade_command(device, command, NULL, 0);
 		} else if (GUIDER_GUIDE_SOUTH_ITEM->number.value > 0) {
 			sprintf(command, ":Mgs%4.0f#", GUIDER_GUIDE_SOUTH_ITEM->number.value);
-			meade_command(device, command, NULL, 0, 0);
+			meade_command(device, command, NULL, 0);
 		}
 		GUIDER_GUIDE_NORTH_ITEM->number.value = GUIDER_GUIDE_SOUTH_ITEM->number.value = 0;
 		GUIDER_GUIDE_DEC_PROPERTY->state = INDIGO_OK_STATE;
@@ -894,10 +866,10 @@ static indigo_result guider_change_property(indigo_device *device, indigo_client
 		char command[128];
 		if (GUIDER_GUIDE_WEST_ITEM->number.value > 0) {
 			sprintf(command, ":Mgw%4.0f#", GUIDER_GUIDE_WEST_ITEM->number.value);
-			meade_command(device, command, NULL, 0, 0);
+			meade_command(device, command, NULL, 0);
 		} else if (GUIDER_GUIDE_EAST_ITEM->number.value > 0) {
 			sprintf(command, ":Mge%4.0f#", GUIDER_GUIDE_EAST_ITEM->number.value);
-			meade_command(device, command, NULL, 0, 0);
+			meade_command(device, command, NULL, 0);
 		}
 		GUIDER_GUIDE_WEST_ITEM->number.value = GUIDER_GUIDE_EAST_ITEM->number.value = 0;
 		GUIDER_GUIDE_RA_PROPERTY->state = INDIGO_OK_STATE;
@@ -89,89 +89,36 @@ static long hexResponseToLong(const char* b) {
 
 static bool synscan_command(indigo_device* device, const char* cmd, char* r) {
 	int nretries = 0;
+	char command[20], resp[20];
+	snprintf(command, sizeof(command), "%s\r", cmd);
 	pthread_mutex_lock(&PRIVATE_DATA->port_mutex);
 	while (nretries < 2) {
-		//  Sleep for a bit if we're having to retry
-		//if (nretries > 0)
-		//    sleep(1);
 		nretries++;
 
-		//  Flush input
-		unsigned char c;
-		struct timeval tv;
-		while (true) {
-			fd_set readout;
-			FD_ZERO(&readout);
-			FD_SET(PRIVATE_DATA->handle, &readout);
-			tv.tv_sec = 0;
-			tv.tv_usec = 100000;
-			long result = select(1, &readout, NULL, NULL, &tv);
-			if (result == 0)
-				break;
-			if (result < 0) {
-				pthread_mutex_unlock(&PRIVATE_DATA->port_mutex);
-				INDIGO_DRIVER_ERROR(DRIVER_NAME, "SELECT FAIL 1\n");
-				return false;
-			}
-			result = read(PRIVATE_DATA->handle, &c, 1);
-			if (result < 1) {
-				pthread_mutex_unlock(&PRIVATE_DATA->port_mutex);
-				INDIGO_DRIVER_ERROR(DRIVER_NAME, "READ FAIL 1\n");
-				return false;
-			}
-		}
-
-		//  Send the command to the port
+		//  Drain input, send the command to the port and read response up to <cr>
 		INDIGO_DRIVER_DEBUG(DRIVER_NAME, "CMD: [%s]\n", cmd);
-		if (!indigo_write(PRIVATE_DATA->handle, cmd, strlen(cmd))) {
+		indigo_transaction transaction = { command, resp, sizeof(resp) - 1, '\r', 1000000L, 1000000L, 0 };
+		if (!indigo_execute_transactions(PRIVATE_DATA->handle, &transaction, 1)) {
 			INDIGO_DRIVER_ERROR(DRIVER_NAME, "Sending command failed\n");
 			break;
 		}
-		if (!indigo_write(PRIVATE_DATA->handle, "\r", 1)) {
-			INDIGO_DRIVER_ERROR(DRIVER_NAME, "Sending command terminator failed\n");
-			break;
-		}
-
-		//  Read a response
-		char resp[20];
-		long total_bytes = 0;
-		while (total_bytes < sizeof(resp)) {
-			long bytes_read = read(PRIVATE_DATA->handle, &c, 1);
-			if (bytes_read == 0) {
-				INDIGO_DRIVER_ERROR(DRIVER_NAME, "SYNSCAN_TIMEOUT\n");
-				break;
-			}
-			if (bytes_read > 0) {
-				resp[total_bytes++] = c;
-				if (c == '\r')
-					//			else
-					break;
-				//		} else {
-				//			errno = ECONNRESET;
-				//			return -1;
-			}
-		}
-		resp[total_bytes] = 0;
-		if (total_bytes <= 0) {
-		//NSData* resp = [self.transport readUpToChar:'\r' withTimeout:1000];
-		//if (!resp) {
+		if (transaction.length <= 0 || !transaction.terminated) {
 			INDIGO_DRIVER_ERROR(DRIVER_NAME, "Reading response failed\n");
 			continue;
 		}
 
 		//  Check response syntax =...<cr>, if invalid retry
-		//const char* cresp = (const char*) [resp bytes];
 		size_t len = strlen(resp);
 		INDIGO_DRIVER_DEBUG(DRIVER_NAME, "RESPONSE: [%s]\n", resp);
-		if (len < 2 || resp[0] != '=' || resp[len - 1] != '\r') {
+		if (len < 1 || len != transaction.length || resp[0] != '=') {
 			INDIGO_DRIVER_ERROR(DRIVER_NAME, "Response syntax error\n");
 			continue;
 		}
 
 		//  Extract response payload, return
 		if (r) {
-			strncpy(r, resp+1, len-2);
-			r[len-2] = 0;
+			strncpy(r, resp + 1, len - 1);
+			r[len - 1] = 0;
 		}
 		pthread_mutex_unlock(&PRIVATE_DATA->port_mutex);
 		return true;
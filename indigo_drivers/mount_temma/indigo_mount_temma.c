@@ -133,44 +133,18 @@ static bool temma_open(indigo_device *device) {
 }
 
 static bool temma_command(indigo_device *device, char *command, bool wait) {
+	char buffer[128], line[128];
+	snprintf(line, sizeof(line), "%s\r\n", command);
+	indigo_transaction transaction = { line, wait ? buffer : NULL, sizeof(buffer) - 1, '\n', 300000L, 300000L, 0 };
 	pthread_mutex_lock(&PRIVATE_DATA->port_mutex);
-	char c;
-	struct timeval tv;
-	// write command
-	indigo_write(PRIVATE_DATA->handle, command, strlen(command));
-	indigo_write(PRIVATE_DATA->handle, "\r\n", 2);
-	// read response
+	if (!indigo_execute_transactions(PRIVATE_DATA->handle, &transaction, 1) || (wait && (transaction.length == 0 || !transaction.terminated))) {
+		INDIGO_DRIVER_ERROR(DRIVER_NAME, "failed to communicate with %s -> %s (%d)", DEVICE_PORT_ITEM->text.value, strerror(errno), errno);
+		pthread_mutex_unlock(&PRIVATE_DATA->port_mutex);
+		return false;
+	}
 	if (wait) {
-		char buffer[128];
-		int index = 0;
-		int timeout = 3;
-		int max = sizeof(buffer) - 1;
-		while (index < max) {
-			fd_set readout;
-			FD_ZERO(&readout);
-			FD_SET(PRIVATE_DATA->handle, &readout);
-			tv.tv_sec = 0;
-			tv.tv_usec = 300000;
-			timeout = 0;
-			long result = select(PRIVATE_DATA->handle+1, &readout, NULL, NULL, &tv);
-			if (result <= 0) {
-				INDIGO_DRIVER_ERROR(DRIVER_NAME, "select failed from %s -> %s (%d)", DEVICE_PORT_ITEM->text.value, strerror(errno), errno);
-				pthread_mutex_unlock(&PRIVATE_DATA->port_mutex);
-				return false;
-			}
-			result = read(PRIVATE_DATA->handle, &c, 1);
-			if (result < 1) {
-				INDIGO_DRIVER_ERROR(DRIVER_NAME, "failed to read from %s -> %s (%d)", DEVICE_PORT_ITEM->text.value, strerror(errno), errno);
-				pthread_mutex_unlock(&PRIVATE_DATA->port_mutex);
-				return false;
-			}
-			if (c == '\r')
-				continue;
-			if (c == '\n')
-				break;
-			buffer[index++] = c;
-		}
-		buffer[index] = 0;
+		if (transaction.length > 0 && buffer[transaction.length - 1] == '\r')
+			buffer[transaction.length - 1] = 0;
 		INDIGO_DRIVER_DEBUG(DRIVER_NAME, "command '%s' -> '%s'", command, buffer);
 		switch (buffer[0]) {
 			case 'E': {
@@ -23,7 +23,7 @@
  \file indigo_ccd_xagyl.c
  */
 
-#define DRIVER_VERSION 0x0001
+#define DRIVER_VERSION 0x0002
 #define DRIVER_NAME "indigo_wheel_xagyl"
 
 #include <stdlib.h>
@@ -40,42 +40,75 @@
 
 #define PRIVATE_DATA        ((xagyl_private_data *)device->private_data)
 
+#define X_WHEEL_PORT_STATISTICS_PROPERTY		(PRIVATE_DATA->port_statistics_property)
+#define X_WHEEL_PORT_QUEUE_DEPTH_ITEM				(X_WHEEL_PORT_STATISTICS_PROPERTY->items+0)
+#define X_WHEEL_PORT_AVERAGE_LATENCY_ITEM		(X_WHEEL_PORT_STATISTICS_PROPERTY->items+1)
+#define X_WHEEL_PORT_MAX_LATENCY_ITEM				(X_WHEEL_PORT_STATISTICS_PROPERTY->items+2)
+#define X_WHEEL_PORT_MERGED_ITEM						(X_WHEEL_PORT_STATISTICS_PROPERTY->items+3)
+
+#define XAGYL_TIMEOUT		3000000L
+
 typedef struct {
 	int handle;
+	indigo_port *port;
 	int slot;
+	indigo_property *port_statistics_property;
 } xagyl_private_data;
 
+static bool xagyl_command(indigo_device *device, indigo_priority priority, char *command, char *response, int max) {
+	indigo_transaction transaction = { command, response, max - 1, '\n', XAGYL_TIMEOUT, 0 };
+	if (!indigo_port_execute(PRIVATE_DATA->port, priority, &transaction, 1) || (response != NULL && transaction.length <= 0)) {
+		INDIGO_DRIVER_DEBUG(DRIVER_NAME, "Command %s -> no response", command);
+		return false;
+	}
+	if (response != NULL && response[transaction.length - 1] == '\r')
+		response[transaction.length - 1] = 0;
+	INDIGO_DRIVER_DEBUG(DRIVER_NAME, "Command %s -> %s", command, response != NULL ? response : "NULL");
+	return true;
+}
+
+static void xagyl_update_statistics(indigo_device *device) {
+	indigo_port_statistics statistics;
+	indigo_port_get_statistics(PRIVATE_DATA->port, &statistics);
+	X_WHEEL_PORT_QUEUE_DEPTH_ITEM->number.value = statistics.queue_depth;
+	X_WHEEL_PORT_AVERAGE_LATENCY_ITEM->number.value = round(statistics.average_latency * 1000);
+	X_WHEEL_PORT_MAX_LATENCY_ITEM->number.value = round(statistics.max_latency * 1000);
+	X_WHEEL_PORT_MERGED_ITEM->number.value = statistics.merged;
+	indigo_update_property(device, X_WHEEL_PORT_STATISTICS_PROPERTY, NULL);
+}
+
 static bool xagyl_open(indigo_device *device) {
 	char *name = DEVICE_PORT_ITEM->text.value;
 	PRIVATE_DATA->handle = indigo_open_serial(name);
 	if (PRIVATE_DATA->handle >= 0) {
 		INDIGO_DRIVER_LOG(DRIVER_NAME, "connected to %s", name);
-		char buffer[128];
-		if (indigo_printf(PRIVATE_DATA->handle, "I0") && indigo_scanf(PRIVATE_DATA->handle, "Xagyl %s", buffer) == 1) {
+		PRIVATE_DATA->port = indigo_port_open(PRIVATE_DATA->handle);
+		char buffer[128], response[128];
+		if (xagyl_command(device, INDIGO_PRIORITY_MOVE, "I0", response, sizeof(response)) && sscanf(response, "Xagyl %s", buffer) == 1) {
 			strncpy(INFO_DEVICE_MODEL_ITEM->text.value, buffer, INDIGO_VALUE_SIZE);
 		} else {
 			INDIGO_DRIVER_ERROR(DRIVER_NAME, "Failed to read model name");
 			return false;
 		}
-		if (indigo_printf(PRIVATE_DATA->handle, "I1") && indigo_scanf(PRIVATE_DATA->handle, "FW %s", buffer) == 1) {
+		if (xagyl_command(device, INDIGO_PRIORITY_MOVE, "I1", response, sizeof(response)) && sscanf(response, "FW %s", buffer) == 1) {
 			strncpy(INFO_DEVICE_FW_REVISION_ITEM->text.value, buffer, INDIGO_VALUE_SIZE);
 		} else {
 			INDIGO_DRIVER_ERROR(DRIVER_NAME, "Failed to read firmware version");
 			return false;
 		}
-		if (indigo_printf(PRIVATE_DATA->handle, "I3") && indigo_scanf(PRIVATE_DATA->handle, "S/N: %s", buffer) == 1) {
+		if (xagyl_command(device, INDIGO_PRIORITY_MOVE, "I3", response, sizeof(response)) && sscanf(response, "S/N: %s", buffer) == 1) {
 			strncpy(INFO_DEVICE_SERIAL_NUM_ITEM->text.value, buffer, INDIGO_VALUE_SIZE);
 		} else {
 			INDIGO_DRIVER_ERROR(DRIVER_NAME, "Failed to read S/N");
 			return false;
 		}
-		if (indigo_printf(PRIVATE_DATA->handle, "I8") && indigo_scanf(PRIVATE_DATA->handle, "FilterSlots %d", &PRIVATE_DATA->slot) == 1) {
+		if (xagyl_command(device, INDIGO_PRIORITY_MOVE, "I8", response, sizeof(response)) && sscanf(response, "FilterSlots %d", &PRIVATE_DATA->slot) == 1) {
 			WHEEL_SLOT_ITEM->number.max = PRIVATE_DATA->slot;
 		} else {
 			INDIGO_DRIVER_ERROR(DRIVER_NAME, "Failed to read slot count");
 			return false;
 		}
-		if (indigo_printf(PRIVATE_DATA->handle, "I2") && indigo_scanf(PRIVATE_DATA->handle, "P%d", &PRIVATE_DATA->slot) == 1) {
+		if (xagyl_command(device, INDIGO_PRIORITY_MOVE, "I2", response, sizeof(response)) && sscanf(response, "P%d", &PRIVATE_DATA->slot) == 1) {
 			WHEEL_SLOT_ITEM->number.value = PRIVATE_DATA->slot;
 		} else {
 			INDIGO_DRIVER_ERROR(DRIVER_NAME, "Failed to read position");
@@ -89,8 +122,10 @@ static bool xagyl_open(indigo_device *device) {
 }
 
 static void xagyl_query(indigo_device *device) {
+	char response[128];
 	for (int repeat = 0; repeat < 60; repeat++) {
-		if (indigo_printf(PRIVATE_DATA->handle, "I2") && indigo_scanf(PRIVATE_DATA->handle, "P%d", &PRIVATE_DATA->slot) == 1) {
+		if (xagyl_command(device, INDIGO_PRIORITY_STATUS, "I2", response, sizeof(response)) && sscanf(response, "P%d", &PRIVATE_DATA->slot) == 1) {
+			xagyl_update_statistics(device);
 			if (PRIVATE_DATA->slot == WHEEL_SLOT_ITEM->number.target) {
 				WHEEL_SLOT_ITEM->number.value = PRIVATE_DATA->slot;
 				WHEEL_SLOT_PROPERTY->state = INDIGO_OK_STATE;
@@ -113,7 +148,9 @@ static void xagyl_query(indigo_device *device) {
 }
 
 static void xagyl_goto(indigo_device *device, int slot) {
-	indigo_printf(PRIVATE_DATA->handle, "G%d", slot);
+	char command[16];
+	snprintf(command, sizeof(command), "G%d", slot);
+	xagyl_command(device, INDIGO_PRIORITY_MOVE, command, NULL, 0);
 	WHEEL_SLOT_PROPERTY->state = INDIGO_BUSY_STATE;
 	indigo_update_property(device, WHEEL_SLOT_PROPERTY, NULL);
 	indigo_set_timer(device, 1, xagyl_query);
@@ -121,7 +158,8 @@ static void xagyl_goto(indigo_device *device, int slot) {
 
 static void xagyl_close(indigo_device *device) {
 	if (PRIVATE_DATA->handle > 0) {
-		close(PRIVATE_DATA->handle);
+		indigo_port_close(PRIVATE_DATA->port);
+		PRIVATE_DATA->port = NULL;
 		PRIVATE_DATA->handle = 0;
 		INDIGO_DRIVER_LOG(DRIVER_NAME, "disconnected from %s", DEVICE_PORT_ITEM->text.value);
 	}
@@ -136,12 +174,27 @@ static indigo_result wheel_attach(indigo_device *device) {
 		DEVICE_PORT_PROPERTY->hidden = false;
 		DEVICE_PORTS_PROPERTY->hidden = false;
 		INFO_PROPERTY->count = 7;
+		X_WHEEL_PORT_STATISTICS_PROPERTY = indigo_init_number_property(NULL, device->name, "X_WHEEL_PORT_STATISTICS", WHEEL_MAIN_GROUP, "Port statistics", INDIGO_OK_STATE, INDIGO_RO_PERM, 4);
+		if (X_WHEEL_PORT_STATISTICS_PROPERTY == NULL)
+			return INDIGO_FAILED;
+		indigo_init_number_item(X_WHEEL_PORT_QUEUE_DEPTH_ITEM, "QUEUE_DEPTH", "Queue depth", 0, 100, 0, 0);
+		indigo_init_number_item(X_WHEEL_PORT_AVERAGE_LATENCY_ITEM, "AVERAGE_LATENCY", "Average latency [ms]", 0, 100000, 0, 0);
+		indigo_init_number_item(X_WHEEL_PORT_MAX_LATENCY_ITEM, "MAX_LATENCY", "Max latency [ms]", 0, 100000, 0, 0);
+		indigo_init_number_item(X_WHEEL_PORT_MERGED_ITEM, "MERGED", "Merged polls", 0, 1000000000, 0, 0);
 		INDIGO_DEVICE_ATTACH_LOG(DRIVER_NAME, device->name);
 		return indigo_wheel_enumerate_properties(device, NULL, NULL);
 	}
 	return INDIGO_FAILED;
 }
 
+static indigo_result wheel_enumerate_properties(indigo_device *device, indigo_client *client, indigo_property *property) {
+	if (IS_CONNECTED) {
+		if (indigo_property_match(X_WHEEL_PORT_STATISTICS_PROPERTY, property))
+			indigo_define_property(device, X_WHEEL_PORT_STATISTICS_PROPERTY, NULL);
+	}
+	return indigo_wheel_enumerate_properties(device, client, property);
+}
+
 static indigo_result wheel_change_property(indigo_device *device, indigo_client *client, indigo_property *property) {
 	assert(device != NULL);
 	assert(DEVICE_CONTEXT != NULL);
@@ -152,12 +205,15 @@ static indigo_result wheel_change_property(indigo_device *device, indigo_client
 		if (CONNECTION_CONNECTED_ITEM->sw.value) {
 			if (xagyl_open(device)) {
 				indigo_update_property(device, INFO_PROPERTY, NULL);
+				indigo_define_property(device, X_WHEEL_PORT_STATISTICS_PROPERTY, NULL);
 				CONNECTION_PROPERTY->state = INDIGO_OK_STATE;
 			} else {
+				xagyl_close(device);
 				CONNECTION_PROPERTY->state = INDIGO_ALERT_STATE;
 				indigo_set_switch(CONNECTION_PROPERTY, CONNECTION_DISCONNECTED_ITEM, true);
 			}
 		} else {
+			indigo_delete_property(device, X_WHEEL_PORT_STATISTICS_PROPERTY, NULL);
 			xagyl_close(device);
 			CONNECTION_PROPERTY->state = INDIGO_OK_STATE;
 		}
@@ -184,6 +240,7 @@ static indigo_result wheel_detach(indigo_device *device) {
 	assert(device != NULL);
 	if (CONNECTION_CONNECTED_ITEM->sw.value)
 		indigo_device_disconnect(NULL, device->name);
+	indigo_release_property(X_WHEEL_PORT_STATISTICS_PROPERTY);
 	INDIGO_DEVICE_DETACH_LOG(DRIVER_NAME, device->name);
 	return indigo_wheel_detach(device);
 }
@@ -195,7 +252,7 @@ indigo_result indigo_wheel_xagyl(indigo_driver_action action, indigo_driver_info
 	static indigo_device wheel_template = INDIGO_DEVICE_INITIALIZER(
 		"Xagyl Filter Wheel",
 		wheel_attach,
-		indigo_wheel_enumerate_properties,
+		wheel_enumerate_properties,
 		wheel_change_property,
 		NULL,
 		wheel_detach
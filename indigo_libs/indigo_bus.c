@@ -33,7 +33,9 @@
 #include <sys/time.h>
 #include <syslog.h>
 #include <unistd.h>
+#include <errno.h>
 #include <sys/socket.h>
+#include <signal.h>
 #endif
 #if defined(INDIGO_WINDOWS)
 #include <io.h>
@@ -44,20 +46,56 @@
 #include "indigo_bus.h"
 #include "indigo_names.h"
 #include "indigo_io.h"
+#include "indigo_metrics.h"
 
 #define MAX_DEVICES 256
 #define MAX_CLIENTS 256
-#define MAX_BLOBS	32
 
 #define BUFFER_SIZE	1024
 
+#define BROADCAST_CACHE_SIZE	16
+
+#define DEVICE_HASH_SIZE	512		/* power of 2 */
+
 static indigo_device *devices[MAX_DEVICES];
 static indigo_client *clients[MAX_CLIENTS];
-static indigo_property *blobs[MAX_BLOBS];
-static pthread_mutex_t device_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_rwlock_t device_lock = PTHREAD_RWLOCK_INITIALIZER;
 static pthread_mutex_t client_mutex = PTHREAD_MUTEX_INITIALIZER;
 static bool is_started = false;
 
+// device registry, devices are indexed by name, remote server adapters ('@ host' names) are kept in separate list,
+// slots are collected and pinned under read lock and callbacks are called without lock, so they can attach or detach devices,
+// detached device is unregistered first and its detach callback is called after all pins from other threads are released
+
+static int device_hash[DEVICE_HASH_SIZE];
+static int device_next[MAX_DEVICES];
+static int remote_devices[MAX_DEVICES];
+static int remote_device_count = 0;
+static int device_pins[MAX_DEVICES];
+static pthread_mutex_t device_pin_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t device_unpinned = PTHREAD_COND_INITIALIZER;
+
+typedef struct device_route {
+	struct device_route *previous;
+	int count;
+	int slots[MAX_DEVICES];
+	indigo_device *targets[MAX_DEVICES];
+} device_route;
+
+static pthread_once_t device_route_once = PTHREAD_ONCE_INIT;
+static pthread_key_t device_route_key;
+
+typedef struct broadcast_cache {
+	struct broadcast_cache *previous;
+	int count;
+	uint32_t keys[BROADCAST_CACHE_SIZE];
+	indigo_shared_message *messages[BROADCAST_CACHE_SIZE];
+} broadcast_cache;
+
+static pthread_mutex_t shared_message_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_key_t broadcast_cache_key;
+static pthread_once_t broadcast_cache_once = PTHREAD_ONCE_INIT;
+
 char *indigo_property_type_text[] = {
 	"UNDEFINED",
 	"TEXT",
@@ -103,7 +141,6 @@ bool indigo_is_sandboxed = false;
 const char **indigo_main_argv = NULL;
 int indigo_main_argc = 0;
 
-char indigo_last_message[128 * 1024];
 char indigo_log_name[255] = {0};
 
 #if defined(INDIGO_WINDOWS)
@@ -128,67 +165,445 @@ int gettimeofday(struct timeval * tp, struct timezone * tzp) {
 }
 #endif
 
-void indigo_log_message(const char *format, va_list args) {
-	static pthread_mutex_t log_mutex = PTHREAD_MUTEX_INITIALIZER;
-	pthread_mutex_lock(&log_mutex);
-	vsnprintf(indigo_last_message, sizeof(indigo_last_message), format, args);
-	char *line = indigo_last_message;
-	if (indigo_log_message_handler != NULL) {
-		indigo_log_message_handler(indigo_last_message);
-#if defined(INDIGO_LINUX) || defined(INDIGO_MACOS)
-  } else if (indigo_use_syslog) {
-		static bool initialize = true;
-		if (initialize)
-			openlog("INDIGO", LOG_NDELAY, LOG_USER | LOG_PERROR);
-		while (line) {
-			char *eol = strchr(line, '\n');
-			if (eol)
-				*eol = 0;
-			if (eol > line)
-				syslog (LOG_NOTICE, "%s", indigo_last_message);
-			syslog (LOG_NOTICE, "%s", line);
-			if (eol)
-				line = eol + 1;
-			else
-				line = NULL;
-		}
-#endif
-	} else {
-		char timestamp[16];
-		struct timeval tmnow;
-		gettimeofday(&tmnow, NULL);
-		strftime (timestamp, 9, "%H:%M:%S", localtime((const time_t *) &tmnow.tv_sec));
-#ifdef INDIGO_MACOS
-		snprintf(timestamp + 8, sizeof(timestamp) - 8, ".%06d", tmnow.tv_usec);
+// -------------------------------------------------------------------------------- asynchronous logging
+
+// Every thread formats its messages into its own single-producer ring; a background writer thread merges
+// the rings in timestamp order and does the slow part (localtime, line splitting and output). Producers
+// never block: when a ring is full the message is dropped and counted, and the writer reports the loss.
+// The writer sleeps on a condition until a producer finds it idle, rings are flushed at exit and on fatal signal.
+
+#define LOG_RING_SIZE		(64 * 1024)	/* bytes, power of 2 */
+#define LOG_TEXT_SIZE		1024				/* longer messages are copied to heap */
+
+#if defined(_MSC_VER)
+#define LOG_LOAD(p)							(*(volatile unsigned *)(p))
+#define LOG_STORE(p, v)					(*(volatile unsigned *)(p) = (v))
+#define LOG_INCREMENT(p)				InterlockedIncrement((volatile long *)(p))
+#define LOG_TAKE(p)							((unsigned)InterlockedExchange((volatile long *)(p), 0))
+#define LOG_FIRST(list)					((log_ring *)InterlockedCompareExchangePointer((volatile PVOID *)(list), NULL, NULL))
+#define LOG_PUSH(list, ring)		(InterlockedCompareExchangePointer((volatile PVOID *)(list), (ring), (ring)->next) == (ring)->next || ((ring)->next = LOG_FIRST(list), false))
+#define LOG_FENCE()							MemoryBarrier()
 #else
-		snprintf(timestamp + 8, sizeof(timestamp) - 8, ".%06ld", tmnow.tv_usec);
+#define LOG_LOAD(p)							__atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define LOG_STORE(p, v)					__atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#define LOG_INCREMENT(p)				__atomic_fetch_add((p), 1, __ATOMIC_RELAXED)
+#define LOG_TAKE(p)							__atomic_exchange_n((p), 0, __ATOMIC_RELAXED)
+#define LOG_PUSH(list, ring)		__atomic_compare_exchange_n((list), &(ring)->next, (ring), true, __ATOMIC_RELEASE, __ATOMIC_RELAXED)
+#define LOG_FIRST(list)					__atomic_load_n((list), __ATOMIC_ACQUIRE)
+#define LOG_FENCE()							__atomic_thread_fence(__ATOMIC_SEQ_CST)
 #endif
-		if (indigo_log_name[0] == '\0') {
-			if (indigo_main_argc == 0) {
-				strncpy(indigo_log_name, "Application", sizeof(indigo_log_name));
+
+typedef struct {
+	struct timeval timestamp;
+	unsigned size;									///< record size including header, aligned to 8 bytes
+	char *long_text;								///< heap copy if message doesn't fit into text
+	char text[];
+} log_record;
+
+#define LOG_RECORD_SIZE(length)	((sizeof(log_record) + (length) + 7) & ~7)
+
+typedef struct log_ring {
+	struct log_ring *next;
+	unsigned head;									///< byte offset, written by owning thread only
+	unsigned tail;									///< byte offset, written by writer thread only
+	unsigned dropped;								///< messages lost since last report
+	unsigned abandoned;							///< owning thread exited
+	char last_message[LOG_TEXT_SIZE];	///< last message logged by owning thread (see indigo_get_last_message())
+	char data[LOG_RING_SIZE];
+} log_ring;
+
+static log_ring *log_rings = NULL;
+static pthread_key_t log_ring_key;
+static pthread_once_t log_once = PTHREAD_ONCE_INIT;
+static pthread_mutex_t log_writer_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t log_wakeup_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t log_wakeup = PTHREAD_COND_INITIALIZER;
+static pthread_mutex_t log_handler_mutex = PTHREAD_MUTEX_INITIALIZER;
+static unsigned log_writer_running = 0;
+static unsigned log_writer_idle = 0;
+static FILE *log_file = NULL;
+static int log_fd = 2;
+static long log_utc_offset = 0;
+
+static void log_ring_release(void *data) {
+	log_ring *ring = data;
+	LOG_STORE(&ring->abandoned, 1);
+}
+
+static void log_output(struct timeval *timestamp, char *text) {
+	static time_t last_second = -1;
+	static char prefix[16];
+	if (indigo_log_name[0] == '\0') {
+		if (indigo_main_argc == 0) {
+			strncpy(indigo_log_name, "Application", 255);
+		} else {
+			char *name = strrchr(indigo_main_argv[0], '/');
+			if (name != NULL) {
+				name++;
 			} else {
-				char *name = strrchr(indigo_main_argv[0], '/');
-				if (name != NULL) {
-					name++;
-				} else {
-					name = (char *)indigo_main_argv[0];
+				name = (char *)indigo_main_argv[0];
+			}
+			strncpy(indigo_log_name, name, 255);
+		}
+	}
+	if (timestamp->tv_sec != last_second) {
+		struct tm local;
+		time_t seconds = timestamp->tv_sec;
+#if defined(INDIGO_WINDOWS)
+		localtime_s(&local, &seconds);
+#else
+		localtime_r(&seconds, &local);
+		log_utc_offset = local.tm_gmtoff;
+#endif
+		strftime(prefix, 9, "%H:%M:%S", &local);
+		last_second = timestamp->tv_sec;
+	}
+	snprintf(prefix + 8, sizeof(prefix) - 8, ".%06ld", (long)timestamp->tv_usec);
+	char *line = text;
+	while (line) {
+		char *eol = strchr(line, '\n');
+		if (eol)
+			*eol = 0;
+		if (*line) {
+#if defined(INDIGO_LINUX) || defined(INDIGO_MACOS)
+			if (indigo_use_syslog && log_file == NULL) {
+				static bool initialize = true;
+				if (initialize) {
+					openlog("INDIGO", LOG_NDELAY | LOG_PERROR, LOG_USER);
+					initialize = false;
 				}
-				strncpy(indigo_log_name, name, sizeof(indigo_log_name));
+				syslog(LOG_NOTICE, "%s", line);
+			} else
+#endif
+				fprintf(log_file ? log_file : stderr, "%s %s: %s\n", prefix, indigo_log_name, line);
+		}
+		if (eol)
+			line = eol + 1;
+		else
+			line = NULL;
+	}
+}
+
+static log_record *log_peek(log_ring *ring) {
+	unsigned head = LOG_LOAD(&ring->head);
+	while (ring->tail != head) {
+		unsigned position = ring->tail & (LOG_RING_SIZE - 1);
+		log_record *record = (log_record *)(ring->data + position);
+		// records never wrap, the end of ring is skipped if it is too short or marked with zero size
+		if (LOG_RING_SIZE - position < sizeof(log_record) || record->size == 0) {
+			LOG_STORE(&ring->tail, ring->tail + LOG_RING_SIZE - position);
+			continue;
+		}
+		return record;
+	}
+	return NULL;
+}
+
+static void log_writer_prepare_fork(void) {
+	pthread_mutex_lock(&log_writer_mutex);
+}
+
+static void log_writer_parent_fork(void) {
+	pthread_mutex_unlock(&log_writer_mutex);
+}
+
+static void log_writer_child_fork(void) {
+	// messages pending at fork time belong to the parent, the writer thread didn't survive anyway
+	for (log_ring *ring = log_rings; ring; ring = ring->next) {
+		log_record *record;
+		while ((record = log_peek(ring)) != NULL) {
+			free(record->long_text);
+			ring->tail += record->size;
+		}
+		ring->dropped = 0;
+	}
+	pthread_mutex_unlock(&log_writer_mutex);
+	pthread_mutex_init(&log_wakeup_mutex, NULL);
+	pthread_cond_init(&log_wakeup, NULL);
+	log_writer_running = 0;
+	log_writer_idle = 0;
+}
+
+static int log_drain(void) {
+	int count = 0;
+	log_ring *ring;
+	for (ring = LOG_FIRST(&log_rings); ring; ring = ring->next) {
+		unsigned dropped = LOG_TAKE(&ring->dropped);
+		if (dropped) {
+			struct timeval now;
+			char text[64];
+			gettimeofday(&now, NULL);
+			snprintf(text, sizeof(text), "Log overflow, %u message(s) dropped", dropped);
+			log_output(&now, text);
+		}
+	}
+	while (true) {
+		log_ring *oldest = NULL;
+		log_record *record = NULL;
+		for (ring = LOG_FIRST(&log_rings); ring; ring = ring->next) {
+			log_record *candidate = log_peek(ring);
+			if (candidate != NULL && (oldest == NULL || candidate->timestamp.tv_sec < record->timestamp.tv_sec || (candidate->timestamp.tv_sec == record->timestamp.tv_sec && candidate->timestamp.tv_usec < record->timestamp.tv_usec))) {
+				oldest = ring;
+				record = candidate;
 			}
 		}
-		while (line) {
-			char *eol = strchr(line, '\n');
-			if (eol)
-				*eol = 0;
-			if (*line)
-				fprintf(stderr, "%s %s: %s\n", timestamp, indigo_log_name, line);
-			if (eol)
-				line = eol + 1;
-			else
-				line = NULL;
+		if (oldest == NULL)
+			break;
+		if (record->long_text) {
+			log_output(&record->timestamp, record->long_text);
+			free(record->long_text);
+		} else {
+			log_output(&record->timestamp, record->text);
+		}
+		LOG_STORE(&oldest->tail, oldest->tail + record->size);
+		count++;
+	}
+	if (count)
+		fflush(log_file ? log_file : stderr);
+	// the list head can be replaced by producers at any time, so exited threads are reclaimed behind it only
+	log_ring *previous = LOG_FIRST(&log_rings);
+	while (previous && (ring = previous->next)) {
+		if (LOG_LOAD(&ring->abandoned) && ring->tail == LOG_LOAD(&ring->head) && LOG_LOAD(&ring->dropped) == 0) {
+			previous->next = ring->next;
+			free(ring);
+		} else {
+			previous = ring;
 		}
 	}
-	pthread_mutex_unlock(&log_mutex);
+	return count;
+}
+
+static bool log_pending(void) {
+	bool pending = false;
+	// abandoned rings are reclaimed under writer mutex
+	pthread_mutex_lock(&log_writer_mutex);
+	for (log_ring *ring = LOG_FIRST(&log_rings); ring && !pending; ring = ring->next)
+		pending = ring->tail != LOG_LOAD(&ring->head) || LOG_LOAD(&ring->dropped);
+	pthread_mutex_unlock(&log_writer_mutex);
+	return pending;
+}
+
+static void *log_writer(void *data) {
+	while (true) {
+		pthread_mutex_lock(&log_writer_mutex);
+		int count = log_drain();
+		pthread_mutex_unlock(&log_writer_mutex);
+		if (count == 0) {
+			// idle flag is published before rings are checked again and producers check it after publishing a record,
+			// so either the writer sees the record or the producer sees the flag and signals
+			pthread_mutex_lock(&log_wakeup_mutex);
+			LOG_STORE(&log_writer_idle, 1);
+			LOG_FENCE();
+			while (!log_pending())
+				pthread_cond_wait(&log_wakeup, &log_wakeup_mutex);
+			LOG_STORE(&log_writer_idle, 0);
+			pthread_mutex_unlock(&log_wakeup_mutex);
+		}
+	}
+	return NULL;
+}
+
+#if defined(INDIGO_LINUX) || defined(INDIGO_MACOS)
+
+static void log_fatal_write(const char *text, size_t length) {
+	while (length > 0) {
+		ssize_t written = write(log_fd, text, length);
+		if (written < 0) {
+			if (errno == EINTR)
+				continue;
+			return;
+		}
+		text += written;
+		length -= written;
+	}
+}
+
+static void log_fatal_signal(int signo) {
+	// only async-signal-safe calls are used, rings are read without taking them over from the writer thread,
+	// record order is kept per thread only and heap copies of long messages are not freed
+	char prefix[32];
+	for (log_ring *ring = LOG_FIRST(&log_rings); ring; ring = ring->next) {
+		unsigned tail = ring->tail, head = LOG_LOAD(&ring->head);
+		while (tail != head) {
+			unsigned position = tail & (LOG_RING_SIZE - 1);
+			log_record *record = (log_record *)(ring->data + position);
+			if (LOG_RING_SIZE - position < sizeof(log_record) || record->size == 0) {
+				tail += LOG_RING_SIZE - position;
+				continue;
+			}
+			long seconds = (long)((record->timestamp.tv_sec + log_utc_offset) % 86400);
+			long usec = (long)record->timestamp.tv_usec;
+			char *p = prefix + sizeof(prefix);
+			*--p = ' ';
+			for (int i = 0; i < 6; i++, usec /= 10)
+				*--p = '0' + usec % 10;
+			*--p = '.';
+			for (int i = 0; i < 3; i++, seconds /= 60) {
+				if (i)
+					*--p = ':';
+				long value = i < 2 ? seconds % 60 : seconds;
+				*--p = '0' + value % 10;
+				*--p = '0' + value / 10 % 10;
+			}
+			log_fatal_write(p, prefix + sizeof(prefix) - p);
+			log_fatal_write(indigo_log_name, strlen(indigo_log_name));
+			log_fatal_write(": ", 2);
+			const char *text = record->long_text ? record->long_text : record->text;
+			log_fatal_write(text, strlen(text));
+			log_fatal_write("\n", 1);
+			tail += record->size;
+		}
+	}
+	// handler was reset by SA_RESETHAND
+	raise(signo);
+}
+
+static void log_install_fatal_handlers(void) {
+	static const int signals[] = { SIGSEGV, SIGBUS, SIGILL, SIGFPE, SIGABRT };
+	for (int i = 0; i < (int)(sizeof(signals) / sizeof(int)); i++) {
+		struct sigaction action;
+		// handlers installed by application are kept
+		if (sigaction(signals[i], NULL, &action) == 0 && action.sa_handler == SIG_DFL) {
+			memset(&action, 0, sizeof(action));
+			action.sa_handler = log_fatal_signal;
+			action.sa_flags = SA_RESETHAND;
+			sigemptyset(&action.sa_mask);
+			sigaction(signals[i], &action, NULL);
+		}
+	}
+}
+
+#endif
+
+static void log_init(void) {
+	pthread_key_create(&log_ring_key, log_ring_release);
+#if defined(INDIGO_LINUX) || defined(INDIGO_MACOS)
+	pthread_atfork(log_writer_prepare_fork, log_writer_parent_fork, log_writer_child_fork);
+	log_install_fatal_handlers();
+#endif
+	atexit(indigo_log_flush);
+}
+
+static log_ring *log_thread_ring(void) {
+	pthread_once(&log_once, log_init);
+	if (!LOG_LOAD(&log_writer_running)) {
+		pthread_mutex_lock(&log_writer_mutex);
+		if (!log_writer_running) {
+			pthread_t thread;
+			if (pthread_create(&thread, NULL, log_writer, NULL) == 0) {
+				pthread_detach(thread);
+				LOG_STORE(&log_writer_running, 1);
+			}
+		}
+		pthread_mutex_unlock(&log_writer_mutex);
+	}
+	log_ring *ring = pthread_getspecific(log_ring_key);
+	if (ring == NULL) {
+		ring = calloc(1, sizeof(log_ring));
+		if (ring == NULL)
+			return NULL;
+		ring->next = LOG_FIRST(&log_rings);
+		while (!LOG_PUSH(&log_rings, ring))
+			;
+		pthread_setspecific(log_ring_key, ring);
+	}
+	return ring;
+}
+
+const char *indigo_get_last_message(void) {
+	log_ring *ring = log_thread_ring();
+	return ring ? ring->last_message : "";
+}
+
+void indigo_log_flush(void) {
+	pthread_mutex_lock(&log_writer_mutex);
+	log_drain();
+	pthread_mutex_unlock(&log_writer_mutex);
+}
+
+bool indigo_set_log_file(const char *path) {
+	FILE *file = NULL;
+	if (path != NULL && *path) {
+		file = fopen(path, "a");
+		if (file == NULL)
+			return false;
+	}
+	pthread_mutex_lock(&log_writer_mutex);
+	log_drain();
+	log_fd = file ? fileno(file) : 2;
+	if (log_file != NULL)
+		fclose(log_file);
+	log_file = file;
+	pthread_mutex_unlock(&log_writer_mutex);
+	return true;
+}
+
+// message is formatted on the calling thread, deferring it would require copies of all arguments (including strings they point to)
+
+void indigo_log_message(const char *format, va_list args) {
+	log_ring *ring = log_thread_ring();
+	if (indigo_log_message_handler != NULL) {
+		static char message[128 * 1024];
+		pthread_mutex_lock(&log_handler_mutex);
+		vsnprintf(message, sizeof(message), format, args);
+		if (ring != NULL) {
+			strncpy(ring->last_message, message, LOG_TEXT_SIZE - 1);
+			ring->last_message[LOG_TEXT_SIZE - 1] = 0;
+		}
+		indigo_log_message_handler(message);
+		pthread_mutex_unlock(&log_handler_mutex);
+		return;
+	}
+	if (ring == NULL)
+		return;
+	struct timeval timestamp;
+	// per-thread last message doubles as formatting buffer, so it is kept without locking or copying
+	char *text = ring->last_message;
+	char *long_text = NULL;
+	va_list copy;
+	va_copy(copy, args);
+	gettimeofday(&timestamp, NULL);
+	int length = vsnprintf(text, LOG_TEXT_SIZE, format, args);
+	if (length < 0) {
+		va_end(copy);
+		return;
+	}
+	if (length >= LOG_TEXT_SIZE) {
+		long_text = malloc(length + 1);
+		if (long_text)
+			vsnprintf(long_text, length + 1, format, copy);
+		else
+			length = LOG_TEXT_SIZE - 1;
+	}
+	va_end(copy);
+	unsigned size = LOG_RECORD_SIZE(long_text ? 0 : length + 1);
+	unsigned head = ring->head;
+	unsigned position = head & (LOG_RING_SIZE - 1);
+	unsigned skip = LOG_RING_SIZE - position < size ? LOG_RING_SIZE - position : 0;
+	unsigned used = head - LOG_LOAD(&ring->tail);
+	if (used + skip + size > LOG_RING_SIZE) {
+		LOG_INCREMENT(&ring->dropped);
+		free(long_text);
+		return;
+	}
+	if (skip) {
+		if (skip >= sizeof(log_record))
+			((log_record *)(ring->data + position))->size = 0;
+		position = 0;
+	}
+	log_record *record = (log_record *)(ring->data + position);
+	record->timestamp = timestamp;
+	record->size = size;
+	record->long_text = long_text;
+	if (long_text == NULL)
+		memcpy(record->text, text, length + 1);
+	LOG_STORE(&ring->head, head + skip + size);
+	LOG_FENCE();
+	if (LOG_LOAD(&log_writer_idle)) {
+		pthread_mutex_lock(&log_wakeup_mutex);
+		pthread_cond_signal(&log_wakeup);
+		pthread_mutex_unlock(&log_wakeup_mutex);
+	}
 }
 
 void indigo_error(const char *format, ...) {
@@ -233,58 +648,202 @@ indigo_log_levels indigo_get_log_level() {
 	return indigo_log_level;
 }
 
+typedef struct {
+	char *text;
+	size_t size;
+	size_t length;
+} trace_buffer;
+
+static void trace_append(trace_buffer *buffer, const char *format, ...) {
+	va_list args;
+	while (true) {
+		size_t available = buffer->size - buffer->length;
+		va_start(args, format);
+		int length = vsnprintf(buffer->text ? buffer->text + buffer->length : NULL, available, format, args);
+		va_end(args);
+		if (length < 0)
+			return;
+		if ((size_t)length < available) {
+			buffer->length += length;
+			return;
+		}
+		size_t size = buffer->size ? buffer->size : BUFFER_SIZE;
+		while (size <= buffer->length + length)
+			size *= 2;
+		char *text = realloc(buffer->text, size);
+		if (text == NULL)
+			return;
+		buffer->text = text;
+		buffer->size = size;
+	}
+}
+
 void indigo_trace_property(const char *message, indigo_property *property, bool defs, bool items) {
 	if (indigo_log_level >= INDIGO_LOG_TRACE) {
-		static pthread_mutex_t log_mutex = PTHREAD_MUTEX_INITIALIZER;
-		pthread_mutex_lock(&log_mutex);
+		// the dump is sent as a single multi-line message so it can't interleave with other threads
+		trace_buffer buffer = { NULL, 0, 0 };
 		if (message != NULL)
-			indigo_trace(message);
+			trace_append(&buffer, "%s\n", message);
 		if (defs)
-			indigo_trace("'%s'.'%s' %s %s %s %d.%d %s { // %s", property->device, property->name, indigo_property_type_text[property->type], indigo_property_perm_text[property->perm], indigo_property_state_text[property->state], (property->version >> 8) & 0xFF, property->version & 0xFF, (property->type == INDIGO_SWITCH_VECTOR ? indigo_switch_rule_text[property->rule]: ""), property->label);
+			trace_append(&buffer, "'%s'.'%s' %s %s %s %d.%d %s { // %s\n", property->device, property->name, indigo_property_type_text[property->type], indigo_property_perm_text[property->perm], indigo_property_state_text[property->state], (property->version >> 8) & 0xFF, property->version & 0xFF, (property->type == INDIGO_SWITCH_VECTOR ? indigo_switch_rule_text[property->rule]: ""), property->label);
 		else
-			indigo_trace("'%s'.'%s' %s %s %s %d.%d %s {", property->device, property->name, indigo_property_type_text[property->type], indigo_property_perm_text[property->perm], indigo_property_state_text[property->state], (property->version >> 8) & 0xFF, property->version & 0xFF, (property->type == INDIGO_SWITCH_VECTOR ? indigo_switch_rule_text[property->rule]: ""));
+			trace_append(&buffer, "'%s'.'%s' %s %s %s %d.%d %s {\n", property->device, property->name, indigo_property_type_text[property->type], indigo_property_perm_text[property->perm], indigo_property_state_text[property->state], (property->version >> 8) & 0xFF, property->version & 0xFF, (property->type == INDIGO_SWITCH_VECTOR ? indigo_switch_rule_text[property->rule]: ""));
 		if (items) {
 			for (int i = 0; i < property->count; i++) {
 				indigo_item *item = &property->items[i];
 				switch (property->type) {
 				case INDIGO_TEXT_VECTOR:
 					if (defs)
-						indigo_trace("  '%s' = '%s' // %s", item->name, item->text.value, item->label);
+						trace_append(&buffer, "  '%s' = '%s' // %s\n", item->name, item->text.value, item->label);
 					else
-						indigo_trace("  '%s' = '%s' ",item->name, item->text.value);
+						trace_append(&buffer, "  '%s' = '%s' \n",item->name, item->text.value);
 					break;
 				case INDIGO_NUMBER_VECTOR:
 					if (defs)
-						indigo_trace("  '%s' = %g (%g, %g, %g) // %s", item->name, item->number.value, item->number.min, item->number.max, item->number.step, item->label);
+						trace_append(&buffer, "  '%s' = %g (%g, %g, %g) // %s\n", item->name, item->number.value, item->number.min, item->number.max, item->number.step, item->label);
 					else
-						indigo_trace("  '%s' = %g ",item->name, item->number.value);
+						trace_append(&buffer, "  '%s' = %g \n",item->name, item->number.value);
 					break;
 				case INDIGO_SWITCH_VECTOR:
 					if (defs)
-						indigo_trace("  '%s' = %s // %s", item->name, (item->sw.value ? "On" : "Off"), item->label);
+						trace_append(&buffer, "  '%s' = %s // %s\n", item->name, (item->sw.value ? "On" : "Off"), item->label);
 					else
-						indigo_trace("  '%s' = %s ",item->name, (item->sw.value ? "On" : "Off"));
+						trace_append(&buffer, "  '%s' = %s \n",item->name, (item->sw.value ? "On" : "Off"));
 					break;
 				case INDIGO_LIGHT_VECTOR:
 					if (defs)
-						indigo_trace("  '%s' = %s // %s", item->name, indigo_property_state_text[item->light.value], item->label);
+						trace_append(&buffer, "  '%s' = %s // %s\n", item->name, indigo_property_state_text[item->light.value], item->label);
 					else
-						indigo_trace("  '%s' = %s ",item->name, indigo_property_state_text[item->light.value]);
+						trace_append(&buffer, "  '%s' = %s \n",item->name, indigo_property_state_text[item->light.value]);
 					break;
 				case INDIGO_BLOB_VECTOR:
 					if (defs)
-						indigo_trace("  '%s' // %s", item->name, item->label);
+						trace_append(&buffer, "  '%s' // %s\n", item->name, item->label);
 					else
-						indigo_trace("  '%s' (%ld bytes, '%s', '%s')",item->name, item->blob.size, item->blob.format, item->blob.url);
+						trace_append(&buffer, "  '%s' (%ld bytes, '%s', '%s')\n",item->name, item->blob.size, item->blob.format, item->blob.url);
 					break;
 				}
 			}
 		}
-		indigo_trace("}");
-		pthread_mutex_unlock(&log_mutex);
+		trace_append(&buffer, "}");
+		if (buffer.text != NULL) {
+			indigo_trace("%s", buffer.text);
+			free(buffer.text);
+		}
+	}
+}
+
+// -------------------------------------------------------------------------------- device registry
+
+static unsigned device_name_hash(const char *name) {
+	unsigned hash = 5381;
+	while (*name)
+		hash = hash * 33 + (unsigned char)*name++;
+	return hash & (DEVICE_HASH_SIZE - 1);
+}
+
+static void register_device(int slot) {
+	indigo_device *device = devices[slot];
+	if (*device->name == '@') {
+		remote_devices[remote_device_count++] = slot;
+	} else {
+		unsigned hash = device_name_hash(device->name);
+		device_next[slot] = device_hash[hash];
+		device_hash[hash] = slot;
+	}
+}
+
+static void unregister_device(int slot) {
+	indigo_device *device = devices[slot];
+	if (*device->name == '@') {
+		for (int i = 0; i < remote_device_count; i++) {
+			if (remote_devices[i] == slot) {
+				remote_devices[i] = remote_devices[--remote_device_count];
+				break;
+			}
+		}
+	} else {
+		for (int *link = &device_hash[device_name_hash(device->name)]; *link >= 0; link = &device_next[*link]) {
+			if (*link == slot) {
+				*link = device_next[slot];
+				break;
+			}
+		}
 	}
 }
 
+static void device_route_init() {
+	pthread_key_create(&device_route_key, NULL);
+}
+
+static int route_property(indigo_property *property, device_route *route) {
+	int *slots = route->slots;
+	int count = 0;
+	pthread_rwlock_rdlock(&device_lock);
+	if (*property->device == 0) {
+		for (int i = 0; i < MAX_DEVICES; i++) {
+			if (devices[i] != NULL)
+				slots[count++] = i;
+		}
+	} else {
+		for (int slot = device_hash[device_name_hash(property->device)]; slot >= 0; slot = device_next[slot]) {
+			if (!strcmp(property->device, devices[slot]->name))
+				slots[count++] = slot;
+		}
+		for (int i = 0; i < remote_device_count; i++) {
+			int slot = remote_devices[i];
+			if (!indigo_use_host_suffix || strstr(property->device, devices[slot]->name))
+				slots[count++] = slot;
+		}
+		// keep attach order
+		for (int i = 1; i < count; i++) {
+			int slot = slots[i], j = i;
+			while (j > 0 && slots[j - 1] > slot) {
+				slots[j] = slots[j - 1];
+				j--;
+			}
+			slots[j] = slot;
+		}
+	}
+	pthread_mutex_lock(&device_pin_mutex);
+	for (int i = 0; i < count; i++) {
+		route->targets[i] = devices[slots[i]];
+		device_pins[slots[i]]++;
+	}
+	pthread_mutex_unlock(&device_pin_mutex);
+	pthread_rwlock_unlock(&device_lock);
+	route->count = count;
+	pthread_once(&device_route_once, device_route_init);
+	route->previous = pthread_getspecific(device_route_key);
+	pthread_setspecific(device_route_key, route);
+	return count;
+}
+
+static void route_release(device_route *route) {
+	pthread_setspecific(device_route_key, route->previous);
+	pthread_mutex_lock(&device_pin_mutex);
+	for (int i = 0; i < route->count; i++)
+		device_pins[route->slots[i]]--;
+	pthread_cond_broadcast(&device_unpinned);
+	pthread_mutex_unlock(&device_pin_mutex);
+}
+
+static void wait_unpinned(int slot) {
+	// pins held by callbacks on the calling thread (e.g. device detaching itself from change_property) are not waited for
+	int own = 0;
+	pthread_once(&device_route_once, device_route_init);
+	for (device_route *route = pthread_getspecific(device_route_key); route != NULL; route = route->previous) {
+		for (int i = 0; i < route->count; i++) {
+			if (route->slots[i] == slot)
+				own++;
+		}
+	}
+	pthread_mutex_lock(&device_pin_mutex);
+	while (device_pins[slot] > own)
+		pthread_cond_wait(&device_unpinned, &device_pin_mutex);
+	pthread_mutex_unlock(&device_pin_mutex);
+}
+
 indigo_result indigo_start() {
 	for (int i = 1; i < indigo_main_argc; i++) {
 		if (!strcmp(indigo_main_argv[i], "-v") || !strcmp(indigo_main_argv[i], "--enable-info")) {
@@ -297,9 +856,16 @@ indigo_result indigo_start() {
 	}
 	pthread_mutex_lock(&client_mutex);
 	if (!is_started) {
+		pthread_rwlock_wrlock(&device_lock);
 		memset(devices, 0, MAX_DEVICES * sizeof(indigo_device *));
+		pthread_mutex_lock(&device_pin_mutex);
+		memset(device_pins, 0, MAX_DEVICES * sizeof(int));
+		pthread_mutex_unlock(&device_pin_mutex);
+		for (int i = 0; i < DEVICE_HASH_SIZE; i++)
+			device_hash[i] = -1;
+		remote_device_count = 0;
+		pthread_rwlock_unlock(&device_lock);
 		memset(clients, 0, MAX_CLIENTS * sizeof(indigo_client *));
-		memset(blobs, 0, MAX_BLOBS * sizeof(indigo_property *));
 		memset(&INDIGO_ALL_PROPERTIES, 0, sizeof(INDIGO_ALL_PROPERTIES));
 		is_started = true;
 	}
@@ -311,17 +877,22 @@ indigo_result indigo_attach_device(indigo_device *device) {
 	if ((!is_started) || (device == NULL))
 		return INDIGO_FAILED;
 
-	pthread_mutex_lock(&device_mutex);
+	pthread_rwlock_wrlock(&device_lock);
+	pthread_mutex_lock(&device_pin_mutex);
 	for (int i = 0; i < MAX_DEVICES; i++) {
-		if (devices[i] == NULL) {
+		// slot of detached device can't be reused until all its pins are released
+		if (devices[i] == NULL && device_pins[i] == 0) {
+			pthread_mutex_unlock(&device_pin_mutex);
 			devices[i] = device;
-			pthread_mutex_unlock(&device_mutex);
+			register_device(i);
+			pthread_rwlock_unlock(&device_lock);
 			if (device->attach != NULL)
 				device->last_result = device->attach(device);
 			return INDIGO_OK;
 		}
 	}
-	pthread_mutex_unlock(&device_mutex);
+	pthread_mutex_unlock(&device_pin_mutex);
+	pthread_rwlock_unlock(&device_lock);
 	return INDIGO_TOO_MANY_ELEMENTS;
 }
 
@@ -347,17 +918,23 @@ indigo_result indigo_detach_device(indigo_device *device) {
 	if ((!is_started) || (device == NULL))
 		return INDIGO_FAILED;
 
-	pthread_mutex_lock(&device_mutex);
+	int slot = -1;
+	pthread_rwlock_wrlock(&device_lock);
 	for (int i = 0; i < MAX_DEVICES; i++) {
 		if (devices[i] == device) {
-			if (device->detach != NULL)
-				device->last_result = device->detach(device);
+			unregister_device(i);
 			devices[i] = NULL;
-			pthread_mutex_unlock(&device_mutex);
-			return INDIGO_OK;
+			slot = i;
+			break;
 		}
 	}
-	pthread_mutex_unlock(&device_mutex);
+	pthread_rwlock_unlock(&device_lock);
+	if (slot < 0)
+		return INDIGO_OK;
+	// device is no longer routable, wait for callbacks in progress on other threads
+	wait_unpinned(slot);
+	if (device->detach != NULL)
+		device->last_result = device->detach(device);
 	return INDIGO_OK;
 }
 
@@ -383,17 +960,14 @@ indigo_result indigo_enumerate_properties(indigo_client *client, indigo_property
 	if (!is_started)
 		return INDIGO_FAILED;
 	INDIGO_TRACE(indigo_trace_property("INDIGO Bus: property enumeration request", property, false, true));
-	for (int i = 0; i < MAX_DEVICES; i++) {
-		indigo_device *device = devices[i];
-		if (device != NULL && device->enumerate_properties != NULL) {
-			bool route = *property->device == 0;
-			route = route || !strcmp(property->device, device->name);
-			route = route || (indigo_use_host_suffix && *device->name == '@' && strstr(property->device, device->name));
-			route = route || (!indigo_use_host_suffix && *device->name == '@');
-			if (route)
-				device->last_result = device->enumerate_properties(device, client, property);
-		}
+	device_route route;
+	int count = route_property(property, &route);
+	for (int i = 0; i < count; i++) {
+		indigo_device *device = route.targets[i];
+		if (device->enumerate_properties != NULL)
+			device->last_result = device->enumerate_properties(device, client, property);
 	}
+	route_release(&route);
 	return INDIGO_OK;
 }
 
@@ -401,17 +975,16 @@ indigo_result indigo_change_property(indigo_client *client, indigo_property *pro
 	if ((!is_started) || (property == NULL) || (property->perm == INDIGO_RO_PERM))
 		return INDIGO_FAILED;
 	INDIGO_TRACE(indigo_trace_property("INDIGO Bus: property change request", property, false, true));
-	for (int i = 0; i < MAX_DEVICES; i++) {
-		indigo_device *device = devices[i];
-		if (device != NULL && device->enumerate_properties != NULL) {
-			bool route = *property->device == 0;
-			route = route || !strcmp(property->device, device->name);
-			route = route || (indigo_use_host_suffix && *device->name == '@' && strstr(property->device, device->name));
-			route = route || (!indigo_use_host_suffix && *device->name == '@');
-			if (route)
-				device->last_result = device->change_property(device, client, property);
-		}
+	device_route route;
+	int count = route_property(property, &route);
+	if (count > 0)
+		indigo_metrics_change(property);
+	for (int i = 0; i < count; i++) {
+		indigo_device *device = route.targets[i];
+		if (device->change_property != NULL)
+			device->last_result = device->change_property(device, client, property);
 	}
+	route_release(&route);
 	return INDIGO_OK;
 }
 
@@ -419,20 +992,92 @@ indigo_result indigo_enable_blob(indigo_client *client, indigo_property *propert
 	if ((!is_started) || (property == NULL))
 		return INDIGO_FAILED;
 	INDIGO_TRACE(indigo_trace_property("INDIGO Bus: enable BLOB mode change request", property, false, true));
-	for (int i = 0; i < MAX_DEVICES; i++) {
-		indigo_device *device = devices[i];
-		if (device != NULL && device->enable_blob != NULL) {
-			bool route = *property->device == 0;
-			route = route || !strcmp(property->device, device->name);
-			route = route || (indigo_use_host_suffix && *device->name == '@' && strstr(property->device, device->name));
-			route = route || (!indigo_use_host_suffix && *device->name == '@');
-			if (route)
-				device->last_result = device->enable_blob(device, client, property, mode);
-		}
+	device_route route;
+	int count = route_property(property, &route);
+	for (int i = 0; i < count; i++) {
+		indigo_device *device = route.targets[i];
+		if (device->enable_blob != NULL)
+			device->last_result = device->enable_blob(device, client, property, mode);
 	}
+	route_release(&route);
 	return INDIGO_OK;
 }
 
+// -------------------------------------------------------------------------------- broadcast cache
+
+indigo_shared_message *indigo_shared_message_create(const char *data, long size) {
+	indigo_shared_message *message = malloc(sizeof(indigo_shared_message) + size);
+	if (message == NULL)
+		return NULL;
+	message->reference_count = 1;
+	message->size = size;
+	message->descriptor = -1;
+	memcpy(message->data, data, size);
+	return message;
+}
+
+indigo_shared_message *indigo_shared_message_retain(indigo_shared_message *message) {
+	if (message != NULL) {
+		pthread_mutex_lock(&shared_message_mutex);
+		message->reference_count++;
+		pthread_mutex_unlock(&shared_message_mutex);
+	}
+	return message;
+}
+
+void indigo_shared_message_release(indigo_shared_message *message) {
+	if (message != NULL) {
+		pthread_mutex_lock(&shared_message_mutex);
+		bool last = --message->reference_count == 0;
+		pthread_mutex_unlock(&shared_message_mutex);
+		if (last) {
+			if (message->descriptor >= 0)
+				close(message->descriptor);
+			free(message);
+		}
+	}
+}
+
+static void broadcast_cache_init() {
+	pthread_key_create(&broadcast_cache_key, NULL);
+}
+
+static void broadcast_begin(broadcast_cache *cache) {
+	pthread_once(&broadcast_cache_once, broadcast_cache_init);
+	cache->previous = pthread_getspecific(broadcast_cache_key);
+	cache->count = 0;
+	pthread_setspecific(broadcast_cache_key, cache);
+}
+
+static void broadcast_end(broadcast_cache *cache) {
+	for (int i = 0; i < cache->count; i++)
+		indigo_shared_message_release(cache->messages[i]);
+	cache->count = 0;
+	pthread_setspecific(broadcast_cache_key, cache->previous);
+}
+
+indigo_shared_message *indigo_broadcast_cache_get(uint32_t key) {
+	pthread_once(&broadcast_cache_once, broadcast_cache_init);
+	broadcast_cache *cache = pthread_getspecific(broadcast_cache_key);
+	if (cache != NULL) {
+		for (int i = 0; i < cache->count; i++) {
+			if (cache->keys[i] == key)
+				return indigo_shared_message_retain(cache->messages[i]);
+		}
+	}
+	return NULL;
+}
+
+void indigo_broadcast_cache_put(uint32_t key, indigo_shared_message *message) {
+	pthread_once(&broadcast_cache_once, broadcast_cache_init);
+	broadcast_cache *cache = pthread_getspecific(broadcast_cache_key);
+	if (cache != NULL && message != NULL && cache->count < BROADCAST_CACHE_SIZE) {
+		cache->keys[cache->count] = key;
+		cache->messages[cache->count] = indigo_shared_message_retain(message);
+		cache->count++;
+	}
+}
+
 indigo_result indigo_define_property(indigo_device *device, indigo_property *property, const char *format, ...) {
 	if ((!is_started) || (property == NULL))
 		return INDIGO_FAILED;
@@ -446,11 +1091,14 @@ indigo_result indigo_define_property(indigo_device *device, indigo_property *pro
 			vsnprintf(message, INDIGO_VALUE_SIZE, format, args);
 			va_end(args);
 		}
+		broadcast_cache cache;
+		broadcast_begin(&cache);
 		for (int i = 0; i < MAX_CLIENTS; i++) {
 			indigo_client *client = clients[i];
 			if (client != NULL && client->define_property != NULL)
 				client->last_result = client->define_property(client, device, property, format != NULL ? message : NULL);
 		}
+		broadcast_end(&cache);
 	}
 	return INDIGO_OK;
 }
@@ -458,6 +1106,7 @@ indigo_result indigo_define_property(indigo_device *device, indigo_property *pro
 indigo_result indigo_update_property(indigo_device *device, indigo_property *property, const char *format, ...) {
 	if ((!is_started) || (property == NULL))
 		return INDIGO_FAILED;
+	indigo_metrics_update(property);
 
 	if (!property->hidden) {
 		char message[INDIGO_VALUE_SIZE];
@@ -471,11 +1120,14 @@ indigo_result indigo_update_property(indigo_device *device, indigo_property *pro
 			vsnprintf(message, INDIGO_VALUE_SIZE, format, args);
 			va_end(args);
 		}
+		broadcast_cache cache;
+		broadcast_begin(&cache);
 		for (int i = 0; i < MAX_CLIENTS; i++) {
 			indigo_client *client = clients[i];
 			if (client != NULL && client->update_property != NULL)
 				client->last_result = client->update_property(client, device, property, format != NULL ? message : NULL);
 		}
+		broadcast_end(&cache);
 		property->count = count;
 	}
 	return INDIGO_OK;
@@ -526,11 +1178,14 @@ indigo_result indigo_stop() {
 	pthread_mutex_lock(&client_mutex);
 	if (is_started) {
 		is_started = false;
-		for (int i = 0; i < MAX_DEVICES; i++) {
-			indigo_device *device = devices[i];
-			if (device != NULL && device->detach != NULL)
+		device_route route;
+		int count = route_property(&INDIGO_ALL_PROPERTIES, &route);
+		for (int i = 0; i < count; i++) {
+			indigo_device *device = route.targets[i];
+			if (device->detach != NULL)
 				device->last_result = device->detach(device);
 		}
+		route_release(&route);
 		for (int i = 0; i < MAX_CLIENTS; i++) {
 			indigo_client *client = clients[i];
 			if (client != NULL && client->detach != NULL)
@@ -650,51 +1305,246 @@ indigo_property *indigo_init_blob_property(indigo_property *property, const char
 
 indigo_property *indigo_resize_property(indigo_property *property, int count) {
 	assert(property != NULL);
+	// items are moved, so BLOB registration is renewed
+	bool blob = property->type == INDIGO_BLOB_VECTOR;
+	if (blob)
+		indigo_delete_blob(property);
 	property = realloc(property, sizeof(indigo_property) + count * sizeof(indigo_item));
 	assert(property != NULL);
 	if (count > property->count)
 		memset(property->items+property->count, 0, (count - property->count) * sizeof(indigo_item));
 	property->count = count;
+	if (blob)
+		indigo_add_blob(property);
 	return property;
 }
 
 void indigo_release_property(indigo_property *property) {
 	if (property == NULL)
 		return;
-	indigo_delete_blob(property);
+	if (property->type == INDIGO_BLOB_VECTOR)
+		indigo_delete_blob(property);
 	free(property);
 }
 
+// -------------------------------------------------------------------------------- BLOB registry
+
+// items of BLOB properties are indexed both by opaque random id (used in /blob/ URLs) and by address,
+// both hash tables grow with number of registered items, value is published as refcounted snapshot taken
+// once per broadcast when URL is sent, HTTP transfers pin the snapshot under the lock and send it outside,
+// so deleting property never waits for a client and driver can replace the value while it is being sent
+
+#define BLOB_REGISTRY_ID	'B'
+
+typedef struct blob_entry {
+	uint64_t id;
+	indigo_item *item;
+	indigo_property *property;
+	indigo_shared_message *data;			///< last published snapshot of the value (or NULL)
+	char format[INDIGO_NAME_SIZE];		///< format of the snapshot
+	struct blob_entry *next_id;
+	struct blob_entry *next_item;
+} blob_entry;
+
+static pthread_mutex_t blob_mutex = PTHREAD_MUTEX_INITIALIZER;
+static blob_entry **blob_id_hash = NULL;
+static blob_entry **blob_item_hash = NULL;
+static unsigned blob_hash_size = 0;
+static unsigned blob_count = 0;
+static uint64_t blob_id_key = 0;
+static uint64_t blob_id_counter = 0;
+
+static uint64_t blob_id_mix(uint64_t z) {
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
+}
+
+static uint64_t next_blob_id(void) {
+	// ids are bijective mix of secret key and counter, so they are unique but can't be guessed from other URLs
+	if (blob_id_key == 0) {
+		FILE *random = fopen("/dev/urandom", "rb");
+		if (random == NULL || fread(&blob_id_key, sizeof(blob_id_key), 1, random) != 1)
+			blob_id_key = blob_id_mix((uint64_t)time(NULL) ^ ((uint64_t)getpid() << 32) ^ (uint64_t)(uintptr_t)&blob_id_key);
+		if (random != NULL)
+			fclose(random);
+		blob_id_key |= 1;
+	}
+	uint64_t id;
+	do {
+		id = blob_id_mix(blob_id_key + ++blob_id_counter * 0x9E3779B97F4A7C15ULL);
+	} while (id == 0);
+	return id;
+}
+
+static unsigned blob_id_bucket(uint64_t id) {
+	return (unsigned)(id ^ (id >> 32)) & (blob_hash_size - 1);
+}
+
+static unsigned blob_item_bucket(indigo_item *item) {
+	return (unsigned)(((uint64_t)(uintptr_t)item * 0x9E3779B97F4A7C15ULL) >> 32) & (blob_hash_size - 1);
+}
+
+static blob_entry *find_blob_item(indigo_item *item) {
+	if (blob_hash_size == 0)
+		return NULL;
+	for (blob_entry *entry = blob_item_hash[blob_item_bucket(item)]; entry; entry = entry->next_item) {
+		if (entry->item == item)
+			return entry;
+	}
+	return NULL;
+}
+
+static bool grow_blob_hash(void) {
+	unsigned size = blob_hash_size ? 2 * blob_hash_size : 64;
+	blob_entry **id_hash = calloc(size, sizeof(blob_entry *));
+	blob_entry **item_hash = calloc(size, sizeof(blob_entry *));
+	if (id_hash == NULL || item_hash == NULL) {
+		free(id_hash);
+		free(item_hash);
+		return false;
+	}
+	unsigned old_size = blob_hash_size;
+	blob_entry **old_id_hash = blob_id_hash;
+	blob_entry **old_item_hash = blob_item_hash;
+	blob_hash_size = size;
+	blob_id_hash = id_hash;
+	blob_item_hash = item_hash;
+	for (unsigned i = 0; i < old_size; i++) {
+		blob_entry *entry = old_id_hash[i];
+		while (entry) {
+			blob_entry *next = entry->next_id;
+			unsigned bucket = blob_id_bucket(entry->id);
+			entry->next_id = blob_id_hash[bucket];
+			blob_id_hash[bucket] = entry;
+			bucket = blob_item_bucket(entry->item);
+			entry->next_item = blob_item_hash[bucket];
+			blob_item_hash[bucket] = entry;
+			entry = next;
+		}
+	}
+	free(old_id_hash);
+	free(old_item_hash);
+	return true;
+}
+
+static void remove_blob_entry(blob_entry *entry) {
+	for (blob_entry **link = &blob_id_hash[blob_id_bucket(entry->id)]; *link; link = &(*link)->next_id) {
+		if (*link == entry) {
+			*link = entry->next_id;
+			break;
+		}
+	}
+	for (blob_entry **link = &blob_item_hash[blob_item_bucket(entry->item)]; *link; link = &(*link)->next_item) {
+		if (*link == entry) {
+			*link = entry->next_item;
+			break;
+		}
+	}
+	blob_count--;
+	indigo_shared_message_release(entry->data);
+	free(entry);
+}
+
 void indigo_add_blob(indigo_property *property) {
-	for (int i = 0; i < MAX_BLOBS; i++)
-	if (blobs[i] == NULL) {
-		blobs[i] = property;
-		break;
+	assert(property != NULL);
+	pthread_mutex_lock(&blob_mutex);
+	for (int i = 0; i < property->count; i++) {
+		indigo_item *item = property->items + i;
+		blob_entry *entry = find_blob_item(item);
+		if (entry != NULL) {
+			entry->property = property;
+			continue;
+		}
+		if (blob_count >= blob_hash_size && !grow_blob_hash())
+			break;
+		entry = malloc(sizeof(blob_entry));
+		if (entry == NULL)
+			break;
+		entry->id = next_blob_id();
+		entry->item = item;
+		entry->property = property;
+		entry->data = NULL;
+		*entry->format = 0;
+		unsigned bucket = blob_id_bucket(entry->id);
+		entry->next_id = blob_id_hash[bucket];
+		blob_id_hash[bucket] = entry;
+		bucket = blob_item_bucket(item);
+		entry->next_item = blob_item_hash[bucket];
+		blob_item_hash[bucket] = entry;
+		blob_count++;
 	}
+	pthread_mutex_unlock(&blob_mutex);
 }
 
 void indigo_delete_blob(indigo_property *property) {
-	for (int i = 0; i < MAX_BLOBS; i++)
-	if (blobs[i] == property) {
-		blobs[i] = NULL;
-		break;
+	assert(property != NULL);
+	pthread_mutex_lock(&blob_mutex);
+	for (int i = 0; i < property->count; i++) {
+		blob_entry *entry = find_blob_item(property->items + i);
+		if (entry != NULL && entry->property == property)
+			remove_blob_entry(entry);
 	}
+	pthread_mutex_unlock(&blob_mutex);
 }
 
-
 indigo_result indigo_validate_blob(indigo_item *item) {
-	for (int i = 0; i < MAX_BLOBS; i++) {
-		indigo_property *property = blobs[i];
-		if (property != NULL) {
-			for (int j = 0; j < property->count; j++) {
-				if (item == &property->items[j])
-					return INDIGO_OK;
-			}
+	pthread_mutex_lock(&blob_mutex);
+	blob_entry *entry = find_blob_item(item);
+	indigo_result result = entry != NULL ? INDIGO_OK : INDIGO_FAILED;
+	pthread_mutex_unlock(&blob_mutex);
+	return result;
+}
+
+uint64_t indigo_blob_id(indigo_item *item) {
+	pthread_mutex_lock(&blob_mutex);
+	blob_entry *entry = find_blob_item(item);
+	uint64_t id = entry != NULL ? entry->id : 0;
+	pthread_mutex_unlock(&blob_mutex);
+	return id;
+}
+
+uint64_t indigo_publish_blob(indigo_item *item, int index) {
+	// snapshot is taken by the first client of the broadcast, outside the registry lock
+	uint32_t key = INDIGO_BROADCAST_KEY(BLOB_REGISTRY_ID, 0, index);
+	indigo_shared_message *data = indigo_broadcast_cache_get(key);
+	bool published = data != NULL;
+	if (!published && item->blob.value != NULL && item->blob.size > 0) {
+		data = indigo_shared_message_create(item->blob.value, item->blob.size);
+		indigo_broadcast_cache_put(key, data);
+	}
+	uint64_t id = 0;
+	pthread_mutex_lock(&blob_mutex);
+	blob_entry *entry = find_blob_item(item);
+	if (entry != NULL) {
+		id = entry->id;
+		if (!published) {
+			indigo_shared_message *previous = entry->data;
+			entry->data = data;
+			strcpy(entry->format, item->blob.format);
+			data = previous;
 		}
 	}
-	return INDIGO_FAILED;
+	pthread_mutex_unlock(&blob_mutex);
+	indigo_shared_message_release(data);
+	return id;
 }
 
+indigo_shared_message *indigo_acquire_blob(uint64_t id, char *format) {
+	indigo_shared_message *data = NULL;
+	pthread_mutex_lock(&blob_mutex);
+	if (blob_hash_size > 0) {
+		for (blob_entry *entry = blob_id_hash[blob_id_bucket(id)]; entry; entry = entry->next_id) {
+			if (entry->id == id) {
+				if ((data = indigo_shared_message_retain(entry->data)) != NULL)
+					strcpy(format, entry->format);
+				break;
+			}
+		}
+	}
+	pthread_mutex_unlock(&blob_mutex);
+	return data;
+}
 
 void indigo_init_text_item(indigo_item *item, const char *name, const char *label, const char *format, ...) {
 	assert(item != NULL);
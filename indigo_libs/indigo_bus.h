@@ -292,26 +292,39 @@ typedef struct {
 	int input;													///< input handle
 	int output;													///< output handle
 	bool web_socket;										///< connection over WebSocket (RFC6455)
+	struct indigo_web_socket *web_socket_state;	///< WebSocket framing and compression state (see indigo_json.h)
+	struct indigo_client_metrics *metrics;	///< per client metrics (see indigo_metrics.h)
 	char url_prefix[INDIGO_NAME_SIZE];	///< server url prefix (for BLOB download)
+	bool shared_memory;									///< peer is on the same host, inline BLOBs are passed as shared memory descriptors
+	struct indigo_xml_cache *cache;			///< remote property cache kept across reconnects (client adapter only, may be NULL, see indigo_xml.h)
 } indigo_adapter_context;
 
 
-/** Last diagnostic messages.
+/** Last diagnostic message logged by calling thread (truncated to 1023 characters).
  */
-extern char indigo_last_message[];
+extern const char *indigo_get_last_message(void);
 
 /** Name to be used in log (if not changed ot will be filled with executable name).
  */
 extern char indigo_log_name[];
 
-/** If set, handler is used to print message instead of stderr/syslog output.
+/** If set, handler is used to print message instead of stderr/syslog output; it is called synchronously on the logging thread.
  */
 extern void (*indigo_log_message_handler)(const char *message);
 
 /** Print diagnostic messages.
+ The message is formatted on the calling thread into a per-thread ring buffer and written asynchronously; if the ring is full, the message is dropped and the loss is reported.
  */
 extern void indigo_log_message(const char *format, va_list args);
 
+/** Write all pending diagnostic messages (called automatically on exit).
+ */
+extern void indigo_log_flush(void);
+
+/** Append diagnostic messages to a file instead of stderr/syslog output, NULL or empty path restores default output.
+ */
+extern bool indigo_set_log_file(const char *path);
+
 /** Print diagnostic messages on trace level, wrap calls to INDIGO_TRACE() macro.
  */
 extern void indigo_trace(const char *format, ...);
@@ -344,6 +357,7 @@ extern indigo_log_levels indigo_get_log_level(void);
 
 /** Attach device to bus.
  Return value of attach() callback function is assigned to last_result in device structure.
+ Device is indexed by its name, so the name must not be changed while device is attached.
  */
 extern indigo_result indigo_attach_device(indigo_device *device);
 
@@ -394,8 +408,8 @@ extern indigo_result indigo_enable_blob(indigo_client *client, indigo_property *
  */
 extern void indigo_add_blob(indigo_property *property);
 
-	/** Unregister BLOB property.
-	 */
+/** Unregister BLOB property, waits until pending transfers of its items are finished.
+ */
 extern void indigo_delete_blob(indigo_property *property);
 
 /** Stop bus operation.
@@ -430,6 +444,12 @@ extern void indigo_release_property(indigo_property *property);
 /** Validate address of item of registered BLOB property.
  */
 extern indigo_result indigo_validate_blob(indigo_item *item);
+/** Get opaque id of item of registered BLOB property (used in /blob/ URLs), 0 if item is not registered.
+ */
+extern uint64_t indigo_blob_id(indigo_item *item);
+/** Publish snapshot of value of item of registered BLOB property (taken once per broadcast) and get its opaque id, 0 if item is not registered.
+ */
+extern uint64_t indigo_publish_blob(indigo_item *item, int index);
 
 /** Initialize text item.
  */
@@ -503,6 +523,43 @@ extern indigo_result indigo_device_disconnect(indigo_client *client, char *devic
  */
 extern void indigo_trim_local_service(char *device_name);
 
+/** Encoded message shared by all clients of the same protocol dialect during single broadcast.
+ */
+typedef struct {
+	int reference_count;						///< number of references, message is freed when it drops to zero
+	long size;											///< size of encoded data
+	int descriptor;									///< shared memory descriptor closed with the message (or -1)
+	char data[];										///< encoded data
+} indigo_shared_message;
+
+/** Broadcast cache key (protocol adapter id, protocol version and BLOB mode).
+ */
+#define INDIGO_BROADCAST_KEY(adapter, version, mode) ((((uint32_t)(adapter) & 0xFF) << 24) | (((uint32_t)(version) & 0xFFFF) << 8) | ((uint32_t)(mode) & 0xFF))
+
+/** Create shared message (with reference count 1) as a copy of data.
+ */
+extern indigo_shared_message *indigo_shared_message_create(const char *data, long size);
+
+/** Retain shared message.
+ */
+extern indigo_shared_message *indigo_shared_message_retain(indigo_shared_message *message);
+
+/** Release shared message.
+ */
+extern void indigo_shared_message_release(indigo_shared_message *message);
+
+/** Get retained snapshot and format of item of registered BLOB property by id, has to be released by indigo_shared_message_release(), NULL if item is not registered or empty.
+ */
+extern indigo_shared_message *indigo_acquire_blob(uint64_t id, char *format);
+
+/** Get retained message encoded for the same key during current broadcast (or NULL).
+ */
+extern indigo_shared_message *indigo_broadcast_cache_get(uint32_t key);
+
+/** Make message available for other clients with the same key during current broadcast.
+ */
+extern void indigo_broadcast_cache_put(uint32_t key, indigo_shared_message *message);
+
 /** Property representing all properties of all devices (used for enumeration broadcast).
  */
 extern indigo_property INDIGO_ALL_PROPERTIES;
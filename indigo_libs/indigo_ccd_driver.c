@@ -33,11 +33,15 @@
 #include <time.h>
 #include <math.h>
 #include <fcntl.h>
+#include <dirent.h>
+#include <pthread.h>
 #include <sys/stat.h>
+#include <sys/time.h>
 #include <jpeglib.h>
 
 #include "indigo_ccd_driver.h"
 #include "indigo_io.h"
+#include "indigo_metrics.h"
 
 static void countdown_timer_callback(indigo_device *device) {
 	if (CCD_CONTEXT->countdown_enabled && CCD_EXPOSURE_PROPERTY->state == INDIGO_BUSY_STATE && CCD_EXPOSURE_ITEM->number.value >= 1) {
@@ -64,6 +68,19 @@ void indigo_use_shortest_exposure_if_bias(indigo_device *device) {
 	}
 }
 
+// CCD_IMAGE_FILE is updated both by the camera thread and by the local storage writer
+
+static pthread_mutex_t image_file_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static void update_image_file(indigo_device *device, const char *file_name, indigo_property_state state, const char *message) {
+	pthread_mutex_lock(&image_file_mutex);
+	if (file_name != NULL && *file_name)
+		strncpy(CCD_IMAGE_FILE_ITEM->text.value, file_name, INDIGO_VALUE_SIZE);
+	CCD_IMAGE_FILE_PROPERTY->state = state;
+	indigo_update_property(device, CCD_IMAGE_FILE_PROPERTY, message);
+	pthread_mutex_unlock(&image_file_mutex);
+}
+
 indigo_result indigo_ccd_attach(indigo_device *device, unsigned version) {
 	assert(device != NULL);
 	if (CCD_CONTEXT == NULL) {
@@ -98,6 +115,23 @@ indigo_result indigo_ccd_attach(indigo_device *device, unsigned version) {
 				return INDIGO_FAILED;
 			indigo_init_text_item(CCD_LOCAL_MODE_DIR_ITEM, CCD_LOCAL_MODE_DIR_ITEM_NAME, "Directory", "%s/", getenv("HOME"));
 			indigo_init_text_item(CCD_LOCAL_MODE_PREFIX_ITEM, CCD_LOCAL_MODE_PREFIX_ITEM_NAME, "File name prefix", "IMAGE_XXX");
+			// -------------------------------------------------------------------------------- CCD_LOCAL_SEQUENCE
+			CCD_LOCAL_SEQUENCE_PROPERTY = indigo_init_number_property(NULL, device->name, CCD_LOCAL_SEQUENCE_PROPERTY_NAME, CCD_MAIN_GROUP, "Local file sequence", INDIGO_OK_STATE, INDIGO_RW_PERM, 1);
+			if (CCD_LOCAL_SEQUENCE_PROPERTY == NULL)
+				return INDIGO_FAILED;
+			indigo_init_number_item(CCD_LOCAL_SEQUENCE_NEXT_ITEM, CCD_LOCAL_SEQUENCE_NEXT_ITEM_NAME, "Next file number", 0, 999999, 1, 0);
+			// -------------------------------------------------------------------------------- CCD_LOCAL_SYNC
+			CCD_LOCAL_SYNC_PROPERTY = indigo_init_number_property(NULL, device->name, CCD_LOCAL_SYNC_PROPERTY_NAME, CCD_MAIN_GROUP, "Local file sync", INDIGO_OK_STATE, INDIGO_RW_PERM, 1);
+			if (CCD_LOCAL_SYNC_PROPERTY == NULL)
+				return INDIGO_FAILED;
+			indigo_init_number_item(CCD_LOCAL_SYNC_FRAMES_ITEM, CCD_LOCAL_SYNC_FRAMES_ITEM_NAME, "Sync every N frames (0 = never)", 0, 1000, 1, 0);
+			// -------------------------------------------------------------------------------- CCD_LOCAL_QUEUE
+			CCD_LOCAL_QUEUE_PROPERTY = indigo_init_number_property(NULL, device->name, CCD_LOCAL_QUEUE_PROPERTY_NAME, CCD_MAIN_GROUP, "Local write queue", INDIGO_OK_STATE, INDIGO_RO_PERM, 3);
+			if (CCD_LOCAL_QUEUE_PROPERTY == NULL)
+				return INDIGO_FAILED;
+			indigo_init_number_item(CCD_LOCAL_QUEUE_DEPTH_ITEM, CCD_LOCAL_QUEUE_DEPTH_ITEM_NAME, "Queued images", 0, 1000, 0, 0);
+			indigo_init_number_item(CCD_LOCAL_QUEUE_PENDING_ITEM, CCD_LOCAL_QUEUE_PENDING_ITEM_NAME, "Pending [MB]", 0, 100000, 0, 0);
+			indigo_init_number_item(CCD_LOCAL_QUEUE_THROUGHPUT_ITEM, CCD_LOCAL_QUEUE_THROUGHPUT_ITEM_NAME, "Throughput [MB/s]", 0, 100000, 0, 0);
 			// -------------------------------------------------------------------------------- CCD_MODE
 			CCD_MODE_PROPERTY = indigo_init_switch_property(NULL, device->name, CCD_MODE_PROPERTY_NAME, CCD_MAIN_GROUP, "Capture mode", INDIGO_OK_STATE, INDIGO_RW_PERM, INDIGO_ONE_OF_MANY_RULE, 64);
 			if (CCD_MODE_PROPERTY == NULL)
@@ -235,6 +269,12 @@ indigo_result indigo_ccd_enumerate_properties(indigo_device *device, indigo_clie
 			indigo_define_property(device, CCD_INFO_PROPERTY, NULL);
 		if (indigo_property_match(CCD_LOCAL_MODE_PROPERTY, property))
 			indigo_define_property(device, CCD_LOCAL_MODE_PROPERTY, NULL);
+		if (indigo_property_match(CCD_LOCAL_SEQUENCE_PROPERTY, property))
+			indigo_define_property(device, CCD_LOCAL_SEQUENCE_PROPERTY, NULL);
+		if (indigo_property_match(CCD_LOCAL_SYNC_PROPERTY, property))
+			indigo_define_property(device, CCD_LOCAL_SYNC_PROPERTY, NULL);
+		if (indigo_property_match(CCD_LOCAL_QUEUE_PROPERTY, property))
+			indigo_define_property(device, CCD_LOCAL_QUEUE_PROPERTY, NULL);
 		if (indigo_property_match(CCD_IMAGE_FILE_PROPERTY, property))
 			indigo_define_property(device, CCD_IMAGE_FILE_PROPERTY, NULL);
 		if (indigo_property_match(CCD_MODE_PROPERTY, property))
@@ -287,6 +327,9 @@ indigo_result indigo_ccd_change_property(indigo_device *device, indigo_client *c
 			indigo_define_property(device, CCD_INFO_PROPERTY, NULL);
 			indigo_define_property(device, CCD_UPLOAD_MODE_PROPERTY, NULL);
 			indigo_define_property(device, CCD_LOCAL_MODE_PROPERTY, NULL);
+			indigo_define_property(device, CCD_LOCAL_SEQUENCE_PROPERTY, NULL);
+			indigo_define_property(device, CCD_LOCAL_SYNC_PROPERTY, NULL);
+			indigo_define_property(device, CCD_LOCAL_QUEUE_PROPERTY, NULL);
 			indigo_define_property(device, CCD_MODE_PROPERTY, NULL);
 			indigo_define_property(device, CCD_READ_MODE_PROPERTY, NULL);
 			indigo_define_property(device, CCD_EXPOSURE_PROPERTY, NULL);
@@ -309,6 +352,9 @@ indigo_result indigo_ccd_change_property(indigo_device *device, indigo_client *c
 			indigo_delete_property(device, CCD_INFO_PROPERTY, NULL);
 			indigo_delete_property(device, CCD_UPLOAD_MODE_PROPERTY, NULL);
 			indigo_delete_property(device, CCD_LOCAL_MODE_PROPERTY, NULL);
+			indigo_delete_property(device, CCD_LOCAL_SEQUENCE_PROPERTY, NULL);
+			indigo_delete_property(device, CCD_LOCAL_SYNC_PROPERTY, NULL);
+			indigo_delete_property(device, CCD_LOCAL_QUEUE_PROPERTY, NULL);
 			indigo_delete_property(device, CCD_MODE_PROPERTY, NULL);
 			indigo_delete_property(device, CCD_READ_MODE_PROPERTY, NULL);
 			indigo_delete_property(device, CCD_EXPOSURE_PROPERTY, NULL);
@@ -335,6 +381,8 @@ indigo_result indigo_ccd_change_property(indigo_device *device, indigo_client *c
 			indigo_save_property(device, NULL, CCD_READ_MODE_PROPERTY);
 			indigo_save_property(device, NULL, CCD_UPLOAD_MODE_PROPERTY);
 			indigo_save_property(device, NULL, CCD_LOCAL_MODE_PROPERTY);
+			indigo_save_property(device, NULL, CCD_LOCAL_SEQUENCE_PROPERTY);
+			indigo_save_property(device, NULL, CCD_LOCAL_SYNC_PROPERTY);
 			indigo_save_property(device, NULL, CCD_FRAME_PROPERTY);
 			indigo_save_property(device, NULL, CCD_BIN_PROPERTY);
 			indigo_save_property(device, NULL, CCD_OFFSET_PROPERTY);
@@ -347,10 +395,8 @@ indigo_result indigo_ccd_change_property(indigo_device *device, indigo_client *c
 		// -------------------------------------------------------------------------------- CCD_EXPOSURE
 		if (CCD_EXPOSURE_PROPERTY->state == INDIGO_BUSY_STATE) {
 			if (CCD_UPLOAD_MODE_LOCAL_ITEM->sw.value) {
-				if (CCD_IMAGE_FILE_PROPERTY->state != INDIGO_BUSY_STATE) {
-					CCD_IMAGE_FILE_PROPERTY->state = INDIGO_BUSY_STATE;
-					indigo_update_property(device, CCD_IMAGE_FILE_PROPERTY, NULL);
-				}
+				if (CCD_IMAGE_FILE_PROPERTY->state != INDIGO_BUSY_STATE)
+					update_image_file(device, NULL, INDIGO_BUSY_STATE, NULL);
 			} else {
 				if (CCD_IMAGE_PROPERTY->state != INDIGO_BUSY_STATE) {
 					CCD_IMAGE_PROPERTY->state = INDIGO_BUSY_STATE;
@@ -501,8 +547,26 @@ indigo_result indigo_ccd_change_property(indigo_device *device, indigo_client *c
 		// -------------------------------------------------------------------------------- CCD_IMAGE_LOCAL_MODE
 		indigo_property_copy_values(CCD_LOCAL_MODE_PROPERTY, property, false);
 		CCD_LOCAL_MODE_PROPERTY->state = INDIGO_OK_STATE;
-		if (IS_CONNECTED)
+		CCD_LOCAL_SEQUENCE_NEXT_ITEM->number.value = 0;
+		if (IS_CONNECTED) {
 			indigo_update_property(device, CCD_LOCAL_MODE_PROPERTY, NULL);
+			indigo_update_property(device, CCD_LOCAL_SEQUENCE_PROPERTY, NULL);
+		}
+		return INDIGO_OK;
+	} else if (indigo_property_match(CCD_LOCAL_SEQUENCE_PROPERTY, property)) {
+		// -------------------------------------------------------------------------------- CCD_LOCAL_SEQUENCE
+		indigo_property_copy_values(CCD_LOCAL_SEQUENCE_PROPERTY, property, false);
+		CCD_LOCAL_SEQUENCE_PROPERTY->state = INDIGO_OK_STATE;
+		*CCD_CONTEXT->local_sequence_format = 0;
+		if (IS_CONNECTED)
+			indigo_update_property(device, CCD_LOCAL_SEQUENCE_PROPERTY, NULL);
+		return INDIGO_OK;
+	} else if (indigo_property_match(CCD_LOCAL_SYNC_PROPERTY, property)) {
+		// -------------------------------------------------------------------------------- CCD_LOCAL_SYNC
+		indigo_property_copy_values(CCD_LOCAL_SYNC_PROPERTY, property, false);
+		CCD_LOCAL_SYNC_PROPERTY->state = INDIGO_OK_STATE;
+		if (IS_CONNECTED)
+			indigo_update_property(device, CCD_LOCAL_SYNC_PROPERTY, NULL);
 		return INDIGO_OK;
 	} else if (indigo_property_match(CCD_FITS_HEADERS_PROPERTY, property)) {
 		// -------------------------------------------------------------------------------- CCD_FITS_HEADERS
@@ -554,11 +618,17 @@ indigo_result indigo_ccd_change_property(indigo_device *device, indigo_client *c
 	return indigo_device_change_property(device, client, property);
 }
 
+static void local_storage_stop(indigo_device *device);
+
 indigo_result indigo_ccd_detach(indigo_device *device) {
 	assert(device != NULL);
+	local_storage_stop(device);
 	indigo_release_property(CCD_INFO_PROPERTY);
 	indigo_release_property(CCD_UPLOAD_MODE_PROPERTY);
 	indigo_release_property(CCD_LOCAL_MODE_PROPERTY);
+	indigo_release_property(CCD_LOCAL_SEQUENCE_PROPERTY);
+	indigo_release_property(CCD_LOCAL_SYNC_PROPERTY);
+	indigo_release_property(CCD_LOCAL_QUEUE_PROPERTY);
 	indigo_release_property(CCD_MODE_PROPERTY);
 	indigo_release_property(CCD_READ_MODE_PROPERTY);
 	indigo_release_property(CCD_EXPOSURE_PROPERTY);
@@ -580,10 +650,266 @@ indigo_result indigo_ccd_detach(indigo_device *device) {
 	return indigo_device_detach(device);
 }
 
-void indigo_process_image(indigo_device *device, void *data, int frame_width, int frame_height, int bpp, bool little_endian, bool byte_order_rgb, indigo_fits_keyword *keywords) {
+static int scan_local_sequence(const char *format) {
+	char directory[INDIGO_VALUE_SIZE], head[INDIGO_VALUE_SIZE];
+	const char *placeholder = strstr(format, "%03d");
+	const char *tail = placeholder + 4;
+	const char *name = placeholder;
+	while (name > format && name[-1] != '/')
+		name--;
+	if (name == format) {
+		strcpy(directory, ".");
+	} else {
+		snprintf(directory, sizeof(directory), "%.*s", (int)(name - format), format);
+	}
+	int head_length = (int)(placeholder - name);
+	snprintf(head, sizeof(head), "%.*s", head_length, name);
+	int max = 0;
+	DIR *dir = opendir(directory);
+	if (dir) {
+		struct dirent *entry;
+		while ((entry = readdir(dir)) != NULL) {
+			char *digits = entry->d_name + head_length, *end;
+			if (strncmp(entry->d_name, head, head_length) || !isdigit(*digits))
+				continue;
+			long sequence = strtol(digits, &end, 10);
+			if (!strcmp(end, tail) && sequence > max)
+				max = (int)sequence;
+		}
+		closedir(dir);
+	}
+	return max + 1;
+}
+
+static int create_local_file(indigo_device *device, const char *suffix, char *file_name, char **message) {
+	char *dir = CCD_LOCAL_MODE_DIR_ITEM->text.value;
+	char *prefix = CCD_LOCAL_MODE_PREFIX_ITEM->text.value;
+	*file_name = 0;
+	if (strlen(dir) + strlen(prefix) + strlen(suffix) >= INDIGO_VALUE_SIZE) {
+		*message = "dir + prefix + suffix is too long";
+		return -1;
+	}
+	int handle;
+	char *xxx = strstr(prefix, "XXX");
+	if (xxx == NULL) {
+		snprintf(file_name, INDIGO_VALUE_SIZE, "%s%s%s", dir, prefix, suffix);
+		handle = open(file_name, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	} else {
+		// directory is scanned only if the sequence is unknown or the file name pattern has changed, O_EXCL guards against files created by somebody else
+		char format[INDIGO_VALUE_SIZE];
+		snprintf(format, sizeof(format), "%s%.*s%%03d%s%s", dir, (int)(xxx - prefix), prefix, xxx + 3, suffix);
+		int sequence = (int)CCD_LOCAL_SEQUENCE_NEXT_ITEM->number.value;
+		if (sequence <= 0 || (*CCD_CONTEXT->local_sequence_format && strcmp(format, CCD_CONTEXT->local_sequence_format)))
+			sequence = scan_local_sequence(format);
+		strcpy(CCD_CONTEXT->local_sequence_format, format);
+		while (true) {
+			snprintf(file_name, INDIGO_VALUE_SIZE, format, sequence);
+			handle = open(file_name, O_WRONLY | O_CREAT | O_EXCL, 0644);
+			if (handle >= 0 || errno != EEXIST)
+				break;
+			int next = scan_local_sequence(format);
+			sequence = next > sequence ? next : sequence + 1;
+		}
+		if (handle >= 0) {
+			CCD_LOCAL_SEQUENCE_NEXT_ITEM->number.value = sequence + 1;
+			indigo_update_property(device, CCD_LOCAL_SEQUENCE_PROPERTY, NULL);
+		}
+	}
+	if (handle < 0)
+		*message = strerror(errno);
+	return handle;
+}
+
+// images are copied to a bounded write-behind queue and written by a per-device thread, so slow storage doesn't throttle capture
+
+#define LOCAL_STORAGE_MAX_DEPTH		16
+#define LOCAL_STORAGE_MAX_PENDING	(512 * 1024 * 1024)
+#define LOCAL_STORAGE_MAX_UNSYNCED	64
+
+typedef struct local_storage_job {
+	struct local_storage_job *next;
+	int handle;
+	char file_name[INDIGO_VALUE_SIZE];
+	size_t size;
+	char data[];
+} local_storage_job;
+
+typedef struct {
+	pthread_t thread;
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	local_storage_job *head, *tail;
+	int depth;
+	size_t pending;
+	int unsynced[LOCAL_STORAGE_MAX_UNSYNCED];
+	int unsynced_count;
+	double throughput;
+	bool terminate;
+} local_storage;
+
+static void local_storage_update(indigo_device *device, local_storage *storage) {
+	CCD_LOCAL_QUEUE_DEPTH_ITEM->number.value = storage->depth;
+	CCD_LOCAL_QUEUE_PENDING_ITEM->number.value = round(storage->pending / 104857.6) / 10;
+	CCD_LOCAL_QUEUE_THROUGHPUT_ITEM->number.value = round(storage->throughput * 10) / 10;
+	CCD_LOCAL_QUEUE_PROPERTY->state = storage->depth > 0 ? INDIGO_BUSY_STATE : INDIGO_OK_STATE;
+	indigo_update_property(device, CCD_LOCAL_QUEUE_PROPERTY, NULL);
+}
+
+static bool local_storage_sync(local_storage *storage) {
+	bool result = true;
+	for (int i = 0; i < storage->unsynced_count; i++) {
+		int handle = storage->unsynced[i];
+#ifdef INDIGO_LINUX
+		if (fdatasync(handle) != 0)
+			result = false;
+#else
+		if (fsync(handle) != 0)
+			result = false;
+#endif
+		if (close(handle) != 0)
+			result = false;
+	}
+	storage->unsynced_count = 0;
+	return result;
+}
+
+static bool local_storage_write(indigo_device *device, local_storage *storage, local_storage_job *job, char **message) {
+	bool result = true;
+#ifdef INDIGO_LINUX
+	posix_fallocate(job->handle, 0, job->size);
+#endif
+	if (!indigo_write(job->handle, job->data, job->size)) {
+		*message = strerror(errno);
+		result = false;
+	}
+	int sync_frames = (int)CCD_LOCAL_SYNC_FRAMES_ITEM->number.value;
+	if (result && sync_frames > 0) {
+		// files are kept open until the sync point and flushed one by one, at most LOCAL_STORAGE_MAX_UNSYNCED at once
+		storage->unsynced[storage->unsynced_count++] = job->handle;
+	} else if (close(job->handle) != 0 && result) {
+		*message = strerror(errno);
+		result = false;
+	}
+	if (storage->unsynced_count > 0 && (storage->unsynced_count >= sync_frames || storage->unsynced_count == LOCAL_STORAGE_MAX_UNSYNCED)) {
+		if (!local_storage_sync(storage) && result) {
+			*message = strerror(errno);
+			result = false;
+		}
+	}
+	return result;
+}
+
+static void *local_storage_worker(indigo_device *device) {
+	local_storage *storage = CCD_CONTEXT->local_storage;
+	pthread_mutex_lock(&storage->mutex);
+	while (true) {
+		while (storage->head == NULL && !storage->terminate)
+			pthread_cond_wait(&storage->cond, &storage->mutex);
+		local_storage_job *job = storage->head;
+		if (job == NULL)
+			break;
+		pthread_mutex_unlock(&storage->mutex);
+		char *message = NULL;
+		struct timeval start, end;
+		gettimeofday(&start, NULL);
+		bool result = local_storage_write(device, storage, job, &message);
+		gettimeofday(&end, NULL);
+		double elapsed = (end.tv_sec - start.tv_sec) + (end.tv_usec - start.tv_usec) / 1000000.0;
+		INDIGO_DEBUG(indigo_debug("Local save of %s in %gs", job->file_name, elapsed));
+		pthread_mutex_lock(&storage->mutex);
+		if (elapsed > 0)
+			storage->throughput = storage->throughput == 0 ? job->size / elapsed / 1048576 : 0.8 * storage->throughput + 0.2 * job->size / elapsed / 1048576;
+		storage->head = job->next;
+		if (storage->head == NULL)
+			storage->tail = NULL;
+		storage->depth--;
+		storage->pending -= job->size;
+		pthread_cond_broadcast(&storage->cond);
+		update_image_file(device, job->file_name, !result ? INDIGO_ALERT_STATE : storage->depth > 0 ? INDIGO_BUSY_STATE : INDIGO_OK_STATE, message);
+		local_storage_update(device, storage);
+		free(job);
+	}
+	if (storage->unsynced_count > 0 && !local_storage_sync(storage))
+		INDIGO_ERROR(indigo_error("Local save sync failed -> %s (%d)", strerror(errno), errno));
+	pthread_mutex_unlock(&storage->mutex);
+	return NULL;
+}
+
+static bool local_storage_enqueue(indigo_device *device, int handle, const char *file_name, void *data, size_t size) {
+	local_storage *storage = CCD_CONTEXT->local_storage;
+	if (storage == NULL) {
+		storage = malloc(sizeof(local_storage));
+		if (storage == NULL)
+			return false;
+		memset(storage, 0, sizeof(local_storage));
+		pthread_mutex_init(&storage->mutex, NULL);
+		pthread_cond_init(&storage->cond, NULL);
+		CCD_CONTEXT->local_storage = storage;
+		if (pthread_create(&storage->thread, NULL, (void *(*)(void *))local_storage_worker, device) != 0) {
+			pthread_mutex_destroy(&storage->mutex);
+			pthread_cond_destroy(&storage->cond);
+			free(storage);
+			CCD_CONTEXT->local_storage = NULL;
+			return false;
+		}
+	}
+	local_storage_job *job = malloc(sizeof(local_storage_job) + size);
+	if (job == NULL)
+		return false;
+	job->next = NULL;
+	job->handle = handle;
+	strncpy(job->file_name, file_name, INDIGO_VALUE_SIZE);
+	job->size = size;
+	memcpy(job->data, data, size);
+	pthread_mutex_lock(&storage->mutex);
+	while (storage->depth > 0 && (storage->depth >= LOCAL_STORAGE_MAX_DEPTH || storage->pending + size > LOCAL_STORAGE_MAX_PENDING))
+		pthread_cond_wait(&storage->cond, &storage->mutex);
+	if (storage->tail)
+		storage->tail->next = job;
+	else
+		storage->head = job;
+	storage->tail = job;
+	storage->depth++;
+	storage->pending += size;
+	pthread_cond_broadcast(&storage->cond);
+	update_image_file(device, file_name, INDIGO_BUSY_STATE, NULL);
+	local_storage_update(device, storage);
+	pthread_mutex_unlock(&storage->mutex);
+	return true;
+}
+
+static void local_storage_stop(indigo_device *device) {
+	local_storage *storage = CCD_CONTEXT->local_storage;
+	if (storage == NULL)
+		return;
+	pthread_mutex_lock(&storage->mutex);
+	storage->terminate = true;
+	pthread_cond_broadcast(&storage->cond);
+	pthread_mutex_unlock(&storage->mutex);
+	pthread_join(storage->thread, NULL);
+	pthread_mutex_destroy(&storage->mutex);
+	pthread_cond_destroy(&storage->cond);
+	free(storage);
+	CCD_CONTEXT->local_storage = NULL;
+}
+
+static void save_local_file(indigo_device *device, int handle, const char *file_name, void *data, size_t size, char **message) {
+	if (local_storage_enqueue(device, handle, file_name, data, size))
+		return;
+	// fallback to synchronous write if image can't be queued
+	indigo_property_state state = INDIGO_OK_STATE;
+	if (!indigo_write(handle, data, size)) {
+		state = INDIGO_ALERT_STATE;
+		*message = strerror(errno);
+	}
+	close(handle);
+	update_image_file(device, file_name, state, *message);
+}
+
+static void process_image(indigo_device *device, void *data, int frame_width, int frame_height, int bpp, bool little_endian, bool byte_order_rgb, bool planar, indigo_fits_keyword *keywords) {
 	assert(device != NULL);
 	assert(data != NULL);
-	INDIGO_DEBUG(clock_t start = clock());
+	uint64_t start = indigo_metrics_now();
 
 	int horizontal_bin = CCD_BIN_HORIZONTAL_ITEM->number.value;
 	int vertical_bin = CCD_BIN_VERTICAL_ITEM->number.value;
@@ -600,8 +926,42 @@ void indigo_process_image(indigo_device *device, void *data, int frame_width, in
 		naxis = 3;
 		blobsize = 6 * size;
 	}
+	if (planar && naxis == 3 && !CCD_IMAGE_FORMAT_FITS_ITEM->sw.value) {
+		unsigned char *raw = malloc(blobsize);
+		if (raw == NULL) {
+			INDIGO_ERROR(indigo_error("Failed to allocate %d bytes for planar image conversion", blobsize));
+			CCD_IMAGE_PROPERTY->state = INDIGO_ALERT_STATE;
+			indigo_update_property(device, CCD_IMAGE_PROPERTY, "Failed to allocate image buffer");
+			return;
+		}
+		if (byte_per_pixel == 1) {
+			unsigned char *red = data + FITS_HEADER_SIZE;
+			unsigned char *green = red + size;
+			unsigned char *blue = green + size;
+			unsigned char *tmp = raw;
+			for (int i = 0; i < size; i++) {
+				*tmp++ = *red++;
+				*tmp++ = *green++;
+				*tmp++ = *blue++;
+			}
+		} else {
+			unsigned short *red = (unsigned short *)(data + FITS_HEADER_SIZE);
+			unsigned short *green = red + size;
+			unsigned short *blue = green + size;
+			unsigned short *tmp = (unsigned short *)raw;
+			for (int i = 0; i < size; i++) {
+				*tmp++ = *red++;
+				*tmp++ = *green++;
+				*tmp++ = *blue++;
+			}
+		}
+		memcpy(data + FITS_HEADER_SIZE, raw, blobsize);
+		free(raw);
+		byte_order_rgb = true;
+		planar = false;
+	}
 	if (CCD_IMAGE_FORMAT_FITS_ITEM->sw.value) {
-		INDIGO_DEBUG(clock_t start = clock());
+		uint64_t start = indigo_metrics_now();
 		time_t timer;
 		struct tm* tm_info;
 		char date_time_end[20];
@@ -724,6 +1084,22 @@ void indigo_process_image(indigo_device *device, void *data, int frame_width, in
 					*raw++ = (value & 0xff) << 8 | (value & 0xff00) >> 8;
 				}
 			}
+		} else if (planar && byte_per_pixel == 2 && naxis == 3) {
+			short *raw = (short *)(data + FITS_HEADER_SIZE);
+			if (little_endian) {
+				for (int i = 0; i < 3 * size; i++) {
+					int value = *raw - 32768;
+					*raw++ = (value & 0xff) << 8 | (value & 0xff00) >> 8;
+				}
+			} else {
+				for (int i = 0; i < 3 * size; i++) {
+					int value = *raw;
+					value = ((value & 0xff) << 8 | (value & 0xff00) >> 8 ) - 32768;
+					*raw++ = (value & 0xff) << 8 | (value & 0xff00) >> 8;
+				}
+			}
+		} else if (planar && byte_per_pixel == 1 && naxis == 3) {
+			// already in FITS layout
 		} else if (byte_per_pixel == 1 && naxis == 3) {
 			unsigned char *raw = malloc(3 * size);
 			unsigned char *red = raw;
@@ -797,9 +1173,11 @@ void indigo_process_image(indigo_device *device, void *data, int frame_width, in
 				blobsize += padding;
 			}
 		}
-		INDIGO_DEBUG(indigo_debug("RAW to FITS conversion in %gs", (clock() - start) / (double)CLOCKS_PER_SEC));
+		uint64_t duration = indigo_metrics_now() - start;
+		indigo_histogram_record(&indigo_blob_encode_histogram, duration);
+		INDIGO_DEBUG(indigo_debug("RAW to FITS conversion in %gs", duration / 1e6));
 	} else if (CCD_IMAGE_FORMAT_XISF_ITEM->sw.value) {
-		INDIGO_DEBUG(clock_t start = clock());
+		uint64_t start = indigo_metrics_now();
 		time_t timer;
 		struct tm* tm_info;
 		char date_time_end[21], date_time_start[21];
@@ -937,7 +1315,9 @@ void indigo_process_image(indigo_device *device, void *data, int frame_width, in
 				}
 			}
 		}
-		INDIGO_DEBUG(indigo_debug("RAW to XISF conversion in %gs", (clock() - start) / (double)CLOCKS_PER_SEC));
+		uint64_t duration = indigo_metrics_now() - start;
+		indigo_histogram_record(&indigo_blob_encode_histogram, duration);
+		INDIGO_DEBUG(indigo_debug("RAW to XISF conversion in %gs", duration / 1e6));
 	} else if (CCD_IMAGE_FORMAT_RAW_ITEM->sw.value) {
 		indigo_raw_header *header = (indigo_raw_header *)(data + FITS_HEADER_SIZE - sizeof(indigo_raw_header));
 		if (naxis == 2 && byte_per_pixel == 1)
@@ -1001,7 +1381,7 @@ void indigo_process_image(indigo_device *device, void *data, int frame_width, in
 		header->width = frame_width;
 		header->height = frame_height;
 	} else if (CCD_IMAGE_FORMAT_JPEG_ITEM->sw.value) {
-		INDIGO_DEBUG(clock_t start = clock());
+		uint64_t start = indigo_metrics_now();
 		unsigned char *mem = NULL;
 		unsigned long mem_size = 0;
 		struct jpeg_compress_struct cinfo;
@@ -1089,11 +1469,11 @@ void indigo_process_image(indigo_device *device, void *data, int frame_width, in
 		}
 		blobsize = (int)mem_size;
 		free(mem);
-		INDIGO_DEBUG(indigo_debug("RAW to JPEG conversion in %gs", (clock() - start) / (double)CLOCKS_PER_SEC));
+		uint64_t duration = indigo_metrics_now() - start;
+		indigo_histogram_record(&indigo_blob_encode_histogram, duration);
+		INDIGO_DEBUG(indigo_debug("RAW to JPEG conversion in %gs", duration / 1e6));
 	}
 	if (CCD_UPLOAD_MODE_LOCAL_ITEM->sw.value || CCD_UPLOAD_MODE_BOTH_ITEM->sw.value) {
-		char *dir = CCD_LOCAL_MODE_DIR_ITEM->text.value;
-		char *prefix = CCD_LOCAL_MODE_PREFIX_ITEM->text.value;
 		char *suffix;
 		if (CCD_IMAGE_FORMAT_FITS_ITEM->sw.value) {
 			suffix = ".fits";
@@ -1104,68 +1484,19 @@ void indigo_process_image(indigo_device *device, void *data, int frame_width, in
 		} else if (CCD_IMAGE_FORMAT_JPEG_ITEM->sw.value) {
 			suffix = ".jpeg";
 		}
-		int handle = 0;
-		char *message = NULL;
-		if (strlen(dir) + strlen(prefix) + strlen(suffix) < INDIGO_VALUE_SIZE) {
-			char file_name[INDIGO_VALUE_SIZE];
-			char *xxx = strstr(prefix, "XXX");
-			if (xxx == NULL) {
-				strncpy(file_name, dir, INDIGO_VALUE_SIZE);
-				strcat(file_name, prefix);
-				strcat(file_name, suffix);
-			} else {
-				char format[INDIGO_VALUE_SIZE];
-				strcpy(format, dir);
-				strncat(format, prefix, xxx - prefix);
-				strcat(format, "%03d");
-				strcat(format, xxx+3);
-				strcat(format, suffix);
-				struct stat sb;
-				int i = 1;
-				while (true) {
-					snprintf(file_name, sizeof(file_name), format, i);
-					if (stat(file_name, &sb) == 0 && S_ISREG(sb.st_mode))
-						i++;
-					else
-						break;
-				}
-			}
-			strncpy(CCD_IMAGE_FILE_ITEM->text.value, file_name, INDIGO_VALUE_SIZE);
-			CCD_IMAGE_FILE_PROPERTY->state = INDIGO_OK_STATE;
-			handle = open(file_name, O_WRONLY | O_CREAT | O_TRUNC, 0644);
-			if (handle) {
-				if (CCD_IMAGE_FORMAT_FITS_ITEM->sw.value) {
-					if (!indigo_write(handle, data, FITS_HEADER_SIZE + blobsize)) {
-						CCD_IMAGE_FILE_PROPERTY->state = INDIGO_ALERT_STATE;
-						message = strerror(errno);
-					}
-				} else if (CCD_IMAGE_FORMAT_XISF_ITEM->sw.value) {
-					if (!indigo_write(handle, data, FITS_HEADER_SIZE + blobsize)) {
-						CCD_IMAGE_FILE_PROPERTY->state = INDIGO_ALERT_STATE;
-						message = strerror(errno);
-					}
-				} else if (CCD_IMAGE_FORMAT_RAW_ITEM->sw.value) {
-					if (!indigo_write(handle, data + FITS_HEADER_SIZE - sizeof(indigo_raw_header), blobsize + sizeof(indigo_raw_header))) {
-						CCD_IMAGE_FILE_PROPERTY->state = INDIGO_ALERT_STATE;
-						message = strerror(errno);
-					}
-				} else if (CCD_IMAGE_FORMAT_JPEG_ITEM->sw.value) {
-					if (!indigo_write(handle, data, blobsize)) {
-						CCD_IMAGE_FILE_PROPERTY->state = INDIGO_ALERT_STATE;
-						message = strerror(errno);
-					}
-				}
-				close(handle);
-			} else {
-				CCD_IMAGE_FILE_PROPERTY->state = INDIGO_ALERT_STATE;
-				message = strerror(errno);
-			}
+		char *message = NULL, file_name[INDIGO_VALUE_SIZE];
+		int handle = create_local_file(device, suffix, file_name, &message);
+		if (handle >= 0) {
+			if (CCD_IMAGE_FORMAT_RAW_ITEM->sw.value)
+				save_local_file(device, handle, file_name, data + FITS_HEADER_SIZE - sizeof(indigo_raw_header), blobsize + sizeof(indigo_raw_header), &message);
+			else if (CCD_IMAGE_FORMAT_JPEG_ITEM->sw.value)
+				save_local_file(device, handle, file_name, data, blobsize, &message);
+			else
+				save_local_file(device, handle, file_name, data, FITS_HEADER_SIZE + blobsize, &message);
 		} else {
-			CCD_IMAGE_FILE_PROPERTY->state = INDIGO_ALERT_STATE;
-			message = "dir + prefix + suffix is too long";
+			update_image_file(device, file_name, INDIGO_ALERT_STATE, message);
 		}
-		indigo_update_property(device, CCD_IMAGE_FILE_PROPERTY, message);
-		INDIGO_DEBUG(indigo_debug("Local save in %gs", (clock() - start) / (double)CLOCKS_PER_SEC));
+		INDIGO_DEBUG(indigo_debug("Local save queued in %gs", (indigo_metrics_now() - start) / 1e6));
 	}
 	if (CCD_UPLOAD_MODE_CLIENT_ITEM->sw.value || CCD_UPLOAD_MODE_BOTH_ITEM->sw.value) {
 		*CCD_IMAGE_ITEM->blob.url = 0;
@@ -1188,63 +1519,32 @@ void indigo_process_image(indigo_device *device, void *data, int frame_width, in
 		}
 		CCD_IMAGE_PROPERTY->state = INDIGO_OK_STATE;
 		indigo_update_property(device, CCD_IMAGE_PROPERTY, NULL);
-		INDIGO_DEBUG(indigo_debug("Client upload in %gs", (clock() - start) / (double)CLOCKS_PER_SEC));
+		INDIGO_DEBUG(indigo_debug("Client upload in %gs", (indigo_metrics_now() - start) / 1e6));
 	}
 }
 
+void indigo_process_image(indigo_device *device, void *data, int frame_width, int frame_height, int bpp, bool little_endian, bool byte_order_rgb, indigo_fits_keyword *keywords) {
+	process_image(device, data, frame_width, frame_height, bpp, little_endian, byte_order_rgb, false, keywords);
+}
+
+void indigo_process_planar_image(indigo_device *device, void *data, int frame_width, int frame_height, int bpp, bool little_endian, indigo_fits_keyword *keywords) {
+	process_image(device, data, frame_width, frame_height, bpp, little_endian, true, true, keywords);
+}
+
 void indigo_process_dslr_image(indigo_device *device, void *data, int blobsize, const char *suffix) {
 	assert(device != NULL);
 	assert(data != NULL);
-	INDIGO_DEBUG(clock_t start = clock());
+	uint64_t start = indigo_metrics_now();
 
 	if (CCD_UPLOAD_MODE_LOCAL_ITEM->sw.value || CCD_UPLOAD_MODE_BOTH_ITEM->sw.value) {
-		char *dir = CCD_LOCAL_MODE_DIR_ITEM->text.value;
-		char *prefix = CCD_LOCAL_MODE_PREFIX_ITEM->text.value;
-		int handle = 0;
-		char *message = NULL;
-		if (strlen(dir) + strlen(prefix) + strlen(suffix) < INDIGO_VALUE_SIZE) {
-			char file_name[INDIGO_VALUE_SIZE];
-			char *xxx = strstr(prefix, "XXX");
-			if (xxx == NULL) {
-				strncpy(file_name, dir, INDIGO_VALUE_SIZE - strlen(prefix) - strlen(suffix));
-				strcat(file_name, prefix);
-				strcat(file_name, suffix);
-			} else {
-				char format[INDIGO_VALUE_SIZE];
-				strncpy(format, dir, INDIGO_VALUE_SIZE);
-				strncat(format, prefix, xxx - prefix);
-				strcat(format, "%03d");
-				strcat(format, xxx+3);
-				strcat(format, suffix);
-				struct stat sb;
-				int i = 1;
-				while (true) {
-					snprintf(file_name, sizeof(file_name), format, i);
-					if (stat(file_name, &sb) == 0 && S_ISREG(sb.st_mode))
-						i++;
-					else
-						break;
-				}
-			}
-			strncpy(CCD_IMAGE_FILE_ITEM->text.value, file_name, INDIGO_VALUE_SIZE);
-			CCD_IMAGE_FILE_PROPERTY->state = INDIGO_OK_STATE;
-			handle = open(file_name, O_WRONLY | O_CREAT | O_TRUNC, 0644);
-			if (handle) {
-				if (!indigo_write(handle, data, blobsize)) {
-					CCD_IMAGE_FILE_PROPERTY->state = INDIGO_ALERT_STATE;
-					message = strerror(errno);
-				}
-				close(handle);
-			} else {
-				CCD_IMAGE_FILE_PROPERTY->state = INDIGO_ALERT_STATE;
-				message = strerror(errno);
-			}
+		char *message = NULL, file_name[INDIGO_VALUE_SIZE];
+		int handle = create_local_file(device, suffix, file_name, &message);
+		if (handle >= 0) {
+			save_local_file(device, handle, file_name, data, blobsize, &message);
 		} else {
-			CCD_IMAGE_FILE_PROPERTY->state = INDIGO_ALERT_STATE;
-			message = "dir + prefix + suffix is too long";
+			update_image_file(device, file_name, INDIGO_ALERT_STATE, message);
 		}
-		indigo_update_property(device, CCD_IMAGE_FILE_PROPERTY, message);
-		INDIGO_DEBUG(indigo_debug("Local save in %gs", (clock() - start) / (double)CLOCKS_PER_SEC));
+		INDIGO_DEBUG(indigo_debug("Local save queued in %gs", (indigo_metrics_now() - start) / 1e6));
 	}
 	if (CCD_UPLOAD_MODE_CLIENT_ITEM->sw.value || CCD_UPLOAD_MODE_BOTH_ITEM->sw.value) {
 		*CCD_IMAGE_ITEM->blob.url = 0;
@@ -1253,6 +1553,6 @@ void indigo_process_dslr_image(indigo_device *device, void *data, int blobsize,
 		strncpy(CCD_IMAGE_ITEM->blob.format, suffix, INDIGO_NAME_SIZE);
 		CCD_IMAGE_PROPERTY->state = INDIGO_OK_STATE;
 		indigo_update_property(device, CCD_IMAGE_PROPERTY, NULL);
-		INDIGO_DEBUG(indigo_debug("Client upload in %gs", (clock() - start) / (double)CLOCKS_PER_SEC));
+		INDIGO_DEBUG(indigo_debug("Client upload in %gs", (indigo_metrics_now() - start) / 1e6));
 	}
 }
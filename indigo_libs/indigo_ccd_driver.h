@@ -113,6 +113,38 @@ extern "C" {
  */
 #define CCD_LOCAL_MODE_PREFIX_ITEM        (CCD_LOCAL_MODE_PROPERTY->items+1)
 
+/** CCD_LOCAL_SEQUENCE property pointer, property is mandatory, property change request is fully handled by indigo_ccd_change_property().
+ */
+#define CCD_LOCAL_SEQUENCE_PROPERTY       (CCD_CONTEXT->ccd_local_sequence_property)
+
+/** CCD_LOCAL_SEQUENCE.NEXT property item pointer.
+ */
+#define CCD_LOCAL_SEQUENCE_NEXT_ITEM      (CCD_LOCAL_SEQUENCE_PROPERTY->items+0)
+
+/** CCD_LOCAL_SYNC property pointer, property is mandatory, property change request is fully handled by indigo_ccd_change_property().
+ */
+#define CCD_LOCAL_SYNC_PROPERTY           (CCD_CONTEXT->ccd_local_sync_property)
+
+/** CCD_LOCAL_SYNC.FRAMES property item pointer.
+ */
+#define CCD_LOCAL_SYNC_FRAMES_ITEM        (CCD_LOCAL_SYNC_PROPERTY->items+0)
+
+/** CCD_LOCAL_QUEUE property pointer, property is mandatory, read-only property, maintained by indigo_ccd_driver.c.
+ */
+#define CCD_LOCAL_QUEUE_PROPERTY          (CCD_CONTEXT->ccd_local_queue_property)
+
+/** CCD_LOCAL_QUEUE.DEPTH property item pointer.
+ */
+#define CCD_LOCAL_QUEUE_DEPTH_ITEM        (CCD_LOCAL_QUEUE_PROPERTY->items+0)
+
+/** CCD_LOCAL_QUEUE.PENDING property item pointer.
+ */
+#define CCD_LOCAL_QUEUE_PENDING_ITEM      (CCD_LOCAL_QUEUE_PROPERTY->items+1)
+
+/** CCD_LOCAL_QUEUE.THROUGHPUT property item pointer.
+ */
+#define CCD_LOCAL_QUEUE_THROUGHPUT_ITEM   (CCD_LOCAL_QUEUE_PROPERTY->items+2)
+
 /** CCD_EXPOSURE property pointer, property is mandatory, property change request handler should set property items and state and call indigo_ccd_change_property().
  */
 #define CCD_EXPOSURE_PROPERTY             (CCD_CONTEXT->ccd_exposure_property)
@@ -355,6 +387,11 @@ typedef struct {
 	indigo_property *ccd_cooler_property;         ///< CCD_COOLER property pointer
 	indigo_property *ccd_cooler_power_property;   ///< CCD_COOLER_POWER property pointer
 	indigo_property *ccd_fits_headers;						///< CCD_FITS_HEADERS property pointer
+	indigo_property *ccd_local_sequence_property; ///< CCD_LOCAL_SEQUENCE property pointer
+	char local_sequence_format[INDIGO_VALUE_SIZE];///< file name format CCD_LOCAL_SEQUENCE is valid for
+	indigo_property *ccd_local_sync_property;     ///< CCD_LOCAL_SYNC property pointer
+	indigo_property *ccd_local_queue_property;    ///< CCD_LOCAL_QUEUE property pointer
+	void *local_storage;                          ///< write-behind queue for locally saved images
 } indigo_ccd_context;
 
 /** Suspend countdown.
@@ -400,6 +437,10 @@ typedef struct {
  */
 extern void indigo_process_image(indigo_device *device, void *data, int frame_width, int frame_height, int bpp, bool little_endian, bool byte_order_rgb, indigo_fits_keyword *keywords);
 
+/** Process planar RGB image in image buffer (red, green and blue planes starting on data + FITS_HEADER_SIZE offset).
+ */
+extern void indigo_process_planar_image(indigo_device *device, void *data, int frame_width, int frame_height, int bpp, bool little_endian, indigo_fits_keyword *keywords);
+
 /** Process DSLR image in image buffer (starting on data).
  */
 extern void indigo_process_dslr_image(indigo_device *device, void *data, int blobsize, const char *suffix);
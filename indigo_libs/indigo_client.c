@@ -35,12 +35,22 @@
 #include <pthread.h>
 #if defined(INDIGO_LINUX) || defined(INDIGO_MACOS)
 #include <unistd.h>
+#include <time.h>
 #include <libgen.h>
 #include <dlfcn.h>
 #include <netdb.h>
 #include <sys/socket.h>
+#include <sys/wait.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
+#include <fcntl.h>
+#include <poll.h>
+#endif
+#if defined(INDIGO_LINUX)
+#include <stdint.h>
+#include <net/if.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
 #endif
 #if defined(INDIGO_WINDOWS)
 #include <io.h>
@@ -50,13 +60,136 @@
 
 #include "indigo_client_xml.h"
 #include "indigo_client.h"
+#include "indigo_io.h"
 
 static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
 
+#define RECONNECT_STABLE_TIME	10
+#define RECONNECT_MIN_DELAY		0.5
+#define RECONNECT_MAX_DELAY		60
+#define CONNECT_TIMEOUT				5
+#define RESYNC_GRACE_TIME			15
+
+static double reconnect_delay(bool stable, int *retries) {
+	// remote which failed after running for a while is reconnected immediately, failing attempts are backed off exponentially with jitter
+	if (stable) {
+		*retries = 0;
+		return 0;
+	}
+	double delay = RECONNECT_MAX_DELAY;
+	if (*retries < 8)
+		delay = RECONNECT_MIN_DELAY * (1 << *retries);
+	if (delay > RECONNECT_MAX_DELAY)
+		delay = RECONNECT_MAX_DELAY;
+	(*retries)++;
+	// seeded per process, so peers which lost the same server don't retry in lockstep
+	static unsigned int seed = 0;
+	if (seed == 0) {
+		struct timespec now;
+		clock_gettime(CLOCK_REALTIME, &now);
+		seed = (unsigned int)(now.tv_sec ^ now.tv_nsec) | 1;
+	}
+	return delay * (0.5 + 0.5 * rand_r(&seed) / RAND_MAX);
+}
+
+// waiting servers and subprocesses are watched by a single scheduler thread, attempt is started on its own thread
+// only when it is due and holds it while connected (XML parser is blocking), so timer pool is never blocked
+
+static pthread_cond_t retry_cond = PTHREAD_COND_INITIALIZER;
+static bool retry_scheduler_started = false;
+
+static int used_server_slots = 0;
+#if defined(INDIGO_LINUX) || defined(INDIGO_MACOS)
+static int used_subprocess_slots = 0;
+static void *subprocess_start(void *data);
+#endif
+static void *server_connect(void *data);
+
+static double monotonic_time(void) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+static bool retry_due(indigo_remote_state *state, double *retry_time, double now, double *next) {
+	if (*state != INDIGO_REMOTE_WAITING)
+		return false;
+	if (*retry_time <= now) {
+		*state = INDIGO_REMOTE_CONNECTING;
+		return true;
+	}
+	if (*next == 0 || *retry_time < *next)
+		*next = *retry_time;
+	return false;
+}
+
+// must be called with mutex locked
+static void start_attempt(void *(*attempt)(void *), void *data, indigo_remote_state *state, double *retry_time) {
+	pthread_t thread;
+	if (pthread_create(&thread, NULL, attempt, data) == 0) {
+		pthread_detach(thread);
+	} else {
+		INDIGO_ERROR(indigo_error("Can't start reconnect thread (%s)", strerror(errno)));
+		*state = INDIGO_REMOTE_WAITING;
+		*retry_time = monotonic_time() + RECONNECT_MAX_DELAY;
+	}
+}
+
+static void *retry_scheduler(void *data) {
+	pthread_mutex_lock(&mutex);
+	while (true) {
+		double now = monotonic_time(), next = 0;
+		for (int i = 0; i < used_server_slots; i++) {
+			indigo_server_entry *server = &indigo_available_servers[i];
+			if (retry_due(&server->state, &server->retry_time, now, &next))
+				start_attempt(server_connect, server, &server->state, &server->retry_time);
+		}
+#if defined(INDIGO_LINUX) || defined(INDIGO_MACOS)
+		for (int i = 0; i < used_subprocess_slots; i++) {
+			indigo_subprocess_entry *subprocess = &indigo_available_subprocesses[i];
+			if (retry_due(&subprocess->state, &subprocess->retry_time, now, &next))
+				start_attempt(subprocess_start, subprocess, &subprocess->state, &subprocess->retry_time);
+		}
+#endif
+		if (next == 0) {
+			pthread_cond_wait(&retry_cond, &mutex);
+		} else {
+			// condition uses realtime clock, deadline is recomputed from monotonic time on each wakeup
+			struct timespec deadline;
+			clock_gettime(CLOCK_REALTIME, &deadline);
+			double delay = next - now;
+			deadline.tv_sec += (time_t)delay;
+			deadline.tv_nsec += (long)((delay - (time_t)delay) * 1e9);
+			if (deadline.tv_nsec >= 1000000000L) {
+				deadline.tv_sec++;
+				deadline.tv_nsec -= 1000000000L;
+			}
+			pthread_cond_timedwait(&retry_cond, &mutex, &deadline);
+		}
+	}
+	pthread_mutex_unlock(&mutex);
+	return NULL;
+}
+
+// must be called with mutex locked
+static void schedule_retry(indigo_remote_state *state, double *retry_time, double delay) {
+	*state = INDIGO_REMOTE_WAITING;
+	*retry_time = monotonic_time() + delay;
+	if (!retry_scheduler_started) {
+		pthread_t thread;
+		if (pthread_create(&thread, NULL, retry_scheduler, NULL) != 0) {
+			INDIGO_ERROR(indigo_error("Can't start reconnect scheduler (%s)", strerror(errno)));
+			return;
+		}
+		pthread_detach(thread);
+		retry_scheduler_started = true;
+	}
+	pthread_cond_signal(&retry_cond);
+}
+
 #if defined(INDIGO_LINUX) || defined(INDIGO_MACOS)
 
 static int used_driver_slots = 0;
-static int used_subprocess_slots = 0;
 
 static indigo_result add_driver(driver_entry_point entry_point, void *dl_handle, bool init, indigo_driver_entry **driver) {
 	int empty_slot = used_driver_slots; /* the first slot after the last used is a good candidate */
@@ -167,58 +300,89 @@ indigo_result indigo_load_driver(const char *name, bool init, indigo_driver_entr
 indigo_driver_entry indigo_available_drivers[INDIGO_MAX_DRIVERS];
 indigo_subprocess_entry indigo_available_subprocesses[INDIGO_MAX_SERVERS];
 
-static void *subprocess_thread(indigo_subprocess_entry *subprocess) {
-	INDIGO_LOG(indigo_log("Subprocess %s thread started", subprocess->executable));
-	int sleep_interval = 5;
-	while (subprocess->pid >= 0) {
-		int input[2], output[2];
-		if (pipe(input) < 0 || pipe(output) < 0) {
-			INDIGO_ERROR(indigo_error("Can't create local pipe for subprocess %s (%s)", subprocess->executable, strerror(errno)));
-			subprocess->last_error = strerror(errno);
-			return NULL;
+static void *subprocess_start(void *data) {
+	indigo_subprocess_entry *subprocess = (indigo_subprocess_entry *)data;
+	bool stable = false;
+	// single socket pair instead of two pipes, so BLOBs can be passed as shared memory descriptors
+	int sockets[2];
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, sockets) < 0) {
+		INDIGO_ERROR(indigo_error("Can't create local socket for subprocess %s (%s)", subprocess->executable, strerror(errno)));
+		subprocess->last_error = strerror(errno);
+	} else {
+		time_t started = time(NULL);
+		pthread_mutex_lock(&mutex);
+		int pid = subprocess->pid < 0 ? -1 : fork();
+		if (pid > 0) {
+			subprocess->pid = pid;
+			subprocess->state = INDIGO_REMOTE_CONNECTED;
 		}
-		subprocess->pid = fork();
-		if (subprocess->pid == -1) {
-			INDIGO_ERROR(indigo_error("Can't create subprocess %s (%s)", subprocess->executable, strerror(errno)));
-			subprocess->last_error = strerror(errno);
-		} else if (subprocess->pid == 0) {
-			close(0);
-			dup2(output[0], 0);
-			close(1);
-			dup2(input[1], 1);
-			execlp(subprocess->executable, subprocess->executable, NULL);
+		pthread_mutex_unlock(&mutex);
+		if (pid == -1) {
+			if (subprocess->pid >= 0) {
+				INDIGO_ERROR(indigo_error("Can't create subprocess %s (%s)", subprocess->executable, strerror(errno)));
+				subprocess->last_error = strerror(errno);
+			}
+			close(sockets[0]);
+			close(sockets[1]);
+		} else if (pid == 0) {
+			close(sockets[0]);
+			dup2(sockets[1], 0);
+			dup2(sockets[1], 1);
+			close(sockets[1]);
+			if (*subprocess->argument)
+				execlp(subprocess->executable, subprocess->executable, subprocess->argument, NULL);
+			else
+				execlp(subprocess->executable, subprocess->executable, NULL);
 			INDIGO_ERROR(indigo_error("Can't execute driver %s (%s)", subprocess->executable, strerror(errno)));
 			exit(0);
 		} else {
-			close(input[1]);
-			close(output[0]);
-			char *slash = strrchr(subprocess->executable, '/');
-			subprocess->protocol_adapter = indigo_xml_client_adapter(slash ? slash + 1 : subprocess->executable, "", input[0], output[1]);
+			close(sockets[1]);
+			INDIGO_LOG(indigo_log("Subprocess %s %s started", subprocess->executable, subprocess->argument));
+			// hosted driver is named by its library name without path and extension
+			const char *path = *subprocess->argument ? subprocess->argument : subprocess->executable;
+			const char *slash = strrchr(path, '/');
+			char name[INDIGO_NAME_SIZE];
+			strncpy(name, slash ? slash + 1 : path, INDIGO_NAME_SIZE);
+			char *dot = strchr(name, '.');
+			if (*subprocess->argument && dot)
+				*dot = 0;
+			subprocess->protocol_adapter = indigo_xml_client_adapter(name, "", sockets[0], dup(sockets[0]));
 			indigo_attach_device(subprocess->protocol_adapter);
 			indigo_xml_parse(subprocess->protocol_adapter, NULL);
 			indigo_detach_device(subprocess->protocol_adapter);
 			free(subprocess->protocol_adapter->device_context);
 			free(subprocess->protocol_adapter);
+			subprocess->protocol_adapter = NULL;
+			int status;
+			kill(pid, SIGKILL);
+			waitpid(pid, &status, 0);
+			if (WIFSIGNALED(status) && WTERMSIG(status) != SIGKILL)
+				INDIGO_ERROR(indigo_error("Subprocess %s %s terminated by signal %d", subprocess->executable, subprocess->argument, WTERMSIG(status)));
+			stable = time(NULL) - started >= RECONNECT_STABLE_TIME;
 		}
-		if (subprocess->pid >= 0) {
-			sleep(sleep_interval);
-			if (sleep_interval < 60)
-				sleep_interval *= 2;
-		} else {
-			sleep_interval = 5;
-		}
 	}
-	subprocess->thread_started = false;
-	INDIGO_LOG(indigo_log("Subprocess %s thread stopped", subprocess->executable));
+	pthread_mutex_lock(&mutex);
+	if (subprocess->pid < 0) {
+		subprocess->state = INDIGO_REMOTE_IDLE;
+		subprocess->thread_started = false;
+		INDIGO_LOG(indigo_log("Subprocess %s %s stopped", subprocess->executable, subprocess->argument));
+	} else {
+		subprocess->pid = 0;
+		double delay = reconnect_delay(stable, &subprocess->retries);
+		if (delay > 0)
+			INDIGO_LOG(indigo_log("Subprocess %s %s restarted in %.1fs", subprocess->executable, subprocess->argument, delay));
+		schedule_retry(&subprocess->state, &subprocess->retry_time, delay);
+	}
+	pthread_mutex_unlock(&mutex);
 	return NULL;
 }
 
-indigo_result indigo_start_subprocess(const char *executable, indigo_subprocess_entry **subprocess) {
+static indigo_result start_subprocess(const char *executable, const char *argument, indigo_subprocess_entry **subprocess) {
 	int empty_slot = used_subprocess_slots;
 	pthread_mutex_lock(&mutex);
 	for (int dc = 0; dc < used_subprocess_slots;  dc++) {
-		if (indigo_available_subprocesses[dc].thread_started && !strcmp(indigo_available_subprocesses[dc].executable, executable)) {
-			INDIGO_LOG(indigo_log("Subprocess %s already started", indigo_available_subprocesses[dc].executable));
+		if (indigo_available_subprocesses[dc].thread_started && !strcmp(indigo_available_subprocesses[dc].executable, executable) && !strcmp(indigo_available_subprocesses[dc].argument, argument)) {
+			INDIGO_LOG(indigo_log("Subprocess %s %s already started", indigo_available_subprocesses[dc].executable, indigo_available_subprocesses[dc].argument));
 			if (subprocess != NULL)
 				*subprocess = &indigo_available_subprocesses[dc];
 			pthread_mutex_unlock(&mutex);
@@ -235,36 +399,56 @@ indigo_result indigo_start_subprocess(const char *executable, indigo_subprocess_
 	}
 
 	strncpy(indigo_available_subprocesses[empty_slot].executable, executable, INDIGO_NAME_SIZE);
+	strncpy(indigo_available_subprocesses[empty_slot].argument, argument, INDIGO_NAME_SIZE);
 	indigo_available_subprocesses[empty_slot].pid = 0;
+	indigo_available_subprocesses[empty_slot].retries = 0;
 	indigo_available_subprocesses[empty_slot].last_error = NULL;
-	if (pthread_create(&indigo_available_subprocesses[empty_slot].thread, NULL, (void*)(void *)subprocess_thread, &indigo_available_subprocesses[empty_slot]) != 0) {
-		indigo_available_subprocesses[empty_slot].thread_started = false;
-		pthread_mutex_unlock(&mutex);
-		return INDIGO_FAILED;
-	}
 	indigo_available_subprocesses[empty_slot].thread_started = true;
 	if (empty_slot == used_subprocess_slots)
 		used_subprocess_slots++;
+	schedule_retry(&indigo_available_subprocesses[empty_slot].state, &indigo_available_subprocesses[empty_slot].retry_time, 0);
 	pthread_mutex_unlock(&mutex);
 	if (subprocess != NULL)
 		*subprocess = &indigo_available_subprocesses[empty_slot];
 	return INDIGO_OK;
 }
 
+indigo_result indigo_start_subprocess(const char *executable, indigo_subprocess_entry **subprocess) {
+	return start_subprocess(executable, "", subprocess);
+}
+
+indigo_result indigo_host_driver(const char *name, indigo_subprocess_entry **subprocess) {
+	char executable[INDIGO_NAME_SIZE] = INDIGO_DRIVER_HOST;
+	// prefer driver host installed next to the running executable
+	if (indigo_main_argc > 0 && strchr(indigo_main_argv[0], '/')) {
+		char path[INDIGO_NAME_SIZE];
+		strncpy(path, indigo_main_argv[0], INDIGO_NAME_SIZE - 1);
+		path[INDIGO_NAME_SIZE - 1] = 0;
+		char candidate[INDIGO_NAME_SIZE];
+		snprintf(candidate, INDIGO_NAME_SIZE, "%s/%s", dirname(path), INDIGO_DRIVER_HOST);
+		if (access(candidate, X_OK) == 0)
+			strncpy(executable, candidate, INDIGO_NAME_SIZE);
+	}
+	return start_subprocess(executable, name, subprocess);
+}
+
 indigo_result indigo_kill_subprocess(indigo_subprocess_entry *subprocess) {
 	assert(subprocess != NULL);
 	pthread_mutex_lock(&mutex);
 	if (subprocess->pid > 0)
 		kill(subprocess->pid, SIGKILL);
 	subprocess->pid = -1;
-	subprocess->thread_started = false;
+	// running subprocess is released by its own attempt thread once the process is gone
+	if (subprocess->state == INDIGO_REMOTE_WAITING) {
+		subprocess->state = INDIGO_REMOTE_IDLE;
+		subprocess->thread_started = false;
+	}
 	pthread_mutex_unlock(&mutex);
 	return INDIGO_OK;
 }
 
 #endif
 
-static int used_server_slots = 0;
 indigo_server_entry indigo_available_servers[INDIGO_MAX_SERVERS];
 
 void indigo_service_name(const char *host, int port, char *name) {
@@ -280,106 +464,266 @@ void indigo_service_name(const char *host, int port, char *name) {
   }
 }
 
-static void *server_thread(indigo_server_entry *server) {
-  INDIGO_LOG(indigo_log("Server %s:%d thread started", server->host, server->port));
-  while (server->socket >= 0) {
-    server->socket = 0;
-		struct addrinfo hints = { 0 }, *address = NULL;
-		int result;
-		hints.ai_family = AF_INET;
-    if ((result = getaddrinfo(server->host, NULL, &hints, &address))) {
-      INDIGO_LOG(indigo_error("Can't resolve host name %s (%s)", server->host, gai_strerror(result)));
-			server->last_error = gai_strerror(result);
-    } else if ((server->socket = socket(address->ai_family, SOCK_STREAM, 0)) < 0) {
-      INDIGO_LOG(indigo_error("Can't create socket (%s)", strerror(errno)));
-			server->last_error = strerror(errno);
-    } else {
-     	((struct sockaddr_in *)address->ai_addr)->sin_port = htons(server->port);
-      if (connect(server->socket, address->ai_addr, address->ai_addrlen) < 0) {
-				INDIGO_LOG(indigo_error("Can't connect to socket (%s)", strerror(errno)));
-				server->last_error = strerror(errno);
-        close(server->socket);
-        server->socket = 0;
-      }
-    }
-		if (address)
-			freeaddrinfo(address);
-    if (server->socket > 0) {
-      if (*server->name == 0) {
-        indigo_service_name(server->host, server->port, server->name);
-      }
-      char  url[INDIGO_NAME_SIZE];
-      snprintf(url, sizeof(url), "http://%s:%d", server->host, server->port);
-      INDIGO_LOG(indigo_log("Server %s:%d (%s, %s) connected", server->host, server->port, server->name, url));
-      server->protocol_adapter = indigo_xml_client_adapter(server->name, url, server->socket, server->socket);
-      indigo_attach_device(server->protocol_adapter);
-      indigo_xml_parse(server->protocol_adapter, NULL);
-      indigo_detach_device(server->protocol_adapter);
-      free(server->protocol_adapter->device_context);
-      free(server->protocol_adapter);
-			server->protocol_adapter = NULL;
-      close(server->socket);
-			server->socket = 0;
-      INDIGO_LOG(indigo_log("Server %s:%d disconnected", server->host, server->port));
-    }
+static int connect_with_timeout(struct addrinfo *address, int port) {
+	int handle = socket(address->ai_family, SOCK_STREAM, 0);
+	if (handle < 0)
+		return -1;
+	((struct sockaddr_in *)address->ai_addr)->sin_port = htons(port);
 #if defined(INDIGO_LINUX) || defined(INDIGO_MACOS)
-    sleep(5); 
-#endif
-#if defined(INDIGO_WINDOWS)
-    Sleep(5);
+	// non-blocking connect, unreachable host shouldn't hold attempt thread for the whole TCP timeout
+	int flags = fcntl(handle, F_GETFL, 0);
+	fcntl(handle, F_SETFL, flags | O_NONBLOCK);
+	int result = connect(handle, address->ai_addr, address->ai_addrlen);
+	if (result < 0 && errno == EINPROGRESS) {
+		struct pollfd descriptor = { handle, POLLOUT, 0 };
+		result = poll(&descriptor, 1, CONNECT_TIMEOUT * 1000);
+		if (result == 0) {
+			errno = ETIMEDOUT;
+			result = -1;
+		} else if (result > 0) {
+			int error = 0;
+			socklen_t length = sizeof(error);
+			getsockopt(handle, SOL_SOCKET, SO_ERROR, &error, &length);
+			if (error) {
+				errno = error;
+				result = -1;
+			} else {
+				result = 0;
+			}
+		}
+	}
+	if (result == 0)
+		fcntl(handle, F_SETFL, flags);
+#else
+	int result = connect(handle, address->ai_addr, address->ai_addrlen);
 #endif
-  }
-  server->thread_started = false;
-  INDIGO_LOG(indigo_log("Server %s:%d thread stopped", server->host, server->port));
-  return NULL;
+	if (result < 0) {
+		int error = errno;
+		close(handle);
+		errno = error;
+		return -1;
+	}
+	return handle;
+}
+
+static void *server_connect(void *data) {
+	indigo_server_entry *server = (indigo_server_entry *)data;
+	struct timespec start, end;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	struct addrinfo hints = { 0 }, *address = NULL;
+	int handle = -1, result;
+	hints.ai_family = AF_INET;
+	pthread_mutex_lock(&mutex);
+	bool disconnected = server->socket < 0;
+	pthread_mutex_unlock(&mutex);
+	if (disconnected) {
+		// disconnected after the attempt was scheduled
+	} else if (*server->host == '/') {
+		// server on the same host, connect to its local socket
+		if ((handle = indigo_open_local(server->host)) < 0) {
+			INDIGO_LOG(indigo_error("Can't connect to local socket %s (%s)", server->host, strerror(errno)));
+			server->last_error = strerror(errno);
+		}
+	} else if ((result = getaddrinfo(server->host, NULL, &hints, &address))) {
+		INDIGO_LOG(indigo_error("Can't resolve host name %s (%s)", server->host, gai_strerror(result)));
+		server->last_error = gai_strerror(result);
+	} else if ((handle = connect_with_timeout(address, server->port)) < 0) {
+		INDIGO_LOG(indigo_error("Can't connect to %s:%d (%s)", server->host, server->port, strerror(errno)));
+		server->last_error = strerror(errno);
+	}
+	if (address)
+		freeaddrinfo(address);
+	bool stable = false;
+	if (handle >= 0) {
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		pthread_mutex_lock(&mutex);
+		disconnected = server->socket < 0;
+		if (!disconnected) {
+			server->socket = handle;
+			server->state = INDIGO_REMOTE_CONNECTED;
+			server->latency = (end.tv_sec - start.tv_sec) * 1e3 + (end.tv_nsec - start.tv_nsec) / 1e6;
+			server->last_error = NULL;
+		}
+		pthread_mutex_unlock(&mutex);
+		if (disconnected) {
+			close(handle);
+		} else {
+			time_t started = time(NULL);
+			char url[INDIGO_NAME_SIZE];
+			if (*server->host == '/') {
+				if (*server->name == 0) {
+					char path[INDIGO_NAME_SIZE];
+					strncpy(path, server->host, INDIGO_NAME_SIZE);
+					strncpy(server->name, basename(path), INDIGO_NAME_SIZE);
+				}
+				snprintf(url, sizeof(url), "http://localhost:%d", server->port);
+			} else {
+				if (*server->name == 0) {
+					indigo_service_name(server->host, server->port, server->name);
+				}
+				snprintf(url, sizeof(url), "http://%s:%d", server->host, server->port);
+			}
+			INDIGO_LOG(indigo_log("Server %s:%d (%s, %s) connected in %.1fms", server->host, server->port, server->name, url, server->latency));
+			// the parser blocks for the lifetime of the connection, the attempt thread ends with it
+			server->protocol_adapter = indigo_xml_client_adapter(server->name, url, handle, handle);
+			((indigo_adapter_context *)server->protocol_adapter->device_context)->cache = &server->cache;
+			indigo_xml_detach_cache(&server->cache);
+			indigo_attach_device(server->protocol_adapter);
+			indigo_xml_parse(server->protocol_adapter, NULL);
+			indigo_detach_device(server->protocol_adapter);
+			// until reconnect, clients which attach or enumerate meanwhile get the cached properties
+			indigo_xml_attach_cache(&server->cache, server->protocol_adapter);
+			free(server->protocol_adapter->device_context);
+			free(server->protocol_adapter);
+			server->protocol_adapter = NULL;
+			stable = time(NULL) - started >= RECONNECT_STABLE_TIME;
+			INDIGO_LOG(indigo_log("Server %s:%d disconnected", server->host, server->port));
+		}
+	}
+	// remote properties are kept for a while, so short outage doesn't force clients to reload everything
+	if (server->socket < 0 || (handle < 0 && server->cache.count > 0 && time(NULL) - server->cache.disconnected >= RESYNC_GRACE_TIME))
+		indigo_xml_release_cache(&server->cache);
+	pthread_mutex_lock(&mutex);
+	if (server->socket < 0) {
+		server->state = INDIGO_REMOTE_IDLE;
+		server->thread_started = false;
+		INDIGO_LOG(indigo_log("Server %s:%d stopped", server->host, server->port));
+	} else {
+		server->socket = 0;
+		double delay = reconnect_delay(stable, &server->retries);
+		if (server->cache.count > 0) {
+			// make sure there is an attempt when grace time for cached properties expires
+			double remaining = RESYNC_GRACE_TIME - (time(NULL) - server->cache.disconnected);
+			if (remaining > 0 && delay > remaining)
+				delay = remaining;
+		}
+		if (delay > 0)
+			INDIGO_LOG(indigo_log("Server %s:%d reconnecting in %.1fs", server->host, server->port, delay));
+		schedule_retry(&server->state, &server->retry_time, delay);
+	}
+	pthread_mutex_unlock(&mutex);
+	return NULL;
+}
+
+#if defined(INDIGO_LINUX)
+
+static void *link_monitor_thread(void *data) {
+	int handle = (int)(intptr_t)data;
+	char buffer[4096];
+	while (true) {
+		int length = (int)recv(handle, buffer, sizeof(buffer), 0);
+		if (length < 0) {
+			if (errno == EINTR || errno == ENOBUFS)
+				continue;
+			break;
+		}
+		bool link_up = false;
+		for (struct nlmsghdr *message = (struct nlmsghdr *)buffer; NLMSG_OK(message, length); message = NLMSG_NEXT(message, length)) {
+			if (message->nlmsg_type == RTM_NEWADDR)
+				link_up = true;
+			else if (message->nlmsg_type == RTM_NEWLINK && (((struct ifinfomsg *)NLMSG_DATA(message))->ifi_flags & IFF_RUNNING))
+				link_up = true;
+		}
+		if (link_up)
+			indigo_reconnect_servers();
+	}
+	close(handle);
+	return NULL;
+}
+
+static void start_link_monitor() {
+	static bool started = false;
+	if (started)
+		return;
+	started = true;
+	int handle = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+	if (handle < 0) {
+		INDIGO_ERROR(indigo_error("Can't create netlink socket (%s)", strerror(errno)));
+		return;
+	}
+	struct sockaddr_nl address = { 0 };
+	address.nl_family = AF_NETLINK;
+	address.nl_groups = RTMGRP_LINK | RTMGRP_IPV4_IFADDR | RTMGRP_IPV6_IFADDR;
+	pthread_t thread;
+	if (bind(handle, (struct sockaddr *)&address, sizeof(address)) < 0 || pthread_create(&thread, NULL, link_monitor_thread, (void *)(intptr_t)handle) != 0) {
+		INDIGO_ERROR(indigo_error("Can't start network link monitor (%s)", strerror(errno)));
+		close(handle);
+		return;
+	}
+	pthread_detach(thread);
 }
 
+#endif
+
 indigo_result indigo_connect_server(const char *name, const char *host, int port, indigo_server_entry **server) {
-  int empty_slot = used_server_slots;
-  pthread_mutex_lock(&mutex);
-  for (int dc = 0; dc < used_server_slots; dc++) {
-    if (indigo_available_servers[dc].socket > 0 && !strcmp(indigo_available_servers[dc].host, host) && indigo_available_servers[dc].port == port) {
-      INDIGO_LOG(indigo_log("Server %s:%d already connected", indigo_available_servers[dc].host, indigo_available_servers[dc].port));
-      if (server != NULL)
-        *server = &indigo_available_servers[dc];
-      pthread_mutex_unlock(&mutex);
-      return INDIGO_DUPLICATED;
-    } else if (!indigo_available_servers[dc].thread_started) {
-      empty_slot = dc;
-    }
-  }
-  if (empty_slot > INDIGO_MAX_SERVERS) {
-    pthread_mutex_unlock(&mutex);
-    return INDIGO_TOO_MANY_ELEMENTS;
-  }
-  if (name != NULL) {
-    strncpy(indigo_available_servers[empty_slot].name, name, INDIGO_NAME_SIZE);
-  } else {
-    *indigo_available_servers[empty_slot].name = 0;
-  }
-  strncpy(indigo_available_servers[empty_slot].host, host, INDIGO_NAME_SIZE);
-  indigo_available_servers[empty_slot].port = port;
-  indigo_available_servers[empty_slot].socket = 0;
+	int empty_slot = used_server_slots;
+	pthread_mutex_lock(&mutex);
+	for (int dc = 0; dc < used_server_slots; dc++) {
+		if (indigo_available_servers[dc].thread_started && !strcmp(indigo_available_servers[dc].host, host) && indigo_available_servers[dc].port == port) {
+			INDIGO_LOG(indigo_log("Server %s:%d already connected", indigo_available_servers[dc].host, indigo_available_servers[dc].port));
+			if (server != NULL)
+				*server = &indigo_available_servers[dc];
+			pthread_mutex_unlock(&mutex);
+			return INDIGO_DUPLICATED;
+		} else if (!indigo_available_servers[dc].thread_started) {
+			empty_slot = dc;
+		}
+	}
+	if (empty_slot > INDIGO_MAX_SERVERS) {
+		pthread_mutex_unlock(&mutex);
+		return INDIGO_TOO_MANY_ELEMENTS;
+	}
+#if defined(INDIGO_LINUX)
+	start_link_monitor();
+#endif
+	if (name != NULL) {
+		strncpy(indigo_available_servers[empty_slot].name, name, INDIGO_NAME_SIZE);
+	} else {
+		*indigo_available_servers[empty_slot].name = 0;
+	}
+	strncpy(indigo_available_servers[empty_slot].host, host, INDIGO_NAME_SIZE);
+	indigo_available_servers[empty_slot].port = port;
+	indigo_available_servers[empty_slot].socket = 0;
+	indigo_available_servers[empty_slot].retries = 0;
+	indigo_available_servers[empty_slot].latency = 0;
 	indigo_available_servers[empty_slot].last_error = NULL;
-  if (pthread_create(&indigo_available_servers[empty_slot].thread, NULL, (void*) (void *) server_thread, &indigo_available_servers[empty_slot]) != 0) {
-    pthread_mutex_unlock(&mutex);
-    return INDIGO_FAILED;
-  }
-  indigo_available_servers[empty_slot].thread_started = true;
-  if (empty_slot == used_server_slots)
-    used_server_slots++;
-  pthread_mutex_unlock(&mutex);
-  if (server != NULL)
-    *server = &indigo_available_servers[empty_slot];
-  return INDIGO_OK;
+	indigo_available_servers[empty_slot].thread_started = true;
+	if (empty_slot == used_server_slots)
+		used_server_slots++;
+	schedule_retry(&indigo_available_servers[empty_slot].state, &indigo_available_servers[empty_slot].retry_time, 0);
+	pthread_mutex_unlock(&mutex);
+	if (server != NULL)
+		*server = &indigo_available_servers[empty_slot];
+	return INDIGO_OK;
 }
 
 indigo_result indigo_disconnect_server(indigo_server_entry *server) {
-  assert(server != NULL);
-  pthread_mutex_lock(&mutex);
-  if (server->socket > 0)
-    close(server->socket);
-  server->socket = -1;
-  pthread_mutex_unlock(&mutex);
-  return INDIGO_OK;
+	assert(server != NULL);
+	pthread_mutex_lock(&mutex);
+	// connected socket is closed by the parser, shutdown just wakes it up
+	if (server->state == INDIGO_REMOTE_CONNECTED && server->socket > 0)
+		shutdown(server->socket, SHUT_RDWR);
+	server->socket = -1;
+	if (server->state == INDIGO_REMOTE_WAITING) {
+		server->state = INDIGO_REMOTE_IDLE;
+		pthread_mutex_unlock(&mutex);
+		indigo_xml_release_cache(&server->cache);
+		pthread_mutex_lock(&mutex);
+		server->thread_started = false;
+	}
+	pthread_mutex_unlock(&mutex);
+	return INDIGO_OK;
+}
+
+void indigo_reconnect_servers(void) {
+	pthread_mutex_lock(&mutex);
+	for (int dc = 0; dc < used_server_slots; dc++) {
+		indigo_server_entry *server = &indigo_available_servers[dc];
+		if (server->state == INDIGO_REMOTE_WAITING) {
+			INDIGO_LOG(indigo_log("Server %s:%d reconnecting now", server->host, server->port));
+			server->retries = 0;
+			schedule_retry(&server->state, &server->retry_time, 0);
+		}
+	}
+	pthread_mutex_unlock(&mutex);
 }
@@ -30,6 +30,7 @@
 #include <stdbool.h>
 
 #include "indigo_bus.h"
+#include "indigo_xml.h"
 
 #if defined(INDIGO_LINUX) || defined(INDIGO_MACOS)
 #include "indigo_driver.h"
@@ -41,6 +42,17 @@ extern "C" {
 
 #define INDIGO_MAX_SERVERS    10
 
+/** Remote server or subprocess connection state.
+ */
+typedef enum {
+	INDIGO_REMOTE_IDLE = 0,                 ///< not started or stopped
+	INDIGO_REMOTE_CONNECTING,               ///< connection attempt (or process start) in progress
+	INDIGO_REMOTE_CONNECTED,                ///< connected
+	INDIGO_REMOTE_WAITING                   ///< waiting for reconnect
+} indigo_remote_state;
+
+struct indigo_timer;
+
 #if defined(INDIGO_LINUX) || defined(INDIGO_MACOS)
 #define INDIGO_MAX_DRIVERS    100
 
@@ -58,8 +70,11 @@ typedef struct {
  */
 typedef struct {
   char executable[INDIGO_NAME_SIZE];      ///< executable path name
-  pthread_t thread;                       ///< client thread ID
-  bool thread_started;                    ///< client thread started/stopped
+  char argument[INDIGO_NAME_SIZE];        ///< executable argument (driver name for driver host, empty otherwise)
+  bool thread_started;                    ///< subprocess started/stopped
+  indigo_remote_state state;              ///< connection state
+  int retries;                            ///< failed restarts since the last stable run
+  double retry_time;                      ///< monotonic time of the next restart (if waiting)
   int pid;																///< process pid
   indigo_device *protocol_adapter;        ///< server protocol adapter
 	const char *last_error;									///< last error reported within client thread
@@ -85,11 +100,19 @@ extern indigo_result indigo_remove_driver(indigo_driver_entry *driver);
  */
 extern indigo_result indigo_load_driver(const char *name, bool init, indigo_driver_entry **driver);
 
-/** Start thread for subprocess.
+/** Start subprocess.
  */
 extern indigo_result indigo_start_subprocess(const char *executable, indigo_subprocess_entry **subprocess);
 
-/** Stop thread for subprocess.
+/** Driver host executable name.
+ */
+#define INDIGO_DRIVER_HOST "indigo_driver_host"
+
+/** Start dynamically linked driver hosted in its own process (see indigo_driver_host).
+ */
+extern indigo_result indigo_host_driver(const char *name, indigo_subprocess_entry **subprocess);
+
+/** Stop subprocess.
  */
 extern indigo_result indigo_kill_subprocess(indigo_subprocess_entry *subprocess);
 
@@ -101,10 +124,14 @@ typedef struct {
 	char name[INDIGO_NAME_SIZE];            ///< service name
 	char host[INDIGO_NAME_SIZE];            ///< server host name
 	int port;                               ///< server port
-	pthread_t thread;                       ///< client thread ID
-	bool thread_started;                    ///< client thread started/stopped
+	bool thread_started;                    ///< server connection started/stopped
+	indigo_remote_state state;              ///< connection state
+	int retries;                            ///< failed attempts since the last stable connection
+	double latency;                         ///< duration of the last successful connect (ms)
+	double retry_time;                      ///< monotonic time of the next attempt (if waiting)
 	int socket;                             ///< stream socket
 	indigo_device *protocol_adapter;        ///< server protocol adapter
+	indigo_xml_cache cache;                 ///< remote properties kept across short disconnects
 	const char *last_error;									///< last error reported within client thread
 } indigo_server_entry;
 
@@ -117,14 +144,18 @@ extern indigo_server_entry indigo_available_servers[INDIGO_MAX_SERVERS];
  */
 void indigo_service_name(const char *host, int port, char *name);
 
-/** Connect and start thread for remote server.
+/** Connect to remote server (and keep reconnecting until disconnected).
  */
 extern indigo_result indigo_connect_server(const char *name, const char *host, int port, indigo_server_entry **server);
 
-/** Disconnect and stop thread for remote server.
+/** Disconnect from remote server.
  */
 extern indigo_result indigo_disconnect_server(indigo_server_entry *server);
 
+/** Retry all servers and subprocesses waiting for reconnect immediately (e.g. on network link up).
+ */
+extern void indigo_reconnect_servers(void);
+
 #ifdef __cplusplus
 }
 #endif
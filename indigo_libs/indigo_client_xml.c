@@ -57,6 +57,8 @@ static indigo_result xml_client_parser_enumerate_properties(indigo_device *devic
 	indigo_adapter_context *device_context = (indigo_adapter_context *)device->device_context;
 	assert(device_context != NULL);
 	int handle = device_context->output;
+	// local server passes inline BLOBs as shared memory descriptors if asked to
+	const char *shm = device_context->shared_memory ? " shm='1'" : "";
 	char device_name[INDIGO_NAME_SIZE];
 	if (property != NULL && *property->device) {
 		strncpy(device_name, property->device, INDIGO_NAME_SIZE);
@@ -71,16 +73,16 @@ static indigo_result xml_client_parser_enumerate_properties(indigo_device *devic
 	}
 	if (property != NULL) {
 		if (*property->device && *indigo_property_name(device->version, property)) {
-			indigo_printf(handle, "<getProperties version='1.7' switch='%d.%d' device='%s' name='%s'/>\n", (INDIGO_VERSION_CURRENT >> 8) & 0xFF, INDIGO_VERSION_CURRENT & 0xFF, indigo_xml_escape(device_name), indigo_property_name(device->version, property));
+			indigo_printf(handle, "<getProperties version='1.7' switch='%d.%d' device='%s' name='%s'%s/>\n", (INDIGO_VERSION_CURRENT >> 8) & 0xFF, INDIGO_VERSION_CURRENT & 0xFF, indigo_xml_escape(device_name), indigo_property_name(device->version, property), shm);
 		} else if (*property->device) {
-			indigo_printf(handle, "<getProperties version='1.7' switch='%d.%d' device='%s'/>\n", (INDIGO_VERSION_CURRENT >> 8) & 0xFF, INDIGO_VERSION_CURRENT & 0xFF, indigo_xml_escape(device_name));
+			indigo_printf(handle, "<getProperties version='1.7' switch='%d.%d' device='%s'%s/>\n", (INDIGO_VERSION_CURRENT >> 8) & 0xFF, INDIGO_VERSION_CURRENT & 0xFF, indigo_xml_escape(device_name), shm);
 		} else if (*indigo_property_name(device->version, property)) {
-			indigo_printf(handle, "<getProperties version='1.7' switch='%d.%d' name='%s'/>\n", (INDIGO_VERSION_CURRENT >> 8) & 0xFF, INDIGO_VERSION_CURRENT & 0xFF, indigo_property_name(device->version, property));
+			indigo_printf(handle, "<getProperties version='1.7' switch='%d.%d' name='%s'%s/>\n", (INDIGO_VERSION_CURRENT >> 8) & 0xFF, INDIGO_VERSION_CURRENT & 0xFF, indigo_property_name(device->version, property), shm);
 		} else {
-			indigo_printf(handle, "<getProperties version='1.7' switch='%d.%d'/>\n", (INDIGO_VERSION_CURRENT >> 8) & 0xFF, INDIGO_VERSION_CURRENT & 0xFF);
+			indigo_printf(handle, "<getProperties version='1.7' switch='%d.%d'%s/>\n", (INDIGO_VERSION_CURRENT >> 8) & 0xFF, INDIGO_VERSION_CURRENT & 0xFF, shm);
 		}
 	} else {
-		indigo_printf(handle, "<getProperties version='1.7' switch='%d.%d'/>\n", (INDIGO_VERSION_CURRENT >> 8) & 0xFF, INDIGO_VERSION_CURRENT & 0xFF);
+		indigo_printf(handle, "<getProperties version='1.7' switch='%d.%d'%s/>\n", (INDIGO_VERSION_CURRENT >> 8) & 0xFF, INDIGO_VERSION_CURRENT & 0xFF, shm);
 	}
 	pthread_mutex_unlock(&xml_mutex);
 	return INDIGO_OK;
@@ -146,6 +148,21 @@ static indigo_result xml_client_parser_enable_blob(indigo_device *device, indigo
 	indigo_adapter_context *device_context = (indigo_adapter_context *)device->device_context;
 	assert(device_context != NULL);
 	int handle = device_context->output;
+	if (device_context->cache != NULL) {
+		// remember the request, so it can be replayed after reconnect
+		indigo_enable_blob_mode_record *record = device_context->cache->enable_blob_mode_records;
+		while (record != NULL && (strncmp(record->device, property->device, INDIGO_NAME_SIZE) || strncmp(record->name, property->name, INDIGO_NAME_SIZE)))
+			record = record->next;
+		if (record == NULL) {
+			record = malloc(sizeof(indigo_enable_blob_mode_record));
+			assert(record != NULL);
+			strncpy(record->device, property->device, INDIGO_NAME_SIZE);
+			strncpy(record->name, property->name, INDIGO_NAME_SIZE);
+			record->next = device_context->cache->enable_blob_mode_records;
+			device_context->cache->enable_blob_mode_records = record;
+		}
+		record->mode = mode;
+	}
 	char device_name[INDIGO_NAME_SIZE];
 	strncpy(device_name, property->device, INDIGO_NAME_SIZE);
 	if (indigo_use_host_suffix) {
@@ -172,8 +189,9 @@ static indigo_result xml_client_parser_enable_blob(indigo_device *device, indigo
 static indigo_result xml_client_parser_detach(indigo_device *device) {
 	assert(device != NULL);
 	indigo_adapter_context *device_context = (indigo_adapter_context *)device->device_context;
-	close(device_context->input);
-	close(device_context->output);
+	// input is closed by indigo_xml_parse()
+	if (device_context->output != device_context->input)
+		close(device_context->output);
 	return INDIGO_OK;
 }
 
@@ -195,6 +213,8 @@ indigo_device *indigo_xml_client_adapter(char *name, char *url_prefix, int input
 	device_context->input = input;
 	device_context->output = output;
 	strncpy(device_context->url_prefix, url_prefix, INDIGO_NAME_SIZE);
+	device_context->shared_memory = indigo_is_local_socket(input);
+	device_context->cache = NULL;
 	device->device_context = device_context;
 	return device;
 }
@@ -34,8 +34,12 @@
 #include <fcntl.h>
 #include <limits.h>
 #include <poll.h>
+#include <stdarg.h>
+#include <stdint.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/time.h>
 
 #if defined(INDIGO_MACOS)
 #include <libusb-1.0/libusb.h>
@@ -323,8 +327,10 @@ indigo_result indigo_device_change_property(indigo_device *device, indigo_client
 			indigo_save_property(device, NULL, SIMULATION_PROPERTY);
 			indigo_save_property(device, NULL, DEVICE_PORT_PROPERTY);
 			if (DEVICE_CONTEXT->property_save_file_handle) {
-				CONFIG_PROPERTY->state = INDIGO_OK_STATE;
-				close(DEVICE_CONTEXT->property_save_file_handle);
+				if (indigo_close_config_file(DEVICE_CONTEXT->property_save_file_handle) == INDIGO_OK)
+					CONFIG_PROPERTY->state = INDIGO_OK_STATE;
+				else
+					CONFIG_PROPERTY->state = INDIGO_ALERT_STATE;
 				DEVICE_CONTEXT->property_save_file_handle = 0;
 			} else {
 				CONFIG_PROPERTY->state = INDIGO_ALERT_STATE;
@@ -447,6 +453,356 @@ int indigo_open_config_file(char *device_name, int profile, int mode, const char
 	return -1;
 }
 
+// Config is written to temporary file as properties are saved and committed atomically on indigo_close_config_file()
+// by renaming it. Beside XML file (kept for export and hand editing) compact binary cache is collected in memory,
+// written the same way and used by indigo_load_properties() as long as it matches XML file.
+
+#define CONFIG_CACHE_MAGIC		"INDIGOCC"
+#define CONFIG_CACHE_VERSION	2
+
+typedef struct {
+	char *data;
+	size_t size;
+	size_t capacity;
+} config_buffer;
+
+typedef struct config_snapshot {
+	int handle;
+	int profile;
+	char device_name[INDIGO_NAME_SIZE];
+	dev_t dev;
+	ino_t ino;
+	config_buffer xml;
+	config_buffer cache;
+	bool failed;
+	bool cache_failed;
+	uint32_t count;
+	struct config_snapshot *next;
+} config_snapshot;
+
+typedef struct {
+	char magic[8];
+	uint32_t version;
+	uint32_t count;
+	uint64_t config_size;
+	int64_t config_mtime;
+	int64_t config_mtime_nsec;
+	uint64_t config_ino;
+} config_cache_header;
+
+static config_snapshot *config_snapshots = NULL;
+static pthread_mutex_t config_snapshots_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static int64_t config_mtime_nsec(struct stat *file_stat) {
+#if defined(INDIGO_MACOS)
+	return file_stat->st_mtimespec.tv_nsec;
+#else
+	return file_stat->st_mtim.tv_nsec;
+#endif
+}
+
+static bool config_buffer_append(config_buffer *buffer, const void *data, size_t size) {
+	if (buffer->size + size > buffer->capacity) {
+		size_t capacity = buffer->capacity ? buffer->capacity : 4096;
+		while (buffer->size + size > capacity)
+			capacity *= 2;
+		char *tmp = realloc(buffer->data, capacity);
+		if (tmp == NULL)
+			return false;
+		buffer->data = tmp;
+		buffer->capacity = capacity;
+	}
+	memcpy(buffer->data + buffer->size, data, size);
+	buffer->size += size;
+	return true;
+}
+
+static bool config_buffer_printf(config_buffer *buffer, const char *format, ...) {
+	char tmp[1024];
+	va_list args;
+	va_start(args, format);
+	int length = vsnprintf(tmp, sizeof(tmp), format, args);
+	va_end(args);
+	if (length < 0)
+		return false;
+	if (length < sizeof(tmp))
+		return config_buffer_append(buffer, tmp, length);
+	char *long_tmp = malloc(length + 1);
+	if (long_tmp == NULL)
+		return false;
+	va_start(args, format);
+	vsnprintf(long_tmp, length + 1, format, args);
+	va_end(args);
+	bool result = config_buffer_append(buffer, long_tmp, length);
+	free(long_tmp);
+	return result;
+}
+
+static bool config_cache_put_string(config_buffer *buffer, const char *string) {
+	uint16_t length = (uint16_t)strlen(string);
+	return config_buffer_append(buffer, &length, sizeof(length)) && config_buffer_append(buffer, string, length);
+}
+
+static bool config_cache_get_string(const unsigned char **data, const unsigned char *end, char *string, int size) {
+	uint16_t length;
+	if (end - *data < sizeof(length))
+		return false;
+	memcpy(&length, *data, sizeof(length));
+	*data += sizeof(length);
+	if (length >= size || end - *data < length)
+		return false;
+	if (string) {
+		memcpy(string, *data, length);
+		string[length] = 0;
+	}
+	*data += length;
+	return true;
+}
+
+static bool config_xml_property(config_buffer *xml, indigo_property *property) {
+	bool ok = true;
+	switch (property->type) {
+	case INDIGO_TEXT_VECTOR:
+		ok = config_buffer_printf(xml, "<newTextVector device='%s' name='%s'>\n", indigo_xml_escape(property->device), property->name);
+		for (int i = 0; ok && i < property->count; i++) {
+			indigo_item *item = &property->items[i];
+			ok = config_buffer_printf(xml, "<oneText name='%s'>%s</oneText>\n", item->name, indigo_xml_escape(item->text.value));
+		}
+		return ok && config_buffer_printf(xml, "</newTextVector>\n");
+	case INDIGO_NUMBER_VECTOR:
+		ok = config_buffer_printf(xml, "<newNumberVector device='%s' name='%s'>\n", indigo_xml_escape(property->device), property->name);
+		for (int i = 0; ok && i < property->count; i++) {
+			indigo_item *item = &property->items[i];
+			ok = config_buffer_printf(xml, "<oneNumber name='%s'>%g</oneNumber>\n", item->name, item->number.value);
+		}
+		return ok && config_buffer_printf(xml, "</newNumberVector>\n");
+	case INDIGO_SWITCH_VECTOR:
+		ok = config_buffer_printf(xml, "<newSwitchVector device='%s' name='%s'>\n", indigo_xml_escape(property->device), property->name);
+		for (int i = 0; ok && i < property->count; i++) {
+			indigo_item *item = &property->items[i];
+			ok = config_buffer_printf(xml, "<oneSwitch name='%s'>%s</oneSwitch>\n", item->name, item->sw.value ? "On" : "Off");
+		}
+		return ok && config_buffer_printf(xml, "</newSwitchVector>\n");
+	default:
+		return true;
+	}
+}
+
+static bool config_cache_property(config_buffer *cache, indigo_property *property) {
+	uint8_t record[2] = { property->type, property->count };
+	bool ok = config_buffer_append(cache, record, sizeof(record)) && config_cache_put_string(cache, property->device) && config_cache_put_string(cache, property->name);
+	for (int i = 0; ok && i < property->count; i++) {
+		indigo_item *item = &property->items[i];
+		ok = config_cache_put_string(cache, item->name);
+		switch (property->type) {
+		case INDIGO_TEXT_VECTOR:
+			ok = ok && config_cache_put_string(cache, item->text.value);
+			break;
+		case INDIGO_NUMBER_VECTOR:
+			ok = ok && config_buffer_append(cache, &item->number.value, sizeof(double));
+			break;
+		case INDIGO_SWITCH_VECTOR: {
+			uint8_t value = item->sw.value;
+			ok = ok && config_buffer_append(cache, &value, sizeof(value));
+			break;
+		}
+		default:
+			break;
+		}
+	}
+	return ok;
+}
+
+static void free_config_snapshot(config_snapshot *snapshot) {
+	free(snapshot->xml.data);
+	free(snapshot->cache.data);
+	free(snapshot);
+}
+
+// handle closed by plain close() (or already reused for another file) can't be committed by indigo_close_config_file(),
+// its XML is complete on disk, so it is renamed without cache; caller must hold config_snapshots_mutex
+static void reap_config_snapshots(void) {
+	config_snapshot **link = &config_snapshots;
+	while (*link) {
+		config_snapshot *snapshot = *link;
+		struct stat file_stat;
+		if (fstat(snapshot->handle, &file_stat) == 0 && file_stat.st_dev == snapshot->dev && file_stat.st_ino == snapshot->ino) {
+			link = &snapshot->next;
+			continue;
+		}
+		*link = snapshot->next;
+		char path[512], tmp_path[512];
+		if (make_config_file_name(snapshot->device_name, snapshot->profile, ".config", path, sizeof(path)) && make_config_file_name(snapshot->device_name, snapshot->profile, ".config.tmp", tmp_path, sizeof(tmp_path))) {
+			if (!snapshot->failed && stat(tmp_path, &file_stat) == 0 && file_stat.st_dev == snapshot->dev && file_stat.st_ino == snapshot->ino && rename(tmp_path, path) == 0) {
+				INDIGO_DEBUG(indigo_debug("Config for '%s' committed after close()", snapshot->device_name));
+			} else {
+				INDIGO_ERROR(indigo_error("Config for '%s' closed by close() before commit, dropped", snapshot->device_name));
+			}
+			if (make_config_file_name(snapshot->device_name, snapshot->profile, ".cache", path, sizeof(path)))
+				unlink(path);
+		}
+		free_config_snapshot(snapshot);
+	}
+}
+
+static config_snapshot *find_config_snapshot(int handle, bool remove) {
+	pthread_mutex_lock(&config_snapshots_mutex);
+	reap_config_snapshots();
+	config_snapshot *snapshot = config_snapshots, *previous = NULL;
+	while (snapshot && snapshot->handle != handle) {
+		previous = snapshot;
+		snapshot = snapshot->next;
+	}
+	if (snapshot && remove) {
+		if (previous)
+			previous->next = snapshot->next;
+		else
+			config_snapshots = snapshot->next;
+	}
+	pthread_mutex_unlock(&config_snapshots_mutex);
+	return snapshot;
+}
+
+static bool commit_config_file(int handle, const char *tmp_path, const char *path, config_buffer *buffer, struct stat *file_stat) {
+	bool result = buffer == NULL || indigo_write(handle, buffer->data ? buffer->data : "", buffer->size);
+	result = result && fsync(handle) == 0;
+	if (file_stat)
+		result = result && fstat(handle, file_stat) == 0;
+	result = close(handle) == 0 && result;
+	if (result && rename(tmp_path, path) == 0)
+		return true;
+	INDIGO_ERROR(indigo_error("Can't save %s (%s)", path, strerror(errno)));
+	unlink(tmp_path);
+	return false;
+}
+
+indigo_result indigo_close_config_file(int handle) {
+	if (handle <= 0)
+		return INDIGO_FAILED;
+	config_snapshot *snapshot = find_config_snapshot(handle, true);
+	if (snapshot == NULL) {
+		close(handle);
+		return INDIGO_OK;
+	}
+	indigo_result result = INDIGO_FAILED;
+	char path[512], tmp_path[512];
+	struct stat config_stat;
+	bool names = make_config_file_name(snapshot->device_name, snapshot->profile, ".config", path, sizeof(path)) && make_config_file_name(snapshot->device_name, snapshot->profile, ".config.tmp", tmp_path, sizeof(tmp_path));
+	if (snapshot->failed) {
+		// previous config is kept untouched
+		INDIGO_ERROR(indigo_error("Config for '%s' not saved, write failed", snapshot->device_name));
+		close(handle);
+		if (names)
+			unlink(tmp_path);
+	} else if (names && commit_config_file(handle, tmp_path, path, NULL, &config_stat)) {
+		result = INDIGO_OK;
+		if (make_config_file_name(snapshot->device_name, snapshot->profile, ".cache", path, sizeof(path)) && make_config_file_name(snapshot->device_name, snapshot->profile, ".cache.tmp", tmp_path, sizeof(tmp_path))) {
+			// incomplete cache is never written, stale one is removed so XML file is used instead
+			if (snapshot->cache_failed) {
+				unlink(path);
+			} else {
+				config_cache_header *header = (config_cache_header *)snapshot->cache.data;
+				header->count = snapshot->count;
+				header->config_size = config_stat.st_size;
+				header->config_mtime = config_stat.st_mtime;
+				header->config_mtime_nsec = config_mtime_nsec(&config_stat);
+				header->config_ino = config_stat.st_ino;
+				handle = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+				if (handle < 0 || !commit_config_file(handle, tmp_path, path, &snapshot->cache, NULL))
+					unlink(path);
+			}
+		}
+		INDIGO_DEBUG(indigo_debug("Config for '%s' saved (%d properties, %ld bytes)", snapshot->device_name, snapshot->count, (long)config_stat.st_size));
+	} else if (!names) {
+		close(handle);
+	}
+	free_config_snapshot(snapshot);
+	return result;
+}
+
+static bool replay_config_cache(const unsigned char *data, const unsigned char *end, indigo_client *client, indigo_property *property) {
+	while (data < end) {
+		uint8_t type, count;
+		if (end - data < 2)
+			return false;
+		type = *data++;
+		count = *data++;
+		if (type < INDIGO_TEXT_VECTOR || type > INDIGO_SWITCH_VECTOR || count > INDIGO_MAX_ITEMS)
+			return false;
+		if (property) {
+			memset(property, 0, sizeof(indigo_property) + INDIGO_MAX_ITEMS * sizeof(indigo_item));
+			property->type = type;
+			property->count = count;
+		}
+		if (!config_cache_get_string(&data, end, property ? property->device : NULL, INDIGO_NAME_SIZE) || !config_cache_get_string(&data, end, property ? property->name : NULL, INDIGO_NAME_SIZE))
+			return false;
+		for (int i = 0; i < count; i++) {
+			indigo_item *item = property ? property->items + i : NULL;
+			if (!config_cache_get_string(&data, end, item ? item->name : NULL, INDIGO_NAME_SIZE))
+				return false;
+			switch (type) {
+				case INDIGO_TEXT_VECTOR:
+					if (!config_cache_get_string(&data, end, item ? item->text.value : NULL, INDIGO_VALUE_SIZE))
+						return false;
+					break;
+				case INDIGO_NUMBER_VECTOR:
+					if (end - data < sizeof(double))
+						return false;
+					if (item)
+						memcpy(&item->number.value, data, sizeof(double));
+					data += sizeof(double);
+					break;
+				case INDIGO_SWITCH_VECTOR:
+					if (end - data < 1)
+						return false;
+					if (item)
+						item->sw.value = *data != 0;
+					data++;
+					break;
+			}
+		}
+		if (property)
+			indigo_change_property(client, property);
+	}
+	return true;
+}
+
+static bool load_config_cache(indigo_device *device, int profile, indigo_client *client) {
+	char path[512];
+	struct stat config_stat, cache_stat;
+	if (!make_config_file_name(device->name, profile, ".config", path, sizeof(path)) || stat(path, &config_stat) < 0)
+		return false;
+	if (!make_config_file_name(device->name, profile, ".cache", path, sizeof(path)))
+		return false;
+	int handle = open(path, O_RDONLY);
+	if (handle < 0)
+		return false;
+	if (fstat(handle, &cache_stat) < 0 || cache_stat.st_size < sizeof(config_cache_header)) {
+		close(handle);
+		return false;
+	}
+	void *data = mmap(NULL, cache_stat.st_size, PROT_READ, MAP_PRIVATE, handle, 0);
+	close(handle);
+	if (data == MAP_FAILED)
+		return false;
+	bool result = false;
+	config_cache_header *header = data;
+	// use cache only if XML file wasn't modified since it was written
+	if (!memcmp(header->magic, CONFIG_CACHE_MAGIC, sizeof(header->magic)) && header->version == CONFIG_CACHE_VERSION && header->config_size == config_stat.st_size && header->config_mtime == config_stat.st_mtime && header->config_mtime_nsec == config_mtime_nsec(&config_stat) && header->config_ino == config_stat.st_ino) {
+		const unsigned char *begin = (const unsigned char *)data + sizeof(config_cache_header);
+		const unsigned char *end = (const unsigned char *)data + cache_stat.st_size;
+		if (replay_config_cache(begin, end, NULL, NULL)) {
+			indigo_property *property = malloc(sizeof(indigo_property) + INDIGO_MAX_ITEMS * sizeof(indigo_item));
+			if (property) {
+				result = replay_config_cache(begin, end, client, property);
+				free(property);
+			}
+		}
+	}
+	munmap(data, cache_stat.st_size);
+	return result;
+}
+
 indigo_result indigo_load_properties(indigo_device *device, bool default_properties) {
 	assert(device != NULL);
 	int profile = 0;
@@ -457,19 +813,29 @@ indigo_result indigo_load_properties(indigo_device *device, bool default_propert
 				break;
 			}
 	}
+	struct timeval start, end;
+	gettimeofday(&start, NULL);
+	indigo_client *client = malloc(sizeof(indigo_client));
+	memset(client, 0, sizeof(indigo_client));
+	client->version = INDIGO_VERSION_CURRENT;
+	if (!default_properties && load_config_cache(device, profile, client)) {
+		gettimeofday(&end, NULL);
+		INDIGO_DEBUG(indigo_debug("Config for '%s' loaded from cache in %gms", device->name, (end.tv_sec - start.tv_sec) * 1000.0 + (end.tv_usec - start.tv_usec) / 1000.0));
+		free(client);
+		return INDIGO_OK;
+	}
 	int handle = indigo_open_config_file(device->name, profile, O_RDONLY, default_properties ? ".default" : ".config");
 	if (handle > 0) {
-		indigo_client *client = malloc(sizeof(indigo_client));
-		memset(client, 0, sizeof(indigo_client));
 		indigo_adapter_context *context = malloc(sizeof(indigo_adapter_context));
 		context->input = handle;
 		client->client_context = context;
-		client->version = INDIGO_VERSION_CURRENT;
 		indigo_xml_parse(NULL, client);
 		close(handle);
 		free(context);
-		free(client);
+		gettimeofday(&end, NULL);
+		INDIGO_DEBUG(indigo_debug("Config for '%s' loaded from %s in %gms", device->name, default_properties ? "defaults" : "XML", (end.tv_sec - start.tv_sec) * 1000.0 + (end.tv_usec - start.tv_usec) / 1000.0));
 	}
+	free(client);
 	return handle > 0 ? INDIGO_OK : INDIGO_FAILED;
 }
 
@@ -480,6 +846,7 @@ indigo_result indigo_save_property(indigo_device*device, int *file_handle, indig
 		if (file_handle == NULL)
 			file_handle = &DEVICE_CONTEXT->property_save_file_handle;
 		int handle = *file_handle;
+		config_snapshot *snapshot = NULL;
 		if (handle == 0) {
 			int profile = 0;
 			if (DEVICE_CONTEXT) {
@@ -489,38 +856,53 @@ indigo_result indigo_save_property(indigo_device*device, int *file_handle, indig
 						break;
 					}
 			}
-			*file_handle = handle = indigo_open_config_file(property->device, profile, O_WRONLY | O_CREAT | O_TRUNC, ".config");
-			if (handle == 0)
+			// commit abandoned snapshots before their temporary file is truncated
+			pthread_mutex_lock(&config_snapshots_mutex);
+			reap_config_snapshots();
+			pthread_mutex_unlock(&config_snapshots_mutex);
+			handle = indigo_open_config_file(property->device, profile, O_WRONLY | O_CREAT | O_TRUNC, ".config.tmp");
+			if (handle <= 0)
+				return INDIGO_FAILED;
+			struct stat file_stat;
+			snapshot = malloc(sizeof(config_snapshot));
+			if (snapshot == NULL || fstat(handle, &file_stat) < 0) {
+				free(snapshot);
+				close(handle);
 				return INDIGO_FAILED;
-		}
-		switch (property->type) {
-		case INDIGO_TEXT_VECTOR:
-			indigo_printf(handle, "<newTextVector device='%s' name='%s'>\n", indigo_xml_escape(property->device), property->name, indigo_property_state_text[property->state]);
-			for (int i = 0; i < property->count; i++) {
-				indigo_item *item = &property->items[i];
-				indigo_printf(handle, "<oneText name='%s'>%s</oneText>\n", item->name, indigo_xml_escape(item->text.value));
-			}
-			indigo_printf(handle, "</newTextVector>\n");
-			break;
-		case INDIGO_NUMBER_VECTOR:
-			indigo_printf(handle, "<newNumberVector device='%s' name='%s'>\n", indigo_xml_escape(property->device), property->name, indigo_property_state_text[property->state]);
-			for (int i = 0; i < property->count; i++) {
-				indigo_item *item = &property->items[i];
-				indigo_printf(handle, "<oneNumber name='%s'>%g</oneNumber>\n", item->name, item->number.value);
-			}
-			indigo_printf(handle, "</newNumberVector>\n");
-			break;
-		case INDIGO_SWITCH_VECTOR:
-			indigo_printf(handle, "<newSwitchVector device='%s' name='%s'>\n", indigo_xml_escape(property->device), property->name, indigo_property_state_text[property->state]);
-			for (int i = 0; i < property->count; i++) {
-				indigo_item *item = &property->items[i];
-				indigo_printf(handle, "<oneSwitch name='%s'>%s</oneSwitch>\n", item->name, item->sw.value ? "On" : "Off");
 			}
-			indigo_printf(handle, "</newSwitchVector>\n");
-			break;
-		default:
-			break;
+			memset(snapshot, 0, sizeof(config_snapshot));
+			snapshot->handle = handle;
+			snapshot->profile = profile;
+			snapshot->dev = file_stat.st_dev;
+			snapshot->ino = file_stat.st_ino;
+			strncpy(snapshot->device_name, property->device, INDIGO_NAME_SIZE - 1);
+			config_cache_header header = { CONFIG_CACHE_MAGIC, CONFIG_CACHE_VERSION, 0, 0, 0, 0, 0 };
+			snapshot->cache_failed = !config_buffer_append(&snapshot->cache, &header, sizeof(header));
+			pthread_mutex_lock(&config_snapshots_mutex);
+			snapshot->next = config_snapshots;
+			config_snapshots = snapshot;
+			pthread_mutex_unlock(&config_snapshots_mutex);
+			*file_handle = handle;
+		} else {
+			snapshot = find_config_snapshot(handle, false);
+		}
+		if (snapshot == NULL) {
+			// handle not created by indigo_save_property(), write XML directly
+			config_buffer xml = { NULL, 0, 0 };
+			bool ok = config_xml_property(&xml, property) && (xml.size == 0 || indigo_write(handle, xml.data, xml.size));
+			free(xml.data);
+			return ok ? INDIGO_OK : INDIGO_FAILED;
+		}
+		if (property->type != INDIGO_TEXT_VECTOR && property->type != INDIGO_NUMBER_VECTOR && property->type != INDIGO_SWITCH_VECTOR)
+			return INDIGO_OK;
+		snapshot->xml.size = 0;
+		if (snapshot->failed || !config_xml_property(&snapshot->xml, property) || !indigo_write(handle, snapshot->xml.data, snapshot->xml.size)) {
+			snapshot->failed = true;
+			return INDIGO_FAILED;
 		}
+		if (!config_cache_property(&snapshot->cache, property))
+			snapshot->cache_failed = true;
+		snapshot->count++;
 	}
 	return INDIGO_OK;
 }
@@ -536,6 +918,8 @@ indigo_result indigo_remove_properties(indigo_device *device) {
 			}
 	}
 	static char path[512];
+	if (make_config_file_name(device->name, profile, ".cache", path, sizeof(path)))
+		unlink(path);
 	if (make_config_file_name(device->name, profile, ".config", path, sizeof(path))) {
 		if (unlink(path) == 0)
 			return INDIGO_OK;
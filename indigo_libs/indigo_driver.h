@@ -291,6 +291,10 @@ extern indigo_result indigo_load_properties(indigo_device *device, bool default_
  */
 extern indigo_result indigo_save_property(indigo_device*device, int *file_handle, indigo_property *property);
 
+/** Atomically commit properties saved by indigo_save_property() and close the handle.
+ */
+extern indigo_result indigo_close_config_file(int handle);
+
 /** Remove properties.
  */
 extern indigo_result indigo_remove_properties(indigo_device *device);
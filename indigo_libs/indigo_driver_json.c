@@ -32,53 +32,322 @@
 #include <pthread.h>
 #include <assert.h>
 #include <stdint.h>
-#include <arpa/inet.h>
+#include <sys/socket.h>
 
 
 #include "indigo_json.h"
+#include "indigo_driver_json.h"
 #include "indigo_io.h"
+#include "indigo_metrics.h"
+
+#define JSON_ADAPTER_ID	'J'
 
 //#undef INDIGO_TRACE_PROTOCOL
 //#define INDIGO_TRACE_PROTOCOL(c) c
 
-static pthread_mutex_t json_mutex = PTHREAD_MUTEX_INITIALIZER;
-
-static void ws_write(int handle, const char *buffer, long length) {
-	uint8_t header[10] = { 0x81 };
-	if (length <= 0x7D) {
-		header[1] = length;
-		indigo_write(handle, (char *)header, 2);
-	} else if (length <= 0xFFFF) {
-		header[1] = 0x7E;
-		uint16_t payloadLength = htons(length);
-		memcpy(header+2, &payloadLength, 2);
-		indigo_write(handle, (char *)header, 4);
-	} else {
-		header[1] = 0x7F;
-		uint64_t payloadLength = htonll(length);
-		memcpy(header+2, &payloadLength, 8);
-		indigo_write(handle, (char *)header, 10);
+typedef struct json_blob_frame {
+	struct json_blob_frame *next;				///< next frame of the same update
+	indigo_shared_message *message;			///< copy of BLOB data shared by all clients of the broadcast
+} json_blob_frame;
+
+typedef struct {
+	indigo_adapter_context context;			///< common adapter context (must be first)
+	pthread_mutex_t mutex;							///< per-connection output lock
+	char *buffer;												///< growable output buffer
+	size_t size;												///< used part of output buffer
+	size_t capacity;										///< allocated size of output buffer
+	bool failed;												///< output buffer couldn't grow, message is dropped
+	pthread_t blob_thread;							///< binary BLOB sender thread
+	pthread_cond_t blob_cond;						///< signalled when frames are queued or sender should terminate
+	json_blob_frame *blob_frames;				///< binary BLOB frames waiting for sender (guarded by mutex)
+	bool blob_busy;											///< sender is writing frames
+	bool blob_thread_started;						///< sender thread is running
+	bool blob_terminate;								///< sender thread should terminate
+} json_adapter_context;
+
+static bool json_reserve(json_adapter_context *context, size_t size) {
+	if (context->size + size <= context->capacity)
+		return true;
+	size_t capacity = context->capacity ? context->capacity : JSON_BUFFER_SIZE;
+	while (context->size + size > capacity)
+		capacity *= 2;
+	char *buffer = realloc(context->buffer, capacity);
+	if (buffer == NULL)
+		return false;
+	context->buffer = buffer;
+	context->capacity = capacity;
+	return true;
+}
+
+static void json_printf(json_adapter_context *context, const char *format, ...) {
+	if (context->failed)
+		return;
+	va_list args;
+	va_start(args, format);
+	int length = vsnprintf(context->buffer + context->size, context->capacity - context->size, format, args);
+	va_end(args);
+	if (length < 0) {
+		context->failed = true;
+		return;
 	}
-	indigo_write(handle, buffer, length);
+	if (context->size + length >= context->capacity) {
+		if (!json_reserve(context, length + 1)) {
+			context->failed = true;
+			return;
+		}
+		va_start(args, format);
+		vsnprintf(context->buffer + context->size, context->capacity - context->size, format, args);
+		va_end(args);
+	}
+	context->size += length;
 }
 
-static const char *escape(const char *s) {
-	char *q = strchr(s, '"');
-	if (q == NULL)
-		return s;
-	static char tmp[INDIGO_VALUE_SIZE * 2];
-	char *t = tmp;
-	while (q) {
-		long l = q - s;
-		memcpy(t, s, l);
-		t += l;
-		*t++ = '\\';
-		*t++ = '"';
-		s = q + 1;
-		q = strchr(s, '"');
+static void json_string(json_adapter_context *context, const char *s) {
+	static const char *hex = "0123456789abcdef";
+	if (context->failed)
+		return;
+	// worst case is \u00XX for every character plus quotes
+	if (!json_reserve(context, 6 * strlen(s) + 3)) {
+		context->failed = true;
+		return;
+	}
+	char *t = context->buffer + context->size;
+	*t++ = '"';
+	for (const unsigned char *c = (const unsigned char *)s; *c; c++) {
+		switch (*c) {
+			case '"':
+				*t++ = '\\';
+				*t++ = '"';
+				break;
+			case '\\':
+				*t++ = '\\';
+				*t++ = '\\';
+				break;
+			case '\n':
+				*t++ = '\\';
+				*t++ = 'n';
+				break;
+			case '\r':
+				*t++ = '\\';
+				*t++ = 'r';
+				break;
+			case '\t':
+				*t++ = '\\';
+				*t++ = 't';
+				break;
+			default:
+				if (*c < 0x20) {
+					*t++ = '\\';
+					*t++ = 'u';
+					*t++ = '0';
+					*t++ = '0';
+					*t++ = hex[*c >> 4];
+					*t++ = hex[*c & 0xF];
+				} else {
+					*t++ = *c;
+				}
+				break;
+		}
 	}
+	*t++ = '"';
 	*t = 0;
-	return tmp;
+	context->size = t - context->buffer;
+}
+
+static void json_key_string(json_adapter_context *context, const char *key, const char *s) {
+	json_printf(context, ", \"%s\": ", key);
+	json_string(context, s);
+}
+
+static bool json_send_frame(json_adapter_context *context, int opcode, const char *data, long length) {
+	uint64_t start = indigo_metrics_now();
+	bool result;
+	if (context->context.web_socket_state)
+		result = indigo_web_socket_write(context->context.web_socket_state, opcode, data, length);
+	else
+		result = indigo_write(context->context.output, data, length);
+	indigo_metrics_client_write(context->context.metrics, length, indigo_metrics_now() - start, indigo_unsent_bytes(context->context.output));
+	return result;
+}
+
+static bool json_send(json_adapter_context *context, const char *data, long length) {
+	INDIGO_TRACE_PROTOCOL(indigo_trace("%d ← %.*s\n", context->context.output, (int)length, data));
+	return json_send_frame(context, WEB_SOCKET_OPCODE_TEXT, data, length);
+}
+
+static json_adapter_context *json_begin(indigo_client *client) {
+	json_adapter_context *context = (json_adapter_context *)client->client_context;
+	assert(context != NULL);
+	pthread_mutex_lock(&context->mutex);
+	context->size = 0;
+	context->failed = false;
+	if (!json_reserve(context, 1)) {
+		pthread_mutex_unlock(&context->mutex);
+		return NULL;
+	}
+	*context->buffer = 0;
+	return context;
+}
+
+static void json_release(json_adapter_context *context) {
+	// keep big buffers allocated by BLOBs or long texts only until next message
+	if (context->capacity > 4 * JSON_BUFFER_SIZE) {
+		free(context->buffer);
+		context->buffer = NULL;
+		context->capacity = 0;
+	}
+	pthread_mutex_unlock(&context->mutex);
+}
+
+static bool json_end(json_adapter_context *context) {
+	// never send truncated JSON, client would fail to parse the rest of the stream
+	bool result = !context->failed;
+	if (result)
+		json_send(context, context->buffer, context->size);
+	else
+		INDIGO_ERROR(indigo_error("%d: out of memory, message dropped", context->context.output));
+	json_release(context);
+	return result;
+}
+
+// binary BLOB frames are written by a per-connection thread, so a slow client never blocks the thread
+// broadcasting the update; only one update can be pending, further ones are sent as URLs only
+
+static void json_blob_frame_free(json_blob_frame *frame) {
+	indigo_shared_message_release(frame->message);
+	free(frame);
+}
+
+static void *json_blob_sender(json_adapter_context *context) {
+	pthread_mutex_lock(&context->mutex);
+	while (true) {
+		while (context->blob_frames == NULL && !context->blob_terminate)
+			pthread_cond_wait(&context->blob_cond, &context->mutex);
+		if (context->blob_terminate)
+			break;
+		json_blob_frame *frames = context->blob_frames;
+		context->blob_frames = NULL;
+		context->blob_busy = true;
+		pthread_mutex_unlock(&context->mutex);
+		bool result = true;
+		while (frames) {
+			json_blob_frame *frame = frames;
+			frames = frame->next;
+			if (result)
+				result = json_send_frame(context, WEB_SOCKET_OPCODE_BINARY, frame->message->data, frame->message->size);
+			json_blob_frame_free(frame);
+		}
+		pthread_mutex_lock(&context->mutex);
+		context->blob_busy = false;
+	}
+	pthread_mutex_unlock(&context->mutex);
+	return NULL;
+}
+
+// BLOB data is copied only once per broadcast, all binary clients share the same copy
+
+static json_blob_frame *json_blob_frames(indigo_property *property) {
+	json_blob_frame *frames = NULL, **tail = &frames;
+	for (int i = 0; i < property->count; i++) {
+		indigo_item *item = &property->items[i];
+		if (item->blob.value == NULL || item->blob.size <= 0)
+			continue;
+		json_blob_frame *frame = malloc(sizeof(json_blob_frame));
+		if (frame != NULL) {
+			uint32_t key = INDIGO_BROADCAST_KEY(JSON_ADAPTER_ID, 1, i);
+			frame->next = NULL;
+			frame->message = indigo_broadcast_cache_get(key);
+			if (frame->message == NULL && (frame->message = indigo_shared_message_create(item->blob.value, item->blob.size)) != NULL)
+				indigo_broadcast_cache_put(key, frame->message);
+		}
+		if (frame == NULL || frame->message == NULL) {
+			free(frame);
+			while (frames) {
+				frame = frames;
+				frames = frame->next;
+				json_blob_frame_free(frame);
+			}
+			return NULL;
+		}
+		*tail = frame;
+		tail = &frame->next;
+	}
+	return frames;
+}
+
+static void json_blob_sender_stop(json_adapter_context *context) {
+	pthread_mutex_lock(&context->mutex);
+	bool started = context->blob_thread_started;
+	context->blob_terminate = true;
+	pthread_cond_signal(&context->blob_cond);
+	// unblock write to stalled client
+	if (context->blob_busy)
+		shutdown(context->context.output, SHUT_RDWR);
+	pthread_mutex_unlock(&context->mutex);
+	if (started)
+		pthread_join(context->blob_thread, NULL);
+	context->blob_thread_started = false;
+	while (context->blob_frames) {
+		json_blob_frame *frame = context->blob_frames;
+		context->blob_frames = frame->next;
+		json_blob_frame_free(frame);
+	}
+}
+
+static indigo_enable_blob_mode json_blob_mode(indigo_client *client, indigo_property *property) {
+	indigo_enable_blob_mode_record *record = client->enable_blob_mode_records;
+	while (record) {
+		if ((*record->device == 0 || !strcmp(property->device, record->device)) && (*record->name == 0 || !strcmp(property->name, record->name)))
+			return record->mode;
+		record = record->next;
+	}
+	return INDIGO_ENABLE_BLOB_NEVER;
+}
+
+// property definitions and updates are the same for all JSON clients, so message is encoded
+// only once per broadcast and shared with other clients
+
+static bool json_send_cached(indigo_client *client) {
+	indigo_shared_message *shared = indigo_broadcast_cache_get(INDIGO_BROADCAST_KEY(JSON_ADAPTER_ID, 0, 0));
+	if (shared == NULL)
+		return false;
+	json_adapter_context *context = (json_adapter_context *)client->client_context;
+	assert(context != NULL);
+	pthread_mutex_lock(&context->mutex);
+	json_send(context, shared->data, shared->size);
+	pthread_mutex_unlock(&context->mutex);
+	indigo_shared_message_release(shared);
+	return true;
+}
+
+static bool json_end_and_cache(json_adapter_context *context) {
+	if (!context->failed) {
+		indigo_shared_message *shared = indigo_shared_message_create(context->buffer, context->size);
+		indigo_broadcast_cache_put(INDIGO_BROADCAST_KEY(JSON_ADAPTER_ID, 0, 0), shared);
+		indigo_shared_message_release(shared);
+	}
+	return json_end(context);
+}
+
+static void json_property_header(json_adapter_context *context, const char *tag, indigo_property *property, const char *message, bool definition) {
+	json_printf(context, "{ \"%s\": { ", tag);
+	if (definition)
+		json_printf(context, "\"version\": %d, ", property->version);
+	json_printf(context, "\"device\": ");
+	json_string(context, property->device);
+	json_key_string(context, "name", property->name);
+	if (definition) {
+		json_key_string(context, "group", property->group);
+		json_key_string(context, "label", property->label);
+		if (property->type != INDIGO_LIGHT_VECTOR && property->type != INDIGO_BLOB_VECTOR)
+			json_printf(context, ", \"perm\": \"%s\"", indigo_property_perm_text[property->perm]);
+	}
+	json_printf(context, ", \"state\": \"%s\"", indigo_property_state_text[property->state]);
+	if (definition && property->type == INDIGO_SWITCH_VECTOR)
+		json_printf(context, ", \"rule\": \"%s\"", indigo_switch_rule_text[property->rule]);
+	if (message)
+		json_key_string(context, "message", message);
+	json_printf(context, ", \"items\": [ ");
 }
 
 static indigo_result json_define_property(indigo_client *client, indigo_device *device, indigo_property *property, const char *message) {
@@ -89,115 +358,70 @@ static indigo_result json_define_property(indigo_client *client, indigo_device *
 		return INDIGO_OK;
 	if (client->version == INDIGO_VERSION_NONE)
 		return INDIGO_OK;
-	pthread_mutex_lock(&json_mutex);
-	indigo_adapter_context *client_context = (indigo_adapter_context *)client->client_context;
-	assert(client_context != NULL);
-	int handle = client_context->output;
-	char output_buffer[JSON_BUFFER_SIZE];
-	char *pnt = output_buffer;
-	int size;
+	if (json_send_cached(client))
+		return INDIGO_OK;
+	json_adapter_context *context = json_begin(client);
+	if (context == NULL)
+		return INDIGO_FAILED;
 	switch (property->type) {
 		case INDIGO_TEXT_VECTOR:
-			size = sprintf(pnt, "{ \"defTextVector\": { \"version\": %d, \"device\": \"%s\", \"name\": \"%s\", \"group\": \"%s\", \"label\": \"%s\", \"perm\": \"%s\", \"state\": \"%s\"", property->version, property->device, property->name, property->group, escape(property->label), indigo_property_perm_text[property->perm], indigo_property_state_text[property->state]);
-			pnt += size;
-			if (message) {
-				size = sprintf(pnt, ", \"message\": \"%s\", \"items\": [ ", escape(message));
-				pnt += size;
-			} else {
-				size = sprintf(pnt, ", \"items\": [ ");
-				pnt += size;
-			}
+			json_property_header(context, "defTextVector", property, message, true);
 			for (int i = 0; i < property->count; i++) {
 				indigo_item *item = &property->items[i];
-				size = sprintf(pnt, "%s { \"name\": \"%s\", \"label\": \"%s\", \"value\": \"%s\" }",  i > 0 ? "," : "", item->name, escape(item->label), item->text.value);
-				pnt += size;
+				json_printf(context, "%s { \"name\": ", i > 0 ? "," : "");
+				json_string(context, item->name);
+				json_key_string(context, "label", item->label);
+				json_key_string(context, "value", item->text.value);
+				json_printf(context, " }");
 			}
-			size = sprintf(pnt, " ] } }");
-			size += pnt - output_buffer;
 			break;
 		case INDIGO_NUMBER_VECTOR:
-			size = sprintf(pnt, "{ \"defNumberVector\": { \"version\": %d, \"device\": \"%s\", \"name\": \"%s\", \"group\": \"%s\", \"label\": \"%s\", \"perm\": \"%s\", \"state\": \"%s\"", property->version, property->device, property->name, property->group, escape(property->label), indigo_property_perm_text[property->perm], indigo_property_state_text[property->state]);
-			pnt += size;
-			if (message) {
-				size = sprintf(pnt, ", \"message\": \"%s\", \"items\": [ ", escape(message));
-				pnt += size;
-			} else {
-				size = sprintf(pnt, ", \"items\": [ ");
-				pnt += size;
-			}
+			json_property_header(context, "defNumberVector", property, message, true);
 			for (int i = 0; i < property->count; i++) {
 				indigo_item *item = &property->items[i];
+				json_printf(context, "%s { \"name\": ", i > 0 ? "," : "");
+				json_string(context, item->name);
+				json_key_string(context, "label", item->label);
+				json_printf(context, ", \"min\": %.8g, \"max\": %.8g, \"step\": %.8g", item->number.min, item->number.max, item->number.step);
+				json_key_string(context, "format", item->number.format);
 				if (property->perm != INDIGO_RO_PERM)
-					size = sprintf(pnt, "%s { \"name\": \"%s\", \"label\": \"%s\", \"min\": %.8g, \"max\": %.8g, \"step\": %.8g, \"format\": \"%s\", \"target\": %.8g, \"value\": %.8g }",  i > 0 ? "," : "", item->name, escape(item->label), item->number.min, item->number.max, item->number.step, item->number.format, item->number.target, item->number.value);
-				else
-					size = sprintf(pnt, "%s { \"name\": \"%s\", \"label\": \"%s\", \"min\": %.8g, \"max\": %.8g, \"step\": %.8g, \"format\": \"%s\", \"value\": %.8g }",  i > 0 ? "," : "", item->name, escape(item->label), item->number.min, item->number.max, item->number.step, item->number.format, item->number.value);
-				pnt += size;
+					json_printf(context, ", \"target\": %.8g", item->number.target);
+				json_printf(context, ", \"value\": %.8g }", item->number.value);
 			}
-			size = sprintf(pnt, " ] } }");
-			size += pnt - output_buffer;
 			break;
 		case INDIGO_SWITCH_VECTOR:
-			size = sprintf(pnt, "{ \"defSwitchVector\": { \"version\": %d, \"device\": \"%s\", \"name\": \"%s\", \"group\": \"%s\", \"label\": \"%s\", \"perm\": \"%s\", \"state\": \"%s\", \"rule\": \"%s\"", property->version, property->device, property->name, property->group, escape(property->label), indigo_property_perm_text[property->perm], indigo_property_state_text[property->state], indigo_switch_rule_text[property->rule]);
-			pnt += size;
-			if (message) {
-				size = sprintf(pnt, ", \"message\": \"%s\", \"items\": [ ", escape(message));
-				pnt += size;
-			} else {
-				size = sprintf(pnt, ", \"items\": [ ");
-				pnt += size;
-			}
+			json_property_header(context, "defSwitchVector", property, message, true);
 			for (int i = 0; i < property->count; i++) {
 				indigo_item *item = &property->items[i];
-				size = sprintf(pnt, "%s { \"name\": \"%s\", \"label\": \"%s\", \"value\": %s }",  i > 0 ? "," : "", item->name, escape(item->label), item->sw.value ? "true" : "false");
-				pnt += size;
+				json_printf(context, "%s { \"name\": ", i > 0 ? "," : "");
+				json_string(context, item->name);
+				json_key_string(context, "label", item->label);
+				json_printf(context, ", \"value\": %s }", item->sw.value ? "true" : "false");
 			}
-			size = sprintf(pnt, " ] } }");
-			size += pnt - output_buffer;
 			break;
 		case INDIGO_LIGHT_VECTOR:
-			size = sprintf(pnt, "{ \"defLightVector\": { \"version\": %d, \"device\": \"%s\", \"name\": \"%s\", \"group\": \"%s\", \"label\": \"%s\", \"state\": \"%s\"", property->version, property->device, property->name, property->group, escape(property->label), indigo_property_state_text[property->state]);
-			pnt += size;
-			if (message) {
-				size = sprintf(pnt, ", \"message\": \"%s\", \"items\": [ ", escape(message));
-				pnt += size;
-			} else {
-				size = sprintf(pnt, ", \"items\": [ ");
-				pnt += size;
-			}
+			json_property_header(context, "defLightVector", property, message, true);
 			for (int i = 0; i < property->count; i++) {
 				indigo_item *item = &property->items[i];
-				size = sprintf(pnt, "%s { \"name\": \"%s\", \"label\": \"%s\", \"value\": \"%s\" }",  i > 0 ? "," : "", item->name, escape(item->label), indigo_property_state_text[item->light.value]);
-				pnt += size;
+				json_printf(context, "%s { \"name\": ", i > 0 ? "," : "");
+				json_string(context, item->name);
+				json_key_string(context, "label", item->label);
+				json_printf(context, ", \"value\": \"%s\" }", indigo_property_state_text[item->light.value]);
 			}
-			size = sprintf(pnt, " ] } }");
-			size += pnt - output_buffer;
 			break;
 		case INDIGO_BLOB_VECTOR:
-			size = sprintf(pnt, "{ \"defBLOBVector\": { \"version\": %d, \"device\": \"%s\", \"name\": \"%s\", \"group\": \"%s\", \"label\": \"%s\", \"state\": \"%s\"", property->version, property->device, property->name, property->group, escape(property->label), indigo_property_state_text[property->state]);
-			pnt += size;
-			if (message) {
-				size = sprintf(pnt, ", \"message\": \"%s\", \"items\": [ ", escape(message));
-				pnt += size;
-			} else {
-				size = sprintf(pnt, ", \"items\": [ ");
-				pnt += size;
-			}
+			json_property_header(context, "defBLOBVector", property, message, true);
 			for (int i = 0; i < property->count; i++) {
 				indigo_item *item = &property->items[i];
-				size = sprintf(pnt, "%s { \"name\": \"%s\", \"label\": \"%s\" }", i > 0 ? "," : "", item->name, escape(item->label));
-				pnt += size;
+				json_printf(context, "%s { \"name\": ", i > 0 ? "," : "");
+				json_string(context, item->name);
+				json_key_string(context, "label", item->label);
+				json_printf(context, " }");
 			}
-			size = sprintf(pnt, " ] } }");
-			size += pnt - output_buffer;
 			break;
 	}
-	if (client_context->web_socket)
-		ws_write(handle, output_buffer, size);
-	else
-		indigo_write(handle, output_buffer, size);
-	INDIGO_TRACE_PROTOCOL(indigo_trace("%d ← %s\n", handle, output_buffer));
-	pthread_mutex_unlock(&json_mutex);
-	return INDIGO_OK;
+	json_printf(context, " ] } }");
+	return json_end_and_cache(context) ? INDIGO_OK : INDIGO_FAILED;
 }
 
 static indigo_result json_update_property(indigo_client *client, indigo_device *device, indigo_property *property, const char *message) {
@@ -208,118 +432,114 @@ static indigo_result json_update_property(indigo_client *client, indigo_device *
 		return INDIGO_OK;
 	if (client->version == INDIGO_VERSION_NONE)
 		return INDIGO_OK;
-	pthread_mutex_lock(&json_mutex);
-	indigo_adapter_context *client_context = (indigo_adapter_context *)client->client_context;
-	assert(client_context != NULL);
-	int handle = client_context->output;
-	char output_buffer[JSON_BUFFER_SIZE];
-	char *pnt = output_buffer;
-	int size;
+	bool binary = false;
+	if (property->type == INDIGO_BLOB_VECTOR) {
+		indigo_enable_blob_mode mode = json_blob_mode(client, property);
+		if (mode == INDIGO_ENABLE_BLOB_NEVER)
+			return INDIGO_OK;
+		// BLOB data are sent as binary WebSocket messages following the announcement, but only if previous
+		// ones were already consumed by the client, otherwise the frame is dropped and only URL is sent
+		indigo_adapter_context *client_context = (indigo_adapter_context *)client->client_context;
+		if (mode == INDIGO_ENABLE_BLOB_ALSO && client_context->web_socket_state != NULL && property->state == INDIGO_OK_STATE) {
+			if (indigo_unsent_bytes(client_context->output) <= JSON_BUFFER_SIZE)
+				binary = true;
+			else
+				INDIGO_DEBUG_PROTOCOL(indigo_debug("%d: client is slow, %s.%s dropped", client_context->output, property->device, property->name));
+		}
+	}
+	if (!binary && json_send_cached(client))
+		return INDIGO_OK;
+	json_adapter_context *context = json_begin(client);
+	if (context == NULL)
+		return INDIGO_FAILED;
+	json_blob_frame *frames = NULL;
+	if (binary) {
+		if (context->blob_frames != NULL || context->blob_busy || context->blob_terminate) {
+			INDIGO_DEBUG_PROTOCOL(indigo_debug("%d: previous BLOB still pending, %s.%s dropped", context->context.output, property->device, property->name));
+			binary = false;
+		} else if (!context->blob_thread_started) {
+			if (pthread_create(&context->blob_thread, NULL, (void *(*)(void *))json_blob_sender, context) == 0)
+				context->blob_thread_started = true;
+			else
+				binary = false;
+		}
+		if (binary && (frames = json_blob_frames(property)) == NULL)
+			binary = false;
+	}
 	switch (property->type) {
 		case INDIGO_TEXT_VECTOR:
-			size = sprintf(pnt, "{ \"setTextVector\": { \"device\": \"%s\", \"name\": \"%s\", \"state\": \"%s\"", property->device, property->name, indigo_property_state_text[property->state]);
-			pnt += size;
-			if (message) {
-				size = sprintf(pnt, ", \"message\": \"%s\", \"items\": [ ", message);
-				pnt += size;
-			} else {
-				size = sprintf(pnt, ", \"items\": [ ");
-				pnt += size;
-			}
+			json_property_header(context, "setTextVector", property, message, false);
 			for (int i = 0; i < property->count; i++) {
 				indigo_item *item = &property->items[i];
-				size = sprintf(pnt, "%s { \"name\": \"%s\", \"value\": \"%s\" }",  i > 0 ? "," : "", item->name, item->text.value);
-				pnt += size;
+				json_printf(context, "%s { \"name\": ", i > 0 ? "," : "");
+				json_string(context, item->name);
+				json_key_string(context, "value", item->text.value);
+				json_printf(context, " }");
 			}
-			size = sprintf(pnt, " ] } }");
-			size += pnt - output_buffer;
 			break;
 		case INDIGO_NUMBER_VECTOR:
-			size = sprintf(pnt, "{ \"setNumberVector\": { \"device\": \"%s\", \"name\": \"%s\", \"state\": \"%s\"", property->device, property->name, indigo_property_state_text[property->state]);
-			pnt += size;
-			if (message) {
-				size = sprintf(pnt, ", \"message\": \"%s\", \"items\": [ ", message);
-				pnt += size;
-			} else {
-				size = sprintf(pnt, ", \"items\": [ ");
-				pnt += size;
-			}
+			json_property_header(context, "setNumberVector", property, message, false);
 			for (int i = 0; i < property->count; i++) {
 				indigo_item *item = &property->items[i];
+				json_printf(context, "%s { \"name\": ", i > 0 ? "," : "");
+				json_string(context, item->name);
 				if (property->perm != INDIGO_RO_PERM)
-					size = sprintf(pnt, "%s { \"name\": \"%s\", \"target\": %.8g, \"value\": %.8g }",  i > 0 ? "," : "", item->name, item->number.target, item->number.value);
-				else
-					size = sprintf(pnt, "%s { \"name\": \"%s\", \"value\": %.8g }",  i > 0 ? "," : "", item->name, item->number.value);
-				pnt += size;
+					json_printf(context, ", \"target\": %.8g", item->number.target);
+				json_printf(context, ", \"value\": %.8g }", item->number.value);
 			}
-			size = sprintf(pnt, " ] } }");
-			size += pnt - output_buffer;
 			break;
 		case INDIGO_SWITCH_VECTOR:
-			size = sprintf(pnt, "{ \"setSwitchVector\": { \"device\": \"%s\", \"name\": \"%s\", \"state\": \"%s\"", property->device, property->name, indigo_property_state_text[property->state]);
-			pnt += size;
-			if (message) {
-				size = sprintf(pnt, ", \"message\": \"%s\", \"items\": [ ", message);
-				pnt += size;
-			} else {
-				size = sprintf(pnt, ", \"items\": [ ");
-				pnt += size;
-			}
+			json_property_header(context, "setSwitchVector", property, message, false);
 			for (int i = 0; i < property->count; i++) {
 				indigo_item *item = &property->items[i];
-				size = sprintf(pnt, "%s { \"name\": \"%s\", \"value\": %s }",  i > 0 ? "," : "", item->name, item->sw.value ? "true" : "false");
-				pnt += size;
+				json_printf(context, "%s { \"name\": ", i > 0 ? "," : "");
+				json_string(context, item->name);
+				json_printf(context, ", \"value\": %s }", item->sw.value ? "true" : "false");
 			}
-			size = sprintf(pnt, " ] } }");
-			size += pnt - output_buffer;
 			break;
 		case INDIGO_LIGHT_VECTOR:
-			size = sprintf(pnt, "{ \"setLightVector\": { \"device\": \"%s\", \"name\": \"%s\", \"state\": \"%s\"", property->device, property->name, indigo_property_state_text[property->state]);
-			pnt += size;
-			if (message) {
-				size = sprintf(pnt, ", \"message\": \"%s\", \"items\": [ ", message);
-				pnt += size;
-			} else {
-				size = sprintf(pnt, ", \"items\": [ ");
-				pnt += size;
-			}
+			json_property_header(context, "setLightVector", property, message, false);
 			for (int i = 0; i < property->count; i++) {
 				indigo_item *item = &property->items[i];
-				size = sprintf(pnt, "%s { \"name\": \"%s\", \"value\": \"%s\" }",  i > 0 ? "," : "", item->name, indigo_property_state_text[item->light.value]);
-				pnt += size;
+				json_printf(context, "%s { \"name\": ", i > 0 ? "," : "");
+				json_string(context, item->name);
+				json_printf(context, ", \"value\": \"%s\" }", indigo_property_state_text[item->light.value]);
 			}
-			size = sprintf(pnt, " ] } }");
-			size += pnt - output_buffer;
 			break;
 		case INDIGO_BLOB_VECTOR:
-			size = sprintf(pnt, "{ \"setBLOBVector\": { \"device\": \"%s\", \"name\": \"%s\", \"state\": \"%s\"", property->device, property->name, indigo_property_state_text[property->state]);
-			pnt += size;
-			if (message) {
-				size = sprintf(pnt, ", \"message\": \"%s\", \"items\": [ ", message);
-				pnt += size;
-			} else {
-				size = sprintf(pnt, ", \"items\": [ ");
-				pnt += size;
-			}
+			json_property_header(context, "setBLOBVector", property, message, false);
 			for (int i = 0; i < property->count; i++) {
 				indigo_item *item = &property->items[i];
-				if (property->state == INDIGO_OK_STATE)
-					size = sprintf(pnt, "%s { \"name\": \"%s\", \"value\": \"/blob/%p%s\" }", i > 0 ? "," : "", item->name, item, item->blob.format);
-				else
-					size = sprintf(pnt, "%s { \"name\": \"%s\" }", i > 0 ? "," : "", item->name);
-				pnt += size;
+				json_printf(context, "%s { \"name\": ", i > 0 ? "," : "");
+				json_string(context, item->name);
+				if (property->state == INDIGO_OK_STATE) {
+					json_printf(context, ", \"value\": \"/blob/%016llx%s\"", (unsigned long long)indigo_publish_blob(item, i), item->blob.format);
+					if (binary && item->blob.value != NULL && item->blob.size > 0) {
+						json_key_string(context, "format", item->blob.format);
+						json_printf(context, ", \"size\": %ld, \"binary\": true", item->blob.size);
+					}
+				}
+				json_printf(context, " }");
 			}
-			size = sprintf(pnt, " ] } }");
-			size += pnt - output_buffer;
 			break;
 	}
-	if (client_context->web_socket)
-		ws_write(handle, output_buffer, size);
-	else
-		indigo_write(handle, output_buffer, size);
-	INDIGO_TRACE_PROTOCOL(indigo_trace("%d ← %s\n", handle, output_buffer));
-	pthread_mutex_unlock(&json_mutex);
-	return INDIGO_OK;
+	json_printf(context, " ] } }");
+	if (binary) {
+		if (context->failed) {
+			while (frames) {
+				json_blob_frame *frame = frames;
+				frames = frame->next;
+				json_blob_frame_free(frame);
+			}
+			return json_end(context) ? INDIGO_OK : INDIGO_FAILED;
+		}
+		json_send(context, context->buffer, context->size);
+		context->blob_frames = frames;
+		pthread_cond_signal(&context->blob_cond);
+		json_release(context);
+		return INDIGO_OK;
+	}
+	return json_end_and_cache(context) ? INDIGO_OK : INDIGO_FAILED;
 }
 
 static indigo_result json_delete_property(indigo_client *client, indigo_device *device, indigo_property *property, const char *message) {
@@ -330,31 +550,20 @@ static indigo_result json_delete_property(indigo_client *client, indigo_device *
 		return INDIGO_OK;
 	if (client->version == INDIGO_VERSION_NONE)
 		return INDIGO_OK;
-	pthread_mutex_lock(&json_mutex);
-	indigo_adapter_context *client_context = (indigo_adapter_context *)client->client_context;
-	assert(client_context != NULL);
-	int handle = client_context->output;
-	char output_buffer[JSON_BUFFER_SIZE];
-	char *pnt = output_buffer;
-	int size;
-	if (*property->name == 0)
-		size = sprintf(pnt, "{ \"deleteProperty\": { \"device\": \"%s\"", device->name);
-	else
-		size = sprintf(pnt, "{ \"deleteProperty\": { \"device\": \"%s\", \"name\": \"%s\"", property->device, property->name);
-	pnt += size;
-	if (message) {
-		size = sprintf(pnt, ", \"message\": \"%s\" } }", message);
+	json_adapter_context *context = json_begin(client);
+	if (context == NULL)
+		return INDIGO_FAILED;
+	json_printf(context, "{ \"deleteProperty\": { \"device\": ");
+	if (*property->name == 0) {
+		json_string(context, device->name);
 	} else {
-		size = sprintf(pnt, " } }");
+		json_string(context, property->device);
+		json_key_string(context, "name", property->name);
 	}
-	size += pnt - output_buffer;
-	if (client_context->web_socket)
-		ws_write(handle, output_buffer, size);
-	else
-		indigo_write(handle, output_buffer, size);
-	INDIGO_TRACE_PROTOCOL(indigo_trace("%d ← %s\n", handle, output_buffer));
-	pthread_mutex_unlock(&json_mutex);
-	return INDIGO_OK;
+	if (message)
+		json_key_string(context, "message", message);
+	json_printf(context, " } }");
+	return json_end(context) ? INDIGO_OK : INDIGO_FAILED;
 }
 
 static indigo_result json_message_property(indigo_client *client, indigo_device *device, const char *message) {
@@ -362,31 +571,36 @@ static indigo_result json_message_property(indigo_client *client, indigo_device
 	assert(client != NULL);
 	if (!indigo_reshare_remote_devices && device->is_remote)
 		return INDIGO_OK;
-	pthread_mutex_lock(&json_mutex);
-	indigo_adapter_context *client_context = (indigo_adapter_context *)client->client_context;
-	assert(client_context != NULL);
-	int handle = client_context->output;
-	char output_buffer[JSON_BUFFER_SIZE];
-	char *pnt = output_buffer;
-	int size = sprintf(pnt, "{ \"message\": \"%s\" }", message);
-	if (client_context->web_socket)
-		ws_write(handle, output_buffer, size);
-	else
-		indigo_write(handle, output_buffer, size);
-	INDIGO_TRACE_PROTOCOL(indigo_trace("%d ← %s\n", handle, output_buffer));
-	pthread_mutex_unlock(&json_mutex);
-	return INDIGO_OK;
+	json_adapter_context *context = json_begin(client);
+	if (context == NULL)
+		return INDIGO_FAILED;
+	json_printf(context, "{ \"message\": ");
+	json_string(context, message);
+	json_printf(context, " }");
+	return json_end(context) ? INDIGO_OK : INDIGO_FAILED;
 }
 
 static indigo_result json_detach(indigo_client *client) {
 	assert(client != NULL);
 	indigo_adapter_context *client_context = (indigo_adapter_context *)client->client_context;
+	json_blob_sender_stop((json_adapter_context *)client_context);
 	close(client_context->input);
 	close(client_context->output);
 	return INDIGO_OK;
 }
 
+indigo_client *indigo_json_web_socket_device_adapter(int input, int ouput, const char *offer, char *response, int size) {
+	indigo_client *client = indigo_json_device_adapter(input, ouput, false);
+	indigo_adapter_context *client_context = (indigo_adapter_context *)client->client_context;
+	client_context->web_socket = true;
+	client_context->web_socket_state = indigo_web_socket_create(input, ouput, offer, response, size);
+	assert(client_context->web_socket_state != NULL);
+	return client;
+}
+
 indigo_client *indigo_json_device_adapter(int input, int ouput, bool web_socket) {
+	if (web_socket)
+		return indigo_json_web_socket_device_adapter(input, ouput, NULL, NULL, 0);
 	static indigo_client client_template = {
 		"", false, NULL, INDIGO_OK, INDIGO_VERSION_CURRENT, NULL,
 		NULL,
@@ -400,11 +614,15 @@ indigo_client *indigo_json_device_adapter(int input, int ouput, bool web_socket)
 	indigo_client *client = malloc(sizeof(indigo_client));
 	assert(client != NULL);
 	memcpy(client, &client_template, sizeof(indigo_client));
-	indigo_adapter_context *client_context = malloc(sizeof(indigo_adapter_context));
+	json_adapter_context *client_context = malloc(sizeof(json_adapter_context));
 	assert(client_context != NULL);
-	client_context->input = input;
-	client_context->output = ouput;
-	client_context->web_socket = web_socket;
+	memset(client_context, 0, sizeof(json_adapter_context));
+	client_context->context.input = input;
+	client_context->context.output = ouput;
+	client_context->context.web_socket = web_socket;
+	client_context->context.metrics = indigo_metrics_client_open("json", ouput);
+	pthread_mutex_init(&client_context->mutex, NULL);
+	pthread_cond_init(&client_context->blob_cond, NULL);
 	client->client_context = client_context;
 	client->is_remote = input == ouput;
 	indigo_enable_blob_mode_record *record = (indigo_enable_blob_mode_record *)malloc(sizeof(indigo_enable_blob_mode_record));
@@ -423,6 +641,13 @@ void indigo_release_json_device_adapter(indigo_client *client) {
 		record = record->next;
 		free(tmp);
 	}
-	free(client->client_context);
+	json_adapter_context *client_context = (json_adapter_context *)client->client_context;
+	json_blob_sender_stop(client_context);
+	indigo_web_socket_release(client_context->context.web_socket_state);
+	indigo_metrics_client_close(client_context->context.metrics);
+	pthread_mutex_destroy(&client_context->mutex);
+	pthread_cond_destroy(&client_context->blob_cond);
+	free(client_context->buffer);
+	free(client_context);
 	free(client);
 }
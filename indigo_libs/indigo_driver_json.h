@@ -36,6 +36,13 @@ extern "C" {
 /** Create initialized instance of JSON wire protocol device side adapter.
  */
 extern indigo_client *indigo_json_device_adapter(int input, int ouput, bool web_socket);
+
+/** Create initialized instance of JSON wire protocol device side adapter over WebSocket, extensions offered by client are negotiated and accepted ones are stored to response (empty if none).
+ */
+extern indigo_client *indigo_json_web_socket_device_adapter(int input, int ouput, const char *offer, char *response, int size);
+
+/** Release JSON wire protocol device side adapter.
+ */
 extern void indigo_release_json_device_adapter(indigo_client *client);
 
 #ifdef __cplusplus
@@ -48,14 +48,113 @@
 #include "indigo_xml.h"
 #include "indigo_io.h"
 #include "indigo_base64.h"
+#include "indigo_metrics.h"
 #include "indigo_version.h"
 #include "indigo_driver_xml.h"
 
 #define RAW_BUF_SIZE 98304
 #define BASE64_BUF_SIZE 131072  /* BASE64_BUF_SIZE >= (RAW_BUF_SIZE + 2) / 3 * 4 */
 
+#define XML_BUFFER_SIZE	4096
+#define XML_ADAPTER_ID	'X'
+#define SHM_ADAPTER_ID	'M'
+
 static pthread_mutex_t write_mutex = PTHREAD_MUTEX_INITIALIZER;
 
+// message is encoded into single buffer (protected by write_mutex) and written at once,
+// encoded message is shared with other XML clients of the same version during broadcast
+
+static char *xml_buffer = NULL;
+static long xml_buffer_size = 0;
+static long xml_buffer_capacity = 0;
+
+static void xml_printf(const char *format, ...) {
+	while (true) {
+		long available = xml_buffer_capacity - xml_buffer_size;
+		va_list args;
+		va_start(args, format);
+		int length = vsnprintf(xml_buffer ? xml_buffer + xml_buffer_size : NULL, available, format, args);
+		va_end(args);
+		if (length < 0)
+			return;
+		if (length < available) {
+			xml_buffer_size += length;
+			return;
+		}
+		long capacity = xml_buffer_capacity ? xml_buffer_capacity : XML_BUFFER_SIZE;
+		while (capacity <= xml_buffer_size + length)
+			capacity *= 2;
+		char *buffer = realloc(xml_buffer, capacity);
+		if (buffer == NULL)
+			return;
+		xml_buffer = buffer;
+		xml_buffer_capacity = capacity;
+	}
+}
+
+static bool xml_write(indigo_adapter_context *context, const char *data, long size) {
+	int handle = context->output;
+	INDIGO_TRACE_PROTOCOL(indigo_trace("%d ← %.*s", handle, (int)(size > 0 && data[size - 1] == '\n' ? size - 1 : size), data));
+	uint64_t start = indigo_metrics_now();
+	bool result = indigo_write(handle, data, size);
+	indigo_metrics_client_write(context->metrics, size, indigo_metrics_now() - start, indigo_unsent_bytes(handle));
+	return result;
+}
+
+static void xml_flush(indigo_adapter_context *context) {
+	if (xml_buffer_size > 0)
+		xml_write(context, xml_buffer, xml_buffer_size);
+	xml_buffer_size = 0;
+}
+
+static void xml_flush_with_descriptor(indigo_adapter_context *context, int descriptor) {
+	int handle = context->output;
+	INDIGO_TRACE_PROTOCOL(indigo_trace("%d ← %.*s [descriptor %d]", handle, (int)(xml_buffer_size > 0 && xml_buffer[xml_buffer_size - 1] == '\n' ? xml_buffer_size - 1 : xml_buffer_size), xml_buffer, descriptor));
+	uint64_t start = indigo_metrics_now();
+	indigo_write_with_descriptor(handle, xml_buffer, xml_buffer_size, descriptor);
+	indigo_metrics_client_write(context->metrics, xml_buffer_size, indigo_metrics_now() - start, indigo_unsent_bytes(handle));
+	xml_buffer_size = 0;
+}
+
+// BLOB item is copied to sealed shared memory object once per broadcast, the same descriptor is passed to all local clients
+
+static indigo_shared_message *xml_shared_blob(indigo_item *item, int index) {
+	uint32_t key = INDIGO_BROADCAST_KEY(SHM_ADAPTER_ID, 0, index);
+	indigo_shared_message *shared = indigo_broadcast_cache_get(key);
+	if (shared == NULL) {
+		int descriptor = indigo_shm_create(item->blob.value, item->blob.size);
+		if (descriptor < 0)
+			return NULL;
+		shared = indigo_shared_message_create("", 0);
+		if (shared == NULL) {
+			close(descriptor);
+			return NULL;
+		}
+		shared->descriptor = descriptor;
+		indigo_broadcast_cache_put(key, shared);
+	}
+	return shared;
+}
+
+static bool xml_send_cached(indigo_adapter_context *context, uint32_t key) {
+	indigo_shared_message *shared = indigo_broadcast_cache_get(key);
+	if (shared == NULL)
+		return false;
+	xml_write(context, shared->data, shared->size);
+	indigo_shared_message_release(shared);
+	return true;
+}
+
+static void xml_send_and_cache(indigo_adapter_context *context, uint32_t key) {
+	if (xml_buffer_size > 0) {
+		xml_write(context, xml_buffer, xml_buffer_size);
+		indigo_shared_message *shared = indigo_shared_message_create(xml_buffer, xml_buffer_size);
+		indigo_broadcast_cache_put(key, shared);
+		indigo_shared_message_release(shared);
+	}
+	xml_buffer_size = 0;
+}
+
 static const char *message_attribute(const char *message) {
 	if (message) {
 		static char buffer[INDIGO_VALUE_SIZE];
@@ -76,52 +175,58 @@ static indigo_result xml_device_adapter_define_property(indigo_client *client, i
 	pthread_mutex_lock(&write_mutex);
 	indigo_adapter_context *client_context = (indigo_adapter_context *)client->client_context;
 	assert(client_context != NULL);
-	int handle = client_context->output;
+	uint32_t key = INDIGO_BROADCAST_KEY(XML_ADAPTER_ID, client->version, 0);
+	if (xml_send_cached(client_context, key)) {
+		pthread_mutex_unlock(&write_mutex);
+		return INDIGO_OK;
+	}
+	xml_buffer_size = 0;
 	switch (property->type) {
 	case INDIGO_TEXT_VECTOR:
-		indigo_printf(handle, "<defTextVector device='%s' name='%s' group='%s' label='%s' perm='%s' state='%s'%s>\n", indigo_xml_escape(property->device), indigo_property_name(client->version, property), indigo_xml_escape(property->group), indigo_xml_escape(property->label), indigo_property_perm_text[property->perm], indigo_property_state_text[property->state], message_attribute(message));
+		xml_printf("<defTextVector device='%s' name='%s' group='%s' label='%s' perm='%s' state='%s'%s>\n", indigo_xml_escape(property->device), indigo_property_name(client->version, property), indigo_xml_escape(property->group), indigo_xml_escape(property->label), indigo_property_perm_text[property->perm], indigo_property_state_text[property->state], message_attribute(message));
 		for (int i = 0; i < property->count; i++) {
 			indigo_item *item = &property->items[i];
-			indigo_printf(handle, "<defText name='%s' label='%s'>%s</defText>\n", indigo_item_name(client->version, property, item), item->label, item->text.value);
+			xml_printf("<defText name='%s' label='%s'>%s</defText>\n", indigo_item_name(client->version, property, item), item->label, item->text.value);
 		}
-		indigo_printf(handle, "</defTextVector>\n");
+		xml_printf("</defTextVector>\n");
 		break;
 	case INDIGO_NUMBER_VECTOR:
-		indigo_printf(handle, "<defNumberVector device='%s' name='%s' group='%s' label='%s' perm='%s' state='%s'%s>\n", indigo_xml_escape(property->device), indigo_property_name(client->version, property), indigo_xml_escape(property->group), indigo_xml_escape(property->label), indigo_property_perm_text[property->perm], indigo_property_state_text[property->state], message_attribute(message));
+		xml_printf("<defNumberVector device='%s' name='%s' group='%s' label='%s' perm='%s' state='%s'%s>\n", indigo_xml_escape(property->device), indigo_property_name(client->version, property), indigo_xml_escape(property->group), indigo_xml_escape(property->label), indigo_property_perm_text[property->perm], indigo_property_state_text[property->state], message_attribute(message));
 		for (int i = 0; i < property->count; i++) {
 			indigo_item *item = &property->items[i];
 			if (client->version >= INDIGO_VERSION_2_0 && property->perm != INDIGO_RO_PERM)
-				indigo_printf(handle, "<defNumber name='%s' label='%s' format='%s' min='%.8g' max='%.8g' step='%.8g' target='%.8g'>%.8g</defNumber>\n", indigo_item_name(client->version, property, item), item->label, item->number.format, item->number.min, item->number.max, item->number.step, item->number.target, item->number.value);
+				xml_printf("<defNumber name='%s' label='%s' format='%s' min='%.8g' max='%.8g' step='%.8g' target='%.8g'>%.8g</defNumber>\n", indigo_item_name(client->version, property, item), item->label, item->number.format, item->number.min, item->number.max, item->number.step, item->number.target, item->number.value);
 			else
-				indigo_printf(handle, "<defNumber name='%s' label='%s' format='%s' min='%.8g' max='%.8g' step='%.8g'>%.8g</defNumber>\n", indigo_item_name(client->version, property, item), item->label, item->number.format, item->number.min, item->number.max, item->number.step, item->number.value);
+				xml_printf("<defNumber name='%s' label='%s' format='%s' min='%.8g' max='%.8g' step='%.8g'>%.8g</defNumber>\n", indigo_item_name(client->version, property, item), item->label, item->number.format, item->number.min, item->number.max, item->number.step, item->number.value);
 		}
-		indigo_printf(handle, "</defNumberVector>\n");
+		xml_printf("</defNumberVector>\n");
 		break;
 	case INDIGO_SWITCH_VECTOR:
-		indigo_printf(handle, "<defSwitchVector device='%s' name='%s' group='%s' label='%s' perm='%s' state='%s' rule='%s'%s>\n", indigo_xml_escape(property->device), indigo_property_name(client->version, property), indigo_xml_escape(property->group), indigo_xml_escape(property->label), indigo_property_perm_text[property->perm], indigo_property_state_text[property->state], indigo_switch_rule_text[property->rule], message_attribute(message));
+		xml_printf("<defSwitchVector device='%s' name='%s' group='%s' label='%s' perm='%s' state='%s' rule='%s'%s>\n", indigo_xml_escape(property->device), indigo_property_name(client->version, property), indigo_xml_escape(property->group), indigo_xml_escape(property->label), indigo_property_perm_text[property->perm], indigo_property_state_text[property->state], indigo_switch_rule_text[property->rule], message_attribute(message));
 		for (int i = 0; i < property->count; i++) {
 			indigo_item *item = &property->items[i];
-			indigo_printf(handle, "<defSwitch name='%s' label='%s'>%s</defSwitch>\n", indigo_item_name(client->version, property, item), item->label, item->sw.value ? "On" : "Off");
+			xml_printf("<defSwitch name='%s' label='%s'>%s</defSwitch>\n", indigo_item_name(client->version, property, item), item->label, item->sw.value ? "On" : "Off");
 		}
-		indigo_printf(handle, "</defSwitchVector>\n");
+		xml_printf("</defSwitchVector>\n");
 		break;
 	case INDIGO_LIGHT_VECTOR:
-		indigo_printf(handle, "<defLightVector device='%s' name='%s' group='%s' label='%s' perm='%s' state='%s'%s>\n", indigo_xml_escape(property->device), indigo_property_name(client->version, property), indigo_xml_escape(property->group), indigo_xml_escape(property->label), indigo_property_perm_text[property->perm], indigo_property_state_text[property->state], message_attribute(message));
+		xml_printf("<defLightVector device='%s' name='%s' group='%s' label='%s' perm='%s' state='%s'%s>\n", indigo_xml_escape(property->device), indigo_property_name(client->version, property), indigo_xml_escape(property->group), indigo_xml_escape(property->label), indigo_property_perm_text[property->perm], indigo_property_state_text[property->state], message_attribute(message));
 		for (int i = 0; i < property->count; i++) {
 			indigo_item *item = &property->items[i];
-			indigo_printf(handle, " <defLight name='%s' label='%s'>%s</defLight>\n", indigo_item_name(client->version, property, item), item->label, indigo_property_state_text[item->light.value]);
+			xml_printf(" <defLight name='%s' label='%s'>%s</defLight>\n", indigo_item_name(client->version, property, item), item->label, indigo_property_state_text[item->light.value]);
 		}
-		indigo_printf(handle, "</defLightVector>\n");
+		xml_printf("</defLightVector>\n");
 		break;
 	case INDIGO_BLOB_VECTOR:
-		indigo_printf(handle, "<defBLOBVector device='%s' name='%s' group='%s' label='%s' perm='%s' state='%s'%s>\n", indigo_xml_escape(property->device), indigo_property_name(client->version, property), indigo_xml_escape(property->group), indigo_xml_escape(property->label), indigo_property_perm_text[property->perm], indigo_property_state_text[property->state], message_attribute(message));
+		xml_printf("<defBLOBVector device='%s' name='%s' group='%s' label='%s' perm='%s' state='%s'%s>\n", indigo_xml_escape(property->device), indigo_property_name(client->version, property), indigo_xml_escape(property->group), indigo_xml_escape(property->label), indigo_property_perm_text[property->perm], indigo_property_state_text[property->state], message_attribute(message));
 		for (int i = 0; i < property->count; i++) {
 			indigo_item *item = &property->items[i];
-			indigo_printf(handle, "<defBLOB name='%s' label='%s'/>\n", indigo_item_name(client->version, property, item), item->label);
+			xml_printf("<defBLOB name='%s' label='%s'/>\n", indigo_item_name(client->version, property, item), item->label);
 		}
-		indigo_printf(handle, "</defBLOBVector>\n");
+		xml_printf("</defBLOBVector>\n");
 		break;
 	}
+	xml_send_and_cache(client_context, key);
 	pthread_mutex_unlock(&write_mutex);
 	return INDIGO_OK;
 }
@@ -140,100 +245,135 @@ static indigo_result xml_device_adapter_update_property(indigo_client *client, i
 	indigo_adapter_context *client_context = (indigo_adapter_context *)client->client_context;
 	assert(client_context != NULL);
 	int handle = client_context->output;
+	indigo_enable_blob_mode mode = INDIGO_ENABLE_BLOB_NEVER;
+	if (property->type == INDIGO_BLOB_VECTOR) {
+		indigo_enable_blob_mode_record *record = client->enable_blob_mode_records;
+		while (record) {
+			if ((*record->device == 0 || !strcmp(property->device, record->device)) && (*record->name == 0 || !strcmp(property->name, record->name))) {
+				mode = record->mode;
+				break;
+			}
+			record = record->next;
+		}
+		if (mode == INDIGO_ENABLE_BLOB_NEVER) {
+			pthread_mutex_unlock(&write_mutex);
+			return INDIGO_OK;
+		}
+	}
+	// inline BLOB data are streamed and never cached
+	bool cacheable = mode != INDIGO_ENABLE_BLOB_ALSO || property->state != INDIGO_OK_STATE;
+	uint32_t key = INDIGO_BROADCAST_KEY(XML_ADAPTER_ID, client->version, mode);
+	if (cacheable && xml_send_cached(client_context, key)) {
+		pthread_mutex_unlock(&write_mutex);
+		return INDIGO_OK;
+	}
+	xml_buffer_size = 0;
 	switch (property->type) {
 		case INDIGO_TEXT_VECTOR:
-			indigo_printf(handle, "<setTextVector device='%s' name='%s' state='%s'%s>\n", indigo_xml_escape(property->device), indigo_property_name(client->version, property), indigo_property_state_text[property->state], message_attribute(message));
+			xml_printf("<setTextVector device='%s' name='%s' state='%s'%s>\n", indigo_xml_escape(property->device), indigo_property_name(client->version, property), indigo_property_state_text[property->state], message_attribute(message));
 			for (int i = 0; i < property->count; i++) {
 				indigo_item *item = &property->items[i];
-				indigo_printf(handle, "<oneText name='%s'>%s</oneText>\n", indigo_item_name(client->version, property, item), indigo_xml_escape(item->text.value));
+				xml_printf("<oneText name='%s'>%s</oneText>\n", indigo_item_name(client->version, property, item), indigo_xml_escape(item->text.value));
 			}
-			indigo_printf(handle, "</setTextVector>\n");
+			xml_printf("</setTextVector>\n");
 			break;
 		case INDIGO_NUMBER_VECTOR:
-			indigo_printf(handle, "<setNumberVector device='%s' name='%s' state='%s'%s>\n", indigo_xml_escape(property->device), indigo_property_name(client->version, property), indigo_property_state_text[property->state], message_attribute(message));
+			xml_printf("<setNumberVector device='%s' name='%s' state='%s'%s>\n", indigo_xml_escape(property->device), indigo_property_name(client->version, property), indigo_property_state_text[property->state], message_attribute(message));
 			for (int i = 0; i < property->count; i++) {
 				indigo_item *item = &property->items[i];
 				if (client->version >= INDIGO_VERSION_2_0 && property->perm != INDIGO_RO_PERM)
-					indigo_printf(handle, "<oneNumber name='%s' target='%.10g'>%.8g</oneNumber>\n", indigo_item_name(client->version, property, item), item->number.target, item->number.value);
+					xml_printf("<oneNumber name='%s' target='%.10g'>%.8g</oneNumber>\n", indigo_item_name(client->version, property, item), item->number.target, item->number.value);
 				else
-					indigo_printf(handle, "<oneNumber name='%s'>%.8g</oneNumber>\n", indigo_item_name(client->version, property, item), item->number.value);
+					xml_printf("<oneNumber name='%s'>%.8g</oneNumber>\n", indigo_item_name(client->version, property, item), item->number.value);
 			}
-			indigo_printf(handle, "</setNumberVector>\n");
+			xml_printf("</setNumberVector>\n");
 			break;
 		case INDIGO_SWITCH_VECTOR:
-			indigo_printf(handle, "<setSwitchVector device='%s' name='%s' state='%s'%s>\n", indigo_xml_escape(property->device), indigo_property_name(client->version, property), indigo_property_state_text[property->state], message_attribute(message));
+			xml_printf("<setSwitchVector device='%s' name='%s' state='%s'%s>\n", indigo_xml_escape(property->device), indigo_property_name(client->version, property), indigo_property_state_text[property->state], message_attribute(message));
 			for (int i = 0; i < property->count; i++) {
 				indigo_item *item = &property->items[i];
-				indigo_printf(handle, "<oneSwitch name='%s'>%s</oneSwitch>\n", indigo_item_name(client->version, property, item), item->sw.value ? "On" : "Off");
+				xml_printf("<oneSwitch name='%s'>%s</oneSwitch>\n", indigo_item_name(client->version, property, item), item->sw.value ? "On" : "Off");
 			}
-			indigo_printf(handle, "</setSwitchVector>\n");
+			xml_printf("</setSwitchVector>\n");
 			break;
 		case INDIGO_LIGHT_VECTOR:
-			indigo_printf(handle, "<setLightVector device='%s' name='%s' state='%s'%s>\n", indigo_xml_escape(property->device), indigo_property_name(client->version, property), indigo_property_state_text[property->state], message_attribute(message));
+			xml_printf("<setLightVector device='%s' name='%s' state='%s'%s>\n", indigo_xml_escape(property->device), indigo_property_name(client->version, property), indigo_property_state_text[property->state], message_attribute(message));
 			for (int i = 0; i < property->count; i++) {
 				indigo_item *item = &property->items[i];
-				indigo_printf(handle, "<oneLight name='%s'>%s</oneLight>\n", indigo_item_name(client->version, property, item), indigo_property_state_text[item->light.value]);
+				xml_printf("<oneLight name='%s'>%s</oneLight>\n", indigo_item_name(client->version, property, item), indigo_property_state_text[item->light.value]);
 			}
-			indigo_printf(handle, "</setLightVector>\n");
+			xml_printf("</setLightVector>\n");
 			break;
 		case INDIGO_BLOB_VECTOR: {
-			indigo_enable_blob_mode mode = INDIGO_ENABLE_BLOB_NEVER;
-			indigo_enable_blob_mode_record *record = client->enable_blob_mode_records;
-			while (record) {
-				if ((*record->device == 0 || !strcmp(property->device, record->device)) && (*record->name == 0 || !strcmp(property->name, record->name))) {
-					mode = record->mode;
-					break;
-				}
-				record = record->next;
-			}
 			if (mode != INDIGO_ENABLE_BLOB_NEVER) {
-				indigo_printf(handle, "<setBLOBVector device='%s' name='%s' state='%s'%s>\n", indigo_xml_escape(property->device), indigo_property_name(client->version, property), indigo_property_state_text[property->state], message_attribute(message));
+				xml_printf("<setBLOBVector device='%s' name='%s' state='%s'%s>\n", indigo_xml_escape(property->device), indigo_property_name(client->version, property), indigo_property_state_text[property->state], message_attribute(message));
 				if (property->state == INDIGO_OK_STATE) {
 					for (int i = 0; i < property->count; i++) {
 						indigo_item *item = &property->items[i];
+						indigo_shared_message *shared;
 						long input_length = item->blob.size;
 						unsigned char *data = item->blob.value;
 						if (mode == INDIGO_ENABLE_BLOB_URL) {
 							if (*item->blob.url == 0)
-								indigo_printf(handle, "<oneBLOB name='%s' path='/blob/%p%s'/>\n", indigo_item_name(client->version, property, item), item, item->blob.format);
+								xml_printf("<oneBLOB name='%s' path='/blob/%016llx%s'/>\n", indigo_item_name(client->version, property, item), (unsigned long long)indigo_publish_blob(item, i), item->blob.format);
 							else
-								indigo_printf(handle, "<oneBLOB name='%s' url='%s'/>\n", indigo_item_name(client->version, property, item), item->blob.url);
+								xml_printf("<oneBLOB name='%s' url='%s'/>\n", indigo_item_name(client->version, property, item), item->blob.url);
+						} else if (client_context->shared_memory && item->blob.value != NULL && item->blob.size > 0 && (shared = xml_shared_blob(item, i)) != NULL) {
+							xml_printf("<oneBLOB name='%s' format='%s' size='%ld' shm='1'/>\n", indigo_item_name(client->version, property, item), item->blob.format, item->blob.size);
+							xml_flush_with_descriptor(client_context, shared->descriptor);
+							indigo_shared_message_release(shared);
 						} else {
-							indigo_printf(handle, "<oneBLOB name='%s' format='%s' size='%ld'>\n", indigo_item_name(client->version, property, item), item->blob.format, item->blob.size);
+							xml_printf("<oneBLOB name='%s' format='%s' size='%ld'>\n", indigo_item_name(client->version, property, item), item->blob.format, item->blob.size);
+							xml_flush(client_context);
 							handle2 = dup(handle);
 							fh = fdopen(handle2, "w");
+							uint64_t start = indigo_metrics_now(), encoding = 0;
+							long sent = 0;
 							if (client->version >= INDIGO_VERSION_2_0) {
 								while (input_length) {
 									char encoded_data[BASE64_BUF_SIZE + 1];
 									long len = (RAW_BUF_SIZE < input_length) ?  RAW_BUF_SIZE : input_length;
+									uint64_t encoding_start = indigo_metrics_now();
 									long enclen = base64_encode((unsigned char*)encoded_data, (unsigned char*)data, len);
+									encoding += indigo_metrics_now() - encoding_start;
 									fwrite(encoded_data, 1, enclen, fh);
+									sent += enclen;
 									input_length -= len;
 									data += len;
 								}
 							} else {
 								static char encoded_data[74];
+								uint64_t encoding_start = indigo_metrics_now();
 								while (input_length) {
 									/* 54 raw = 72 encoded */
 									long len = (54 < input_length) ?  54 : input_length;
 									long enclen = base64_encode((unsigned char*)encoded_data, (unsigned char*)data, len);
 									encoded_data[enclen] = '\n';
 									fwrite(encoded_data, 1, enclen, fh);
+									sent += enclen;
 									input_length -= len;
 									data += len;
 								}
+								// encoding and buffered writes are interleaved line by line, measured together
+								encoding = indigo_metrics_now() - encoding_start;
 							}
 							fflush(fh);
 							fclose(fh);
-							indigo_printf(handle, "</oneBLOB>\n");
+							indigo_histogram_record(&indigo_blob_encode_histogram, encoding);
+							indigo_metrics_client_write(client_context->metrics, sent, indigo_metrics_now() - start, indigo_unsent_bytes(handle));
+							xml_printf("</oneBLOB>\n");
 						}
 					}
 				}
-				indigo_printf(handle, "</setBLOBVector>\n");
+				xml_printf("</setBLOBVector>\n");
 			}
 			break;
 		}
 	}
+	if (cacheable)
+		xml_send_and_cache(client_context, key);
+	else
+		xml_flush(client_context);
 	pthread_mutex_unlock(&write_mutex);
 	return INDIGO_OK;
 }
@@ -292,6 +432,9 @@ indigo_client *indigo_xml_device_adapter(int input, int ouput) {
 	assert(client_context != NULL);
 	client_context->input = input;
 	client_context->output = ouput;
+	client_context->web_socket_state = NULL;
+	client_context->shared_memory = false;
+	client_context->metrics = indigo_metrics_client_open("xml", ouput);
 	client->client_context = client_context;
 	client->is_remote = input == ouput;
 	return client;
@@ -300,6 +443,7 @@ indigo_client *indigo_xml_device_adapter(int input, int ouput) {
 void indigo_release_xml_device_adapter(indigo_client *client) {
 	assert(client != NULL);
 	assert(client->client_context != NULL);
+	indigo_metrics_client_close(((indigo_adapter_context *)client->client_context)->metrics);
 	free(client->client_context);
 	free(client);
 }
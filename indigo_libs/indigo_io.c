@@ -24,10 +24,15 @@
  \file indigo_io.c
  */
 
+#if defined(INDIGO_LINUX)
+#define _GNU_SOURCE
+#endif
+
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 #include <stdarg.h>
+#include <assert.h>
 #include <fcntl.h>
 #include <errno.h>
 #include <pthread.h>
@@ -35,10 +40,19 @@
 #if defined(INDIGO_LINUX) || defined(INDIGO_MACOS)
 #include <unistd.h>
 #include <termios.h>
+#include <sys/time.h>
+#include <sys/select.h>
 #include <netdb.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
+#include <sys/ioctl.h>
+#include <sys/un.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+#if defined(INDIGO_LINUX)
+#include <linux/sockios.h>
 #endif
 
 #if defined(INDIGO_WINDOWS)
@@ -50,6 +64,8 @@
 #include "indigo_bus.h"
 #include "indigo_io.h"
 
+#define IO_BUFFER_SIZE	1024
+
 #if defined(INDIGO_LINUX) || defined(INDIGO_MACOS)
 
 int indigo_open_serial(const char *dev_file) {
@@ -119,6 +135,173 @@ int indigo_open_tcp(const char *host, int port) {
 	return sock;
 }
 
+#if defined(INDIGO_LINUX) || defined(INDIGO_MACOS)
+
+int indigo_open_local(const char *path) {
+	struct sockaddr_un address;
+	if (strlen(path) >= sizeof(address.sun_path)) {
+		errno = ENAMETOOLONG;
+		return -1;
+	}
+	int sock = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (sock == -1)
+		return -1;
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	strcpy(address.sun_path, path);
+	if (connect(sock, (struct sockaddr *)&address, sizeof(address)) < 0) {
+		close(sock);
+		return -1;
+	}
+	return sock;
+}
+
+bool indigo_is_local_socket(int handle) {
+	struct sockaddr_storage address;
+	socklen_t length = sizeof(address);
+	if (getsockname(handle, (struct sockaddr *)&address, &length) < 0)
+		return false;
+	return address.ss_family == AF_UNIX;
+}
+
+int indigo_shm_create(const void *data, long size) {
+	int handle;
+#if defined(MFD_ALLOW_SEALING)
+	handle = memfd_create("indigo_blob", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+#else
+	static volatile int counter = 0;
+	char name[32];
+	snprintf(name, sizeof(name), "/indigo.%d.%d", getpid(), __sync_fetch_and_add(&counter, 1));
+	handle = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+	if (handle >= 0)
+		shm_unlink(name);
+#endif
+	if (handle < 0)
+		return -1;
+	if (size > 0) {
+		if (ftruncate(handle, size) < 0) {
+			close(handle);
+			return -1;
+		}
+		void *mapping = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, handle, 0);
+		if (mapping == MAP_FAILED) {
+			close(handle);
+			return -1;
+		}
+		memcpy(mapping, data, size);
+		munmap(mapping, size);
+	}
+#if defined(MFD_ALLOW_SEALING)
+	// receivers can't modify or resize the data while other clients may still read them
+	fcntl(handle, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL);
+#endif
+	return handle;
+}
+
+void *indigo_shm_map(int descriptor, long size) {
+	// peer can't be trusted, short or shrinkable object would fault on access and writable one could change while being read
+	void *mapping = NULL;
+	struct stat info;
+	if (size <= 0 || fstat(descriptor, &info) < 0 || info.st_size < size) {
+		errno = EINVAL;
+#if defined(MFD_ALLOW_SEALING)
+	} else if ((fcntl(descriptor, F_GET_SEALS) & (F_SEAL_SHRINK | F_SEAL_WRITE)) != (F_SEAL_SHRINK | F_SEAL_WRITE)) {
+		errno = EPERM;
+#endif
+	} else if ((mapping = mmap(NULL, size, PROT_READ, MAP_SHARED, descriptor, 0)) == MAP_FAILED) {
+		mapping = NULL;
+	}
+	int error = errno;
+	close(descriptor);
+	errno = error;
+	return mapping;
+}
+
+bool indigo_write_with_descriptor(int handle, const char *buffer, long length, int descriptor) {
+	char control[CMSG_SPACE(sizeof(int))];
+	memset(control, 0, sizeof(control));
+	struct iovec vector = { (void *)buffer, length };
+	struct msghdr message = { 0 };
+	message.msg_iov = &vector;
+	message.msg_iovlen = 1;
+	message.msg_control = control;
+	message.msg_controllen = sizeof(control);
+	struct cmsghdr *header = CMSG_FIRSTHDR(&message);
+	header->cmsg_level = SOL_SOCKET;
+	header->cmsg_type = SCM_RIGHTS;
+	header->cmsg_len = CMSG_LEN(sizeof(int));
+	memcpy(CMSG_DATA(header), &descriptor, sizeof(int));
+	ssize_t bytes_written;
+	while ((bytes_written = sendmsg(handle, &message, 0)) < 0 && errno == EINTR)
+		;
+	if (bytes_written < 0)
+		return false;
+	// descriptor travels with the first chunk, the rest is plain data
+	return indigo_write(handle, buffer + bytes_written, length - bytes_written);
+}
+
+#define MAX_RECEIVED_DESCRIPTORS	8
+
+#if !defined(MSG_CMSG_CLOEXEC)
+#define MSG_CMSG_CLOEXEC	0
+#endif
+
+long indigo_read_with_descriptors(int handle, char *buffer, long length, int *descriptors, int *count, int max) {
+	char control[CMSG_SPACE(MAX_RECEIVED_DESCRIPTORS * sizeof(int))];
+	struct iovec vector = { buffer, length };
+	struct msghdr message = { 0 };
+	message.msg_iov = &vector;
+	message.msg_iovlen = 1;
+	message.msg_control = control;
+	message.msg_controllen = sizeof(control);
+	ssize_t bytes_read;
+	while ((bytes_read = recvmsg(handle, &message, MSG_CMSG_CLOEXEC)) < 0 && errno == EINTR)
+		;
+	for (struct cmsghdr *header = CMSG_FIRSTHDR(&message); bytes_read >= 0 && header != NULL; header = CMSG_NXTHDR(&message, header)) {
+		if (header->cmsg_level == SOL_SOCKET && header->cmsg_type == SCM_RIGHTS) {
+			int received = (int)((header->cmsg_len - CMSG_LEN(0)) / sizeof(int));
+			for (int i = 0; i < received; i++) {
+				int descriptor;
+				memcpy(&descriptor, CMSG_DATA(header) + i * sizeof(int), sizeof(int));
+				if (*count < max)
+					descriptors[(*count)++] = descriptor;
+				else
+					close(descriptor);
+			}
+		}
+	}
+	return bytes_read;
+}
+
+#else
+
+int indigo_open_local(const char *path) {
+	return -1;
+}
+
+bool indigo_is_local_socket(int handle) {
+	return false;
+}
+
+int indigo_shm_create(const void *data, long size) {
+	return -1;
+}
+
+void *indigo_shm_map(int descriptor, long size) {
+	close(descriptor);
+	return NULL;
+}
+
+bool indigo_write_with_descriptor(int handle, const char *buffer, long length, int descriptor) {
+	return false;
+}
+
+long indigo_read_with_descriptors(int handle, char *buffer, long length, int *descriptors, int *count, int max) {
+	return read(handle, buffer, length);
+}
+
+#endif
+
 int indigo_read(int handle, char *buffer, long length) {
 	long remains = length;
 	long total_bytes = 0;
@@ -194,3 +377,299 @@ int indigo_scanf(int handle, const char *format, ...) {
 	va_end(args);
 	return count;
 }
+
+#if defined(INDIGO_LINUX) || defined(INDIGO_MACOS)
+
+typedef struct {
+	int handle;
+	char buffer[IO_BUFFER_SIZE];
+	int start, end;
+} read_ahead_buffer;
+
+static int read_response(read_ahead_buffer *read_ahead, char *buffer, int max, char terminator, long timeout, long gap, bool read_ahead_allowed, bool *terminated) {
+	int index = 0;
+	*terminated = false;
+	while (index < max) {
+		if (read_ahead->start == read_ahead->end) {
+			fd_set readout;
+			FD_ZERO(&readout);
+			FD_SET(read_ahead->handle, &readout);
+			long wait = (index == 0 || gap <= 0) ? timeout : gap;
+			struct timeval tv;
+			tv.tv_sec = wait / 1000000L;
+			tv.tv_usec = wait % 1000000L;
+			long result = select(read_ahead->handle + 1, &readout, NULL, NULL, &tv);
+			if (result == 0)
+				break;
+			if (result < 0) {
+				if (errno == EINTR)
+					continue;
+				return -1;
+			}
+			// read ahead only if the following bytes belong to another response of the same batch
+			result = read(read_ahead->handle, read_ahead->buffer, terminator ? (read_ahead_allowed ? IO_BUFFER_SIZE : 1) : max - index);
+			if (result < 1) {
+				if (result == 0)
+					errno = ECONNRESET;
+				return -1;
+			}
+			read_ahead->start = 0;
+			read_ahead->end = (int)result;
+		}
+		char c = read_ahead->buffer[read_ahead->start++];
+		if (terminator && c == terminator) {
+			*terminated = true;
+			break;
+		}
+		buffer[index++] = c;
+	}
+	buffer[index] = 0;
+	return index;
+}
+
+bool indigo_drain(int handle) {
+	if (isatty(handle))
+		return tcflush(handle, TCIFLUSH) == 0;
+	char buffer[IO_BUFFER_SIZE];
+	while (true) {
+		long result = recv(handle, buffer, sizeof(buffer), MSG_DONTWAIT);
+		if (result > 0)
+			continue;
+		if (result == 0)
+			return false;
+		if (errno == EAGAIN || errno == EWOULDBLOCK)
+			return true;
+		if (errno != ENOTSOCK)
+			return false;
+		break;
+	}
+	// neither serial line nor socket, fall back to polling
+	while (true) {
+		fd_set readout;
+		FD_ZERO(&readout);
+		FD_SET(handle, &readout);
+		struct timeval tv = { 0, 0 };
+		long result = select(handle + 1, &readout, NULL, NULL, &tv);
+		if (result == 0)
+			return true;
+		if (result < 0 || read(handle, buffer, sizeof(buffer)) < 1)
+			return false;
+	}
+}
+
+long indigo_unsent_bytes(int handle) {
+	int pending = 0;
+#if defined(INDIGO_LINUX)
+	if (ioctl(handle, SIOCOUTQ, &pending) < 0)
+		pending = 0;
+#elif defined(INDIGO_MACOS)
+	socklen_t length = sizeof(pending);
+	if (getsockopt(handle, SOL_SOCKET, SO_NWRITE, &pending, &length) < 0)
+		pending = 0;
+#endif
+	return pending;
+}
+
+int indigo_read_response(int handle, char *buffer, int max, char terminator, long timeout) {
+	read_ahead_buffer read_ahead;
+	read_ahead.handle = handle;
+	read_ahead.start = read_ahead.end = 0;
+	bool terminated;
+	int length = read_response(&read_ahead, buffer, max, terminator, timeout, timeout, false, &terminated);
+	if (length >= 0)
+		INDIGO_TRACE_PROTOCOL(indigo_trace("%d → %s", handle, buffer));
+	return length;
+}
+
+bool indigo_execute_transactions(int handle, indigo_transaction *transactions, int count) {
+	char buffer[IO_BUFFER_SIZE];
+	long length = 0;
+	for (int i = 0; i < count; i++)
+		transactions[i].length = -1;
+	if (!indigo_drain(handle))
+		return false;
+	for (int i = 0; i < count; i++) {
+		const char *command = transactions[i].command;
+		if (command == NULL)
+			continue;
+		long command_length = strlen(command);
+		if (length + command_length > sizeof(buffer)) {
+			if (!indigo_write(handle, buffer, length))
+				return false;
+			length = 0;
+		}
+		if (command_length > sizeof(buffer)) {
+			if (!indigo_write(handle, command, command_length))
+				return false;
+		} else {
+			memcpy(buffer + length, command, command_length);
+			length += command_length;
+		}
+		INDIGO_TRACE_PROTOCOL(indigo_trace("%d ← %s", handle, command));
+	}
+	if (length > 0 && !indigo_write(handle, buffer, length))
+		return false;
+	read_ahead_buffer read_ahead;
+	read_ahead.handle = handle;
+	read_ahead.start = read_ahead.end = 0;
+	int last = -1;
+	for (int i = 0; i < count; i++)
+		if (transactions[i].response != NULL)
+			last = i;
+	for (int i = 0; i < count; i++) {
+		indigo_transaction *transaction = transactions + i;
+		transaction->terminated = false;
+		if (transaction->response == NULL) {
+			transaction->length = 0;
+			continue;
+		}
+		transaction->length = read_response(&read_ahead, transaction->response, transaction->max, transaction->terminator, transaction->timeout, transaction->gap, i < last, &transaction->terminated);
+		if (transaction->length < 0)
+			return false;
+		INDIGO_TRACE_PROTOCOL(indigo_trace("%d → %s", handle, transaction->response));
+	}
+	return true;
+}
+
+typedef struct port_request {
+	indigo_priority priority;
+	indigo_transaction *transactions;
+	int count;
+	bool done;
+	bool result;
+	struct port_request *leader;
+	struct port_request *next;
+} port_request;
+
+struct indigo_port {
+	int handle;
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	bool busy;
+	port_request *queue;
+	indigo_port_statistics statistics;
+};
+
+static bool same_transactions(port_request *request, port_request *other) {
+	if (request->count != other->count)
+		return false;
+	for (int i = 0; i < request->count; i++) {
+		indigo_transaction *transaction = request->transactions + i;
+		indigo_transaction *other_transaction = other->transactions + i;
+		if (transaction->command == NULL || other_transaction->command == NULL || strcmp(transaction->command, other_transaction->command))
+			return false;
+		if ((transaction->response == NULL) != (other_transaction->response == NULL) || transaction->terminator != other_transaction->terminator)
+			return false;
+	}
+	return true;
+}
+
+static port_request *next_request(indigo_port *port) {
+	port_request *next = NULL;
+	for (port_request *request = port->queue; request; request = request->next) {
+		if (request->leader == NULL && (next == NULL || request->priority > next->priority))
+			next = request;
+	}
+	return next;
+}
+
+static void dequeue_request(indigo_port *port, port_request *request) {
+	port_request **link = &port->queue;
+	while (*link) {
+		if (*link == request) {
+			*link = request->next;
+			break;
+		}
+		link = &(*link)->next;
+	}
+}
+
+indigo_port *indigo_port_open(int handle) {
+	indigo_port *port = malloc(sizeof(indigo_port));
+	assert(port != NULL);
+	memset(port, 0, sizeof(indigo_port));
+	port->handle = handle;
+	pthread_mutex_init(&port->mutex, NULL);
+	pthread_cond_init(&port->cond, NULL);
+	return port;
+}
+
+void indigo_port_close(indigo_port *port) {
+	if (port == NULL)
+		return;
+	close(port->handle);
+	pthread_cond_destroy(&port->cond);
+	pthread_mutex_destroy(&port->mutex);
+	free(port);
+}
+
+bool indigo_port_execute(indigo_port *port, indigo_priority priority, indigo_transaction *transactions, int count) {
+	port_request request = { priority, transactions, count, false, false, NULL, NULL };
+	struct timeval start, end;
+	gettimeofday(&start, NULL);
+	pthread_mutex_lock(&port->mutex);
+	if (priority == INDIGO_PRIORITY_STATUS) {
+		for (port_request *pending = port->queue; pending; pending = pending->next) {
+			if (pending->priority == INDIGO_PRIORITY_STATUS && pending->leader == NULL && same_transactions(pending, &request)) {
+				request.leader = pending;
+				port->statistics.merged++;
+				break;
+			}
+		}
+	}
+	port_request **link = &port->queue;
+	while (*link)
+		link = &(*link)->next;
+	*link = &request;
+	port->statistics.queue_depth++;
+	while (!request.done && (request.leader != NULL || port->busy || next_request(port) != &request))
+		pthread_cond_wait(&port->cond, &port->mutex);
+	if (!request.done) {
+		dequeue_request(port, &request);
+		port->busy = true;
+		pthread_mutex_unlock(&port->mutex);
+		request.result = indigo_execute_transactions(port->handle, transactions, count);
+		pthread_mutex_lock(&port->mutex);
+		port_request *follower = port->queue;
+		while (follower) {
+			port_request *next = follower->next;
+			if (follower->leader == &request) {
+				for (int i = 0; i < count; i++) {
+					indigo_transaction *transaction = transactions + i;
+					indigo_transaction *follower_transaction = follower->transactions + i;
+					follower_transaction->length = transaction->length;
+					follower_transaction->terminated = transaction->terminated;
+					if (transaction->response != NULL && transaction->length >= 0) {
+						int length = transaction->length < follower_transaction->max ? transaction->length : follower_transaction->max;
+						memcpy(follower_transaction->response, transaction->response, length);
+						follower_transaction->response[length] = 0;
+						follower_transaction->length = length;
+					}
+				}
+				follower->result = request.result;
+				follower->done = true;
+				dequeue_request(port, follower);
+			}
+			follower = next;
+		}
+		request.done = true;
+		port->busy = false;
+	}
+	gettimeofday(&end, NULL);
+	double latency = (end.tv_sec - start.tv_sec) + (end.tv_usec - start.tv_usec) / 1000000.0;
+	port->statistics.queue_depth--;
+	port->statistics.average_latency = port->statistics.average_latency == 0 ? latency : 0.9 * port->statistics.average_latency + 0.1 * latency;
+	if (latency > port->statistics.max_latency)
+		port->statistics.max_latency = latency;
+	pthread_cond_broadcast(&port->cond);
+	pthread_mutex_unlock(&port->mutex);
+	return request.result;
+}
+
+void indigo_port_get_statistics(indigo_port *port, indigo_port_statistics *statistics) {
+	pthread_mutex_lock(&port->mutex);
+	*statistics = port->statistics;
+	pthread_mutex_unlock(&port->mutex);
+}
+
+#endif
@@ -46,6 +46,30 @@ extern int indigo_open_serial_with_speed(const char *dev_file, int speed);
  */
 extern int indigo_open_tcp(const char *host, int port);
 
+/** Open local (Unix domain socket) connection.
+ */
+extern int indigo_open_local(const char *path);
+
+/** Check if handle is local (Unix domain) socket able to pass descriptors.
+ */
+extern bool indigo_is_local_socket(int handle);
+
+/** Create sealed read-only shared memory object with copy of data, returns descriptor or -1 if not supported.
+ */
+extern int indigo_shm_create(const void *data, long size);
+
+/** Map shared memory object received from peer read-only and close descriptor, returns NULL (with errno set) if it is shorter than size or not sealed against writing and shrinking.
+ */
+extern void *indigo_shm_map(int descriptor, long size);
+
+/** Write buffer to local socket and pass descriptor along with it.
+ */
+extern bool indigo_write_with_descriptor(int handle, const char *buffer, long length, int descriptor);
+
+/** Read at most length bytes from local socket, descriptors received along with data are appended to descriptors (up to max).
+ */
+extern long indigo_read_with_descriptors(int handle, char *buffer, long length, int *descriptors, int *count, int max);
+
 /** Read buffer.
  */
 extern int indigo_read(int handle, char *buffer, long length);
@@ -67,6 +91,72 @@ extern bool indigo_printf(int handle, const char *format, ...);
  */
 
 extern int indigo_scanf(int handle, const char *format, ...);
+
+/** Serial transaction (command and its response).
+ */
+typedef struct {
+	const char *command;		///< command to send (NULL if nothing should be sent)
+	char *response;					///< response buffer of at least max + 1 bytes (NULL if no response is expected)
+	int max;								///< maximal response length
+	char terminator;				///< response terminator (not stored in response, 0 if response has fixed length)
+	long timeout;						///< timeout for the first response character in microseconds
+	long gap;								///< timeout between response characters in microseconds (0 to use timeout)
+	int length;							///< received response length (-1 on failure)
+	bool terminated;				///< response terminator was received
+} indigo_transaction;
+
+/** Discard pending input (tcflush() for serial lines, non-blocking read for sockets).
+ */
+extern bool indigo_drain(int handle);
+
+/** Get number of bytes written to socket but not sent yet (0 if not supported by platform).
+ */
+extern long indigo_unsent_bytes(int handle);
+
+/** Read response up to terminator or max characters, whichever comes first, waiting at most timeout microseconds for each character.
+ */
+extern int indigo_read_response(int handle, char *buffer, int max, char terminator, long timeout);
+
+/** Drain input, send commands of all transactions in a single write and collect their responses in order.
+ */
+extern bool indigo_execute_transactions(int handle, indigo_transaction *transactions, int count);
+
+/** Shared port transaction priority.
+ */
+typedef enum {
+	INDIGO_PRIORITY_STATUS = 0,	///< status poll, identical pending polls are merged
+	INDIGO_PRIORITY_MOVE,				///< user initiated command
+	INDIGO_PRIORITY_ABORT				///< abort, executed before any other pending transaction
+} indigo_priority;
+
+/** Shared port statistics.
+ */
+typedef struct {
+	int queue_depth;						///< number of callers waiting for the port
+	double average_latency;			///< moving average of wait and execution time in seconds
+	double max_latency;					///< maximal wait and execution time in seconds
+	long merged;								///< number of status polls served by identical pending poll
+} indigo_port_statistics;
+
+/** Shared port (opaque).
+ */
+typedef struct indigo_port indigo_port;
+
+/** Create shared port owning handle.
+ */
+extern indigo_port *indigo_port_open(int handle);
+
+/** Close shared port and its handle.
+ */
+extern void indigo_port_close(indigo_port *port);
+
+/** Execute transactions on shared port, pending transactions are served in priority order.
+ */
+extern bool indigo_port_execute(indigo_port *port, indigo_priority priority, indigo_transaction *transactions, int count);
+
+/** Get shared port statistics.
+ */
+extern void indigo_port_get_statistics(indigo_port *port, indigo_port_statistics *statistics);
 	
 #ifdef __cplusplus
 }
@@ -32,7 +32,11 @@
 #include <pthread.h>
 #include <assert.h>
 #include <stdint.h>
+#include <errno.h>
+#include <poll.h>
+#include <sys/uio.h>
 #include <arpa/inet.h>
+#include <zlib.h>
 
 #include "indigo_json.h"
 #include "indigo_io.h"
@@ -45,32 +49,431 @@
 
 #define PROPERTY_SIZE sizeof(indigo_property)+INDIGO_MAX_ITEMS*(sizeof(indigo_item))
 
-static long ws_read(int handle, char *buffer, long length) {
-	uint8_t header[14];
-	if (indigo_read(handle, (char *)header, 6) <= 0)
-		return -1;
-	INDIGO_TRACE_PARSER(indigo_trace("ws_read -> %2x", header[0]));
-	uint8_t *masking_key = header+2;
-	uint64_t payload_length = header[1] & 0x7F;
-	if (payload_length == 0x7E) {
-		if (indigo_read(handle, (char *)header + 6, 2) <= 0)
+#define WEB_SOCKET_FRAME_SIZE							(64 * 1024)
+#define WEB_SOCKET_MAX_MESSAGE_SIZE				(16 * JSON_BUFFER_SIZE)
+#define WEB_SOCKET_COMPRESSION_THRESHOLD	64
+#define WEB_SOCKET_PING_INTERVAL					30
+#define WEB_SOCKET_MAX_MISSED_PINGS				2
+
+typedef struct ws_text_message {
+	struct ws_text_message *next;				///< next queued message
+	long length;												///< message length
+	char data[];												///< copy of message
+} ws_text_message;
+
+struct indigo_web_socket {
+	int input;													///< input handle
+	int output;													///< output handle
+	pthread_mutex_t mutex;							///< frame write lock
+	pthread_cond_t cond;								///< signalled when binary fragment or message is written
+	bool binary_pending;								///< fragmented binary message is being sent, text messages are queued
+	bool fragment_pending;							///< binary fragment is being written without frame write lock
+	ws_text_message *text_queue;				///< text messages waiting for binary message to complete
+	ws_text_message **text_queue_tail;
+	bool deflate;												///< permessage-deflate negotiated
+	bool server_no_context_takeover;		///< reset compression context after each message
+	z_stream deflate_stream;						///< outgoing compression context (sliding window kept across messages)
+	z_stream inflate_stream;						///< incoming decompression context
+	char *frame;												///< incoming message payload (assembled from fragments)
+	long frame_capacity;
+	char *message;											///< incoming decompressed message
+	long message_capacity;
+	char *output_buffer;								///< outgoing compressed message
+	long output_capacity;
+	int missed_pings;										///< pings sent without any incoming data
+};
+
+static bool ws_reserve(char **buffer, long *capacity, long size) {
+	if (size <= *capacity)
+		return true;
+	long new_capacity = *capacity ? *capacity : JSON_BUFFER_SIZE;
+	while (new_capacity < size)
+		new_capacity *= 2;
+	char *new_buffer = realloc(*buffer, new_capacity);
+	if (new_buffer == NULL)
+		return false;
+	*buffer = new_buffer;
+	*capacity = new_capacity;
+	return true;
+}
+
+static bool ws_write_frame(indigo_web_socket *web_socket, uint8_t first, const char *data, long length) {
+	uint8_t header[10];
+	header[0] = first;
+	struct iovec iov[2];
+	iov[0].iov_base = header;
+	if (length <= 0x7D) {
+		header[1] = length;
+		iov[0].iov_len = 2;
+	} else if (length <= 0xFFFF) {
+		header[1] = 0x7E;
+		uint16_t payload_length = htons(length);
+		memcpy(header + 2, &payload_length, 2);
+		iov[0].iov_len = 4;
+	} else {
+		header[1] = 0x7F;
+		uint64_t payload_length = htonll(length);
+		memcpy(header + 2, &payload_length, 8);
+		iov[0].iov_len = 10;
+	}
+	iov[1].iov_base = (void *)data;
+	iov[1].iov_len = length;
+	struct iovec *pnt = iov;
+	int count = length > 0 ? 2 : 1;
+	while (count > 0) {
+		ssize_t written = writev(web_socket->output, pnt, count);
+		if (written < 0) {
+			if (errno == EINTR)
+				continue;
+			return false;
+		}
+		while (count > 0 && written >= (ssize_t)pnt->iov_len) {
+			written -= pnt->iov_len;
+			pnt++;
+			count--;
+		}
+		if (count > 0) {
+			pnt->iov_base = (char *)pnt->iov_base + written;
+			pnt->iov_len -= written;
+		}
+	}
+	return true;
+}
+
+static void ws_write_control(indigo_web_socket *web_socket, int opcode, const char *data, long length) {
+	pthread_mutex_lock(&web_socket->mutex);
+	// control frames may be interleaved between fragments, but not inside of one
+	while (web_socket->fragment_pending)
+		pthread_cond_wait(&web_socket->cond, &web_socket->mutex);
+	ws_write_frame(web_socket, 0x80 | opcode, data, length);
+	pthread_mutex_unlock(&web_socket->mutex);
+}
+
+static void ws_close(indigo_web_socket *web_socket, int status) {
+	uint8_t payload[2] = { status >> 8, status & 0xFF };
+	ws_write_control(web_socket, WEB_SOCKET_OPCODE_CLOSE, (char *)payload, 2);
+}
+
+static bool ws_negotiate(indigo_web_socket *web_socket, const char *offer, char *response, int size) {
+	// accept first permessage-deflate offer we can fulfill (RFC7692 section 5)
+	char buffer[1024];
+	strncpy(buffer, offer, sizeof(buffer) - 1);
+	buffer[sizeof(buffer) - 1] = 0;
+	char *offer_context = NULL;
+	for (char *extension = strtok_r(buffer, ",", &offer_context); extension; extension = strtok_r(NULL, ",", &offer_context)) {
+		char *param_context = NULL;
+		char *token = strtok_r(extension, "; \t", &param_context);
+		if (token == NULL || strcmp(token, "permessage-deflate"))
+			continue;
+		bool acceptable = true;
+		bool server_no_context_takeover = false;
+		int server_max_window_bits = 0;
+		while (acceptable && (token = strtok_r(NULL, "; \t", &param_context))) {
+			if (!strcmp(token, "server_no_context_takeover")) {
+				server_no_context_takeover = true;
+			} else if (!strncmp(token, "server_max_window_bits=", 23)) {
+				server_max_window_bits = atoi(token + 23 + (token[23] == '"'));
+				// zlib doesn't support 8 bit window for raw deflate
+				acceptable = server_max_window_bits >= 9 && server_max_window_bits <= 15;
+			} else if (strcmp(token, "client_no_context_takeover") && strcmp(token, "client_max_window_bits") && strncmp(token, "client_max_window_bits=", 23)) {
+				acceptable = false;
+			}
+		}
+		if (!acceptable)
+			continue;
+		if (deflateInit2(&web_socket->deflate_stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -(server_max_window_bits ? server_max_window_bits : 15), 8, Z_DEFAULT_STRATEGY) != Z_OK)
+			return false;
+		if (inflateInit2(&web_socket->inflate_stream, -15) != Z_OK) {
+			deflateEnd(&web_socket->deflate_stream);
+			return false;
+		}
+		web_socket->deflate = true;
+		web_socket->server_no_context_takeover = server_no_context_takeover;
+		if (response) {
+			int length = snprintf(response, size, "permessage-deflate");
+			if (server_no_context_takeover)
+				length += snprintf(response + length, size - length, "; server_no_context_takeover");
+			if (server_max_window_bits)
+				snprintf(response + length, size - length, "; server_max_window_bits=%d", server_max_window_bits);
+		}
+		return true;
+	}
+	return false;
+}
+
+indigo_web_socket *indigo_web_socket_create(int input, int output, const char *offer, char *response, int size) {
+	indigo_web_socket *web_socket = malloc(sizeof(indigo_web_socket));
+	if (web_socket == NULL)
+		return NULL;
+	memset(web_socket, 0, sizeof(indigo_web_socket));
+	web_socket->input = input;
+	web_socket->output = output;
+	pthread_mutex_init(&web_socket->mutex, NULL);
+	pthread_cond_init(&web_socket->cond, NULL);
+	web_socket->text_queue_tail = &web_socket->text_queue;
+	if (response && size > 0)
+		*response = 0;
+	if (offer && *offer && ws_negotiate(web_socket, offer, response, size))
+		INDIGO_DEBUG_PROTOCOL(indigo_debug("%d: permessage-deflate enabled", output));
+	return web_socket;
+}
+
+void indigo_web_socket_release(indigo_web_socket *web_socket) {
+	if (web_socket == NULL)
+		return;
+	if (web_socket->deflate) {
+		deflateEnd(&web_socket->deflate_stream);
+		inflateEnd(&web_socket->inflate_stream);
+	}
+	while (web_socket->text_queue) {
+		ws_text_message *message = web_socket->text_queue;
+		web_socket->text_queue = message->next;
+		free(message);
+	}
+	pthread_cond_destroy(&web_socket->cond);
+	pthread_mutex_destroy(&web_socket->mutex);
+	free(web_socket->frame);
+	free(web_socket->message);
+	free(web_socket->output_buffer);
+	free(web_socket);
+}
+
+static bool ws_wait(indigo_web_socket *web_socket) {
+	// ping idle peer to keep connection (and NAT mappings) alive and detect dead peers
+	while (true) {
+		struct pollfd fd = { web_socket->input, POLLIN, 0 };
+		int result = poll(&fd, 1, WEB_SOCKET_PING_INTERVAL * 1000);
+		if (result > 0) {
+			web_socket->missed_pings = 0;
+			return true;
+		}
+		if (result < 0) {
+			if (errno == EINTR)
+				continue;
+			return false;
+		}
+		if (web_socket->missed_pings++ >= WEB_SOCKET_MAX_MISSED_PINGS) {
+			INDIGO_DEBUG_PROTOCOL(indigo_debug("%d: WebSocket peer not responding", web_socket->input));
+			return false;
+		}
+		ws_write_control(web_socket, WEB_SOCKET_OPCODE_PING, NULL, 0);
+	}
+}
+
+static long ws_inflate(indigo_web_socket *web_socket, long size) {
+	// append empty stored block removed by sender (RFC7692 section 7.2.2)
+	memcpy(web_socket->frame + size, "\x00\x00\xff\xff", 4);
+	z_stream *stream = &web_socket->inflate_stream;
+	stream->next_in = (Bytef *)web_socket->frame;
+	stream->avail_in = (uInt)(size + 4);
+	long length = 0;
+	while (true) {
+		if (!ws_reserve(&web_socket->message, &web_socket->message_capacity, length + 4 * size + 1024))
+			return -1;
+		stream->next_out = (Bytef *)web_socket->message + length;
+		stream->avail_out = (uInt)(web_socket->message_capacity - length - 1);
+		int result = inflate(stream, Z_SYNC_FLUSH);
+		if (result != Z_OK && result != Z_BUF_ERROR)
 			return -1;
-		masking_key = header + 4;
-		payload_length = ntohs(*((uint16_t *)(header+2)));
-	} else if (payload_length == 0x7F) {
-		if (indigo_read(handle, (char *)header + 6, 8) <= 0)
+		length = (char *)stream->next_out - web_socket->message;
+		if (length > WEB_SOCKET_MAX_MESSAGE_SIZE)
 			return -1;
-		masking_key = header+10;
-		payload_length = ntohll(*((uint64_t *)(header+2)));
+		if (stream->avail_in == 0 && stream->avail_out > 0)
+			break;
 	}
-	if (length < payload_length)
-		return -1;
-	if (indigo_read(handle, buffer, payload_length) <= 0)
+	web_socket->message[length] = 0;
+	return length;
+}
+
+long indigo_web_socket_read(indigo_web_socket *web_socket, char **message) {
+	long size = 0;
+	int opcode = -1;
+	bool compressed = false;
+	while (true) {
+		uint8_t header[8];
+		if (!ws_wait(web_socket) || indigo_read(web_socket->input, (char *)header, 2) <= 0)
+			return -1;
+		bool fin = header[0] & 0x80;
+		bool rsv1 = header[0] & 0x40;
+		int frame_opcode = header[0] & 0x0F;
+		bool masked = header[1] & 0x80;
+		uint64_t length = header[1] & 0x7F;
+		if (length == 0x7E) {
+			if (indigo_read(web_socket->input, (char *)header, 2) <= 0)
+				return -1;
+			length = ntohs(*((uint16_t *)header));
+		} else if (length == 0x7F) {
+			if (indigo_read(web_socket->input, (char *)header, 8) <= 0)
+				return -1;
+			length = ntohll(*((uint64_t *)header));
+		}
+		uint8_t masking_key[4] = { 0 };
+		if (masked && indigo_read(web_socket->input, (char *)masking_key, 4) <= 0)
+			return -1;
+		INDIGO_TRACE_PARSER(indigo_trace("ws_read -> %02x %llu", header[0], (unsigned long long)length));
+		if (frame_opcode & 0x08) {
+			char payload[125];
+			if (!fin || length > sizeof(payload)) {
+				ws_close(web_socket, 1002);
+				return -1;
+			}
+			if (length > 0 && indigo_read(web_socket->input, payload, (int)length) <= 0)
+				return -1;
+			for (uint64_t i = 0; i < length; i++)
+				payload[i] ^= masking_key[i % 4];
+			if (frame_opcode == WEB_SOCKET_OPCODE_CLOSE) {
+				ws_write_control(web_socket, WEB_SOCKET_OPCODE_CLOSE, payload, length >= 2 ? 2 : 0);
+				return -1;
+			}
+			if (frame_opcode == WEB_SOCKET_OPCODE_PING)
+				ws_write_control(web_socket, WEB_SOCKET_OPCODE_PONG, payload, length);
+			continue;
+		}
+		if (frame_opcode == WEB_SOCKET_OPCODE_CONTINUATION) {
+			if (opcode < 0) {
+				ws_close(web_socket, 1002);
+				return -1;
+			}
+		} else {
+			if (opcode >= 0 || (rsv1 && !web_socket->deflate)) {
+				ws_close(web_socket, 1002);
+				return -1;
+			}
+			opcode = frame_opcode;
+			compressed = rsv1;
+		}
+		if (size + length > WEB_SOCKET_MAX_MESSAGE_SIZE) {
+			ws_close(web_socket, 1009);
+			return -1;
+		}
+		if (!ws_reserve(&web_socket->frame, &web_socket->frame_capacity, size + length + 5))
+			return -1;
+		char *payload = web_socket->frame + size;
+		if (length > 0 && indigo_read(web_socket->input, payload, (int)length) <= 0)
+			return -1;
+		for (uint64_t i = 0; i < length; i++)
+			payload[i] ^= masking_key[i % 4];
+		size += length;
+		if (!fin)
+			continue;
+		if (compressed) {
+			long length = ws_inflate(web_socket, size);
+			if (length < 0) {
+				ws_close(web_socket, 1007);
+				return -1;
+			}
+			*message = web_socket->message;
+			return length;
+		}
+		web_socket->frame[size] = 0;
+		*message = web_socket->frame;
+		return size;
+	}
+}
+
+static long ws_deflate(indigo_web_socket *web_socket, const char *data, long length) {
+	z_stream *stream = &web_socket->deflate_stream;
+	stream->next_in = (Bytef *)data;
+	stream->avail_in = (uInt)length;
+	long size = 0;
+	if (!ws_reserve(&web_socket->output_buffer, &web_socket->output_capacity, deflateBound(stream, length) + 16))
 		return -1;
-	for (uint64_t i = 0; i < payload_length; i++) {
-		buffer[i] ^= masking_key[i%4];
+	do {
+		if (web_socket->output_capacity == size && !ws_reserve(&web_socket->output_buffer, &web_socket->output_capacity, size + 1024))
+			return -1;
+		stream->next_out = (Bytef *)web_socket->output_buffer + size;
+		stream->avail_out = (uInt)(web_socket->output_capacity - size);
+		int result = deflate(stream, Z_SYNC_FLUSH);
+		if (result != Z_OK && result != Z_BUF_ERROR)
+			return -1;
+		size = (char *)stream->next_out - web_socket->output_buffer;
+	} while (stream->avail_out == 0);
+	// remove trailing empty stored block (RFC7692 section 7.2.1)
+	if (size >= 4 && !memcmp(web_socket->output_buffer + size - 4, "\x00\x00\xff\xff", 4))
+		size -= 4;
+	if (web_socket->server_no_context_takeover)
+		deflateReset(stream);
+	return size;
+}
+
+// must be called with frame write lock held
+static bool ws_write_text(indigo_web_socket *web_socket, const char *data, long length) {
+	uint8_t rsv1 = 0;
+	// binary messages carry already compressed image data, so only text is deflated
+	if (web_socket->deflate && length >= WEB_SOCKET_COMPRESSION_THRESHOLD) {
+		long size = ws_deflate(web_socket, data, length);
+		if (size < 0)
+			return false;
+		data = web_socket->output_buffer;
+		length = size;
+		rsv1 = 0x40;
+	}
+	bool result = true;
+	long offset = 0;
+	do {
+		long chunk = length - offset < WEB_SOCKET_FRAME_SIZE ? length - offset : WEB_SOCKET_FRAME_SIZE;
+		bool fin = offset + chunk == length;
+		uint8_t first = (offset == 0 ? WEB_SOCKET_OPCODE_TEXT | rsv1 : WEB_SOCKET_OPCODE_CONTINUATION) | (fin ? 0x80 : 0);
+		result = ws_write_frame(web_socket, first, data + offset, chunk);
+		offset += chunk;
+	} while (result && offset < length);
+	return result;
+}
+
+// binary message is written in WEB_SOCKET_FRAME_SIZE fragments without holding the frame write lock, so control frames
+// can be sent between them and text messages don't wait for the whole image; text messages can't be interleaved with
+// fragments of another message (RFC6455 section 5.4), so they are queued and sent right after the binary message
+
+static bool ws_write_binary(indigo_web_socket *web_socket, const char *data, long length) {
+	while (web_socket->binary_pending)
+		pthread_cond_wait(&web_socket->cond, &web_socket->mutex);
+	web_socket->binary_pending = true;
+	bool result = true;
+	long offset = 0;
+	do {
+		long chunk = length - offset < WEB_SOCKET_FRAME_SIZE ? length - offset : WEB_SOCKET_FRAME_SIZE;
+		bool fin = offset + chunk == length;
+		uint8_t first = (offset == 0 ? WEB_SOCKET_OPCODE_BINARY : WEB_SOCKET_OPCODE_CONTINUATION) | (fin ? 0x80 : 0);
+		web_socket->fragment_pending = true;
+		pthread_mutex_unlock(&web_socket->mutex);
+		result = ws_write_frame(web_socket, first, data + offset, chunk);
+		pthread_mutex_lock(&web_socket->mutex);
+		web_socket->fragment_pending = false;
+		pthread_cond_broadcast(&web_socket->cond);
+		offset += chunk;
+	} while (result && offset < length);
+	while (web_socket->text_queue) {
+		ws_text_message *message = web_socket->text_queue;
+		web_socket->text_queue = message->next;
+		if (result)
+			result = ws_write_text(web_socket, message->data, message->length);
+		free(message);
+	}
+	web_socket->text_queue_tail = &web_socket->text_queue;
+	web_socket->binary_pending = false;
+	pthread_cond_broadcast(&web_socket->cond);
+	return result;
+}
+
+bool indigo_web_socket_write(indigo_web_socket *web_socket, int opcode, const char *data, long length) {
+	pthread_mutex_lock(&web_socket->mutex);
+	bool result;
+	if (opcode == WEB_SOCKET_OPCODE_BINARY) {
+		result = ws_write_binary(web_socket, data, length);
+	} else if (web_socket->binary_pending) {
+		ws_text_message *message = malloc(sizeof(ws_text_message) + length);
+		if ((result = message != NULL)) {
+			message->next = NULL;
+			message->length = length;
+			memcpy(message->data, data, length);
+			*web_socket->text_queue_tail = message;
+			web_socket->text_queue_tail = &message->next;
+		}
+	} else {
+		result = ws_write_text(web_socket, data, length);
 	}
-	return payload_length;
+	pthread_mutex_unlock(&web_socket->mutex);
+	return result;
 }
 
 typedef enum {
@@ -228,6 +631,56 @@ static void *new_switch_vector_handler(parser_state state, char *name, char *val
 	return new_switch_vector_handler;
 }
 
+static void *enable_blob_handler(parser_state state, char *name, char *value, indigo_property *property, indigo_device *device, indigo_client *client, char *message) {
+	INDIGO_TRACE_PARSER(indigo_trace("JSON Parser: %s %s '%s' '%s'", __FUNCTION__, parser_state_name[state], name != NULL ? name : "", value != NULL ? value : ""));
+	if (state == TEXT_VALUE) {
+		if (!strcmp(name, "device")) {
+			strncpy(property->device, value, INDIGO_NAME_SIZE);
+		} else if (!strcmp(name, "name")) {
+			strncpy(property->name, value, INDIGO_NAME_SIZE);
+		} else if (!strcmp(name, "value")) {
+			strncpy(message, value, INDIGO_VALUE_SIZE);
+		}
+	} else if (state == END_STRUCT) {
+		// JSON adapter has default URL record for all devices, so explicit "Never" is recorded too
+		indigo_enable_blob_mode_record *record = client->enable_blob_mode_records;
+		indigo_enable_blob_mode_record *prev = NULL;
+		while (record) {
+			if (!strcmp(property->device, record->device) && (*property->name == 0 || !strcmp(property->name, record->name))) {
+				if (prev) {
+					prev->next = record->next;
+					free(record);
+					record = prev->next;
+				} else {
+					client->enable_blob_mode_records = record->next;
+					free(record);
+					record = client->enable_blob_mode_records;
+				}
+			} else {
+				prev = record;
+				record = record->next;
+			}
+		}
+		record = malloc(sizeof(indigo_enable_blob_mode_record));
+		assert(record != NULL);
+		strncpy(record->device, property->device, INDIGO_NAME_SIZE);
+		strncpy(record->name, property->name, INDIGO_NAME_SIZE);
+		if (!strcmp(message, "Never"))
+			record->mode = INDIGO_ENABLE_BLOB_NEVER;
+		else if (!strcmp(message, "Also"))
+			record->mode = INDIGO_ENABLE_BLOB_ALSO;
+		else
+			record->mode = INDIGO_ENABLE_BLOB_URL;
+		record->next = client->enable_blob_mode_records;
+		client->enable_blob_mode_records = record;
+		indigo_enable_blob(client, property, record->mode);
+		*property->device = *property->name = 0;
+		*message = 0;
+		return top_level_handler;
+	}
+	return enable_blob_handler;
+}
+
 static void *top_level_handler(parser_state state, char *name, char *value, indigo_property *property, indigo_device *device, indigo_client *client, char *message) {
 	INDIGO_TRACE_PARSER(indigo_trace("JSON Parser: %s %s '%s' '%s'", __FUNCTION__, parser_state_name[state], name != NULL ? name : "", value != NULL ? value : ""));
 	if (state == BEGIN_STRUCT) {
@@ -235,6 +688,11 @@ static void *top_level_handler(parser_state state, char *name, char *value, indi
 		if (name != NULL) {
 			if (!strcmp(name, "getProperties"))
 				return get_properties_handler;
+			if (!strcmp(name, "enableBLOB")) {
+				property->type = INDIGO_BLOB_VECTOR;
+				*message = 0;
+				return enable_blob_handler;
+			}
 			if (!strcmp(name, "newTextVector")) {
 				property->type = INDIGO_TEXT_VECTOR;
 				property->version = client->version;
@@ -258,7 +716,8 @@ static void *top_level_handler(parser_state state, char *name, char *value, indi
 void indigo_json_parse(indigo_device *device, indigo_client *client) {
 	indigo_adapter_context *context = (indigo_adapter_context*)client->client_context;
 	int handle = context->input;
-	char buffer[JSON_BUFFER_SIZE];
+	char line_buffer[JSON_BUFFER_SIZE + 1];
+	char *buffer = line_buffer;
 	char *pointer = buffer;
 	char *buffer_end = NULL;
 	char property_buffer[PROPERTY_SIZE];
@@ -277,14 +736,20 @@ void indigo_json_parse(indigo_device *device, indigo_client *client) {
 	memset(property_buffer, 0, PROPERTY_SIZE);
 
 	while (true) {
-		assert(pointer - buffer <= JSON_BUFFER_SIZE);
+		assert(buffer_end == NULL || pointer <= buffer_end + 1);
 		assert(name_pointer - name_buffer <= INDIGO_NAME_SIZE);
 		if (state == ERROR) {
 			indigo_error("JSON Parser: syntax error");
 			goto exit_loop;
 		}
 		while ((c = *pointer++) == 0) {
-			ssize_t count = (int)context->web_socket ? ws_read(handle, buffer, JSON_BUFFER_SIZE) : indigo_read_line(handle, buffer, JSON_BUFFER_SIZE);
+			ssize_t count;
+			if (context->web_socket_state) {
+				count = indigo_web_socket_read(context->web_socket_state, &buffer);
+			} else {
+				buffer = line_buffer;
+				count = indigo_read_line(handle, buffer, JSON_BUFFER_SIZE);
+			}
 			if (count <= 0) {
 				goto exit_loop;
 			}
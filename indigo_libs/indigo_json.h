@@ -43,6 +43,33 @@ extern "C" {
 #define ntohll(x) ((1==ntohl(1)) ? (x) : ((uint64_t)ntohl((x) & 0xFFFFFFFF) << 32) | ntohl((x) >> 32))
 #endif
 
+#define WEB_SOCKET_OPCODE_CONTINUATION	0x0
+#define WEB_SOCKET_OPCODE_TEXT					0x1
+#define WEB_SOCKET_OPCODE_BINARY				0x2
+#define WEB_SOCKET_OPCODE_CLOSE					0x8
+#define WEB_SOCKET_OPCODE_PING					0x9
+#define WEB_SOCKET_OPCODE_PONG					0xA
+
+/** WebSocket connection state (RFC6455 framing, RFC7692 permessage-deflate).
+ */
+typedef struct indigo_web_socket indigo_web_socket;
+
+/** Create WebSocket connection state, offer is client Sec-WebSocket-Extensions header value (or NULL) and accepted extensions to be sent back are stored to response (empty if none).
+ */
+extern indigo_web_socket *indigo_web_socket_create(int input, int output, const char *offer, char *response, int size);
+
+/** Release WebSocket connection state.
+ */
+extern void indigo_web_socket_release(indigo_web_socket *web_socket);
+
+/** Read next complete (defragmented and decompressed) data message, control frames are handled internally. Returned buffer is valid until next call.
+ */
+extern long indigo_web_socket_read(indigo_web_socket *web_socket, char **message);
+
+/** Write data message (compressed and fragmented if needed).
+ */
+extern bool indigo_web_socket_write(indigo_web_socket *web_socket, int opcode, const char *data, long length);
+
 /** JSON wire protocol parser.
  */
 extern void indigo_json_parse(indigo_device *device, indigo_client *client);
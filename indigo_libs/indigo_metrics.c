@@ -0,0 +1,344 @@
+// Copyright (c) 2026 agent
+// All rights reserved.
+//
+// You can use this software under the terms of 'INDIGO Astronomy
+// open-source license' (see LICENSE.md).
+//
+// THIS SOFTWARE IS PROVIDED BY THE AUTHORS 'AS IS' AND ANY EXPRESS
+// OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+// GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// version history
+// 2.0 by agent <agent@local>
+
+
+/** INDIGO metrics
+ \file indigo_metrics.c
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <time.h>
+#include <pthread.h>
+#if defined(INDIGO_LINUX) || defined(INDIGO_MACOS)
+#include <sys/time.h>
+#endif
+#if defined(INDIGO_WINDOWS)
+#include <windows.h>
+#pragma warning(disable:4996)
+#endif
+
+#include "indigo_metrics.h"
+
+#define PROPERTY_TABLE_SIZE	512		/* power of 2 */
+#define MAX_CLIENTS					256
+#define FORMAT_BUFFER_SIZE	16384
+
+#if defined(_MSC_VER)
+#define METRICS_ADD(p, v)		InterlockedExchangeAdd64((volatile LONG64 *)(p), (v))
+#define METRICS_LOAD(p)			((uint64_t)InterlockedCompareExchange64((volatile LONG64 *)(p), 0, 0))
+#define METRICS_EXCHANGE(p, v)	((uint64_t)InterlockedExchange64((volatile LONG64 *)(p), (v)))
+#define METRICS_SET_IF_ZERO(p, v)	InterlockedCompareExchange64((volatile LONG64 *)(p), (v), 0)
+#define METRICS_ACQUIRE(p)		InterlockedCompareExchange((volatile long *)(p), 0, 0)
+#define METRICS_RELEASE(p, v)	InterlockedExchange((volatile long *)(p), (v))
+#else
+#define METRICS_ADD(p, v)		__atomic_fetch_add((p), (v), __ATOMIC_RELAXED)
+#define METRICS_LOAD(p)			__atomic_load_n((p), __ATOMIC_RELAXED)
+#define METRICS_EXCHANGE(p, v)	__atomic_exchange_n((p), (v), __ATOMIC_RELAXED)
+#define METRICS_SET_IF_ZERO(p, v)	({ uint64_t zero = 0; __atomic_compare_exchange_n((p), &zero, (v), false, __ATOMIC_RELAXED, __ATOMIC_RELAXED); })
+#define METRICS_ACQUIRE(p)		__atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define METRICS_RELEASE(p, v)	__atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#endif
+
+typedef struct {
+	int used;														///< set after device and name are filled, entries are never removed
+	char device[INDIGO_NAME_SIZE];
+	char name[INDIGO_NAME_SIZE];
+	uint64_t pending;										///< time of pending change request or 0
+	indigo_histogram latency;
+} property_metrics;
+
+struct indigo_client_metrics {
+	char name[INDIGO_NAME_SIZE];
+	bool used;
+	uint64_t bytes_sent;
+	indigo_histogram write_latency;
+	indigo_histogram queue_depth;
+};
+
+indigo_histogram indigo_update_latency_histogram;
+indigo_histogram indigo_write_latency_histogram;
+indigo_histogram indigo_queue_depth_histogram;
+indigo_histogram indigo_blob_encode_histogram;
+indigo_histogram indigo_timer_lateness_histogram;
+uint64_t indigo_bytes_sent = 0;
+
+// property table is searched without lock, only insertion of new entries is serialized by property_mutex
+
+static property_metrics properties[PROPERTY_TABLE_SIZE];
+static int property_count = 0;
+static pthread_mutex_t property_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static indigo_client_metrics clients[MAX_CLIENTS];
+static pthread_mutex_t client_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+uint64_t indigo_metrics_now(void) {
+#if defined(INDIGO_WINDOWS)
+	static LARGE_INTEGER frequency;
+	LARGE_INTEGER counter;
+	if (frequency.QuadPart == 0)
+		QueryPerformanceFrequency(&frequency);
+	QueryPerformanceCounter(&counter);
+	return (uint64_t)(counter.QuadPart * 1000000.0 / frequency.QuadPart);
+#else
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+#endif
+}
+
+void indigo_histogram_record(indigo_histogram *histogram, uint64_t value) {
+	int bucket = 0;
+	while (bucket < INDIGO_METRICS_BUCKETS && value > ((uint64_t)1 << bucket))
+		bucket++;
+	METRICS_ADD(&histogram->buckets[bucket], 1);
+	METRICS_ADD(&histogram->sum, value);
+	METRICS_ADD(&histogram->count, 1);
+}
+
+uint64_t indigo_histogram_percentile(indigo_histogram *histogram, double percentile) {
+	uint64_t count = METRICS_LOAD(&histogram->count);
+	if (count == 0)
+		return 0;
+	uint64_t rank = (uint64_t)(count * percentile / 100.0);
+	if (rank >= count)
+		rank = count - 1;
+	uint64_t total = 0;
+	for (int bucket = 0; bucket < INDIGO_METRICS_BUCKETS; bucket++) {
+		total += METRICS_LOAD(&histogram->buckets[bucket]);
+		if (total > rank)
+			return (uint64_t)1 << bucket;
+	}
+	return (uint64_t)1 << INDIGO_METRICS_BUCKETS;
+}
+
+// -------------------------------------------------------------------------------- change-to-update latency
+
+static property_metrics *find_property(indigo_property *property, bool create) {
+	unsigned hash = 5381;
+	for (const char *c = property->device; *c; c++)
+		hash = hash * 33 + (unsigned char)*c;
+	for (const char *c = property->name; *c; c++)
+		hash = hash * 33 + (unsigned char)*c;
+	for (int i = 0; i < PROPERTY_TABLE_SIZE; i++) {
+		property_metrics *entry = properties + ((hash + i) & (PROPERTY_TABLE_SIZE - 1));
+		if (!METRICS_ACQUIRE(&entry->used)) {
+			// keep a quarter of the table empty to keep probe sequences short
+			if (!create || property_count >= PROPERTY_TABLE_SIZE * 3 / 4)
+				return NULL;
+			strncpy(entry->device, property->device, INDIGO_NAME_SIZE - 1);
+			strncpy(entry->name, property->name, INDIGO_NAME_SIZE - 1);
+			METRICS_RELEASE(&entry->used, 1);
+			METRICS_RELEASE(&property_count, property_count + 1);
+			return entry;
+		}
+		if (!strcmp(entry->device, property->device) && !strcmp(entry->name, property->name))
+			return entry;
+	}
+	return NULL;
+}
+
+void indigo_metrics_change(indigo_property *property) {
+	if (*property->device == 0 || *property->name == 0)
+		return;
+	uint64_t now = indigo_metrics_now();
+	property_metrics *entry = find_property(property, false);
+	if (entry == NULL) {
+		pthread_mutex_lock(&property_mutex);
+		entry = find_property(property, true);
+		pthread_mutex_unlock(&property_mutex);
+	}
+	if (entry != NULL)
+		METRICS_SET_IF_ZERO(&entry->pending, now);
+}
+
+void indigo_metrics_update(indigo_property *property) {
+	if (METRICS_ACQUIRE(&property_count) == 0)
+		return;
+	property_metrics *entry = find_property(property, false);
+	if (entry != NULL && METRICS_LOAD(&entry->pending) != 0) {
+		uint64_t pending = METRICS_EXCHANGE(&entry->pending, 0);
+		if (pending != 0) {
+			uint64_t latency = indigo_metrics_now() - pending;
+			indigo_histogram_record(&entry->latency, latency);
+			indigo_histogram_record(&indigo_update_latency_histogram, latency);
+		}
+	}
+}
+
+// -------------------------------------------------------------------------------- client writes
+
+indigo_client_metrics *indigo_metrics_client_open(const char *protocol, int handle) {
+	indigo_client_metrics *metrics = NULL;
+	pthread_mutex_lock(&client_mutex);
+	for (int i = 0; i < MAX_CLIENTS; i++) {
+		if (!clients[i].used) {
+			metrics = clients + i;
+			memset(metrics, 0, sizeof(indigo_client_metrics));
+			snprintf(metrics->name, INDIGO_NAME_SIZE, "%s-%d", protocol, handle);
+			metrics->used = true;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&client_mutex);
+	return metrics;
+}
+
+void indigo_metrics_client_write(indigo_client_metrics *metrics, long bytes, uint64_t duration, long queued) {
+	METRICS_ADD(&indigo_bytes_sent, bytes);
+	indigo_histogram_record(&indigo_write_latency_histogram, duration);
+	indigo_histogram_record(&indigo_queue_depth_histogram, queued);
+	if (metrics != NULL) {
+		METRICS_ADD(&metrics->bytes_sent, bytes);
+		indigo_histogram_record(&metrics->write_latency, duration);
+		indigo_histogram_record(&metrics->queue_depth, queued);
+	}
+}
+
+void indigo_metrics_client_close(indigo_client_metrics *metrics) {
+	if (metrics != NULL) {
+		pthread_mutex_lock(&client_mutex);
+		metrics->used = false;
+		pthread_mutex_unlock(&client_mutex);
+	}
+}
+
+// -------------------------------------------------------------------------------- Prometheus text format
+
+typedef struct {
+	char *text;
+	long size;
+	long capacity;
+} format_buffer;
+
+static void format_printf(format_buffer *buffer, const char *format, ...) {
+	while (buffer->text != NULL) {
+		long available = buffer->capacity - buffer->size;
+		va_list args;
+		va_start(args, format);
+		int length = vsnprintf(buffer->text + buffer->size, available, format, args);
+		va_end(args);
+		if (length < 0)
+			return;
+		if (length < available) {
+			buffer->size += length;
+			return;
+		}
+		long capacity = buffer->capacity * 2;
+		while (capacity <= buffer->size + length)
+			capacity *= 2;
+		char *text = realloc(buffer->text, capacity);
+		if (text == NULL) {
+			free(buffer->text);
+			buffer->text = NULL;
+			return;
+		}
+		buffer->text = text;
+		buffer->capacity = capacity;
+	}
+}
+
+static void format_label(char *label, const char *value) {
+	char *end = label + INDIGO_NAME_SIZE * 2 - 1;
+	for (const char *c = value; *c && label < end - 1; c++) {
+		if (*c == '"' || *c == '\\')
+			*label++ = '\\';
+		*label++ = *c == '\n' ? ' ' : *c;
+	}
+	*label = 0;
+}
+
+static void format_header(format_buffer *buffer, const char *name, const char *type, const char *help) {
+	format_printf(buffer, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+// values are recorded in microseconds or bytes, time histograms are exported in seconds
+static void format_histogram(format_buffer *buffer, const char *name, const char *labels, indigo_histogram *histogram, double scale) {
+	uint64_t total = 0;
+	const char *separator = *labels ? "," : "";
+	for (int bucket = 0; bucket < INDIGO_METRICS_BUCKETS; bucket++) {
+		total += METRICS_LOAD(&histogram->buckets[bucket]);
+		format_printf(buffer, "%s_bucket{%s%sle=\"%.9g\"} %llu\n", name, labels, separator, ((uint64_t)1 << bucket) * scale, (unsigned long long)total);
+	}
+	uint64_t count = METRICS_LOAD(&histogram->count);
+	format_printf(buffer, "%s_bucket{%s%sle=\"+Inf\"} %llu\n", name, labels, separator, (unsigned long long)count);
+	if (*labels) {
+		format_printf(buffer, "%s_sum{%s} %g\n", name, labels, METRICS_LOAD(&histogram->sum) * scale);
+		format_printf(buffer, "%s_count{%s} %llu\n", name, labels, (unsigned long long)count);
+	} else {
+		format_printf(buffer, "%s_sum %g\n", name, METRICS_LOAD(&histogram->sum) * scale);
+		format_printf(buffer, "%s_count %llu\n", name, (unsigned long long)count);
+	}
+}
+
+char *indigo_metrics_format(long *length) {
+	format_buffer buffer = { malloc(FORMAT_BUFFER_SIZE), 0, FORMAT_BUFFER_SIZE };
+	char labels[INDIGO_NAME_SIZE * 5], device[INDIGO_NAME_SIZE * 2], name[INDIGO_NAME_SIZE * 2];
+	format_header(&buffer, "indigo_update_latency_seconds", "histogram", "Time from change request to the next update of the same property.");
+	format_histogram(&buffer, "indigo_update_latency_seconds", "", &indigo_update_latency_histogram, 1e-6);
+	format_header(&buffer, "indigo_property_update_latency_seconds", "histogram", "Time from change request to the next update per property.");
+	for (int i = 0; i < PROPERTY_TABLE_SIZE; i++) {
+		property_metrics *entry = properties + i;
+		if (METRICS_ACQUIRE(&entry->used) && METRICS_LOAD(&entry->latency.count)) {
+			format_label(device, entry->device);
+			format_label(name, entry->name);
+			snprintf(labels, sizeof(labels), "device=\"%s\",property=\"%s\"", device, name);
+			format_histogram(&buffer, "indigo_property_update_latency_seconds", labels, &entry->latency, 1e-6);
+		}
+	}
+	// samples of one metric family have to be grouped together
+	pthread_mutex_lock(&client_mutex);
+	format_header(&buffer, "indigo_client_write_latency_seconds", "histogram", "Duration of writes to client.");
+	for (int i = 0; i < MAX_CLIENTS; i++) {
+		if (clients[i].used) {
+			format_label(name, clients[i].name);
+			snprintf(labels, sizeof(labels), "client=\"%s\"", name);
+			format_histogram(&buffer, "indigo_client_write_latency_seconds", labels, &clients[i].write_latency, 1e-6);
+		}
+	}
+	format_header(&buffer, "indigo_client_queue_bytes", "histogram", "Data queued in client socket buffer after write.");
+	for (int i = 0; i < MAX_CLIENTS; i++) {
+		if (clients[i].used) {
+			format_label(name, clients[i].name);
+			snprintf(labels, sizeof(labels), "client=\"%s\"", name);
+			format_histogram(&buffer, "indigo_client_queue_bytes", labels, &clients[i].queue_depth, 1);
+		}
+	}
+	format_header(&buffer, "indigo_client_sent_bytes_total", "counter", "Bytes sent to client.");
+	for (int i = 0; i < MAX_CLIENTS; i++) {
+		if (clients[i].used) {
+			format_label(name, clients[i].name);
+			format_printf(&buffer, "indigo_client_sent_bytes_total{client=\"%s\"} %llu\n", name, (unsigned long long)METRICS_LOAD(&clients[i].bytes_sent));
+		}
+	}
+	pthread_mutex_unlock(&client_mutex);
+	format_header(&buffer, "indigo_sent_bytes_total", "counter", "Bytes sent to all clients.");
+	format_printf(&buffer, "indigo_sent_bytes_total %llu\n", (unsigned long long)METRICS_LOAD(&indigo_bytes_sent));
+	format_header(&buffer, "indigo_blob_encode_seconds", "histogram", "Duration of image format conversion and BLOB encoding.");
+	format_histogram(&buffer, "indigo_blob_encode_seconds", "", &indigo_blob_encode_histogram, 1e-6);
+	format_header(&buffer, "indigo_timer_lateness_seconds", "histogram", "Delay between scheduled and actual timer callback time.");
+	format_histogram(&buffer, "indigo_timer_lateness_seconds", "", &indigo_timer_lateness_histogram, 1e-6);
+	if (length != NULL)
+		*length = buffer.text ? buffer.size : 0;
+	return buffer.text;
+}
@@ -0,0 +1,119 @@
+// Copyright (c) 2026 agent
+// All rights reserved.
+//
+// You can use this software under the terms of 'INDIGO Astronomy
+// open-source license' (see LICENSE.md).
+//
+// THIS SOFTWARE IS PROVIDED BY THE AUTHORS 'AS IS' AND ANY EXPRESS
+// OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+// GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// version history
+// 2.0 by agent <agent@local>
+
+
+/** INDIGO metrics
+ \file indigo_metrics.h
+ */
+
+#ifndef indigo_metrics_h
+#define indigo_metrics_h
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "indigo_bus.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Number of histogram buckets, bucket i counts values up to 2^i (microseconds or bytes), last bucket counts the rest.
+ */
+#define INDIGO_METRICS_BUCKETS	25
+
+/** Histogram with power of 2 buckets, updated without locks.
+ */
+typedef struct {
+	uint64_t count;													///< number of recorded values
+	uint64_t sum;														///< sum of recorded values
+	uint64_t buckets[INDIGO_METRICS_BUCKETS + 1];	///< value counts per bucket (not cumulative)
+} indigo_histogram;
+
+/** Per client metrics, allocated by indigo_metrics_client_open().
+ */
+typedef struct indigo_client_metrics indigo_client_metrics;
+
+/** Change-to-update latency of all properties in microseconds.
+ */
+extern indigo_histogram indigo_update_latency_histogram;
+
+/** Write latency of all clients in microseconds.
+ */
+extern indigo_histogram indigo_write_latency_histogram;
+
+/** Unsent data queued in socket buffers of all clients in bytes.
+ */
+extern indigo_histogram indigo_queue_depth_histogram;
+
+/** Time spent by image format conversion and BLOB encoding in microseconds.
+ */
+extern indigo_histogram indigo_blob_encode_histogram;
+
+/** Timer lateness (difference between scheduled and actual time) in microseconds.
+ */
+extern indigo_histogram indigo_timer_lateness_histogram;
+
+/** Total number of bytes sent to all clients.
+ */
+extern uint64_t indigo_bytes_sent;
+
+/** Monotonic time in microseconds.
+ */
+extern uint64_t indigo_metrics_now(void);
+
+/** Record value to histogram.
+ */
+extern void indigo_histogram_record(indigo_histogram *histogram, uint64_t value);
+
+/** Get upper bound of the bucket containing given percentile (0-100).
+ */
+extern uint64_t indigo_histogram_percentile(indigo_histogram *histogram, double percentile);
+
+/** Note change request for property, latency is measured to the next update of the same property.
+ */
+extern void indigo_metrics_change(indigo_property *property);
+
+/** Note property update, record change-to-update latency if change request is pending.
+ */
+extern void indigo_metrics_update(indigo_property *property);
+
+/** Register client connection with given protocol and handle for per-client metrics.
+ */
+extern indigo_client_metrics *indigo_metrics_client_open(const char *protocol, int handle);
+
+/** Record single write to client (bytes written, write duration in microseconds and unsent bytes queued after write).
+ */
+extern void indigo_metrics_client_write(indigo_client_metrics *metrics, long bytes, uint64_t duration, long queued);
+
+/** Unregister client connection.
+ */
+extern void indigo_metrics_client_close(indigo_client_metrics *metrics);
+
+/** Format all metrics in Prometheus text exposition format, returned buffer has to be released by free().
+ */
+extern char *indigo_metrics_format(long *length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* indigo_metrics_h */
@@ -272,6 +272,41 @@
  */
 #define CCD_LOCAL_MODE_PREFIX_ITEM_NAME       "PREFIX"
 
+//----------------------------------------------------------------------
+/** CCD_LOCAL_SEQUENCE property name.
+ */
+#define CCD_LOCAL_SEQUENCE_PROPERTY_NAME      "CCD_LOCAL_SEQUENCE"
+
+/** CCD_LOCAL_SEQUENCE.NEXT property item name.
+ */
+#define CCD_LOCAL_SEQUENCE_NEXT_ITEM_NAME     "NEXT"
+
+//----------------------------------------------------------------------
+/** CCD_LOCAL_SYNC property name.
+ */
+#define CCD_LOCAL_SYNC_PROPERTY_NAME          "CCD_LOCAL_SYNC"
+
+/** CCD_LOCAL_SYNC.FRAMES property item name.
+ */
+#define CCD_LOCAL_SYNC_FRAMES_ITEM_NAME       "FRAMES"
+
+//----------------------------------------------------------------------
+/** CCD_LOCAL_QUEUE property name.
+ */
+#define CCD_LOCAL_QUEUE_PROPERTY_NAME         "CCD_LOCAL_QUEUE"
+
+/** CCD_LOCAL_QUEUE.DEPTH property item name.
+ */
+#define CCD_LOCAL_QUEUE_DEPTH_ITEM_NAME       "DEPTH"
+
+/** CCD_LOCAL_QUEUE.PENDING property item name.
+ */
+#define CCD_LOCAL_QUEUE_PENDING_ITEM_NAME     "PENDING"
+
+/** CCD_LOCAL_QUEUE.THROUGHPUT property item name.
+ */
+#define CCD_LOCAL_QUEUE_THROUGHPUT_ITEM_NAME  "THROUGHPUT"
+
 //----------------------------------------------------------------------
 /** CCD_EXPOSURE property name.
  */
@@ -38,6 +38,7 @@
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <sys/time.h>
+#include <sys/un.h>
 #include <netinet/in.h>
 
 #ifdef INDIGO_LINUX
@@ -50,6 +51,7 @@
 #include "indigo_client_xml.h"
 #include "indigo_base64.h"
 #include "indigo_io.h"
+#include "indigo_metrics.h"
 
 #define SHA1_SIZE 20
 #if _MSC_VER
@@ -61,12 +63,14 @@
 void sha1(unsigned char h[static SHA1_SIZE], const void *_sha1_restrict p, size_t n);
 
 static int server_socket;
+static int local_server_socket = -1;
 static bool shutdown_initiated = false;
 static int client_count = 0;
 static indigo_server_tcp_callback server_callback;
 
 int indigo_server_tcp_port = 7624;
 bool indigo_is_ephemeral_port = false;
+char indigo_server_local_path[INDIGO_LOCAL_PATH_SIZE] = "";
 
 static struct resource {
 	char *path;
@@ -114,10 +118,16 @@ static void start_worker_thread(int *client_socket) {
 					if (param)
 						*param = 0;
 					char websocket_key[256] = "";
+					char websocket_extensions[BUFFER_SIZE] = "";
 					bool keep_alive = false;
 					while (indigo_read_line(socket, header, BUFFER_SIZE) > 0) {
 						if (!strncasecmp(header, "Sec-WebSocket-Key: ", 19))
 							strncpy(websocket_key, header + 19, 256);
+						if (!strncasecmp(header, "Sec-WebSocket-Extensions: ", 26)) {
+							if (*websocket_extensions)
+								strncat(websocket_extensions, ", ", BUFFER_SIZE - strlen(websocket_extensions) - 1);
+							strncat(websocket_extensions, header + 26, BUFFER_SIZE - strlen(websocket_extensions) - 1);
+						}
 						if (!strcasecmp(header, "Connection: keep-alive"))
 							keep_alive = true;
 					}
@@ -133,13 +143,17 @@ static void start_worker_thread(int *client_socket) {
 							indigo_printf(socket, "Connection: upgrade\r\n");
 							base64_encode((unsigned char *)websocket_key, shaHash, 20);
 							indigo_printf(socket, "Sec-WebSocket-Accept: %s\r\n", websocket_key);
-							indigo_printf(socket, "\r\n");
-							INDIGO_LOG(indigo_log("Protocol switched to JSON-over-WebSockets"));
-							indigo_client *protocol_adapter = indigo_json_device_adapter(socket, socket, true);
+							char accepted_extensions[256];
+							indigo_client *protocol_adapter = indigo_json_web_socket_device_adapter(socket, socket, websocket_extensions, accepted_extensions, sizeof(accepted_extensions));
 							assert(protocol_adapter != NULL);
+							if (*accepted_extensions)
+								indigo_printf(socket, "Sec-WebSocket-Extensions: %s\r\n", accepted_extensions);
+							indigo_printf(socket, "\r\n");
+							INDIGO_LOG(indigo_log("Protocol switched to JSON-over-WebSockets%s", *accepted_extensions ? " (compressed)" : ""));
 							indigo_attach_client(protocol_adapter);
 							indigo_json_parse(NULL, protocol_adapter);
 							indigo_detach_client(protocol_adapter);
+							indigo_release_json_device_adapter(protocol_adapter);
 							break;
 						} else {
 							indigo_printf(socket, "HTTP/1.1 301 OK\r\n");
@@ -152,22 +166,27 @@ static void start_worker_thread(int *client_socket) {
 						}
 					} else {
 						if (!strncmp(path, "/blob/", 6)) {
-							indigo_item *item;
-							if (sscanf(path, "/blob/%p.", &item) && indigo_validate_blob(item) == INDIGO_OK) {
+							unsigned long long id = 0;
+							char format[INDIGO_NAME_SIZE];
+							indigo_shared_message *data = NULL;
+							if (sscanf(path, "/blob/%16llx", &id) == 1)
+								data = indigo_acquire_blob(id, format);
+							if (data != NULL) {
 								indigo_printf(socket, "HTTP/1.1 200 OK\r\n");
 								indigo_printf(socket, "Server: INDIGO/%d.%d-%d\r\n", (INDIGO_VERSION_CURRENT >> 8) & 0xFF, INDIGO_VERSION_CURRENT & 0xFF, INDIGO_BUILD);
-								if (!strcmp(item->blob.format, ".jpeg")) {
+								if (!strcmp(format, ".jpeg")) {
 									indigo_printf(socket, "Content-Type: image/jpeg\r\n");
 								} else {
 									indigo_printf(socket, "Content-Type: application/octet-stream\r\n");
-									indigo_printf(socket, "Content-Disposition: attachment; filename=\"%p%s\"\r\n", item, item->blob.format);
+									indigo_printf(socket, "Content-Disposition: attachment; filename=\"%016llx%s\"\r\n", id, format);
 								}
 								if (keep_alive)
 									indigo_printf(socket, "Connection: keep-alive\r\n");
-								indigo_printf(socket, "Content-Length: %ld\r\n", item->blob.size);
+								indigo_printf(socket, "Content-Length: %ld\r\n", data->size);
 								indigo_printf(socket, "\r\n");
-								indigo_write(socket, item->blob.value, item->blob.size);
-								INDIGO_LOG(indigo_log("%s -> OK (%ld bytes)\r\n", request, item->blob.size));
+								indigo_write(socket, data->data, data->size);
+								INDIGO_LOG(indigo_log("%s -> OK (%ld bytes)\r\n", request, data->size));
+								indigo_shared_message_release(data);
 							} else {
 								indigo_printf(socket, "HTTP/1.1 404 Not found\r\n");
 								indigo_printf(socket, "Content-Type: text/plain\r\n");
@@ -179,6 +198,21 @@ static void start_worker_thread(int *client_socket) {
 								INDIGO_LOG(indigo_log("%s -> Failed", request));
 								break;
 							}
+						} else if (!strcmp(path, "/metrics")) {
+							long length = 0;
+							char *metrics = indigo_metrics_format(&length);
+							indigo_printf(socket, "HTTP/1.1 200 OK\r\n");
+							indigo_printf(socket, "Server: INDIGO/%d.%d-%d\r\n", (INDIGO_VERSION_CURRENT >> 8) & 0xFF, INDIGO_VERSION_CURRENT & 0xFF, INDIGO_BUILD);
+							indigo_printf(socket, "Content-Type: text/plain; version=0.0.4\r\n");
+							if (keep_alive)
+								indigo_printf(socket, "Connection: keep-alive\r\n");
+							indigo_printf(socket, "Content-Length: %ld\r\n", length);
+							indigo_printf(socket, "\r\n");
+							if (metrics != NULL) {
+								indigo_write(socket, metrics, length);
+								free(metrics);
+							}
+							INDIGO_LOG(indigo_log("%s -> OK (%ld bytes)", request, length));
 						} else {
 							struct resource *resource = resources;
 							while (resource != NULL)
@@ -236,6 +270,12 @@ static void start_worker_thread(int *client_socket) {
 void indigo_server_shutdown() {
 	if (!shutdown_initiated) {
 		shutdown_initiated = true;
+		if (local_server_socket >= 0) {
+			shutdown(local_server_socket, SHUT_RDWR);
+			close(local_server_socket);
+			local_server_socket = -1;
+			unlink(indigo_server_local_path);
+		}
 		shutdown(server_socket, SHUT_RDWR);
 		close(server_socket);
 	}
@@ -252,6 +292,60 @@ void indigo_server_add_resource(const char *path, unsigned char *data, unsigned
 	resources = resource;
 }
 
+static void local_server_thread(int *server_socket) {
+	int socket = *server_socket;
+	while (1) {
+		int client_socket = accept(socket, NULL, NULL);
+		if (client_socket == -1) {
+			if (shutdown_initiated || local_server_socket == -1)
+				break;
+			indigo_error("Can't accept local connection (%s)", strerror(errno));
+		} else {
+			pthread_t thread;
+			int *pointer = malloc(sizeof(int));
+			*pointer = client_socket;
+			if (pthread_create(&thread , NULL, (void *(*)(void *))&start_worker_thread, pointer) != 0)
+				indigo_error("Can't create worker thread for local connection (%s)", strerror(errno));
+		}
+	}
+	INDIGO_LOG(indigo_log("Local server on %s finished", indigo_server_local_path));
+}
+
+static bool start_local_server() {
+	local_server_socket = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (local_server_socket == -1) {
+		indigo_error("Can't open local server socket (%s)", strerror(errno));
+		return false;
+	}
+	struct sockaddr_un server_address;
+	memset(&server_address, 0, sizeof(server_address));
+	server_address.sun_family = AF_UNIX;
+	strncpy(server_address.sun_path, indigo_server_local_path, sizeof(server_address.sun_path) - 1);
+	unlink(server_address.sun_path);
+	if (bind(local_server_socket, (struct sockaddr *)&server_address, sizeof(server_address)) < 0) {
+		indigo_error("Can't bind local server socket %s (%s)", indigo_server_local_path, strerror(errno));
+		close(local_server_socket);
+		local_server_socket = -1;
+		return false;
+	}
+	if (listen(local_server_socket, 5) < 0) {
+		indigo_error("Can't listen on local server socket (%s)", strerror(errno));
+		close(local_server_socket);
+		local_server_socket = -1;
+		return false;
+	}
+	pthread_t thread;
+	if (pthread_create(&thread, NULL, (void *(*)(void *))&local_server_thread, &local_server_socket) != 0) {
+		indigo_error("Can't create local server thread (%s)", strerror(errno));
+		close(local_server_socket);
+		local_server_socket = -1;
+		return false;
+	}
+	pthread_detach(thread);
+	INDIGO_LOG(indigo_log("Local server started on %s", indigo_server_local_path));
+	return true;
+}
+
 indigo_result indigo_server_start(indigo_server_tcp_callback callback) {
 	server_callback = callback;
 	int client_socket;
@@ -299,6 +393,8 @@ indigo_result indigo_server_start(indigo_server_tcp_callback callback) {
 	INDIGO_LOG(indigo_log("Server started on %d", indigo_server_tcp_port));
 	server_callback(client_count);
 	signal(SIGPIPE, SIG_IGN);
+	if (*indigo_server_local_path)
+		start_local_server();
 	while (1) {
 		client_socket = accept(server_socket, (struct sockaddr *)&client_name, &name_len);
 		if (client_socket == -1) {
@@ -44,6 +44,14 @@ extern int indigo_server_tcp_port;
  */
 extern bool indigo_is_ephemeral_port;
 
+/** Maximal length of local socket path (sun_path size on macOS).
+ */
+#define INDIGO_LOCAL_PATH_SIZE	104
+
+/** Unix domain socket path for same-host clients (empty if not used).
+ */
+extern char indigo_server_local_path[INDIGO_LOCAL_PATH_SIZE];
+
 /** Add static document.
  */
 extern void indigo_server_add_resource(const char *path, unsigned char *data, unsigned length, const char *content_type);
@@ -30,6 +30,7 @@
 #include <errno.h>
 
 #include "indigo_timer.h"
+#include "indigo_metrics.h"
 
 #include "indigo_driver.h"
 
@@ -76,11 +77,20 @@ static void *timer_func(indigo_timer *timer) {
 					if (rc == ETIMEDOUT)
 						break;
 				}
+				if (!timer->canceled) {
+					struct timespec now;
+					utc_time(&now);
+					long long lateness = (now.tv_sec - end.tv_sec) * 1000000LL + (now.tv_nsec - end.tv_nsec) / 1000;
+					indigo_histogram_record(&indigo_timer_lateness_histogram, lateness > 0 ? lateness : 0);
+				}
 			}
 
 			timer->scheduled = false;
 			if (!timer->canceled) {
-				timer->callback(timer->device);
+				if (timer->callback_with_data)
+					timer->callback_with_data(timer->device, timer->data);
+				else
+					timer->callback(timer->device);
 			}
 		}
 
@@ -118,7 +128,7 @@ static void *timer_func(indigo_timer *timer) {
 	return NULL;
 }
 
-indigo_timer *indigo_set_timer(indigo_device *device, double delay, indigo_timer_callback callback) {
+static indigo_timer *set_timer(indigo_device *device, double delay, indigo_timer_callback callback, indigo_timer_with_data_callback callback_with_data, void *data) {
 	indigo_timer *timer = NULL;
 	pthread_mutex_lock(&free_timer_mutex);
 	if (free_timer != NULL) {
@@ -135,6 +145,8 @@ indigo_timer *indigo_set_timer(indigo_device *device, double delay, indigo_timer
 			timer->next = NULL;
 		}
 		timer->callback = callback;
+		timer->callback_with_data = callback_with_data;
+		timer->data = data;
 		pthread_mutex_lock(&timer->mutex);
 		pthread_cond_signal(&timer->cond);
 		pthread_mutex_unlock(&timer->mutex);
@@ -153,12 +165,22 @@ indigo_timer *indigo_set_timer(indigo_device *device, double delay, indigo_timer
 		}
 		timer->delay = delay;
 		timer->callback = callback;
+		timer->callback_with_data = callback_with_data;
+		timer->data = data;
 		pthread_create(&timer->thread, NULL, (void * (*)(void*))timer_func, timer);
 	}
 	pthread_mutex_unlock(&free_timer_mutex);
 	return timer;
 }
 
+indigo_timer *indigo_set_timer(indigo_device *device, double delay, indigo_timer_callback callback) {
+	return set_timer(device, delay, callback, NULL, NULL);
+}
+
+indigo_timer *indigo_set_timer_with_data(indigo_device *device, double delay, indigo_timer_with_data_callback callback, void *data) {
+	return set_timer(device, delay, NULL, callback, data);
+}
+
 // TODO: do we need device?
 
 bool indigo_reschedule_timer(indigo_device *device, double delay, indigo_timer **timer) {
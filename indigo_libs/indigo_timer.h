@@ -39,6 +39,10 @@ extern "C" {
  */
 typedef void (*indigo_timer_callback)(indigo_device *device);
 
+/** Timer callback function prototype with user data.
+ */
+typedef void (*indigo_timer_with_data_callback)(indigo_device *device, void *data);
+
 /** Timer structure.
  */
 typedef struct indigo_timer {
@@ -53,6 +57,8 @@ typedef struct indigo_timer {
 	pthread_mutex_t mutex;
 	pthread_t thread;
 	struct indigo_timer *next;
+	indigo_timer_with_data_callback callback_with_data; ///< callback function pointer (if used instead of callback)
+	void *data;                               ///< user data passed to callback_with_data
 } indigo_timer;
 
 /* fix timespec so that abs(tv_nsec) < 1s */
@@ -83,6 +89,10 @@ static inline void normalize_timespec(struct timespec *ts) {
  */
 extern indigo_timer *indigo_set_timer(indigo_device *device, double delay, indigo_timer_callback callback);
 
+/** Set timer with callback receiving user data.
+ */
+extern indigo_timer *indigo_set_timer_with_data(indigo_device *device, double delay, indigo_timer_with_data_callback callback, void *data);
+
 /** Rescheduled timer (if not null).
  */
 extern bool indigo_reschedule_timer(indigo_device *device, double delay, indigo_timer **timer);
@@ -6,9 +6,13 @@
 //  Copyright © 2018 CloudMakers, s. r. o. All rights reserved.
 //
 
+#include <stdlib.h>
 #include <string.h>
+#include <pthread.h>
+#include <sys/time.h>
 
 #include "indigo_bus.h"
+#include "indigo_driver.h"
 #include "indigo_usb_utils.h"
 
 indigo_result indigo_get_usb_path(libusb_device* handle, char *path) {
@@ -31,3 +35,99 @@ indigo_result indigo_get_usb_path(libusb_device* handle, char *path) {
 	}
 	return INDIGO_OK;
 }
+
+typedef struct {
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	unsigned char *buffer;
+	long count, submitted, received;
+	int chunk_size;
+	int in_flight;
+	int status;
+	bool cancelled;
+	struct libusb_transfer **transfers;
+	int transfer_count;
+} bulk_read_state;
+
+static void LIBUSB_CALL bulk_read_callback(struct libusb_transfer *transfer) {
+	bulk_read_state *state = transfer->user_data;
+	pthread_mutex_lock(&state->mutex);
+	state->in_flight--;
+	if (transfer->status == LIBUSB_TRANSFER_COMPLETED) {
+		state->received += transfer->actual_length;
+		// short transfer in the middle of the frame would leave a gap in the buffer
+		if (transfer->actual_length < transfer->length && state->status == 0 && state->received < state->count)
+			state->status = LIBUSB_ERROR_IO;
+	} else if (state->status == 0) {
+		state->status = transfer->status == LIBUSB_TRANSFER_TIMED_OUT ? LIBUSB_ERROR_TIMEOUT : transfer->status == LIBUSB_TRANSFER_NO_DEVICE ? LIBUSB_ERROR_NO_DEVICE : LIBUSB_ERROR_IO;
+	}
+	if (state->status == 0 && state->submitted < state->count) {
+		int size = state->count - state->submitted < state->chunk_size ? (int)(state->count - state->submitted) : state->chunk_size;
+		libusb_fill_bulk_transfer(transfer, transfer->dev_handle, transfer->endpoint, state->buffer + state->submitted, size, bulk_read_callback, state, transfer->timeout);
+		if ((state->status = libusb_submit_transfer(transfer)) == 0) {
+			state->submitted += size;
+			state->in_flight++;
+		}
+	}
+	if (state->status != 0 && !state->cancelled) {
+		state->cancelled = true;
+		for (int i = 0; i < state->transfer_count; i++) {
+			if (state->transfers[i] != transfer)
+				libusb_cancel_transfer(state->transfers[i]);
+		}
+	}
+	if (state->in_flight == 0)
+		pthread_cond_signal(&state->cond);
+	pthread_mutex_unlock(&state->mutex);
+}
+
+bool indigo_usb_bulk_read(libusb_device_handle *handle, unsigned char endpoint, unsigned char *buffer, long count, int chunk_size, int transfers, unsigned int timeout, double *duration) {
+	struct timeval start, end;
+	gettimeofday(&start, NULL);
+	indigo_start_usb_event_handler();
+	bulk_read_state state;
+	memset(&state, 0, sizeof(state));
+	state.transfers = calloc(transfers, sizeof(struct libusb_transfer *));
+	if (state.transfers == NULL)
+		return false;
+	pthread_mutex_init(&state.mutex, NULL);
+	pthread_cond_init(&state.cond, NULL);
+	state.buffer = buffer;
+	state.count = count;
+	state.chunk_size = chunk_size;
+	pthread_mutex_lock(&state.mutex);
+	for (int i = 0; i < transfers && state.submitted < count && state.status == 0; i++) {
+		struct libusb_transfer *transfer = libusb_alloc_transfer(0);
+		if (transfer == NULL) {
+			if (i == 0)
+				state.status = LIBUSB_ERROR_NO_MEM;
+			break;
+		}
+		state.transfers[state.transfer_count++] = transfer;
+		int size = count - state.submitted < chunk_size ? (int)(count - state.submitted) : chunk_size;
+		libusb_fill_bulk_transfer(transfer, handle, endpoint, buffer + state.submitted, size, bulk_read_callback, &state, timeout);
+		if ((state.status = libusb_submit_transfer(transfer)) == 0) {
+			state.submitted += size;
+			state.in_flight++;
+		}
+	}
+	if (state.status != 0 && !state.cancelled) {
+		state.cancelled = true;
+		for (int i = 0; i < state.transfer_count; i++)
+			libusb_cancel_transfer(state.transfers[i]);
+	}
+	while (state.in_flight > 0)
+		pthread_cond_wait(&state.cond, &state.mutex);
+	pthread_mutex_unlock(&state.mutex);
+	for (int i = 0; i < state.transfer_count; i++)
+		libusb_free_transfer(state.transfers[i]);
+	free(state.transfers);
+	pthread_mutex_destroy(&state.mutex);
+	pthread_cond_destroy(&state.cond);
+	gettimeofday(&end, NULL);
+	if (duration)
+		*duration = (end.tv_sec - start.tv_sec) + (end.tv_usec - start.tv_usec) / 1000000.0;
+	if (state.status != 0)
+		INDIGO_DEBUG(indigo_debug("indigo_usb_bulk_read(%02x) -> %ld of %ld bytes %s", endpoint, state.received, count, libusb_error_name(state.status)));
+	return state.status == 0 && state.received == count;
+}
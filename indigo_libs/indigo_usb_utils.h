@@ -27,6 +27,7 @@
 #define indigo_usb_utils_h
 
 #include <stdio.h>
+#include <stdbool.h>
 
 #if defined(INDIGO_MACOS)
 #include <libusb-1.0/libusb.h>
@@ -43,6 +44,11 @@ extern "C" {
 #endif
 
 extern indigo_result indigo_get_usb_path(libusb_device* handle, char *path);
+
+/** Read count bytes from bulk endpoint to buffer keeping up to transfers asynchronous chunk_size transfers in flight.
+ Transfers are completed on USB event handler thread, duration of the whole read in seconds is returned in duration (if not NULL).
+ */
+extern bool indigo_usb_bulk_read(libusb_device_handle *handle, unsigned char endpoint, unsigned char *buffer, long count, int chunk_size, int transfers, unsigned int timeout, double *duration);
 	
 #ifdef __cplusplus
 }
@@ -37,6 +37,13 @@
 
 #if defined(INDIGO_LINUX) || defined(INDIGO_MACOS)
 #include <unistd.h>
+#include <sys/mman.h>
+#include <poll.h>
+#endif
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
 #endif
 #if defined(INDIGO_WINDOWS)
 #include <io.h>
@@ -51,9 +58,19 @@
 #include "indigo_driver_xml.h"
 
 #define BUFFER_SIZE 524288  /* BUFFER_SIZE % 4 == 0, inportant for base64 */
+#define SCAN_PADDING 16     /* vector scanner may read up to 15 bytes beyond terminating \0 */
+#define MAX_DESCRIPTORS 16  /* shared memory descriptors received ahead of their oneBLOB elements */
+#define RESYNC_QUIET_TIME 1 /* resynchronization is finished when no definition arrives for this time (s) */
 
 #define PROPERTY_SIZE sizeof(indigo_property)+INDIGO_MAX_ITEMS*(sizeof(indigo_item))
 
+// handlers write only to items below property->count, so it is enough to clear them (full property buffer is ~80kB)
+
+static inline void reset_property(indigo_property *property) {
+	int count = property->count < INDIGO_MAX_ITEMS ? property->count : INDIGO_MAX_ITEMS;
+	memset(property, 0, sizeof(indigo_property) + count * sizeof(indigo_item));
+}
+
 typedef enum {
 	ERROR,
 	IDLE,
@@ -127,14 +144,110 @@ typedef struct {
 	char property_buffer[PROPERTY_SIZE];
 	indigo_device *device;
 	indigo_client *client;
-	int count;
-	indigo_property **properties;
+	indigo_xml_cache *cache;
+	bool local_socket;
+	int descriptors[MAX_DESCRIPTORS];
+	int descriptor_count;
+	int shm_descriptor;
+	void *mappings[INDIGO_MAX_ITEMS];
+	long mapping_sizes[INDIGO_MAX_ITEMS];
+	int mapping_count;
 } parser_context;
 
 bool indigo_use_blob_urls = true;
 
 typedef void *(* parser_handler)(parser_state state, parser_context *context, char *name, char *value, char *message);
 
+static double current_time() {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+static void release_cached_property(indigo_property *property) {
+	if (property->type == INDIGO_BLOB_VECTOR) {
+		for (int i = 0; i < property->count; i++) {
+			void *blob = property->items[i].blob.value;
+			if (blob)
+				free(blob);
+		}
+	}
+	indigo_release_property(property);
+}
+
+static void finish_resync(parser_context *context) {
+	indigo_xml_cache *cache = context->cache;
+	int removed = 0;
+	cache->resync = false;
+	for (int index = 0; index < cache->count; index++) {
+		indigo_property *property = cache->properties[index];
+		if (property != NULL && cache->stale[index]) {
+			indigo_delete_property(context->device, property, NULL);
+			release_cached_property(property);
+			cache->properties[index] = NULL;
+			removed++;
+		}
+		cache->stale[index] = false;
+	}
+	INDIGO_LOG(indigo_log("XML Parser: %s resynchronized, %d properties removed", context->device->name, removed));
+}
+
+// descriptors passed over local socket are queued in order and consumed by oneBLOB elements with shm attribute
+
+static ssize_t parser_read(parser_context *context, int handle, void *buffer, size_t length) {
+	if (context->cache->resync) {
+		// remote server doesn't mark the end of definitions, resynchronization is over when they stop arriving
+		while (true) {
+			double idle = current_time() - context->cache->last_definition;
+			if (idle >= RESYNC_QUIET_TIME) {
+				finish_resync(context);
+				break;
+			}
+#if defined(INDIGO_LINUX) || defined(INDIGO_MACOS)
+			struct pollfd descriptor = { handle, POLLIN, 0 };
+			if (poll(&descriptor, 1, (int)((RESYNC_QUIET_TIME - idle) * 1000) + 1) != 0)
+				break;
+#else
+			break;
+#endif
+		}
+	}
+	if (context->local_socket)
+		return indigo_read_with_descriptors(handle, buffer, length, context->descriptors, &context->descriptor_count, MAX_DESCRIPTORS);
+	return read(handle, buffer, length);
+}
+
+static int pop_descriptor(parser_context *context) {
+	if (context->descriptor_count == 0)
+		return -1;
+	int descriptor = context->descriptors[0];
+	memmove(context->descriptors, context->descriptors + 1, --context->descriptor_count * sizeof(int));
+	return descriptor;
+}
+
+static void *map_descriptor(parser_context *context, int descriptor, long size) {
+	if (context->mapping_count >= INDIGO_MAX_ITEMS) {
+		close(descriptor);
+		return NULL;
+	}
+	void *mapping = indigo_shm_map(descriptor, size);
+	if (mapping == NULL) {
+		indigo_error("XML Parser: can't map shared BLOB (%s)", strerror(errno));
+	} else {
+		context->mappings[context->mapping_count] = mapping;
+		context->mapping_sizes[context->mapping_count++] = size;
+	}
+	return mapping;
+}
+
+static void unmap_descriptors(parser_context *context) {
+#if defined(INDIGO_LINUX) || defined(INDIGO_MACOS)
+	for (int i = 0; i < context->mapping_count; i++)
+		munmap(context->mappings[i], context->mapping_sizes[i]);
+#endif
+	context->mapping_count = 0;
+}
+
 static void *top_level_handler(parser_state state, parser_context *context, char *name, char *value, char *message);
 static void *new_text_vector_handler(parser_state state, parser_context *context, char *name, char *value, char *message);
 static void *new_number_vector_handler(parser_state state, parser_context *context, char *name, char *value, char *message);
@@ -195,7 +308,7 @@ static void *enable_blob_handler(parser_state state, parser_context *context, ch
 			indigo_enable_blob(client, property, INDIGO_ENABLE_BLOB_NEVER);
 		}		
 	} else if (state == END_TAG) {
-		memset(property, 0, PROPERTY_SIZE);
+		reset_property(property);
 		return top_level_handler;
 	}
 	return enable_blob_handler;
@@ -226,6 +339,9 @@ static void *get_properties_handler(parser_state state, parser_context *context,
 				indigo_printf(handle, "<switchProtocol version='%d.%d'/>\n", (version >> 8) & 0xFF, version & 0xFF);
 				client->version = version;
 			}
+		} else if (!strcmp(name, "shm")) {
+			indigo_adapter_context *client_context = (indigo_adapter_context *)client->client_context;
+			client_context->shared_memory = !strcmp(value, "1") && indigo_is_local_socket(client_context->output);
 		} else if (!strncmp(name, "device",INDIGO_NAME_SIZE)) {
 			strncpy(property->device, value, INDIGO_NAME_SIZE);
 		} else if (!strncmp(name, "name",INDIGO_NAME_SIZE)) {
@@ -233,7 +349,7 @@ static void *get_properties_handler(parser_state state, parser_context *context,
 		}
 	} else if (state == END_TAG) {
 		indigo_enumerate_properties(client, property);
-		memset(property, 0, PROPERTY_SIZE);
+		reset_property(property);
 		return top_level_handler;
 	}
 	return get_properties_handler;
@@ -275,7 +391,7 @@ static void *new_text_vector_handler(parser_state state, parser_context *context
 		}
 	} else if (state == END_TAG) {
 		indigo_change_property(client, property);
-		memset(property, 0, PROPERTY_SIZE);
+		reset_property(property);
 		return top_level_handler;
 	}
 	return new_text_vector_handler;
@@ -317,7 +433,7 @@ static void *new_number_vector_handler(parser_state state, parser_context *conte
 		}
 	} else if (state == END_TAG) {
 		indigo_change_property(client, property);
-		memset(property, 0, PROPERTY_SIZE);
+		reset_property(property);
 		return top_level_handler;
 	}
 	return new_number_vector_handler;
@@ -360,7 +476,7 @@ static void *new_switch_vector_handler(parser_state state, parser_context *conte
 		return new_switch_vector_handler;
 	} else if (state == END_TAG) {
 		indigo_change_property(client, property);
-		memset(property, 0, PROPERTY_SIZE);
+		reset_property(property);
 		return top_level_handler;
 	}
 	return new_switch_vector_handler;
@@ -383,9 +499,10 @@ static void *switch_protocol_handler(parser_state state, parser_context *context
 }
 
 static void set_property(parser_context *context, indigo_property *other, char *message) {
-	for (int index = 0; index < context->count; index++) {
-		indigo_property *property = context->properties[index];
+	for (int index = 0; index < context->cache->count; index++) {
+		indigo_property *property = context->cache->properties[index];
 		if (property != NULL && !strncmp(property->device, other->device, INDIGO_NAME_SIZE) && !strncmp(property->name, other->name, INDIGO_NAME_SIZE)) {
+			context->cache->stale[index] = false;
 			property->state = other->state;
 			if (property->type == INDIGO_SWITCH_VECTOR && property->rule != INDIGO_ANY_OF_MANY_RULE) {
 				for (int j = 0; j < property->count; j++) {
@@ -488,7 +605,7 @@ static void *set_text_vector_handler(parser_state state, parser_context *context
 		}
 	} else if (state == END_TAG) {
 		set_property(context, property, message);
-		memset(property, 0, PROPERTY_SIZE);
+		reset_property(property);
 		return top_level_handler;
 	}
 	return set_text_vector_handler;
@@ -549,7 +666,7 @@ static void *set_number_vector_handler(parser_state state, parser_context *conte
 		}
 	} else if (state == END_TAG) {
 		set_property(context, property, message);
-		memset(property, 0, PROPERTY_SIZE);
+		reset_property(property);
 		return top_level_handler;
 	}
 	return set_number_vector_handler;
@@ -596,7 +713,7 @@ static void *set_switch_vector_handler(parser_state state, parser_context *conte
 		}
 	} else if (state == END_TAG) {
 		set_property(context, property, message);
-		memset(property, 0, PROPERTY_SIZE);
+		reset_property(property);
 		return top_level_handler;
 	}
 	return set_switch_vector_handler;
@@ -643,7 +760,7 @@ static void *set_light_vector_handler(parser_state state, parser_context *contex
 		}
 	} else if (state == END_TAG) {
 		set_property(context, property, message);
-		memset(property, 0, PROPERTY_SIZE);
+		reset_property(property);
 		return top_level_handler;
 	}
 	return set_light_vector_handler;
@@ -667,10 +784,19 @@ static void *set_one_blob_vector_handler(parser_state state, parser_context *con
 			snprintf(property->items[property->count-1].blob.url, INDIGO_VALUE_SIZE, "%s%s", ((indigo_adapter_context *)context->device->device_context)->url_prefix, value);
 		} else if (!strcmp(name, "url")) {
 			strncpy(property->items[property->count-1].blob.url, value, INDIGO_VALUE_SIZE);
+		} else if (!strcmp(name, "shm")) {
+			context->shm_descriptor = pop_descriptor(context);
 		}
 	} else if (state == BLOB) {
 		property->items[property->count-1].blob.value = value;
 	} else if (state == END_TAG) {
+		if (context->shm_descriptor >= 0) {
+			indigo_item *item = property->items + property->count - 1;
+			item->blob.value = map_descriptor(context, context->shm_descriptor, item->blob.size);
+			if (item->blob.value == NULL)
+				item->blob.size = 0;
+			context->shm_descriptor = -1;
+		}
 		return set_blob_vector_handler;
 	}
 	return set_one_blob_vector_handler;
@@ -701,27 +827,111 @@ static void *set_blob_vector_handler(parser_state state, parser_context *context
 		}
 	} else if (state == END_TAG) {
 		set_property(context, property, message);
-		memset(property, 0, PROPERTY_SIZE);
+		reset_property(property);
+		unmap_descriptors(context);
 		return top_level_handler;
 	}
 	return set_blob_vector_handler;
 }
 
+static bool same_definition(indigo_property *property, indigo_property *other) {
+	if (property->type != other->type || property->perm != other->perm || property->rule != other->rule || property->count != other->count)
+		return false;
+	if (strncmp(property->group, other->group, INDIGO_NAME_SIZE) || strncmp(property->label, other->label, INDIGO_VALUE_SIZE))
+		return false;
+	for (int i = 0; i < property->count; i++) {
+		indigo_item *property_item = property->items + i;
+		indigo_item *other_item = other->items + i;
+		if (strncmp(property_item->name, other_item->name, INDIGO_NAME_SIZE) || strncmp(property_item->label, other_item->label, INDIGO_VALUE_SIZE))
+			return false;
+		if (property->type == INDIGO_NUMBER_VECTOR) {
+			if (property_item->number.min != other_item->number.min || property_item->number.max != other_item->number.max || property_item->number.step != other_item->number.step || strncmp(property_item->number.format, other_item->number.format, INDIGO_VALUE_SIZE))
+				return false;
+		}
+	}
+	return true;
+}
+
+static bool copy_values(indigo_property *property, indigo_property *other) {
+	bool changed = property->state != other->state;
+	property->state = other->state;
+	for (int i = 0; i < property->count; i++) {
+		indigo_item *property_item = property->items + i;
+		indigo_item *other_item = other->items + i;
+		switch (property->type) {
+			case INDIGO_TEXT_VECTOR:
+				if (strncmp(property_item->text.value, other_item->text.value, INDIGO_VALUE_SIZE)) {
+					strncpy(property_item->text.value, other_item->text.value, INDIGO_VALUE_SIZE);
+					changed = true;
+				}
+				break;
+			case INDIGO_NUMBER_VECTOR:
+				if (property_item->number.value != other_item->number.value || property_item->number.target != other_item->number.target) {
+					property_item->number.value = other_item->number.value;
+					property_item->number.target = other_item->number.target;
+					changed = true;
+				}
+				break;
+			case INDIGO_SWITCH_VECTOR:
+				if (property_item->sw.value != other_item->sw.value) {
+					property_item->sw.value = other_item->sw.value;
+					changed = true;
+				}
+				break;
+			case INDIGO_LIGHT_VECTOR:
+				if (property_item->light.value != other_item->light.value) {
+					property_item->light.value = other_item->light.value;
+					changed = true;
+				}
+				break;
+			default:
+				break;
+		}
+	}
+	return changed;
+}
+
 static void def_property(parser_context *context, indigo_property *other, char *message) {
+	indigo_xml_cache *cache = context->cache;
 	indigo_property *property = NULL;
-	int index;
-	for (index = 0; index < context->count; index++) {
-		property = context->properties[index];
-		if (property == NULL)
-			break;
+	int index, free_index = -1;
+	// deleted properties leave holes, so the whole cache has to be searched before a free slot is used
+	for (index = 0; index < cache->count; index++) {
+		property = cache->properties[index];
+		if (property == NULL) {
+			if (free_index < 0)
+				free_index = index;
+			continue;
+		}
 		if (!strncmp(property->device, other->device, INDIGO_NAME_SIZE) && !strncmp(property->name, other->name, INDIGO_NAME_SIZE))
 			break;
 	}
-	if (index == context->count) {
-		context->properties = realloc(context->properties, context->count * 2 * sizeof(indigo_property *));
-		memset(context->properties + context->count, 0, context->count * sizeof(indigo_property *));
-		context->count *= 2;
+	if (index == cache->count) {
 		property = NULL;
+		if (free_index >= 0) {
+			index = free_index;
+		} else {
+			cache->properties = realloc(cache->properties, cache->count * 2 * sizeof(indigo_property *));
+			memset(cache->properties + cache->count, 0, cache->count * sizeof(indigo_property *));
+			cache->stale = realloc(cache->stale, cache->count * 2 * sizeof(bool));
+			memset(cache->stale + cache->count, 0, cache->count * sizeof(bool));
+			cache->count *= 2;
+		}
+	}
+	if (cache->resync) {
+		cache->last_definition = current_time();
+		if (property != NULL && cache->stale[index]) {
+			// property cached before reconnect, broadcast only what changed since
+			cache->stale[index] = false;
+			if (same_definition(property, other)) {
+				if (copy_values(property, other))
+					indigo_update_property(context->device, property, *message ? message : NULL);
+				return;
+			}
+			indigo_delete_property(context->device, property, NULL);
+			release_cached_property(property);
+			cache->properties[index] = property = NULL;
+		}
 	}
 	if (property == NULL) {
 		switch (other->type) {
@@ -754,7 +964,8 @@ static void def_property(parser_context *context, indigo_property *other, char *
 				}
 				break;
 		}
-		context->properties[index] = property;
+		cache->properties[index] = property;
+		cache->stale[index] = false;
 	}
 	INDIGO_TRACE_PARSER(indigo_trace("XML Parser: def_property '%s' '%s' %d", property->device, property->name, index));
 	indigo_define_property(context->device, property, *message ? message : NULL);
@@ -809,7 +1020,7 @@ static void *def_text_vector_handler(parser_state state, parser_context *context
 		}
 	} else if (state == END_TAG) {
 		def_property(context, property, message);
-		memset(property, 0, PROPERTY_SIZE);
+		reset_property(property);
 		return top_level_handler;
 	}
 	return def_text_vector_handler;
@@ -872,7 +1083,7 @@ static void *def_number_vector_handler(parser_state state, parser_context *conte
 		}
 	} else if (state == END_TAG) {
 		def_property(context, property, message);
-		memset(property, 0, PROPERTY_SIZE);
+		reset_property(property);
 		return top_level_handler;
 	}
 	return def_number_vector_handler;
@@ -929,7 +1140,7 @@ static void *def_switch_vector_handler(parser_state state, parser_context *conte
 		}
 	} else if (state == END_TAG) {
 		def_property(context, property, message);
-		memset(property, 0, PROPERTY_SIZE);
+		reset_property(property);
 		return top_level_handler;
 	}
 	return def_switch_vector_handler;
@@ -982,7 +1193,7 @@ static void *def_light_vector_handler(parser_state state, parser_context *contex
 		}
 	} else if (state == END_TAG) {
 		def_property(context, property, message);
-		memset(property, 0, PROPERTY_SIZE);
+		reset_property(property);
 		return top_level_handler;
 	}
 	return def_light_vector_handler;
@@ -1039,7 +1250,7 @@ static void *def_blob_vector_handler(parser_state state, parser_context *context
 		}
 	} else if (state == END_TAG) {
 		def_property(context, property, message);
-		memset(property, 0, PROPERTY_SIZE);
+		reset_property(property);
 		return top_level_handler;
 	}
 	return def_blob_vector_handler;
@@ -1062,26 +1273,26 @@ static void *del_property_handler(parser_state state, parser_context *context, c
 		}
 	} else if (state == END_TAG) {
 		if (*property->name) {
-			for (int i = 0; i < context->count; i++) {
-				indigo_property *tmp = context->properties[i];
+			for (int i = 0; i < context->cache->count; i++) {
+				indigo_property *tmp = context->cache->properties[i];
 				if (tmp != NULL && !strncmp(tmp->device, property->device, INDIGO_NAME_SIZE) && !strncmp(tmp->name, property->name, INDIGO_NAME_SIZE)) {
 					indigo_delete_property(device, tmp, *message ? message : NULL);
 					indigo_release_property(tmp);
-					context->properties[i] = NULL;
+					context->cache->properties[i] = NULL;
 					break;
 				}
 			}
 		} else {
-			for (int i = 0; i < context->count; i++) {
-				indigo_property *tmp = context->properties[i];
+			for (int i = 0; i < context->cache->count; i++) {
+				indigo_property *tmp = context->cache->properties[i];
 				if (tmp != NULL && !strncmp(tmp->device, property->device, INDIGO_NAME_SIZE)) {
 					indigo_delete_property(device, tmp, *message ? message : NULL);
 					indigo_release_property(tmp);
-					context->properties[i] = NULL;
+					context->cache->properties[i] = NULL;
 				}
 			}
 		}
-		memset(property, 0, PROPERTY_SIZE);
+		reset_property(property);
 		return top_level_handler;
 	}
 	return del_property_handler;
@@ -1097,7 +1308,7 @@ static void *message_handler(parser_state state, parser_context *context, char *
 		}
 	} else if (state == END_TAG) {
 		indigo_send_message(device, *message ? message : NULL);
-		memset(property, 0, PROPERTY_SIZE);
+		reset_property(property);
 		return top_level_handler;
 	}
 	return message_handler;
@@ -1175,8 +1386,43 @@ static void *top_level_handler(parser_state state, parser_context *context, char
 	return top_level_handler;
 }
 
+// Find first occurence of a, b or terminating \0 in 16 byte chunks, so runs of ordinary characters in text
+// and attribute values don't need to pass through the state machine one by one.
+
+static inline char *xml_scan(char *pointer, char a, char b) {
+#if defined(__SSE2__)
+	__m128i va = _mm_set1_epi8(a);
+	__m128i vb = _mm_set1_epi8(b);
+	__m128i vz = _mm_setzero_si128();
+	while (true) {
+		__m128i chunk = _mm_loadu_si128((const __m128i *)pointer);
+		int mask = _mm_movemask_epi8(_mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, va), _mm_cmpeq_epi8(chunk, vb)), _mm_cmpeq_epi8(chunk, vz)));
+		if (mask)
+			return pointer + __builtin_ctz(mask);
+		pointer += 16;
+	}
+#elif defined(__aarch64__)
+	uint8x16_t va = vdupq_n_u8(a);
+	uint8x16_t vb = vdupq_n_u8(b);
+	while (true) {
+		uint8x16_t chunk = vld1q_u8((const uint8_t *)pointer);
+		uint8x16_t match = vorrq_u8(vorrq_u8(vceqq_u8(chunk, va), vceqq_u8(chunk, vb)), vceqzq_u8(chunk));
+		if (vmaxvq_u8(match)) {
+			while (*pointer && *pointer != a && *pointer != b)
+				pointer++;
+			return pointer;
+		}
+		pointer += 16;
+	}
+#else
+	while (*pointer && *pointer != a && *pointer != b)
+		pointer++;
+	return pointer;
+#endif
+}
+
 void indigo_xml_parse(indigo_device *device, indigo_client *client) {
-	char *buffer = malloc(BUFFER_SIZE+3); /* BUFFER_SIZE % 4 == 0 and keep always +3 for base64 alignmet */
+	char *buffer = malloc(BUFFER_SIZE+3+SCAN_PADDING); /* BUFFER_SIZE % 4 == 0 and keep always +3 for base64 alignmet */
 	assert(buffer != NULL);
 	char *value_buffer = malloc(BUFFER_SIZE+1); /* +1 to accomodate \0" */
 	assert(value_buffer != NULL);
@@ -1204,13 +1450,29 @@ void indigo_xml_parse(indigo_device *device, indigo_client *client) {
 	parser_context context;
 	context.client = client;
 	context.device = device;
+	context.descriptor_count = 0;
+	context.shm_descriptor = -1;
+	context.mapping_count = 0;
+	indigo_xml_cache local_cache;
+	memset(&local_cache, 0, sizeof(local_cache));
+	context.cache = &local_cache;
 	if (device != NULL) {
-		context.count = 32;
-		context.properties = malloc(context.count * sizeof(indigo_property *));
-		memset(context.properties, 0, context.count * sizeof(indigo_property *));
-	} else {
-		context.count = 0;
-		context.properties = NULL;
+		if (((indigo_adapter_context *)device->device_context)->cache != NULL)
+			context.cache = ((indigo_adapter_context *)device->device_context)->cache;
+		if (context.cache->count == 0) {
+			context.cache->count = 32;
+			context.cache->properties = malloc(context.cache->count * sizeof(indigo_property *));
+			memset(context.cache->properties, 0, context.cache->count * sizeof(indigo_property *));
+			context.cache->stale = malloc(context.cache->count * sizeof(bool));
+			memset(context.cache->stale, 0, context.cache->count * sizeof(bool));
+		} else {
+			// reconnect, cached properties are kept until remote server confirms or replaces them
+			for (int i = 0; i < context.cache->count; i++) {
+				context.cache->stale[i] = context.cache->properties[i] != NULL;
+				context.cache->resync |= context.cache->stale[i];
+			}
+			context.cache->last_definition = current_time();
+		}
 	}
 
 	indigo_property *property = (indigo_property *)&context.property_buffer;
@@ -1219,9 +1481,19 @@ void indigo_xml_parse(indigo_device *device, indigo_client *client) {
 	int handle = 0;
 	if (device != NULL) {
 		handle = ((indigo_adapter_context *)device->device_context)->input;
+		context.local_socket = ((indigo_adapter_context *)device->device_context)->shared_memory;
 		device->enumerate_properties(device, client, NULL);
+		for (indigo_enable_blob_mode_record *record = context.cache->enable_blob_mode_records; record != NULL; record = record->next) {
+			memset(property, 0, sizeof(indigo_property));
+			strncpy(property->device, record->device, INDIGO_NAME_SIZE);
+			strncpy(property->name, record->name, INDIGO_NAME_SIZE);
+			property->version = INDIGO_VERSION_CURRENT;
+			device->enable_blob(device, NULL, property, record->mode);
+		}
+		memset(property, 0, sizeof(indigo_property));
 	} else {
 		handle = ((indigo_adapter_context *)client->client_context)->input;
+		context.local_socket = false;
 	}
 	*pointer = 0;
 	while (true) {
@@ -1232,8 +1504,36 @@ void indigo_xml_parse(indigo_device *device, indigo_client *client) {
 			indigo_error("XML Parser: syntax error");
 			goto exit_loop;
 		}
+		if (entity_pointer == NULL) {
+			// fast path, copy whole run of ordinary characters at once
+			if (state == ATTRIBUTE_VALUE) {
+				char *end = xml_scan(pointer, q, '&');
+				long length = end - pointer;
+				long available = BUFFER_SIZE - (value_pointer - value_buffer);
+				if (length > available)
+					length = available;
+				memcpy(value_pointer, pointer, length);
+				value_pointer += length;
+				pointer = end;
+			} else if (state == TEXT) {
+				char *end = xml_scan(pointer, '<', '&');
+				if (depth == 2 || handler == enable_blob_handler) {
+					long length = end - pointer;
+					long available = INDIGO_VALUE_SIZE - (value_pointer - value_buffer);
+					if (length > available)
+						length = available;
+					if (length > 0) {
+						memcpy(value_pointer, pointer, length);
+						value_pointer += length;
+					}
+				}
+				pointer = end;
+			} else if (state == IDLE) {
+				pointer = xml_scan(pointer, '<', '<');
+			}
+		}
 		while ((c = *pointer++) == 0) {
-			ssize_t count = (int)read(handle, (void *)buffer, (ssize_t)BUFFER_SIZE);
+			ssize_t count = (int)parser_read(&context, handle, (void *)buffer, (ssize_t)BUFFER_SIZE);
 			if (count <= 0) {
 				goto exit_loop;
 			}
@@ -1418,7 +1718,7 @@ void indigo_xml_parse(indigo_device *device, indigo_client *client) {
 					ssize_t bytes_needed = len % 4;
 					if(bytes_needed) bytes_needed = 4 - bytes_needed;
 					while (bytes_needed) {
-						count = (int)read(handle, (void *)buffer_end, bytes_needed);
+						count = (int)parser_read(&context, handle, (void *)buffer_end, bytes_needed);
 						if (count <= 0)
 							goto exit_loop;
 						len += count;
@@ -1433,7 +1733,7 @@ void indigo_xml_parse(indigo_device *device, indigo_client *client) {
 						ssize_t to_read = len;
 						char *ptr = buffer;
 						while(to_read) {
-							count = (int)read(handle, (void *)ptr, to_read);
+							count = (int)parser_read(&context, handle, (void *)ptr, to_read);
 							if (count <= 0)
 								goto exit_loop;
 							ptr += count;
@@ -1541,7 +1841,8 @@ void indigo_xml_parse(indigo_device *device, indigo_client *client) {
 					handler = handler(ATTRIBUTE_VALUE, &context, name_buffer, value_buffer, message);
 					INDIGO_TRACE_PARSER(indigo_trace("XML Parser: '%c' ATTRIBUTE_VALUE -> ATTRIBUTE_NAME1", c));
 				} else {
-					*value_pointer++ = c;
+					if (value_pointer - value_buffer < BUFFER_SIZE)
+						*value_pointer++ = c;
 					INDIGO_TRACE_PARSER(indigo_trace("XML Parser: '%c' ATTRIBUTE_VALUE", c));
 				}
 				break;
@@ -1550,11 +1851,74 @@ void indigo_xml_parse(indigo_device *device, indigo_client *client) {
 		}
 	}
 exit_loop:
+	if (context.cache == &local_cache) {
+		indigo_xml_release_cache(&local_cache);
+	} else {
+		context.cache->resync = false;
+		context.cache->disconnected = time(NULL);
+	}
+	unmap_descriptors(&context);
+	if (context.shm_descriptor >= 0)
+		close(context.shm_descriptor);
+	while (context.descriptor_count > 0)
+		close(pop_descriptor(&context));
+	if (blob_buffer != NULL)
+		free(blob_buffer);
+	free(buffer);
+	free(value_buffer);
+	close(handle);
+	indigo_log("XML Parser: parser finished");
+}
+
+static indigo_result cache_enumerate_properties(indigo_device *device, indigo_client *client, indigo_property *property) {
+	if (!indigo_reshare_remote_devices && client && client->is_remote)
+		return INDIGO_OK;
+	indigo_xml_cache *cache = (indigo_xml_cache *)device->device_context;
+	for (int index = 0; index < cache->count; index++) {
+		indigo_property *cached = cache->properties[index];
+		if (cached != NULL && indigo_property_match(cached, property))
+			indigo_define_property(device, cached, NULL);
+	}
+	return INDIGO_OK;
+}
+
+void indigo_xml_attach_cache(indigo_xml_cache *cache, indigo_device *adapter) {
+	static indigo_device device_template = INDIGO_DEVICE_INITIALIZER(
+		"", NULL,
+		cache_enumerate_properties,
+		NULL,
+		NULL,
+		NULL
+	);
+	if (cache->device != NULL || cache->count == 0)
+		return;
+	indigo_device *device = malloc(sizeof(indigo_device));
+	if (device == NULL)
+		return;
+	memcpy(device, &device_template, sizeof(indigo_device));
+	strncpy(device->name, adapter->name, INDIGO_NAME_SIZE);
+	device->is_remote = adapter->is_remote;
+	device->version = adapter->version;
+	device->device_context = cache;
+	cache->device = device;
+	indigo_attach_device(device);
+}
+
+void indigo_xml_detach_cache(indigo_xml_cache *cache) {
+	if (cache->device != NULL) {
+		indigo_detach_device(cache->device);
+		free(cache->device);
+		cache->device = NULL;
+	}
+}
+
+void indigo_xml_release_cache(indigo_xml_cache *cache) {
+	indigo_xml_detach_cache(cache);
 	while (true) {
 		indigo_property *property = NULL;
 		int index;
-		for (index = 0; index < context.count; index++) {
-			property = context.properties[index];
+		for (index = 0; index < cache->count; index++) {
+			property = cache->properties[index];
 			if (property != NULL)
 				break;
 		}
@@ -1566,27 +1930,25 @@ exit_loop:
 		indigo_property *all_properties = indigo_init_text_property(NULL, remote_device.name, "", "", "", INDIGO_OK_STATE, INDIGO_RO_PERM, 0);
 		indigo_delete_property(&remote_device, all_properties, NULL);
 		indigo_release_property(all_properties);
-		for (; index < context.count; index++) {
-			indigo_property *property = context.properties[index];
+		for (; index < cache->count; index++) {
+			indigo_property *property = cache->properties[index];
 			if (property != NULL && !strncmp(remote_device.name, property->device, INDIGO_NAME_SIZE)) {
-				if (property->type == INDIGO_BLOB_VECTOR) {
-					for (int i = 0; i < property->count; i++) {
-						void *blob = property->items[i].blob.value;
-						if (blob)
-							free(blob);
-					}
-				}
-				indigo_release_property(property);
-				context.properties[index] = NULL;
+				release_cached_property(property);
+				cache->properties[index] = NULL;
 			}
 		}
 	}
-	if (blob_buffer != NULL)
-		free(blob_buffer);
-	free(buffer);
-	free(value_buffer);
-	close(handle);
-	indigo_log("XML Parser: parser finished");
+	indigo_enable_blob_mode_record *record = cache->enable_blob_mode_records;
+	while (record != NULL) {
+		indigo_enable_blob_mode_record *next = record->next;
+		free(record);
+		record = next;
+	}
+	if (cache->properties != NULL)
+		free(cache->properties);
+	if (cache->stale != NULL)
+		free(cache->stale);
+	memset(cache, 0, sizeof(indigo_xml_cache));
 }
 
 char *indigo_xml_escape(char *string) {
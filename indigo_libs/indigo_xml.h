@@ -27,6 +27,7 @@
 #define indigo_xml_h
 
 #include <stdio.h>
+#include <time.h>
 #include "indigo_bus.h"
 
 #ifdef __cplusplus
@@ -38,6 +39,34 @@ extern "C" {
 
 extern bool indigo_use_blob_urls;
 
+/** Remote property cache of client adapter.
+ If it is kept across reconnects, parser resynchronizes it with definitions sent by remote server after
+ reconnect and only properties which were changed, added or removed in the meantime are broadcasted.
+ */
+typedef struct indigo_xml_cache {
+	indigo_property **properties;           ///< cached properties (NULL for empty slot)
+	bool *stale;                            ///< property wasn't confirmed by remote server since reconnect
+	int count;                              ///< number of slots
+	bool resync;                            ///< resynchronization in progress
+	double last_definition;                 ///< time of the last definition received during resynchronization
+	time_t disconnected;                    ///< time of the last disconnect
+	indigo_enable_blob_mode_record *enable_blob_mode_records; ///< enableBLOB requests to be replayed after reconnect
+	indigo_device *device;                  ///< device answering enumeration from the cache while remote server is disconnected (or NULL)
+} indigo_xml_cache;
+
+/** Answer enumeration requests from the cache on behalf of detached client adapter until the cache is released or indigo_xml_detach_cache() is called.
+ So clients attached during disconnect get the same properties as the others and resynchronization can skip unchanged ones.
+ */
+extern void indigo_xml_attach_cache(indigo_xml_cache *cache, indigo_device *adapter);
+
+/** Stop answering enumeration requests from the cache (before client adapter is attached again).
+ */
+extern void indigo_xml_detach_cache(indigo_xml_cache *cache);
+
+/** Delete all properties in the cache and release it.
+ */
+extern void indigo_xml_release_cache(indigo_xml_cache *cache);
+
 /** XML wire protocol parser.
  */
 extern void indigo_xml_parse(indigo_device *device, indigo_client *client);
@@ -23,7 +23,7 @@
  \file indigo_ccd_gphoto2.c
  */
 
-#define DRIVER_VERSION 0x0003
+#define DRIVER_VERSION 0x0004
 #define DRIVER_NAME "indigo_ccd_gphoto2"
 
 #include <stdio.h>
@@ -35,6 +35,7 @@
 #include <assert.h>
 #include <ctype.h>
 #include <math.h>
+#include <time.h>
 #include <pthread.h>
 #include <gphoto2/gphoto2-camera.h>
 #include <gphoto2/gphoto2-list.h>
@@ -89,8 +90,14 @@
 #define GPHOTO2_NAME_DEBAYER_ALGORITHM_AHD_LABEL "AHD"
 #define GPHOTO2_NAME_DEBAYER_ALGORITHM_DCB_LABEL "DCB"
 #define GPHOTO2_NAME_DEBAYER_ALGORITHM_DHT_LABEL "DHT"
+#define GPHOTO2_NAME_DEBAYER_OPTIONS             "Debayer options"
+#define GPHOTO2_NAME_DEBAYER_HALF_SIZE_NAME      "HALF_SIZE"
+#define GPHOTO2_NAME_DEBAYER_PIPELINE_NAME       "PIPELINE"
+#define GPHOTO2_NAME_DEBAYER_HALF_SIZE_LABEL     "Half size preview"
+#define GPHOTO2_NAME_DEBAYER_PIPELINE_LABEL      "Overlap with next exposure"
 
 #define GPHOTO2_DEBAYER_ALGORITHM_PROPERTY_NAME	 "GPHOTO2_DEBAYER_ALGORITHM"
+#define GPHOTO2_DEBAYER_OPTIONS_PROPERTY_NAME	 "GPHOTO2_DEBAYER_OPTIONS"
 #define GPHOTO2_LIBGPHOTO2_VERSION_PROPERTY_NAME "GPHOTO2_LIBGPHOTO2_VERSION"
 #define GPHOTO2_LIBGPHOTO2_VERSION_ITEM_NAME     "LIBGPHOTO2_VERSION"
 
@@ -124,6 +131,8 @@
 #define SONY_COMPRESSION			NIKON_COMPRESSION
 
 #define TIMER_COUNTER_STEP_SEC                  0.1   /* 100 ms. */
+#define DEBAYER_MAX_WORKERS			4
+#define DEBAYER_MAX_PENDING			2
 
 #define UNUSED(x)				(void)(x)
 #define MAX_DEVICES				8
@@ -144,6 +153,9 @@
 #define DSLR_DEBAYER_ALGORITHM_AHD_ITEM		(PRIVATE_DATA->dslr_debayer_algorithm_property->items + 3)
 #define DSLR_DEBAYER_ALGORITHM_DCB_ITEM		(PRIVATE_DATA->dslr_debayer_algorithm_property->items + 4)
 #define DSLR_DEBAYER_ALGORITHM_DHT_ITEM		(PRIVATE_DATA->dslr_debayer_algorithm_property->items + 5)
+#define DSLR_DEBAYER_OPTIONS_PROPERTY		(PRIVATE_DATA->dslr_debayer_options_property)
+#define DSLR_DEBAYER_HALF_SIZE_ITEM		(PRIVATE_DATA->dslr_debayer_options_property->items + 0)
+#define DSLR_DEBAYER_PIPELINE_ITEM		(PRIVATE_DATA->dslr_debayer_options_property->items + 1)
 #define GPHOTO2_LIBGPHOTO2_VERSION_PROPERTY	(PRIVATE_DATA->dslr_libgphoto2_version_property)
 #define GPHOTO2_LIBGPHOTO2_VERSION_ITEM		(PRIVATE_DATA->dslr_libgphoto2_version_property->items)
 #define COMPRESSION                             (PRIVATE_DATA->gphoto2_compression_id)
@@ -186,6 +198,8 @@ typedef struct {
 	char *buffer;
 	unsigned long int buffer_size;
 	unsigned long int buffer_size_max;
+	char *image_buffer;
+	unsigned long int image_buffer_size_max;
 	char filename_suffix[9];
 	enum vendor vendor;
 	char *gphoto2_compression_id;
@@ -196,6 +210,8 @@ typedef struct {
 	bool has_single_bulb_mode;
 	bool has_eos_remote_release;
 	int debayer_algorithm;
+	int debayer_pending;
+	bool debayer_busy;
 	indigo_property *dslr_shutter_property;
 	indigo_property *dslr_iso_property;
 	indigo_property *dslr_compression_property;
@@ -204,9 +220,11 @@ typedef struct {
 	indigo_property *dslr_mirror_lockup_property;
 	indigo_property *dslr_delete_image_property;
 	indigo_property *dslr_debayer_algorithm_property;
+	indigo_property *dslr_debayer_options_property;
 	indigo_property *dslr_libgphoto2_version_property;
 	indigo_timer *exposure_timer, *counter_timer;
 	pthread_mutex_t driver_mutex;
+	pthread_mutex_t image_mutex;
 } gphoto2_private_data;
 
 struct capture_abort {
@@ -214,6 +232,29 @@ struct capture_abort {
 	indigo_device *device;
 };
 
+struct debayer_job {
+	indigo_device *device;
+	char *buffer;
+	unsigned long int buffer_size;
+	int algorithm;
+	bool half_size;
+	bool pipelined;
+	struct debayer_job *next;
+};
+
+static struct {
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	struct debayer_job *head;
+	struct debayer_job *tail;
+	pthread_t workers[DEBAYER_MAX_WORKERS];
+	int worker_count;
+	bool shutdown;
+} debayer_pool = {
+	.mutex = PTHREAD_MUTEX_INITIALIZER,
+	.cond = PTHREAD_COND_INITIALIZER
+};
+
 static GPContext *context = NULL;
 static pthread_t thread_id_capture;
 static indigo_device *devices[MAX_DEVICES] = {NULL};
@@ -268,19 +309,74 @@ static int progress_cb(void *callback_data,
 	return 0;
 }
 
+/* Same as LibRaw's gamma_curve() in mode 2, it is not exported by the C API.
+   libraw_dcraw_make_mem_image() rebuilds color.curve this way before
+   copying the image. */
+static void libraw_gamma_curve(unsigned short *curve, double pwr, double ts,
+			       int imax)
+{
+	double g[6], bnd[2] = {0, 0}, r;
+
+	g[0] = pwr;
+	g[1] = ts;
+	g[2] = g[3] = g[4] = 0;
+	bnd[g[1] >= 1] = 1;
+	if (g[1] && (g[1] - 1) * (g[0] - 1) <= 0) {
+		for (int i = 0; i < 48; i++) {
+			g[2] = (bnd[0] + bnd[1]) / 2;
+			if (g[0])
+				bnd[(pow(g[2] / g[1], -g[0]) - 1) / g[0] - 1 / g[2] > -1] = g[2];
+			else
+				bnd[g[2] / exp(1 - 1 / g[2]) < g[1]] = g[2];
+		}
+		g[3] = g[2] / g[1];
+		if (g[0])
+			g[4] = g[2] * (1 / g[0] - 1);
+	}
+	for (int i = 0; i < 0x10000; i++) {
+		curve[i] = 0xffff;
+		if ((r = (double)i / imax) < 1)
+			curve[i] = 0x10000 * (r < g[3] ? r * g[1] :
+					      (g[0] ? pow(r, g[0]) * (1 + g[4]) - g[4] :
+					       log(r) * g[2] + 1));
+	}
+}
+
+/* Same as LibRaw's flip_index(), used to copy the debayered
+   image with the orientation libraw_dcraw_make_mem_image() would give. */
+static inline int libraw_flip_index(int flip, int iwidth, int iheight,
+				    int row, int col)
+{
+	if (flip & 4) {
+		int tmp = row;
+		row = col;
+		col = tmp;
+	}
+	if (flip & 2)
+		row = iheight - 1 - row;
+	if (flip & 1)
+		col = iwidth - 1 - col;
+
+	return row * iwidth + col;
+}
+
 static int process_dslr_image_debayer(indigo_device *device,
-				       void *buffer, size_t buffer_size)
+				      struct debayer_job *job)
 {
-        int rc;
-        libraw_data_t *raw_data;
-        libraw_processed_image_t *processed_image = NULL;
+	int rc;
+	libraw_data_t *raw_data;
+	struct timespec start, end;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
 
-        raw_data = libraw_init(0);
+	raw_data = libraw_init(0);
 
 	/* Linear 16-bit output. */
 	raw_data->params.output_bps = 16;
 	/* Debayer algorithm. */
-	raw_data->params.user_qual = PRIVATE_DATA->debayer_algorithm;
+	raw_data->params.user_qual = job->algorithm;
+	/* Half size fast preview, 2x2 superpixels instead of interpolation. */
+	raw_data->params.half_size = job->half_size;
 	/* Disable four color space. */
 	raw_data->params.four_color_rgb = 0;
 	/* Disable LibRaw's default histogram transformation. */
@@ -296,7 +392,7 @@ static int process_dslr_image_debayer(indigo_device *device,
 
 	libraw_set_progress_handler(raw_data, &progress_cb, NULL);
 
-	rc = libraw_open_buffer(raw_data, buffer, buffer_size);
+	rc = libraw_open_buffer(raw_data, job->buffer, job->buffer_size);
 	if (rc != LIBRAW_SUCCESS) {
 		INDIGO_DRIVER_ERROR(DRIVER_NAME,
 				    "[rc:%d] libraw_open_buffer "
@@ -332,37 +428,13 @@ static int process_dslr_image_debayer(indigo_device *device,
 		goto cleanup;
 	}
 
-	processed_image = libraw_dcraw_make_mem_image(raw_data, &rc);
-	if (!processed_image) {
-		INDIGO_DRIVER_ERROR(DRIVER_NAME,
-				    "[rc:%d] libraw_dcraw_make_mem_image "
-				    "failed: '%s'",
-				    rc, libraw_strerror(rc));
-		goto cleanup;
-	}
-
-	if (processed_image->type != LIBRAW_IMAGE_BITMAP) {
-		INDIGO_DRIVER_ERROR(DRIVER_NAME,
-				    "input data is not of type "
-				    "LIBRAW_IMAGE_BITMAP");
-		rc = LIBRAW_UNSPECIFIED_ERROR;
-		goto cleanup;
-	}
-
-	if (processed_image->colors != 3) {
+	if (raw_data->idata.colors != 3) {
 		INDIGO_DRIVER_ERROR(DRIVER_NAME,
 				    "debayered data has not 3 colors");
 		rc = LIBRAW_UNSPECIFIED_ERROR;
 		goto cleanup;
 	}
 
-	if (!(processed_image->bits == 16 || processed_image->bits == 8)) {
-		INDIGO_DRIVER_ERROR(DRIVER_NAME,
-				    "8 or 16 bit is supported only");
-		rc = LIBRAW_UNSPECIFIED_ERROR;
-		goto cleanup;
-	}
-
 	float cam_sensor_temperature = -273.15f;
 	if (raw_data->other.SensorTemperature > -273.15f)
 		cam_sensor_temperature = raw_data->other.SensorTemperature;
@@ -385,48 +457,258 @@ static int process_dslr_image_debayer(indigo_device *device,
 	if (cam_sensor_temperature == -273.15f)
 		memcpy(&keywords[2], &keywords[3], sizeof(indigo_fits_keyword));
 
-	void *data = (unsigned char *)processed_image->data;
-        unsigned long int data_size = processed_image->data_size +
-		FITS_HEADER_SIZE;
+	int iwidth = raw_data->sizes.iwidth;
+	int iheight = raw_data->sizes.iheight;
+	int flip = raw_data->sizes.flip;
+	int width = (flip & 4) ? iheight : iwidth;
+	int height = (flip & 4) ? iwidth : iheight;
+	unsigned long int size = (unsigned long int)width * height;
+	unsigned long int data_size = FITS_HEADER_SIZE +
+		3 * size * sizeof(unsigned short);
 	int padding = 0;
-        int mod2880 = data_size % 2880;
+	int mod2880 = data_size % 2880;
 	if (mod2880)
 		padding = 2880 - mod2880;
 	data_size += padding;
 
-	if (data_size > PRIVATE_DATA->buffer_size_max) {
-		PRIVATE_DATA->buffer_size_max = data_size;
-		PRIVATE_DATA->buffer = realloc(PRIVATE_DATA->buffer,
-					       data_size);
+	/* Output curve as libraw_dcraw_make_mem_image() builds it, with
+	   no_auto_bright set the white point is fixed. */
+	int t_white = 0x2000;
+	libraw_gamma_curve(raw_data->color.curve, raw_data->params.gamm[0],
+			   raw_data->params.gamm[1],
+			   (t_white << 3) / raw_data->params.bright);
+
+	/* Image buffer and CCD properties are shared with the exposure
+	   timer thread. */
+	pthread_mutex_lock(&PRIVATE_DATA->image_mutex);
+	if (data_size > PRIVATE_DATA->image_buffer_size_max) {
+		char *image_buffer = realloc(PRIVATE_DATA->image_buffer,
+					     data_size);
+		if (!image_buffer) {
+			pthread_mutex_unlock(&PRIVATE_DATA->image_mutex);
+			INDIGO_DRIVER_ERROR(DRIVER_NAME,
+					    "failed to allocate %lu bytes "
+					    "for debayered image", data_size);
+			rc = LIBRAW_UNSUFFICIENT_MEMORY;
+			goto cleanup;
+		}
+		PRIVATE_DATA->image_buffer = image_buffer;
+		PRIVATE_DATA->image_buffer_size_max = data_size;
+	}
+
+	/* Write RGB planes straight into the FITS buffer instead of letting
+	   libraw_dcraw_make_mem_image() allocate an interleaved copy. */
+	unsigned short *red = (unsigned short *)(PRIVATE_DATA->image_buffer +
+						 FITS_HEADER_SIZE);
+	unsigned short *green = red + size;
+	unsigned short *blue = green + size;
+	unsigned short *curve = raw_data->color.curve;
+	unsigned short (*image)[4] = raw_data->image;
+	int soff = libraw_flip_index(flip, iwidth, iheight, 0, 0);
+	int cstep = libraw_flip_index(flip, iwidth, iheight, 0, 1) - soff;
+	int rstep = libraw_flip_index(flip, iwidth, iheight, 1, 0) -
+		libraw_flip_index(flip, iwidth, iheight, 0, width);
+	for (int row = 0; row < height; row++, soff += rstep) {
+		for (int col = 0; col < width; col++, soff += cstep) {
+			*red++ = curve[image[soff][0]];
+			*green++ = curve[image[soff][1]];
+			*blue++ = curve[image[soff][2]];
+		}
 	}
-	memcpy(PRIVATE_DATA->buffer + FITS_HEADER_SIZE,
-	       data, processed_image->data_size);
-	PRIVATE_DATA->buffer_size = data_size;
 
-	indigo_process_image(device, PRIVATE_DATA->buffer,
-                             processed_image->width, processed_image->height,
-                             processed_image->bits * processed_image->colors,
-                             true, /* little_endian */
-			     true, /* RBG order */
-                             keywords);
+	indigo_process_planar_image(device, PRIVATE_DATA->image_buffer,
+				    width, height, 48,
+				    true, /* little_endian */
+				    keywords);
+	pthread_mutex_unlock(&PRIVATE_DATA->image_mutex);
 
+	clock_gettime(CLOCK_MONOTONIC, &end);
 	INDIGO_DRIVER_DEBUG(DRIVER_NAME, "input data: "
-			    "%d bytes -> unpacked and debayered output data: "
-			    "%d bytes, colors: %d, "
-			    "bits: %d, algorithm: %s", buffer_size,
-			    processed_image->data_size,
-			    processed_image->colors, processed_image->bits,
-			    debayer_algorithm_str_id(PRIVATE_DATA->debayer_algorithm));
+			    "%lu bytes -> unpacked and debayered output data: "
+			    "%dx%d, algorithm: %s, half size: %s, %.2f s",
+			    job->buffer_size, width, height,
+			    debayer_algorithm_str_id(job->algorithm),
+			    job->half_size ? "yes" : "no",
+			    (end.tv_sec - start.tv_sec) +
+			    (end.tv_nsec - start.tv_nsec) / 1e9);
 
 cleanup:
-	libraw_dcraw_clear_mem(processed_image);
 	libraw_free_image(raw_data);
 	libraw_recycle(raw_data);
-        libraw_close(raw_data);
+	libraw_close(raw_data);
 
 	return rc;
 }
 
+static void debayer_finished(indigo_device *device, struct debayer_job *job,
+			     int rc)
+{
+	if (!CONNECTION_CONNECTED_ITEM->sw.value)
+		return;
+
+	if (job->pipelined) {
+		/* Exposure was already completed, report on image. */
+		if (rc) {
+			CCD_IMAGE_PROPERTY->state = INDIGO_ALERT_STATE;
+			indigo_update_property(device, CCD_IMAGE_PROPERTY,
+					       "debayer failed");
+		}
+		return;
+	}
+	if (rc) {
+		CCD_EXPOSURE_PROPERTY->state = INDIGO_ALERT_STATE;
+		indigo_update_property(device, CCD_EXPOSURE_PROPERTY,
+				       "debayer failed");
+		return;
+	}
+	CCD_EXPOSURE_PROPERTY->state = INDIGO_OK_STATE;
+	CCD_EXPOSURE_ITEM->number.value = 0;
+	indigo_update_property(device, CCD_EXPOSURE_PROPERTY, NULL);
+}
+
+static void *debayer_worker(void *user_data)
+{
+	UNUSED(user_data);
+
+	pthread_mutex_lock(&debayer_pool.mutex);
+	while (true) {
+		struct debayer_job *job, *prev = NULL;
+
+		/* Images of one camera are debayered in order, different
+		   cameras are debayered in parallel. */
+		for (job = debayer_pool.head; job; prev = job, job = job->next)
+			if (!((gphoto2_private_data *)job->device->private_data)->debayer_busy)
+				break;
+		if (!job) {
+			if (debayer_pool.shutdown)
+				break;
+			pthread_cond_wait(&debayer_pool.cond, &debayer_pool.mutex);
+			continue;
+		}
+		if (prev)
+			prev->next = job->next;
+		else
+			debayer_pool.head = job->next;
+		if (debayer_pool.tail == job)
+			debayer_pool.tail = prev;
+
+		indigo_device *device = job->device;
+		PRIVATE_DATA->debayer_busy = true;
+		pthread_mutex_unlock(&debayer_pool.mutex);
+
+		int rc = process_dslr_image_debayer(device, job);
+		pthread_mutex_lock(&PRIVATE_DATA->image_mutex);
+		debayer_finished(device, job, rc);
+		pthread_mutex_unlock(&PRIVATE_DATA->image_mutex);
+		free(job->buffer);
+		free(job);
+
+		pthread_mutex_lock(&debayer_pool.mutex);
+		PRIVATE_DATA->debayer_busy = false;
+		PRIVATE_DATA->debayer_pending--;
+		pthread_cond_broadcast(&debayer_pool.cond);
+	}
+	pthread_mutex_unlock(&debayer_pool.mutex);
+
+	return NULL;
+}
+
+/* Hand downloaded raw image over to the worker pool. The job takes
+   ownership of PRIVATE_DATA->buffer, so the next capture downloads into
+   a fresh buffer while this one is being debayered. */
+static bool debayer_enqueue(indigo_device *device, bool pipelined)
+{
+	struct debayer_job *job = malloc(sizeof(struct debayer_job));
+
+	if (!job)
+		return false;
+
+	pthread_mutex_lock(&debayer_pool.mutex);
+	if (debayer_pool.worker_count == 0) {
+		long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+		int count = MAX(1, MIN(DEBAYER_MAX_WORKERS, cpus));
+
+		debayer_pool.shutdown = false;
+		for (int i = 0; i < count; i++) {
+			if (pthread_create(&debayer_pool.workers[i], NULL,
+					   debayer_worker, NULL))
+				break;
+			debayer_pool.worker_count++;
+		}
+		INDIGO_DRIVER_DEBUG(DRIVER_NAME, "%d debayer worker(s) started",
+				    debayer_pool.worker_count);
+		if (debayer_pool.worker_count == 0) {
+			pthread_mutex_unlock(&debayer_pool.mutex);
+			free(job);
+			return false;
+		}
+	}
+	/* Do not let raw images pile up if debayering is slower than
+	   capturing. */
+	while (PRIVATE_DATA->debayer_pending >= DEBAYER_MAX_PENDING)
+		pthread_cond_wait(&debayer_pool.cond, &debayer_pool.mutex);
+
+	job->device = device;
+	job->buffer = PRIVATE_DATA->buffer;
+	job->buffer_size = PRIVATE_DATA->buffer_size;
+	job->algorithm = PRIVATE_DATA->debayer_algorithm;
+	job->half_size = DSLR_DEBAYER_HALF_SIZE_ITEM->sw.value;
+	job->pipelined = pipelined;
+	job->next = NULL;
+	if (debayer_pool.tail)
+		debayer_pool.tail->next = job;
+	else
+		debayer_pool.head = job;
+	debayer_pool.tail = job;
+	PRIVATE_DATA->debayer_pending++;
+	PRIVATE_DATA->buffer = NULL;
+	PRIVATE_DATA->buffer_size = 0;
+	PRIVATE_DATA->buffer_size_max = 0;
+	pthread_cond_broadcast(&debayer_pool.cond);
+	pthread_mutex_unlock(&debayer_pool.mutex);
+
+	return true;
+}
+
+/* Drop queued images of device and wait for the running one. */
+static void debayer_cancel(indigo_device *device)
+{
+	pthread_mutex_lock(&debayer_pool.mutex);
+	struct debayer_job *job = debayer_pool.head, *prev = NULL;
+	while (job) {
+		struct debayer_job *next = job->next;
+		if (job->device == device) {
+			if (prev)
+				prev->next = next;
+			else
+				debayer_pool.head = next;
+			if (debayer_pool.tail == job)
+				debayer_pool.tail = prev;
+			free(job->buffer);
+			free(job);
+			PRIVATE_DATA->debayer_pending--;
+		} else {
+			prev = job;
+		}
+		job = next;
+	}
+	while (PRIVATE_DATA->debayer_pending > 0)
+		pthread_cond_wait(&debayer_pool.cond, &debayer_pool.mutex);
+	pthread_cond_broadcast(&debayer_pool.cond);
+	pthread_mutex_unlock(&debayer_pool.mutex);
+}
+
+static void debayer_shutdown(void)
+{
+	pthread_mutex_lock(&debayer_pool.mutex);
+	debayer_pool.shutdown = true;
+	pthread_cond_broadcast(&debayer_pool.cond);
+	pthread_mutex_unlock(&debayer_pool.mutex);
+	for (int i = 0; i < debayer_pool.worker_count; i++)
+		pthread_join(debayer_pool.workers[i], NULL);
+	debayer_pool.worker_count = 0;
+}
+
 static void vendor_identify_widget(indigo_device *device,
 				   const char *property_name)
 {
@@ -866,25 +1148,34 @@ static void exposure_timer_callback(indigo_device *device)
 
 		}
 		if (CCD_IMAGE_FORMAT_RAW_ITEM->sw.value ||
-		    CCD_IMAGE_FORMAT_JPEG_ITEM->sw.value)
+		    CCD_IMAGE_FORMAT_JPEG_ITEM->sw.value) {
+			pthread_mutex_lock(&PRIVATE_DATA->image_mutex);
 			indigo_process_dslr_image(device,
 						  PRIVATE_DATA->buffer,
 						  PRIVATE_DATA->buffer_size,
 						  PRIVATE_DATA->filename_suffix);
+			pthread_mutex_unlock(&PRIVATE_DATA->image_mutex);
+		}
 		if (CCD_IMAGE_FORMAT_FITS_ITEM->sw.value) {
-			rc = process_dslr_image_debayer(device,
-							PRIVATE_DATA->buffer,
-							PRIVATE_DATA->buffer_size);
-			if (rc) {
+			/* Debayered image is processed by worker pool, without
+			   pipelining the exposure is completed there as well. */
+			bool pipelined = DSLR_DEBAYER_PIPELINE_ITEM->sw.value;
+			if (!debayer_enqueue(device, pipelined)) {
+				pthread_mutex_lock(&PRIVATE_DATA->image_mutex);
 				CCD_EXPOSURE_PROPERTY->state = INDIGO_ALERT_STATE;
 				indigo_update_property(device, CCD_EXPOSURE_PROPERTY,
 						       "debayer failed");
+				pthread_mutex_unlock(&PRIVATE_DATA->image_mutex);
 				return;
 			}
+			if (!pipelined)
+				return;
 		}
+		pthread_mutex_lock(&PRIVATE_DATA->image_mutex);
 		CCD_EXPOSURE_PROPERTY->state = INDIGO_OK_STATE;
 		CCD_EXPOSURE_ITEM->number.value = 0;
 		indigo_update_property(device, CCD_EXPOSURE_PROPERTY, NULL);
+		pthread_mutex_unlock(&PRIVATE_DATA->image_mutex);
 	} else {
 		CCD_EXPOSURE_PROPERTY->state = INDIGO_ALERT_STATE;
 		indigo_update_property(device, CCD_EXPOSURE_PROPERTY,
@@ -1347,6 +1638,11 @@ static indigo_result ccd_attach(indigo_device *device)
 		PRIVATE_DATA->buffer = NULL;
 		PRIVATE_DATA->buffer_size = 0;
 		PRIVATE_DATA->buffer_size_max = 0;
+		PRIVATE_DATA->image_buffer = NULL;
+		PRIVATE_DATA->image_buffer_size_max = 0;
+		PRIVATE_DATA->debayer_pending = 0;
+		PRIVATE_DATA->debayer_busy = false;
+		pthread_mutex_init(&PRIVATE_DATA->image_mutex, NULL);
 		PRIVATE_DATA->name_best_jpeg_format = NULL;
 		PRIVATE_DATA->name_pure_raw_format = NULL;
 		PRIVATE_DATA->mirror_lockup_secs = 0;
@@ -1537,6 +1833,25 @@ static indigo_result ccd_attach(indigo_device *device)
 		PRIVATE_DATA->debayer_algorithm =
 			debayer_algorithm_value_id(GPHOTO2_NAME_DEBAYER_ALGORITHM_VNG_NAME);
 
+		/*--------------------- DEBAYER-OPTIONS --------------------*/
+		DSLR_DEBAYER_OPTIONS_PROPERTY = indigo_init_switch_property(NULL,
+									    device->name,
+									    GPHOTO2_DEBAYER_OPTIONS_PROPERTY_NAME,
+									    GPHOTO2_NAME_DSLR,
+									    GPHOTO2_NAME_DEBAYER_OPTIONS,
+									    INDIGO_OK_STATE,
+									    INDIGO_RW_PERM,
+									    INDIGO_ANY_OF_MANY_RULE,
+									    2);
+		indigo_init_switch_item(DSLR_DEBAYER_HALF_SIZE_ITEM,
+					GPHOTO2_NAME_DEBAYER_HALF_SIZE_NAME,
+					GPHOTO2_NAME_DEBAYER_HALF_SIZE_LABEL,
+					false);
+		indigo_init_switch_item(DSLR_DEBAYER_PIPELINE_ITEM,
+					GPHOTO2_NAME_DEBAYER_PIPELINE_NAME,
+					GPHOTO2_NAME_DEBAYER_PIPELINE_LABEL,
+					false);
+
 
 		/*--------------------- LIBGPHOTO2-VERSION --------------------*/
 		GPHOTO2_LIBGPHOTO2_VERSION_PROPERTY = indigo_init_text_property(NULL,
@@ -1635,6 +1950,9 @@ static indigo_result ccd_detach(indigo_device *device)
 
 	INDIGO_DEVICE_DETACH_LOG(DRIVER_NAME, device->name);
 
+	debayer_cancel(device);
+	pthread_mutex_destroy(&PRIVATE_DATA->image_mutex);
+
 	indigo_release_property(DSLR_SHUTTER_PROPERTY);
 	indigo_release_property(DSLR_ISO_PROPERTY);
 	indigo_release_property(DSLR_COMPRESSION_PROPERTY);
@@ -1643,6 +1961,7 @@ static indigo_result ccd_detach(indigo_device *device)
 	indigo_release_property(DSLR_MIRROR_LOCKUP_PROPERTY);
 	indigo_release_property(DSLR_DELETE_IMAGE_PROPERTY);
 	indigo_release_property(DSLR_DEBAYER_ALGORITHM_PROPERTY);
+	indigo_release_property(DSLR_DEBAYER_OPTIONS_PROPERTY);
 	indigo_release_property(GPHOTO2_LIBGPHOTO2_VERSION_PROPERTY);
 
 	if (COMPRESSION)
@@ -1655,6 +1974,12 @@ static indigo_result ccd_detach(indigo_device *device)
 		PRIVATE_DATA->buffer_size_max = 0;
 	}
 
+	if (PRIVATE_DATA->image_buffer) {
+		free(PRIVATE_DATA->image_buffer);
+		PRIVATE_DATA->image_buffer = NULL;
+		PRIVATE_DATA->image_buffer_size_max = 0;
+	}
+
 	if (PRIVATE_DATA->name_pure_raw_format)
 		free(PRIVATE_DATA->name_pure_raw_format);
 
@@ -1695,6 +2020,7 @@ static indigo_result ccd_change_property(indigo_device *device,
 			indigo_define_property(device, DSLR_MIRROR_LOCKUP_PROPERTY, NULL);
 			indigo_define_property(device, DSLR_DELETE_IMAGE_PROPERTY, NULL);
 			indigo_define_property(device, DSLR_DEBAYER_ALGORITHM_PROPERTY, NULL);
+			indigo_define_property(device, DSLR_DEBAYER_OPTIONS_PROPERTY, NULL);
 			indigo_define_property(device, GPHOTO2_LIBGPHOTO2_VERSION_PROPERTY, NULL);
 		} else {
 			if (device->is_connected) {
@@ -1706,6 +2032,7 @@ static indigo_result ccd_change_property(indigo_device *device,
 				indigo_delete_property(device, DSLR_MIRROR_LOCKUP_PROPERTY, NULL);
 				indigo_delete_property(device, DSLR_DELETE_IMAGE_PROPERTY, NULL);
 				indigo_delete_property(device, DSLR_DEBAYER_ALGORITHM_PROPERTY, NULL);
+				indigo_delete_property(device, DSLR_DEBAYER_OPTIONS_PROPERTY, NULL);
 				indigo_delete_property(device, GPHOTO2_LIBGPHOTO2_VERSION_PROPERTY, NULL);
 				device->is_connected = false;
 			}
@@ -1786,6 +2113,14 @@ static indigo_result ccd_change_property(indigo_device *device,
 
 		return INDIGO_OK;
 	}
+	/*-------------------------- DEBAYER-OPTIONS -------------------------*/
+	else if (indigo_property_match(DSLR_DEBAYER_OPTIONS_PROPERTY, property)) {
+		indigo_property_copy_values(DSLR_DEBAYER_OPTIONS_PROPERTY, property, false);
+		DSLR_DEBAYER_OPTIONS_PROPERTY->state = INDIGO_OK_STATE;
+		indigo_update_property(device, DSLR_DEBAYER_OPTIONS_PROPERTY, NULL);
+
+		return INDIGO_OK;
+	}
 	/*------------------------- CCD-IMAGE-FORMAT -------------------------*/
 	else if (indigo_property_match(CCD_IMAGE_FORMAT_PROPERTY, property)) {
 		indigo_property_copy_values(CCD_IMAGE_FORMAT_PROPERTY, property,
@@ -1856,8 +2191,10 @@ static indigo_result ccd_change_property(indigo_device *device,
 	else if (indigo_property_match(CCD_ABORT_EXPOSURE_PROPERTY, property)) {
 		indigo_property_copy_values(CCD_ABORT_EXPOSURE_PROPERTY, property, false);
 		if (CCD_EXPOSURE_PROPERTY->state == INDIGO_BUSY_STATE) {
-			/* Only bulb captures can be abort. */
-			if (PRIVATE_DATA->shutterspeed_bulb) {
+			/* Only bulb captures can be abort, image being
+			   debayered has been already captured. */
+			if (PRIVATE_DATA->shutterspeed_bulb &&
+			    PRIVATE_DATA->exposure_timer) {
 				indigo_cancel_timer(device,
 						    &PRIVATE_DATA->exposure_timer);
 				pthread_cancel(thread_id_capture);
@@ -1917,6 +2254,8 @@ static indigo_result ccd_change_property(indigo_device *device,
 					     DSLR_DELETE_IMAGE_PROPERTY);
 			indigo_save_property(device, NULL,
 					     DSLR_DEBAYER_ALGORITHM_PROPERTY);
+			indigo_save_property(device, NULL,
+					     DSLR_DEBAYER_OPTIONS_PROPERTY);
 		}
 	}
 
@@ -2208,6 +2547,7 @@ indigo_result indigo_ccd_gphoto2(indigo_driver_action action, indigo_driver_info
 		last_action = action;
 		libusb_hotplug_deregister_callback(NULL, callback_handle);
 		INDIGO_DRIVER_DEBUG(DRIVER_NAME, "libusb_hotplug_deregister_callback");
+		debayer_shutdown();
 		gp_context_unref(context);
 		break;
 
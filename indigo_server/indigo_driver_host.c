@@ -0,0 +1,85 @@
+// Copyright (c) 2026 agent
+// All rights reserved.
+//
+// You can use this software under the terms of 'INDIGO Astronomy
+// open-source license' (see LICENSE.md).
+//
+// THIS SOFTWARE IS PROVIDED BY THE AUTHORS 'AS IS' AND ANY EXPRESS
+// OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+// GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// version history
+// 2.0 by agent <agent@local>
+
+/** INDIGO driver host
+ \file indigo_driver_host.c
+
+ Runs single dynamically linked driver in its own process, so a crash in vendor SDK
+ doesn't take the server down. It is started by indigo_host_driver() with stdin and
+ stdout connected to local socket, inline BLOBs are passed back as shared memory.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#ifdef INDIGO_LINUX
+#include <sys/prctl.h>
+#endif
+
+#include "indigo_bus.h"
+#include "indigo_client.h"
+#include "indigo_driver_xml.h"
+
+int main(int argc, const char * argv[]) {
+	indigo_main_argc = argc;
+	indigo_main_argv = argv;
+	if (argc != 2) {
+		fprintf(stderr, "%s driver_name\n", argv[0]);
+		return 1;
+	}
+#ifdef INDIGO_LINUX
+	// don't outlive the server
+	prctl(PR_SET_PDEATHSIG, SIGKILL);
+#endif
+	// protocol uses private copies of the socket, so output of vendor SDK printing to stdout (or reading stdin) doesn't corrupt it
+	int input = fcntl(0, F_DUPFD_CLOEXEC, 3);
+	int output = fcntl(1, F_DUPFD_CLOEXEC, 3);
+	if (input < 0 || output < 0) {
+		perror("dup");
+		return 1;
+	}
+	int null = open("/dev/null", O_RDONLY);
+	if (null >= 0) {
+		dup2(null, 0);
+		close(null);
+	}
+	dup2(2, 1);
+	indigo_client *protocol_adapter = indigo_xml_device_adapter(input, output);
+	indigo_enable_blob_mode_record *record = (indigo_enable_blob_mode_record *)malloc(sizeof(indigo_enable_blob_mode_record));
+	memset(record, 0, sizeof(indigo_enable_blob_mode_record));
+	record->mode = INDIGO_ENABLE_BLOB_ALSO;
+	protocol_adapter->enable_blob_mode_records = record;
+	indigo_start();
+	indigo_driver_entry *driver = NULL;
+	if (indigo_load_driver(argv[1], true, &driver) != INDIGO_OK) {
+		indigo_stop();
+		return 1;
+	}
+	indigo_attach_client(protocol_adapter);
+	indigo_xml_parse(NULL, protocol_adapter);
+	indigo_remove_driver(driver);
+	indigo_stop();
+	return 0;
+}
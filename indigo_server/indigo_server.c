@@ -45,6 +45,7 @@
 #include "indigo_driver.h"
 #include "indigo_client.h"
 #include "indigo_xml.h"
+#include "indigo_metrics.h"
 
 #include "ccd_simulator/indigo_ccd_simulator.h"
 #include "mount_simulator/indigo_mount_simulator.h"
@@ -193,10 +194,14 @@ driver_entry_point static_drivers[] = {
 static int first_driver = 4; /* This should be equial to number of simulator drivers */
 static indigo_property *drivers_property;
 static indigo_property *servers_property;
+static indigo_property *servers_latency_property;
+static indigo_timer *servers_timer;
 static indigo_property *load_property;
 static indigo_property *unload_property;
 static indigo_property *restart_property;
 static indigo_property *log_level_property;
+static indigo_property *metrics_property;
+static indigo_timer *metrics_timer;
 static DNSServiceRef sd_http;
 static DNSServiceRef sd_indigo;
 
@@ -209,6 +214,17 @@ static bool runLoop = true;
 #define LOG_LEVEL_DEBUG_ITEM        (log_level_property->items + 2)
 #define LOG_LEVEL_TRACE_ITEM        (log_level_property->items + 3)
 
+#define METRICS_UPDATE_LATENCY_P50_ITEM	(metrics_property->items + 0)
+#define METRICS_UPDATE_LATENCY_P99_ITEM	(metrics_property->items + 1)
+#define METRICS_WRITE_LATENCY_P99_ITEM	(metrics_property->items + 2)
+#define METRICS_QUEUE_DEPTH_P99_ITEM		(metrics_property->items + 3)
+#define METRICS_BYTES_SENT_ITEM					(metrics_property->items + 4)
+#define METRICS_BLOB_ENCODE_P99_ITEM		(metrics_property->items + 5)
+#define METRICS_TIMER_LATENESS_P99_ITEM	(metrics_property->items + 6)
+
+#define METRICS_REFRESH_INTERVAL				10
+#define SERVERS_REFRESH_INTERVAL				1
+
 static pid_t server_pid = 0;
 static bool keep_server_running = true;
 static bool use_sigkill = false;
@@ -280,6 +296,79 @@ static void server_callback(int count) {
 	}
 }
 
+static void metrics_refresh(indigo_device *device) {
+	double values[] = {
+		indigo_histogram_percentile(&indigo_update_latency_histogram, 50) / 1000.0,
+		indigo_histogram_percentile(&indigo_update_latency_histogram, 99) / 1000.0,
+		indigo_histogram_percentile(&indigo_write_latency_histogram, 99) / 1000.0,
+		indigo_histogram_percentile(&indigo_queue_depth_histogram, 99),
+		indigo_bytes_sent,
+		indigo_histogram_percentile(&indigo_blob_encode_histogram, 99) / 1000.0,
+		indigo_histogram_percentile(&indigo_timer_lateness_histogram, 99) / 1000.0
+	};
+	bool changed = false;
+	for (int i = 0; i < metrics_property->count; i++) {
+		// sending METRICS itself increases BYTES_SENT, so it doesn't trigger update on its own
+		if (metrics_property->items[i].number.value != values[i]) {
+			metrics_property->items[i].number.value = values[i];
+			if (metrics_property->items + i != METRICS_BYTES_SENT_ITEM)
+				changed = true;
+		}
+	}
+	if (changed)
+		indigo_update_property(&server_device, metrics_property, NULL);
+	indigo_reschedule_timer(device, METRICS_REFRESH_INTERVAL, &metrics_timer);
+}
+
+static indigo_property_state remote_light(indigo_remote_state state, const char *last_error) {
+	switch (state) {
+		case INDIGO_REMOTE_CONNECTED:
+			return INDIGO_OK_STATE;
+		case INDIGO_REMOTE_CONNECTING:
+			return INDIGO_BUSY_STATE;
+		case INDIGO_REMOTE_WAITING:
+			return last_error ? INDIGO_ALERT_STATE : INDIGO_BUSY_STATE;
+		default:
+			return INDIGO_IDLE_STATE;
+	}
+}
+
+static void servers_refresh(indigo_device *device) {
+	bool servers_changed = false, latency_changed = false;
+	int index = 0;
+	for (int i = 0; i < INDIGO_MAX_SERVERS && index < servers_property->count; i++) {
+		indigo_server_entry *entry = indigo_available_servers + i;
+		if (*entry->host) {
+			indigo_property_state state = remote_light(entry->state, entry->last_error);
+			if (servers_property->items[index].light.value != state) {
+				servers_property->items[index].light.value = state;
+				servers_changed = true;
+			}
+			if (index < servers_latency_property->count && servers_latency_property->items[index].number.value != entry->latency) {
+				servers_latency_property->items[index].number.value = entry->latency;
+				latency_changed = true;
+			}
+			index++;
+		}
+	}
+	for (int i = 0; i < INDIGO_MAX_SERVERS && index < servers_property->count; i++) {
+		indigo_subprocess_entry *entry = indigo_available_subprocesses + i;
+		if (*entry->executable) {
+			indigo_property_state state = remote_light(entry->state, entry->last_error);
+			if (servers_property->items[index].light.value != state) {
+				servers_property->items[index].light.value = state;
+				servers_changed = true;
+			}
+			index++;
+		}
+	}
+	if (servers_changed)
+		indigo_update_property(&server_device, servers_property, NULL);
+	if (latency_changed)
+		indigo_update_property(&server_device, servers_latency_property, NULL);
+	indigo_reschedule_timer(device, SERVERS_REFRESH_INTERVAL, &servers_timer);
+}
+
 static indigo_result attach(indigo_device *device) {
 	assert(device != NULL);
 	drivers_property = indigo_init_switch_property(NULL, server_device.name, "DRIVERS", MAIN_GROUP, "Active drivers", INDIGO_OK_STATE, INDIGO_RW_PERM, INDIGO_ANY_OF_MANY_RULE, INDIGO_MAX_DRIVERS);
@@ -289,6 +378,8 @@ static indigo_result attach(indigo_device *device) {
 			indigo_init_switch_item(&drivers_property->items[drivers_property->count++], indigo_available_drivers[i].description, indigo_available_drivers[i].description, true);
 	servers_property = indigo_init_light_property(NULL, server_device.name, "SERVERS", MAIN_GROUP, "Active servers", INDIGO_OK_STATE, 2 * INDIGO_MAX_SERVERS);
 	servers_property->count = 0;
+	servers_latency_property = indigo_init_number_property(NULL, server_device.name, "SERVERS_LATENCY", MAIN_GROUP, "Server connect latency (ms)", INDIGO_OK_STATE, INDIGO_RO_PERM, INDIGO_MAX_SERVERS);
+	servers_latency_property->count = 0;
 	for (int i = 0; i < INDIGO_MAX_SERVERS; i++) {
 		indigo_server_entry *entry = indigo_available_servers + i;
 		if (*entry->host) {
@@ -297,15 +388,19 @@ static indigo_result attach(indigo_device *device) {
 				strncpy(buf, entry->host, sizeof(buf));
 			else
 				snprintf(buf, sizeof(buf), "%s:%d", entry->host, entry->port);
-			indigo_init_light_item(&servers_property->items[servers_property->count++], buf, buf, INDIGO_OK_STATE);
+			indigo_init_light_item(&servers_property->items[servers_property->count++], buf, buf, INDIGO_IDLE_STATE);
+			indigo_init_number_item(&servers_latency_property->items[servers_latency_property->count++], buf, buf, 0, 1e9, 0, 0);
 		}
 	}
 	for (int i = 0; i < INDIGO_MAX_SERVERS; i++) {
 		indigo_subprocess_entry *entry = indigo_available_subprocesses + i;
 		if (*entry->executable) {
-			indigo_init_light_item(&servers_property->items[servers_property->count++], entry->executable, entry->executable, INDIGO_OK_STATE);
+			const char *name = *entry->argument ? entry->argument : entry->executable;
+			indigo_init_light_item(&servers_property->items[servers_property->count++], name, name, INDIGO_IDLE_STATE);
 		}
 	}
+	if (servers_property->count > 0)
+		servers_timer = indigo_set_timer(NULL, SERVERS_REFRESH_INTERVAL, servers_refresh);
 	load_property = indigo_init_text_property(NULL, server_device.name, "LOAD", MAIN_GROUP, "Load driver", INDIGO_OK_STATE, INDIGO_RW_PERM, 1);
 	indigo_init_text_item(&load_property->items[0], "DRIVER", "Load driver", "");
 	unload_property = indigo_init_text_property(NULL, server_device.name, "UNLOAD", MAIN_GROUP, "Unload driver", INDIGO_OK_STATE, INDIGO_RW_PERM, 1);
@@ -317,6 +412,15 @@ static indigo_result attach(indigo_device *device) {
 	indigo_init_switch_item(&log_level_property->items[1], "INFO", "Info", false);
 	indigo_init_switch_item(&log_level_property->items[2], "DEBUG", "Debug", false);
 	indigo_init_switch_item(&log_level_property->items[3], "TRACE", "Trace", false);
+	metrics_property = indigo_init_number_property(NULL, device->name, "METRICS", MAIN_GROUP, "Metrics", INDIGO_OK_STATE, INDIGO_RO_PERM, 7);
+	indigo_init_number_item(METRICS_UPDATE_LATENCY_P50_ITEM, "UPDATE_LATENCY_P50", "Change to update latency, median (ms)", 0, 1e9, 0, 0);
+	indigo_init_number_item(METRICS_UPDATE_LATENCY_P99_ITEM, "UPDATE_LATENCY_P99", "Change to update latency, 99th percentile (ms)", 0, 1e9, 0, 0);
+	indigo_init_number_item(METRICS_WRITE_LATENCY_P99_ITEM, "WRITE_LATENCY_P99", "Client write latency, 99th percentile (ms)", 0, 1e9, 0, 0);
+	indigo_init_number_item(METRICS_QUEUE_DEPTH_P99_ITEM, "QUEUE_DEPTH_P99", "Client queue depth, 99th percentile (bytes)", 0, 1e12, 0, 0);
+	indigo_init_number_item(METRICS_BYTES_SENT_ITEM, "BYTES_SENT", "Bytes sent to clients", 0, 1e18, 0, 0);
+	indigo_init_number_item(METRICS_BLOB_ENCODE_P99_ITEM, "BLOB_ENCODE_P99", "BLOB encoding time, 99th percentile (ms)", 0, 1e9, 0, 0);
+	indigo_init_number_item(METRICS_TIMER_LATENESS_P99_ITEM, "TIMER_LATENESS_P99", "Timer lateness, 99th percentile (ms)", 0, 1e9, 0, 0);
+	metrics_timer = indigo_set_timer(NULL, METRICS_REFRESH_INTERVAL, metrics_refresh);
 
 	indigo_log_levels log_level = indigo_get_log_level();
 	switch (log_level) {
@@ -344,10 +448,13 @@ static indigo_result enumerate_properties(indigo_device *device, indigo_client *
 	indigo_define_property(device, drivers_property, NULL);
 	if (servers_property->count > 0)
 		indigo_define_property(device, servers_property, NULL);
+	if (servers_latency_property->count > 0)
+		indigo_define_property(device, servers_latency_property, NULL);
 	indigo_define_property(device, load_property, NULL);
 	indigo_define_property(device, unload_property, NULL);
 	indigo_define_property(device, restart_property, NULL);
 	indigo_define_property(device, log_level_property, NULL);
+	indigo_define_property(device, metrics_property, NULL);
 	return INDIGO_OK;
 }
 
@@ -370,7 +477,7 @@ static indigo_result change_property(indigo_device *device, indigo_client *clien
 		indigo_update_property(device, drivers_property, NULL);
 		int handle = 0;
 		indigo_save_property(device, &handle, drivers_property);
-		close(handle);
+		indigo_close_config_file(handle);
 	} else if (indigo_property_match(load_property, property)) {
 		// -------------------------------------------------------------------------------- LOAD
 		indigo_property_copy_values(load_property, property, false);
@@ -390,7 +497,7 @@ static indigo_result change_property(indigo_device *device, indigo_client *clien
 					}
 			} else {
 				load_property->state = INDIGO_ALERT_STATE;
-				indigo_update_property(device, load_property, indigo_last_message);
+				indigo_update_property(device, load_property, "%s", indigo_get_last_message());
 			}
 		}
 	} else if (indigo_property_match(unload_property, property)) {
@@ -415,7 +522,7 @@ static indigo_result change_property(indigo_device *device, indigo_client *clien
 				indigo_update_property(device, unload_property, "Driver %s unloaded", unload_property->items[0].text.value);
 			} else {
 				load_property->state = INDIGO_ALERT_STATE;
-				indigo_update_property(device, unload_property, indigo_last_message);
+				indigo_update_property(device, unload_property, "%s", indigo_get_last_message());
 			}
 		}
 	} else if (indigo_property_match(restart_property, property)) {
@@ -447,11 +554,16 @@ static indigo_result change_property(indigo_device *device, indigo_client *clien
 static indigo_result detach(indigo_device *device) {
 	assert(device != NULL);
 	indigo_delete_property(device, drivers_property, NULL);
+	indigo_cancel_timer(device, &servers_timer);
 	if (servers_property->count > 0)
 		indigo_delete_property(device, servers_property, NULL);
+	if (servers_latency_property->count > 0)
+		indigo_delete_property(device, servers_latency_property, NULL);
 	indigo_delete_property(device, load_property, NULL);
 	indigo_delete_property(device, unload_property, NULL);
 	indigo_delete_property(device, log_level_property, NULL);
+	indigo_cancel_timer(device, &metrics_timer);
+	indigo_delete_property(device, metrics_property, NULL);
 	INDIGO_LOG(indigo_log("%s detached", device->name));
 	return INDIGO_OK;
 }
@@ -464,6 +576,9 @@ static void server_main() {
 		if ((!strcmp(server_argv[i], "-p") || !strcmp(server_argv[i], "--port")) && i < server_argc - 1) {
 			indigo_server_tcp_port = atoi(server_argv[i + 1]);
 			i++;
+		} else if ((!strcmp(server_argv[i], "-x") || !strcmp(server_argv[i], "--local-socket")) && i < server_argc - 1) {
+			strncpy(indigo_server_local_path, server_argv[i + 1], sizeof(indigo_server_local_path) - 1);
+			i++;
 		} else if (!strcmp(server_argv[i], "-s") || !strcmp(server_argv[i], "--enable-simulators")) {
 			first_driver = 0;
 		} else if ((!strcmp(server_argv[i], "-r") || !strcmp(server_argv[i], "--remote-server")) && i < server_argc - 1) {
@@ -484,6 +599,10 @@ static void server_main() {
 			indigo_reshare_remote_devices = true;
 			indigo_start_subprocess(executable, NULL);
 			i++;
+		} else if ((!strcmp(server_argv[i], "-o") || !strcmp(server_argv[i], "--out-of-process")) && i < server_argc - 1) {
+			indigo_reshare_remote_devices = true;
+			indigo_host_driver(server_argv[i + 1], NULL);
+			i++;
 		} else if (!strcmp(server_argv[i], "-b-") || !strcmp(server_argv[i], "--disable-bonjour")) {
 			use_bonjour = false;
 		} else if (!strcmp(server_argv[i], "-b") || !strcmp(server_argv[i], "--bonjour")) {
@@ -586,9 +705,13 @@ int main(int argc, const char * argv[]) {
 			do_fork = false;
 		} else if (!strcmp(argv[i], "-l") || !strcmp(argv[i], "--use-syslog")) {
 			indigo_use_syslog = true;
+		} else if ((!strcmp(argv[i], "-f") || !strcmp(argv[i], "--log-file")) && i < argc - 1) {
+			if (!indigo_set_log_file(argv[i + 1]))
+				INDIGO_ERROR(indigo_error("Can't open log file %s", argv[i + 1]));
+			i++;
 		} else if (!strcmp(argv[i], "-h") || !strcmp(argv[i], "--help")) {
 			printf("%s [-h|--help]\n", argv[0]);
-			printf("%s [--|--do-not-fork] [-l|--use-syslog] [-s|--enable-simulators] [-p|--port port] [-u-|--disable-blob-urls] [-b|--bonjour name] [-b-|--disable-bonjour] [-c-|--disable-control-panel] [-v|--enable-info] [-vv|--enable-debug] [-vvv|--enable-trace] [-r|--remote-server host:port] [-i|--indi-driver driver_executable] indigo_driver_name indigo_driver_name ...\n", argv[0]);
+			printf("%s [--|--do-not-fork] [-l|--use-syslog] [-f|--log-file path] [-s|--enable-simulators] [-p|--port port] [-x|--local-socket path] [-u-|--disable-blob-urls] [-b|--bonjour name] [-b-|--disable-bonjour] [-c-|--disable-control-panel] [-v|--enable-info] [-vv|--enable-debug] [-vvv|--enable-trace] [-r|--remote-server host:port] [-i|--indi-driver driver_executable] [-o|--out-of-process indigo_driver_name] indigo_driver_name indigo_driver_name ...\n", argv[0]);
 			return 0;
 		} else {
 			server_argv[server_argc++] = argv[i];
@@ -0,0 +1,640 @@
+// Copyright (c) 2026 agent
+// All rights reserved.
+//
+// You can use this software under the terms of 'INDIGO Astronomy
+// open-source license' (see LICENSE.md).
+//
+// THIS SOFTWARE IS PROVIDED BY THE AUTHORS 'AS IS' AND ANY EXPRESS
+// OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+// GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// version history
+// 2.0 by agent <agent@local>
+
+/** INDIGO benchmark suite
+ \file indigo_bench.c
+
+ Results are printed to stdout as one JSON object per line, e.g.
+ { "benchmark": "bus_fanout", "clients": 64, "operations": 20000, "seconds": 0.081, "rate": 246913.6, "unit": "updates/s" }
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/wait.h>
+#include <sys/utsname.h>
+
+#include "indigo_bus.h"
+#include "indigo_driver.h"
+#include "indigo_client.h"
+#include "indigo_ccd_driver.h"
+#include "indigo_xml.h"
+#include "indigo_json.h"
+#include "indigo_driver_xml.h"
+#include "indigo_client_xml.h"
+#include "indigo_driver_json.h"
+#include "indigo_base64.h"
+#include "indigo_server_tcp.h"
+#include "indigo_metrics.h"
+#include "indigo_version.h"
+#include "ccd_simulator/indigo_ccd_simulator.h"
+
+#define BENCH_DEVICE		"Bench Device"
+#define MAX_BENCH_CLIENTS	250
+
+static bool quick = false;
+static const char *filter = NULL;
+static const char *traffic = NULL;
+static FILE *output;
+
+// -------------------------------------------------------------------------------- helpers
+
+static double now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int compare_doubles(const void *a, const void *b) {
+	double x = *(const double *)a, y = *(const double *)b;
+	return x < y ? -1 : x > y;
+}
+
+static double percentile(double *values, int count, double percentile) {
+	qsort(values, count, sizeof(double), compare_doubles);
+	int index = (int)(count * percentile / 100.0);
+	return values[index < count ? index : count - 1];
+}
+
+static void emit(const char *benchmark, const char *format, ...) {
+	char fields[1024];
+	va_list args;
+	va_start(args, format);
+	vsnprintf(fields, sizeof(fields), format, args);
+	va_end(args);
+	fprintf(output, "{ \"benchmark\": \"%s\", %s }\n", benchmark, fields);
+	fflush(output);
+}
+
+static bool selected(const char *benchmark) {
+	return filter == NULL || strstr(benchmark, filter) != NULL;
+}
+
+static int iterations(int count) {
+	return quick ? (count / 10 > 0 ? count / 10 : 1) : count;
+}
+
+static int temporary_file(char *path) {
+	strcpy(path, "/tmp/indigo_bench_XXXXXX");
+	return mkstemp(path);
+}
+
+// -------------------------------------------------------------------------------- bench device and clients
+
+static indigo_property *number_property;
+static indigo_property *text_property;
+static long changes = 0;
+
+static indigo_result bench_device_attach(indigo_device *device) {
+	number_property = indigo_init_number_property(NULL, BENCH_DEVICE, "BENCH_NUMBER", MAIN_GROUP, "Number", INDIGO_OK_STATE, INDIGO_RW_PERM, 4);
+	for (int i = 0; i < 4; i++) {
+		char name[INDIGO_NAME_SIZE];
+		snprintf(name, sizeof(name), "VALUE_%d", i);
+		indigo_init_number_item(number_property->items + i, name, name, -1e6, 1e6, 0, 0);
+	}
+	text_property = indigo_init_text_property(NULL, BENCH_DEVICE, "BENCH_TEXT", MAIN_GROUP, "Text", INDIGO_OK_STATE, INDIGO_RO_PERM, 2);
+	indigo_init_text_item(text_property->items + 0, "TEXT_0", "Text 0", "");
+	indigo_init_text_item(text_property->items + 1, "TEXT_1", "Text 1", "indigo <bench> & co.");
+	return INDIGO_OK;
+}
+
+static indigo_result bench_device_enumerate_properties(indigo_device *device, indigo_client *client, indigo_property *property) {
+	indigo_define_property(device, number_property, NULL);
+	indigo_define_property(device, text_property, NULL);
+	return INDIGO_OK;
+}
+
+static indigo_result bench_device_change_property(indigo_device *device, indigo_client *client, indigo_property *property) {
+	if (indigo_property_match(number_property, property)) {
+		indigo_property_copy_values(number_property, property, false);
+		changes++;
+	}
+	return INDIGO_OK;
+}
+
+static indigo_result bench_device_detach(indigo_device *device) {
+	indigo_release_property(number_property);
+	indigo_release_property(text_property);
+	return INDIGO_OK;
+}
+
+static indigo_device bench_device = INDIGO_DEVICE_INITIALIZER(
+	BENCH_DEVICE,
+	bench_device_attach,
+	bench_device_enumerate_properties,
+	bench_device_change_property,
+	NULL,
+	bench_device_detach
+);
+
+static long deliveries = 0;
+
+static indigo_result bench_client_update_property(indigo_client *client, indigo_device *device, indigo_property *property, const char *message) {
+	__atomic_fetch_add(&deliveries, 1, __ATOMIC_RELAXED);
+	return INDIGO_OK;
+}
+
+static void update_bench_properties(int i) {
+	if (i & 1) {
+		snprintf(text_property->items[0].text.value, INDIGO_VALUE_SIZE, "update #%d of a rather long text value", i);
+		indigo_update_property(&bench_device, text_property, NULL);
+	} else {
+		for (int j = 0; j < number_property->count; j++)
+			number_property->items[j].number.value = i * 0.01 + j;
+		number_property->state = i & 2 ? INDIGO_BUSY_STATE : INDIGO_OK_STATE;
+		indigo_update_property(&bench_device, number_property, i & 2 ? "Busy & <escaped>" : NULL);
+	}
+}
+
+// -------------------------------------------------------------------------------- bus fan-out
+
+static void bench_bus_fanout(void) {
+	static indigo_client clients[MAX_BENCH_CLIENTS];
+	static const int client_counts[] = { 1, 8, 64, MAX_BENCH_CLIENTS };
+	int count = iterations(20000);
+	for (int c = 0; c < sizeof(client_counts) / sizeof(int); c++) {
+		int client_count = client_counts[c];
+		for (int i = 0; i < client_count; i++) {
+			memset(clients + i, 0, sizeof(indigo_client));
+			snprintf(clients[i].name, INDIGO_NAME_SIZE, "Bench client #%d", i);
+			clients[i].version = INDIGO_VERSION_CURRENT;
+			clients[i].update_property = bench_client_update_property;
+			indigo_attach_client(clients + i);
+		}
+		update_bench_properties(0);
+		deliveries = 0;
+		double start = now();
+		for (int i = 0; i < count; i++)
+			update_bench_properties(i);
+		double seconds = now() - start;
+		emit("bus_fanout", "\"clients\": %d, \"operations\": %d, \"deliveries\": %ld, \"seconds\": %.6f, \"rate\": %.1f, \"unit\": \"updates/s\"", client_count, count, deliveries, seconds, count / seconds);
+		for (int i = 0; i < client_count; i++)
+			indigo_detach_client(clients + i);
+	}
+}
+
+// -------------------------------------------------------------------------------- protocol serialize and parse
+
+static char xml_traffic[64] = "";
+
+static void bench_serialize(const char *benchmark, bool json) {
+	char path[64];
+	int handle = temporary_file(path);
+	if (handle < 0)
+		return;
+	indigo_client *adapter;
+	if (json) {
+		adapter = indigo_json_device_adapter(handle, handle, false);
+	} else {
+		adapter = indigo_xml_device_adapter(handle, handle);
+		adapter->version = INDIGO_VERSION_2_0;
+	}
+	indigo_attach_client(adapter);
+	adapter->define_property(adapter, &bench_device, number_property, NULL);
+	adapter->define_property(adapter, &bench_device, text_property, NULL);
+	int count = iterations(200000);
+	double start = now();
+	for (int i = 0; i < count; i++)
+		update_bench_properties(i);
+	double seconds = now() - start;
+	long bytes = lseek(handle, 0, SEEK_CUR);
+	indigo_detach_client(adapter);
+	emit(benchmark, "\"operations\": %d, \"bytes\": %ld, \"seconds\": %.6f, \"rate\": %.1f, \"throughput\": %.3f, \"unit\": \"messages/s\"", count, bytes, seconds, count / seconds, bytes / seconds / 1e6);
+	if (json) {
+		indigo_release_json_device_adapter(adapter);
+		close(handle);
+		unlink(path);
+	} else {
+		indigo_release_xml_device_adapter(adapter);
+		close(handle);
+		// keep output as recorded traffic for xml_parse
+		strcpy(xml_traffic, path);
+	}
+}
+
+static void bench_xml_serialize(void) {
+	bench_serialize("xml_serialize", false);
+}
+
+static void bench_json_serialize(void) {
+	bench_serialize("json_serialize", true);
+}
+
+static indigo_result parse_enumerate_properties(indigo_device *device, indigo_client *client, indigo_property *property) {
+	return INDIGO_OK;
+}
+
+static void bench_xml_parse(void) {
+	const char *source = traffic;
+	if (source == NULL) {
+		if (*xml_traffic == 0)
+			bench_xml_serialize();
+		source = xml_traffic;
+	}
+	if (*source == 0)
+		return;
+	static indigo_client client = { "Bench parser", false, NULL, INDIGO_OK, INDIGO_VERSION_CURRENT, NULL, NULL, bench_client_update_property, bench_client_update_property, NULL, NULL, NULL };
+	indigo_attach_client(&client);
+	int count = iterations(10) / (quick ? 1 : 5) + 1;
+	long bytes = 0;
+	deliveries = 0;
+	double start = now();
+	for (int i = 0; i < count; i++) {
+		indigo_adapter_context context = { 0 };
+		context.input = open(source, O_RDONLY);
+		context.output = -1;
+		if (context.input < 0)
+			break;
+		bytes += lseek(context.input, 0, SEEK_END);
+		lseek(context.input, 0, SEEK_SET);
+		indigo_device device = { 0 };
+		strcpy(device.name, "Bench parser");
+		device.device_context = &context;
+		device.version = INDIGO_VERSION_2_0;
+		device.enumerate_properties = parse_enumerate_properties;
+		indigo_xml_parse(&device, NULL);
+		close(context.input);
+	}
+	double seconds = now() - start;
+	indigo_detach_client(&client);
+	emit("xml_parse", "\"source\": \"%s\", \"messages\": %ld, \"bytes\": %ld, \"seconds\": %.6f, \"rate\": %.1f, \"throughput\": %.3f, \"unit\": \"messages/s\"", traffic ? traffic : "recorded", deliveries, bytes, seconds, deliveries / seconds, bytes / seconds / 1e6);
+	if (traffic == NULL && *xml_traffic) {
+		unlink(xml_traffic);
+		*xml_traffic = 0;
+	}
+}
+
+static void bench_json_parse(void) {
+	char path[64];
+	int handle = temporary_file(path);
+	if (handle < 0)
+		return;
+	FILE *file = fdopen(handle, "w");
+	int count = iterations(200000);
+	for (int i = 0; i < count; i++)
+		fprintf(file, "{ \"newNumberVector\": { \"device\": \"%s\", \"name\": \"BENCH_NUMBER\", \"items\": [ { \"name\": \"VALUE_0\", \"value\": %g }, { \"name\": \"VALUE_1\", \"value\": %d } ] } }\n", BENCH_DEVICE, i * 0.01, i);
+	long bytes = ftell(file);
+	fclose(file);
+	int input = open(path, O_RDONLY);
+	int null = open("/dev/null", O_WRONLY);
+	indigo_client *adapter = indigo_json_device_adapter(input, null, false);
+	changes = 0;
+	double start = now();
+	indigo_json_parse(NULL, adapter);
+	double seconds = now() - start;
+	indigo_release_json_device_adapter(adapter);
+	close(input);
+	close(null);
+	unlink(path);
+	emit("json_parse", "\"messages\": %d, \"changes\": %ld, \"bytes\": %ld, \"seconds\": %.6f, \"rate\": %.1f, \"throughput\": %.3f, \"unit\": \"messages/s\"", count, changes, bytes, seconds, count / seconds, bytes / seconds / 1e6);
+}
+
+// -------------------------------------------------------------------------------- base64
+
+static void bench_base64(void) {
+	long size = 16 * 1024 * 1024;
+	unsigned char *data = malloc(size);
+	unsigned char *encoded = malloc((size + 2) / 3 * 4 + 4);
+	unsigned char *decoded = malloc(size + 4);
+	unsigned seed = 1;
+	for (long i = 0; i < size; i++)
+		data[i] = (unsigned char)((seed = seed * 1103515245 + 12345) >> 16);
+	int count = iterations(20);
+	long encoded_size = 0;
+	double start = now();
+	for (int i = 0; i < count; i++)
+		encoded_size = base64_encode(encoded, data, size);
+	double seconds = now() - start;
+	emit("base64_encode", "\"bytes\": %ld, \"operations\": %d, \"seconds\": %.6f, \"rate\": %.3f, \"unit\": \"MB/s\"", size, count, seconds, size * (double)count / seconds / 1e6);
+	long decoded_size = 0;
+	start = now();
+	for (int i = 0; i < count; i++)
+		decoded_size = base64_decode_fast(decoded, encoded, encoded_size);
+	seconds = now() - start;
+	bool valid = decoded_size == size && !memcmp(data, decoded, size);
+	emit("base64_decode", "\"bytes\": %ld, \"operations\": %d, \"seconds\": %.6f, \"rate\": %.3f, \"unit\": \"MB/s\", \"valid\": %s", size, count, seconds, size * (double)count / seconds / 1e6, valid ? "true" : "false");
+	free(data);
+	free(encoded);
+	free(decoded);
+}
+
+// -------------------------------------------------------------------------------- image processing
+
+static indigo_result bench_ccd_attach(indigo_device *device) {
+	return indigo_ccd_attach(device, INDIGO_VERSION_CURRENT);
+}
+
+static indigo_result bench_ccd_detach(indigo_device *device) {
+	return indigo_ccd_detach(device);
+}
+
+static void bench_process_image(void) {
+	static const int resolutions[][2] = { { 640, 480 }, { 1600, 1200 }, { 4096, 3072 } };
+	static const char *formats[] = { "fits", "xisf", "raw", "jpeg" };
+	static indigo_device ccd_device = INDIGO_DEVICE_INITIALIZER("Bench CCD", bench_ccd_attach, indigo_ccd_enumerate_properties, indigo_ccd_change_property, NULL, bench_ccd_detach);
+	indigo_device *device = &ccd_device;
+	indigo_attach_device(device);
+	int count = iterations(5);
+	for (int r = 0; r < sizeof(resolutions) / sizeof(resolutions[0]); r++) {
+		int width = resolutions[r][0], height = resolutions[r][1];
+		long size = FITS_HEADER_SIZE + 2L * width * height + 2880;
+		unsigned short *pattern = malloc(2L * width * height);
+		char *data = malloc(size);
+		unsigned seed = 1;
+		for (long i = 0; i < (long)width * height; i++)
+			pattern[i] = (unsigned short)(((i % width) * 16 + (i / width) * 8) ^ ((seed = seed * 1103515245 + 12345) >> 24));
+		for (int f = 0; f < 4; f++) {
+			indigo_set_switch(CCD_IMAGE_FORMAT_PROPERTY, CCD_IMAGE_FORMAT_PROPERTY->items + f, true);
+			double *times = malloc(count * sizeof(double));
+			for (int i = 0; i < count; i++) {
+				// conversion is done in place, so data is restored before each run
+				memcpy(data + FITS_HEADER_SIZE, pattern, 2L * width * height);
+				double start = now();
+				indigo_process_image(device, data, width, height, 16, true, true, NULL);
+				times[i] = now() - start;
+			}
+			double median = percentile(times, count, 50);
+			emit("process_image", "\"format\": \"%s\", \"width\": %d, \"height\": %d, \"bpp\": 16, \"operations\": %d, \"seconds\": %.6f, \"rate\": %.3f, \"unit\": \"Mpx/s\"", formats[f], width, height, count, median, width * (double)height / median / 1e6);
+			free(times);
+		}
+		free(pattern);
+		free(data);
+	}
+	indigo_detach_device(device);
+}
+
+// -------------------------------------------------------------------------------- timers
+
+static pthread_mutex_t timer_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t timer_cond = PTHREAD_COND_INITIALIZER;
+static double timer_fired;
+
+static void bench_timer_callback(indigo_device *device) {
+	pthread_mutex_lock(&timer_mutex);
+	timer_fired = now();
+	pthread_cond_signal(&timer_cond);
+	pthread_mutex_unlock(&timer_mutex);
+}
+
+static void bench_timer_accuracy(void) {
+	static const double delays[] = { 0.001, 0.01, 0.1 };
+	int count = iterations(50);
+	double *lateness = malloc(count * sizeof(double));
+	for (int d = 0; d < sizeof(delays) / sizeof(double); d++) {
+		double sum = 0;
+		for (int i = 0; i < count; i++) {
+			pthread_mutex_lock(&timer_mutex);
+			timer_fired = 0;
+			double start = now();
+			indigo_set_timer(NULL, delays[d], bench_timer_callback);
+			while (timer_fired == 0)
+				pthread_cond_wait(&timer_cond, &timer_mutex);
+			lateness[i] = (timer_fired - start - delays[d]) * 1e6;
+			pthread_mutex_unlock(&timer_mutex);
+			sum += lateness[i];
+		}
+		double median = percentile(lateness, count, 50);
+		emit("timer_accuracy", "\"delay\": %g, \"operations\": %d, \"mean\": %.1f, \"median\": %.1f, \"p99\": %.1f, \"max\": %.1f, \"unit\": \"us\"", delays[d], count, sum / count, median, percentile(lateness, count, 99), lateness[count - 1]);
+	}
+	free(lateness);
+}
+
+// -------------------------------------------------------------------------------- end-to-end simulator exposure over loopback
+
+static int port_pipe[2];
+
+static void bench_server_callback(int count) {
+	static bool started = false;
+	if (!started) {
+		started = true;
+		if (write(port_pipe[1], &indigo_server_tcp_port, sizeof(int)) != sizeof(int))
+			exit(EXIT_FAILURE);
+	}
+}
+
+static pthread_mutex_t e2e_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t e2e_cond = PTHREAD_COND_INITIALIZER;
+static char e2e_device[INDIGO_NAME_SIZE] = "";
+static bool e2e_connected = false;
+static bool e2e_image = false;
+static long e2e_image_size = 0;
+
+static bool is_simulator(indigo_property *property) {
+	// remote devices are named "<device> @ <server>"
+	int length = strlen(CCD_SIMULATOR_IMAGER_CAMERA_NAME);
+	return !strncmp(property->device, CCD_SIMULATOR_IMAGER_CAMERA_NAME, length) && (property->device[length] == 0 || !strncmp(property->device + length, " @ ", 3));
+}
+
+static indigo_result e2e_attach(indigo_client *client) {
+	indigo_enumerate_properties(client, &INDIGO_ALL_PROPERTIES);
+	return INDIGO_OK;
+}
+
+static indigo_result e2e_define_property(indigo_client *client, indigo_device *device, indigo_property *property, const char *message) {
+	if (!is_simulator(property))
+		return INDIGO_OK;
+	pthread_mutex_lock(&e2e_mutex);
+	if (!strcmp(property->name, CONNECTION_PROPERTY_NAME)) {
+		strncpy(e2e_device, property->device, INDIGO_NAME_SIZE);
+		pthread_cond_signal(&e2e_cond);
+	} else if (!strcmp(property->name, CCD_IMAGE_PROPERTY_NAME)) {
+		indigo_enable_blob(client, property, INDIGO_ENABLE_BLOB_ALSO);
+	}
+	pthread_mutex_unlock(&e2e_mutex);
+	return INDIGO_OK;
+}
+
+static indigo_result e2e_update_property(indigo_client *client, indigo_device *device, indigo_property *property, const char *message) {
+	if (!is_simulator(property))
+		return INDIGO_OK;
+	pthread_mutex_lock(&e2e_mutex);
+	if (!strcmp(property->name, CONNECTION_PROPERTY_NAME) && property->state == INDIGO_OK_STATE) {
+		e2e_connected = indigo_get_switch(property, CONNECTION_CONNECTED_ITEM_NAME);
+		pthread_cond_signal(&e2e_cond);
+	} else if (!strcmp(property->name, CCD_IMAGE_PROPERTY_NAME) && property->state == INDIGO_OK_STATE && property->items[0].blob.size > 0) {
+		e2e_image = true;
+		e2e_image_size = property->items[0].blob.size;
+		pthread_cond_signal(&e2e_cond);
+	}
+	pthread_mutex_unlock(&e2e_mutex);
+	return INDIGO_OK;
+}
+
+static bool e2e_wait(bool *condition, const char *what) {
+	struct timespec deadline;
+	clock_gettime(CLOCK_REALTIME, &deadline);
+	deadline.tv_sec += 30;
+	while (!*condition) {
+		if (pthread_cond_timedwait(&e2e_cond, &e2e_mutex, &deadline) != 0) {
+			emit("e2e_exposure", "\"error\": \"timeout waiting for %s\"", what);
+			return false;
+		}
+	}
+	return true;
+}
+
+static bool e2e_wait_device(void) {
+	struct timespec deadline;
+	clock_gettime(CLOCK_REALTIME, &deadline);
+	deadline.tv_sec += 30;
+	while (*e2e_device == 0) {
+		if (pthread_cond_timedwait(&e2e_cond, &e2e_mutex, &deadline) != 0) {
+			emit("e2e_exposure", "\"error\": \"timeout waiting for simulator\"");
+			return false;
+		}
+	}
+	return true;
+}
+
+static pid_t server_pid = -1;
+static int server_port = 0;
+
+static void start_simulator_server(void) {
+	if (pipe(port_pipe) < 0)
+		return;
+	server_pid = fork();
+	if (server_pid == 0) {
+		close(port_pipe[0]);
+		indigo_start();
+		indigo_add_driver(indigo_ccd_simulator, true, NULL);
+		indigo_server_tcp_port = 0;
+		indigo_server_start(bench_server_callback);
+		exit(EXIT_SUCCESS);
+	}
+	close(port_pipe[1]);
+	if (server_pid < 0 || read(port_pipe[0], &server_port, sizeof(int)) != sizeof(int))
+		server_port = 0;
+	close(port_pipe[0]);
+}
+
+static void stop_simulator_server(void) {
+	if (server_pid > 0) {
+		kill(server_pid, SIGKILL);
+		waitpid(server_pid, NULL, 0);
+	}
+}
+
+static void bench_e2e_exposure(void) {
+	if (server_port == 0) {
+		emit("e2e_exposure", "\"error\": \"server failed to start\"");
+		return;
+	}
+	static indigo_client client = { "Bench e2e", false, NULL, INDIGO_OK, INDIGO_VERSION_CURRENT, NULL, e2e_attach, e2e_define_property, e2e_update_property, NULL, NULL, NULL };
+	indigo_attach_client(&client);
+	indigo_server_entry *server;
+	indigo_connect_server("bench", "localhost", server_port, &server);
+	pthread_mutex_lock(&e2e_mutex);
+	if (e2e_wait_device()) {
+		pthread_mutex_unlock(&e2e_mutex);
+		indigo_device_connect(&client, e2e_device);
+		pthread_mutex_lock(&e2e_mutex);
+		if (e2e_wait(&e2e_connected, "connection")) {
+			int count = iterations(20);
+			double *latency = malloc(count * sizeof(double));
+			static const char *items[] = { CCD_EXPOSURE_ITEM_NAME };
+			static const double values[] = { 0 };
+			int i;
+			for (i = 0; i < count; i++) {
+				e2e_image = false;
+				double start = now();
+				pthread_mutex_unlock(&e2e_mutex);
+				indigo_change_number_property(&client, e2e_device, CCD_EXPOSURE_PROPERTY_NAME, 1, items, values);
+				pthread_mutex_lock(&e2e_mutex);
+				if (!e2e_wait(&e2e_image, "image"))
+					break;
+				latency[i] = (now() - start) * 1e3;
+			}
+			if (i == count) {
+				double median = percentile(latency, count, 50);
+				emit("e2e_exposure", "\"exposure\": 0, \"image_bytes\": %ld, \"operations\": %d, \"median\": %.3f, \"p99\": %.3f, \"max\": %.3f, \"unit\": \"ms\"", e2e_image_size, count, median, percentile(latency, count, 99), latency[count - 1]);
+			}
+			free(latency);
+		}
+	}
+	pthread_mutex_unlock(&e2e_mutex);
+	indigo_disconnect_server(server);
+	indigo_detach_client(&client);
+}
+
+// -------------------------------------------------------------------------------- main
+
+static struct {
+	const char *name;
+	void (*run)(void);
+} benchmarks[] = {
+	{ "bus_fanout", bench_bus_fanout },
+	{ "xml_serialize", bench_xml_serialize },
+	{ "xml_parse", bench_xml_parse },
+	{ "json_serialize", bench_json_serialize },
+	{ "json_parse", bench_json_parse },
+	{ "base64", bench_base64 },
+	{ "process_image", bench_process_image },
+	{ "timer_accuracy", bench_timer_accuracy },
+	{ "e2e_exposure", bench_e2e_exposure },
+};
+
+int main(int argc, const char * argv[]) {
+	indigo_main_argc = argc;
+	indigo_main_argv = argv;
+	output = stdout;
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "-q") || !strcmp(argv[i], "--quick")) {
+			quick = true;
+		} else if ((!strcmp(argv[i], "-f") || !strcmp(argv[i], "--filter")) && i < argc - 1) {
+			filter = argv[++i];
+		} else if ((!strcmp(argv[i], "-t") || !strcmp(argv[i], "--traffic")) && i < argc - 1) {
+			traffic = argv[++i];
+		} else if ((!strcmp(argv[i], "-o") || !strcmp(argv[i], "--output")) && i < argc - 1) {
+			output = fopen(argv[++i], "w");
+			if (output == NULL) {
+				perror(argv[i]);
+				return EXIT_FAILURE;
+			}
+		} else {
+			printf("%s [-h|--help] [-q|--quick] [-f|--filter name] [-t|--traffic recorded.xml] [-o|--output results.json]\n", argv[0]);
+			return argv[i][1] == 'h' || !strcmp(argv[i], "--help") ? EXIT_SUCCESS : EXIT_FAILURE;
+		}
+	}
+	struct utsname host;
+	uname(&host);
+	emit("info", "\"version\": \"%d.%d-%d\", \"system\": \"%s %s\", \"machine\": \"%s\", \"cpus\": %ld, \"quick\": %s, \"timestamp\": %ld", (INDIGO_VERSION_CURRENT >> 8) & 0xFF, INDIGO_VERSION_CURRENT & 0xFF, INDIGO_BUILD, host.sysname, host.release, host.machine, sysconf(_SC_NPROCESSORS_ONLN), quick ? "true" : "false", (long)time(NULL));
+	// the simulator server is forked before any bus threads exist in this process
+	if (selected("e2e_exposure"))
+		start_simulator_server();
+	indigo_start();
+	indigo_attach_device(&bench_device);
+	for (int i = 0; i < sizeof(benchmarks) / sizeof(benchmarks[0]); i++) {
+		if (selected(benchmarks[i].name))
+			benchmarks[i].run();
+	}
+	indigo_detach_device(&bench_device);
+	indigo_stop();
+	stop_simulator_server();
+	if (output != stdout)
+		fclose(output);
+	return EXIT_SUCCESS;
+}
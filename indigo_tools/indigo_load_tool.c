@@ -0,0 +1,902 @@
+// Copyright (c) 2026 agent
+// All rights reserved.
+//
+// You can use this software under the terms of 'INDIGO Astronomy
+// open-source license' (see LICENSE.md).
+//
+// THIS SOFTWARE IS PROVIDED BY THE AUTHORS 'AS IS' AND ANY EXPRESS
+// OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+// GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// version history
+// 2.0 by agent <agent@local>
+
+/** INDIGO load generator
+ \file indigo_load_tool.c
+
+ Opens many XML, JSON and WebSocket connections to a server and replays a scripted
+ sequence of property changes on each of them at a fixed rate. Request is completed
+ by the first update of the changed property which is not busy. Latency percentiles
+ and throughput are reported per protocol.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <unistd.h>
+#include <string.h>
+#include <strings.h>
+#include <pthread.h>
+#include <signal.h>
+#include <time.h>
+#include <ctype.h>
+#include <sys/socket.h>
+
+#include "indigo_bus.h"
+#include "indigo_io.h"
+#include "indigo_xml.h"
+#include "indigo_json.h"
+#include "indigo_client_xml.h"
+
+#define INDIGO_DEFAULT_PORT	7624
+#define MAX_CONNECTIONS			200
+#define MAX_STEPS						64
+#define MAX_STEP_ITEMS			16
+#define CONNECTION_PREFIX		"load"
+
+typedef enum {
+	LOAD_XML = 0,
+	LOAD_JSON,
+	LOAD_WS,
+	LOAD_PROTOCOLS
+} load_protocol;
+
+static const char *protocol_names[] = { "xml", "json", "ws" };
+
+typedef struct {
+	char device[INDIGO_NAME_SIZE];
+	char property[INDIGO_NAME_SIZE];
+	int count;
+	char items[MAX_STEP_ITEMS][INDIGO_NAME_SIZE];
+	char values[MAX_STEP_ITEMS][INDIGO_VALUE_SIZE];
+	indigo_property_type type;		///< learned from the first definition, 0 until then
+} load_step;
+
+typedef struct {
+	int index;
+	load_protocol protocol;
+	int socket;
+	char name[INDIGO_NAME_SIZE];
+	indigo_device *adapter;
+	pthread_t reader;
+	pthread_t writer;
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	bool closed;
+	int waiting;									///< index of step waiting for completion or -1
+	bool completed;
+	indigo_property_state state;
+	int requests;
+	int errors;
+	int timeouts;
+	long blob_bytes;
+	double *latencies;
+} load_connection;
+
+static load_step steps[MAX_STEPS];
+static int step_count = 0;
+static load_connection connections[MAX_CONNECTIONS];
+static int connection_count = 10;
+static pthread_mutex_t steps_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t steps_cond = PTHREAD_COND_INITIALIZER;
+
+static char hostname[255] = "localhost";
+static int port = INDIGO_DEFAULT_PORT;
+static bool protocols[LOAD_PROTOCOLS] = { true, false, false };
+static int request_count = 100;
+static double rate = 10;
+static double timeout = 30;
+static indigo_enable_blob_mode blob_mode = INDIGO_ENABLE_BLOB_NEVER;
+static const char *blob_mode_names[] = { [INDIGO_ENABLE_BLOB_ALSO] = "Also", [INDIGO_ENABLE_BLOB_NEVER] = "Never", [INDIGO_ENABLE_BLOB_URL] = "URL" };
+
+// -------------------------------------------------------------------------------- helpers
+
+static double now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// clock_nanosleep() is not available on macOS, remaining interval is recomputed after each interruption
+static void sleep_until(double time) {
+	double interval;
+	while ((interval = time - now()) > 0) {
+		struct timespec ts;
+		ts.tv_sec = (time_t)interval;
+		ts.tv_nsec = (long)((interval - ts.tv_sec) * 1e9);
+		if (nanosleep(&ts, NULL) == 0)
+			break;
+	}
+}
+
+static void deadline_after(struct timespec *deadline, double seconds) {
+	clock_gettime(CLOCK_REALTIME, deadline);
+	double time = deadline->tv_sec + deadline->tv_nsec / 1e9 + seconds;
+	deadline->tv_sec = (time_t)time;
+	deadline->tv_nsec = (long)((time - deadline->tv_sec) * 1e9);
+}
+
+static int compare_doubles(const void *a, const void *b) {
+	double x = *(const double *)a, y = *(const double *)b;
+	return x < y ? -1 : x > y;
+}
+
+static void trim_spaces(char *str) {
+	int len = strlen(str);
+	while (len > 0 && isspace(str[len - 1]))
+		str[--len] = '\0';
+	int skip = 0;
+	while (isspace(str[skip]))
+		skip++;
+	if (skip)
+		memmove(str, str + skip, len - skip + 1);
+}
+
+static bool switch_value(const char *value) {
+	return !strcasecmp(value, "ON") || !strcasecmp(value, "true") || !strcmp(value, "1");
+}
+
+// -------------------------------------------------------------------------------- workload script
+
+static bool parse_step(const char *line, load_step *step) {
+	char buffer[INDIGO_NAME_SIZE * 2 + MAX_STEP_ITEMS * (INDIGO_NAME_SIZE + INDIGO_VALUE_SIZE)];
+	strncpy(buffer, line, sizeof(buffer) - 1);
+	buffer[sizeof(buffer) - 1] = 0;
+	memset(step, 0, sizeof(load_step));
+	char *property = strchr(buffer, '.');
+	if (property == NULL)
+		return false;
+	*property++ = 0;
+	char *item = strchr(property, '.');
+	if (item == NULL)
+		return false;
+	*item++ = 0;
+	strncpy(step->device, buffer, INDIGO_NAME_SIZE - 1);
+	strncpy(step->property, property, INDIGO_NAME_SIZE - 1);
+	trim_spaces(step->device);
+	trim_spaces(step->property);
+	char *last = NULL;
+	for (char *pair = strtok_r(item, ";", &last); pair != NULL; pair = strtok_r(NULL, ";", &last)) {
+		char *value = strchr(pair, '=');
+		if (value == NULL || step->count == MAX_STEP_ITEMS)
+			return false;
+		*value++ = 0;
+		strncpy(step->items[step->count], pair, INDIGO_NAME_SIZE - 1);
+		strncpy(step->values[step->count], value, INDIGO_VALUE_SIZE - 1);
+		trim_spaces(step->items[step->count]);
+		trim_spaces(step->values[step->count]);
+		step->count++;
+	}
+	return step->count > 0;
+}
+
+static bool add_step(const char *line) {
+	if (step_count == MAX_STEPS) {
+		fprintf(stderr, "Too many steps\n");
+		return false;
+	}
+	if (!parse_step(line, steps + step_count)) {
+		fprintf(stderr, "Invalid property string format '%s'\n", line);
+		return false;
+	}
+	step_count++;
+	return true;
+}
+
+static bool load_script(const char *path) {
+	FILE *file = fopen(path, "r");
+	if (file == NULL) {
+		fprintf(stderr, "Can't open %s: %s\n", path, strerror(errno));
+		return false;
+	}
+	char line[4096];
+	bool result = true;
+	while (result && fgets(line, sizeof(line), file)) {
+		trim_spaces(line);
+		if (*line && *line != '#')
+			result = add_step(line);
+	}
+	fclose(file);
+	return result;
+}
+
+static void learn_step_type(const char *device, const char *property, indigo_property_type type) {
+	pthread_mutex_lock(&steps_mutex);
+	for (int i = 0; i < step_count; i++) {
+		if (steps[i].type == 0 && !strcmp(steps[i].device, device) && !strcmp(steps[i].property, property)) {
+			steps[i].type = type;
+			pthread_cond_broadcast(&steps_cond);
+		}
+	}
+	pthread_mutex_unlock(&steps_mutex);
+}
+
+static bool wait_for_step_type(load_step *step) {
+	// properties may be defined by one of previous steps (e.g. after CONNECTION is changed)
+	struct timespec deadline;
+	deadline_after(&deadline, timeout);
+	pthread_mutex_lock(&steps_mutex);
+	while (step->type == 0) {
+		if (pthread_cond_timedwait(&steps_cond, &steps_mutex, &deadline) != 0)
+			break;
+	}
+	pthread_mutex_unlock(&steps_mutex);
+	return step->type != 0;
+}
+
+// -------------------------------------------------------------------------------- request completion
+
+static void property_updated(load_connection *connection, const char *device, const char *property, indigo_property_state state) {
+	pthread_mutex_lock(&connection->mutex);
+	if (connection->waiting >= 0 && state != INDIGO_BUSY_STATE) {
+		load_step *step = steps + connection->waiting;
+		if (!strcmp(step->device, device) && !strcmp(step->property, property)) {
+			connection->completed = true;
+			connection->state = state;
+			pthread_cond_signal(&connection->cond);
+		}
+	}
+	pthread_mutex_unlock(&connection->mutex);
+}
+
+static void connection_closed(load_connection *connection) {
+	pthread_mutex_lock(&connection->mutex);
+	connection->closed = true;
+	pthread_cond_signal(&connection->cond);
+	pthread_mutex_unlock(&connection->mutex);
+}
+
+// -------------------------------------------------------------------------------- XML connections (client adapter on local bus)
+
+static load_connection *xml_connection(const char *device, char *local_name) {
+	// remote devices are named "<device> @ loadNNNN"
+	const char *at = strrchr(device, '@');
+	if (at == NULL || strncmp(at + 2, CONNECTION_PREFIX, strlen(CONNECTION_PREFIX)))
+		return NULL;
+	int index = atoi(at + 2 + strlen(CONNECTION_PREFIX));
+	if (index < 0 || index >= connection_count)
+		return NULL;
+	int length = at - device;
+	while (length > 0 && device[length - 1] == ' ')
+		length--;
+	memcpy(local_name, device, length);
+	local_name[length] = 0;
+	return connections + index;
+}
+
+static indigo_result load_client_define_property(indigo_client *client, indigo_device *device, indigo_property *property, const char *message) {
+	char name[INDIGO_NAME_SIZE];
+	load_connection *connection = xml_connection(property->device, name);
+	if (connection == NULL)
+		return INDIGO_OK;
+	learn_step_type(name, property->name, property->type);
+	if (property->type == INDIGO_BLOB_VECTOR && blob_mode != INDIGO_ENABLE_BLOB_NEVER)
+		indigo_enable_blob(client, property, blob_mode);
+	property_updated(connection, name, property->name, property->state);
+	return INDIGO_OK;
+}
+
+static indigo_result load_client_update_property(indigo_client *client, indigo_device *device, indigo_property *property, const char *message) {
+	char name[INDIGO_NAME_SIZE];
+	load_connection *connection = xml_connection(property->device, name);
+	if (connection == NULL)
+		return INDIGO_OK;
+	if (property->type == INDIGO_BLOB_VECTOR && property->state == INDIGO_OK_STATE) {
+		for (int i = 0; i < property->count; i++)
+			connection->blob_bytes += property->items[i].blob.size;
+	}
+	property_updated(connection, name, property->name, property->state);
+	return INDIGO_OK;
+}
+
+static indigo_client load_client = {
+	"Load generator", false, NULL, INDIGO_OK, INDIGO_VERSION_CURRENT, NULL,
+	NULL,
+	load_client_define_property,
+	load_client_update_property,
+	NULL,
+	NULL,
+	NULL
+};
+
+static void *xml_reader(load_connection *connection) {
+	indigo_xml_parse(connection->adapter, NULL);
+	connection_closed(connection);
+	return NULL;
+}
+
+static bool xml_open(load_connection *connection) {
+	char url[INDIGO_NAME_SIZE];
+	snprintf(url, sizeof(url), "http://%s:%d", hostname, port);
+	connection->adapter = indigo_xml_client_adapter(connection->name, url, connection->socket, connection->socket);
+	indigo_attach_device(connection->adapter);
+	if (pthread_create(&connection->reader, NULL, (void *(*)(void *))xml_reader, connection))
+		return false;
+	// only this connection is asked for properties, not all attached adapters
+	connection->adapter->enumerate_properties(connection->adapter, &load_client, NULL);
+	return true;
+}
+
+static void xml_send(load_connection *connection, load_step *step) {
+	char device[INDIGO_NAME_SIZE];
+	snprintf(device, sizeof(device), "%s @ %s", step->device, connection->name);
+	const char *items[MAX_STEP_ITEMS];
+	for (int i = 0; i < step->count; i++)
+		items[i] = step->items[i];
+	switch (step->type) {
+		case INDIGO_TEXT_VECTOR: {
+			const char *values[MAX_STEP_ITEMS];
+			for (int i = 0; i < step->count; i++)
+				values[i] = step->values[i];
+			indigo_change_text_property(&load_client, device, step->property, step->count, items, values);
+			break;
+		}
+		case INDIGO_NUMBER_VECTOR: {
+			double values[MAX_STEP_ITEMS];
+			for (int i = 0; i < step->count; i++)
+				values[i] = atof(step->values[i]);
+			indigo_change_number_property(&load_client, device, step->property, step->count, items, values);
+			break;
+		}
+		case INDIGO_SWITCH_VECTOR: {
+			bool values[MAX_STEP_ITEMS];
+			for (int i = 0; i < step->count; i++)
+				values[i] = switch_value(step->values[i]);
+			indigo_change_switch_property(&load_client, device, step->property, step->count, items, values);
+			break;
+		}
+		default:
+			break;
+	}
+}
+
+// -------------------------------------------------------------------------------- JSON and WebSocket connections
+
+typedef struct {
+	char *data;
+	long size;
+	long capacity;
+} json_buffer;
+
+static bool json_reserve(json_buffer *buffer, long size) {
+	if (size <= buffer->capacity)
+		return true;
+	long capacity = buffer->capacity ? buffer->capacity : 64 * 1024;
+	while (capacity < size)
+		capacity *= 2;
+	char *data = realloc(buffer->data, capacity);
+	if (data == NULL)
+		return false;
+	buffer->data = data;
+	buffer->capacity = capacity;
+	return true;
+}
+
+static void json_string(json_buffer *buffer, const char *string) {
+	json_reserve(buffer, buffer->size + 2 * strlen(string) + 3);
+	char *target = buffer->data + buffer->size;
+	*target++ = '"';
+	for (const char *source = string; *source; source++) {
+		if (*source == '"' || *source == '\\')
+			*target++ = '\\';
+		*target++ = *source;
+	}
+	*target++ = '"';
+	*target = 0;
+	buffer->size = target - buffer->data;
+}
+
+static void json_append(json_buffer *buffer, const char *text) {
+	long length = strlen(text);
+	json_reserve(buffer, buffer->size + length + 1);
+	memcpy(buffer->data + buffer->size, text, length + 1);
+	buffer->size += length;
+}
+
+static bool json_field(const char *message, const char *key, char *value, int size) {
+	char pattern[INDIGO_NAME_SIZE];
+	snprintf(pattern, sizeof(pattern), "\"%s\": \"", key);
+	const char *source = strstr(message, pattern);
+	if (source == NULL)
+		return false;
+	source += strlen(pattern);
+	int length = 0;
+	while (*source && *source != '"' && length < size - 1) {
+		if (*source == '\\' && source[1])
+			source++;
+		value[length++] = *source++;
+	}
+	value[length] = 0;
+	return true;
+}
+
+static bool ws_send(load_connection *connection, int opcode, const char *data, long length) {
+	// client frames must be masked (RFC6455 5.3), key is fixed as it has no security role here
+	static const unsigned char mask[4] = { 0x49, 0x4E, 0x44, 0x49 };
+	unsigned char header[14];
+	int header_size = 2;
+	header[0] = 0x80 | opcode;
+	if (length < 126) {
+		header[1] = 0x80 | length;
+	} else if (length < 65536) {
+		header[1] = 0x80 | 126;
+		header[2] = (length >> 8) & 0xFF;
+		header[3] = length & 0xFF;
+		header_size = 4;
+	} else {
+		header[1] = 0x80 | 127;
+		for (int i = 0; i < 8; i++)
+			header[2 + i] = (length >> (56 - 8 * i)) & 0xFF;
+		header_size = 10;
+	}
+	memcpy(header + header_size, mask, 4);
+	header_size += 4;
+	char *masked = malloc(length);
+	if (masked == NULL)
+		return false;
+	for (long i = 0; i < length; i++)
+		masked[i] = data[i] ^ mask[i % 4];
+	bool result = indigo_write(connection->socket, (char *)header, header_size) && indigo_write(connection->socket, masked, length);
+	free(masked);
+	return result;
+}
+
+static bool json_send_message(load_connection *connection, json_buffer *message) {
+	if (connection->protocol == LOAD_WS)
+		return ws_send(connection, WEB_SOCKET_OPCODE_TEXT, message->data, message->size);
+	// plain JSON requests are read line by line
+	return indigo_write(connection->socket, message->data, message->size) && indigo_write(connection->socket, "\n", 1);
+}
+
+static long ws_read(load_connection *connection, json_buffer *buffer, int *opcode) {
+	unsigned char header[8];
+	buffer->size = 0;
+	*opcode = -1;
+	while (true) {
+		if (indigo_read(connection->socket, (char *)header, 2) <= 0)
+			return -1;
+		bool fin = header[0] & 0x80;
+		int frame_opcode = header[0] & 0x0F;
+		uint64_t length = header[1] & 0x7F;
+		if (length == 126) {
+			if (indigo_read(connection->socket, (char *)header, 2) <= 0)
+				return -1;
+			length = (header[0] << 8) | header[1];
+		} else if (length == 127) {
+			if (indigo_read(connection->socket, (char *)header, 8) <= 0)
+				return -1;
+			length = 0;
+			for (int i = 0; i < 8; i++)
+				length = (length << 8) | header[i];
+		}
+		if (!json_reserve(buffer, buffer->size + length + 1))
+			return -1;
+		if (length > 0 && indigo_read(connection->socket, buffer->data + buffer->size, (long)length) <= 0)
+			return -1;
+		if (frame_opcode & 0x08) {
+			if (frame_opcode == WEB_SOCKET_OPCODE_CLOSE)
+				return -1;
+			if (frame_opcode == WEB_SOCKET_OPCODE_PING)
+				ws_send(connection, WEB_SOCKET_OPCODE_PONG, buffer->data + buffer->size, (long)length);
+			continue;
+		}
+		if (frame_opcode != WEB_SOCKET_OPCODE_CONTINUATION)
+			*opcode = frame_opcode;
+		buffer->size += length;
+		if (fin) {
+			buffer->data[buffer->size] = 0;
+			return buffer->size;
+		}
+	}
+}
+
+static long json_read(load_connection *connection, json_buffer *buffer, char *pending, int *pending_size) {
+	// plain JSON stream has no framing, message ends when top level object is closed
+	int depth = 0;
+	bool in_string = false, escaped = false;
+	buffer->size = 0;
+	while (true) {
+		if (*pending_size == 0) {
+			long bytes = read(connection->socket, pending, 64 * 1024);
+			if (bytes <= 0)
+				return -1;
+			*pending_size = (int)bytes;
+		}
+		int i;
+		bool complete = false;
+		for (i = 0; i < *pending_size && !complete; i++) {
+			char c = pending[i];
+			if (in_string) {
+				if (escaped)
+					escaped = false;
+				else if (c == '\\')
+					escaped = true;
+				else if (c == '"')
+					in_string = false;
+			} else if (c == '"') {
+				in_string = true;
+			} else if (c == '{') {
+				depth++;
+			} else if (c == '}') {
+				complete = --depth == 0;
+			}
+		}
+		if (!json_reserve(buffer, buffer->size + i + 1))
+			return -1;
+		memcpy(buffer->data + buffer->size, pending, i);
+		buffer->size += i;
+		memmove(pending, pending + i, *pending_size - i);
+		*pending_size -= i;
+		if (complete) {
+			buffer->data[buffer->size] = 0;
+			return buffer->size;
+		}
+	}
+}
+
+static void json_message(load_connection *connection, const char *message) {
+	char tag[INDIGO_NAME_SIZE], device[INDIGO_NAME_SIZE], name[INDIGO_NAME_SIZE], state[INDIGO_NAME_SIZE];
+	if (sscanf(message, " { \"%127[^\"]\"", tag) != 1 || !json_field(message, "device", device, sizeof(device)) || !json_field(message, "name", name, sizeof(name)))
+		return;
+	indigo_property_state property_state = INDIGO_IDLE_STATE;
+	if (json_field(message, "state", state, sizeof(state))) {
+		if (!strcmp(state, "Ok"))
+			property_state = INDIGO_OK_STATE;
+		else if (!strcmp(state, "Busy"))
+			property_state = INDIGO_BUSY_STATE;
+		else if (!strcmp(state, "Alert"))
+			property_state = INDIGO_ALERT_STATE;
+	}
+	if (!strncmp(tag, "def", 3)) {
+		indigo_property_type type = 0;
+		if (!strcmp(tag, "defTextVector"))
+			type = INDIGO_TEXT_VECTOR;
+		else if (!strcmp(tag, "defNumberVector"))
+			type = INDIGO_NUMBER_VECTOR;
+		else if (!strcmp(tag, "defSwitchVector"))
+			type = INDIGO_SWITCH_VECTOR;
+		else if (!strcmp(tag, "defLightVector"))
+			type = INDIGO_LIGHT_VECTOR;
+		else if (!strcmp(tag, "defBLOBVector"))
+			type = INDIGO_BLOB_VECTOR;
+		if (type)
+			learn_step_type(device, name, type);
+	} else if (strncmp(tag, "set", 3)) {
+		return;
+	}
+	property_updated(connection, device, name, property_state);
+}
+
+static void *json_reader(load_connection *connection) {
+	json_buffer buffer = { NULL, 0, 0 };
+	char *pending = malloc(64 * 1024);
+	int pending_size = 0;
+	while (true) {
+		long size;
+		int opcode = WEB_SOCKET_OPCODE_TEXT;
+		if (connection->protocol == LOAD_WS)
+			size = ws_read(connection, &buffer, &opcode);
+		else
+			size = json_read(connection, &buffer, pending, &pending_size);
+		if (size < 0)
+			break;
+		if (opcode == WEB_SOCKET_OPCODE_BINARY)
+			connection->blob_bytes += size;
+		else
+			json_message(connection, buffer.data);
+	}
+	free(buffer.data);
+	free(pending);
+	connection_closed(connection);
+	return NULL;
+}
+
+static bool json_open(load_connection *connection) {
+	if (connection->protocol == LOAD_WS) {
+		indigo_printf(connection->socket, "GET / HTTP/1.1\r\nHost: %s:%d\r\nUpgrade: websocket\r\nConnection: Upgrade\r\nSec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\nSec-WebSocket-Version: 13\r\n\r\n", hostname, port);
+		char line[1024];
+		if (indigo_read_line(connection->socket, line, sizeof(line)) <= 0 || strncmp(line, "HTTP/1.1 101", 12)) {
+			fprintf(stderr, "WebSocket handshake failed\n");
+			return false;
+		}
+		while (indigo_read_line(connection->socket, line, sizeof(line)) > 0)
+			;
+	}
+	if (pthread_create(&connection->reader, NULL, (void *(*)(void *))json_reader, connection))
+		return false;
+	json_buffer message = { NULL, 0, 0 };
+	char text[128];
+	snprintf(text, sizeof(text), "{ \"getProperties\": { \"version\": %d } }", INDIGO_VERSION_CURRENT);
+	json_append(&message, text);
+	bool result = json_send_message(connection, &message);
+	if (blob_mode != INDIGO_ENABLE_BLOB_NEVER) {
+		for (int i = 0; result && i < step_count; i++) {
+			message.size = 0;
+			json_append(&message, "{ \"enableBLOB\": { \"device\": ");
+			json_string(&message, steps[i].device);
+			snprintf(text, sizeof(text), ", \"value\": \"%s\" } }", blob_mode_names[blob_mode]);
+			json_append(&message, text);
+			result = json_send_message(connection, &message);
+		}
+	}
+	free(message.data);
+	return result;
+}
+
+static void json_send(load_connection *connection, load_step *step) {
+	static const char *tags[] = { NULL, "newTextVector", "newNumberVector", "newSwitchVector" };
+	if (step->type < INDIGO_TEXT_VECTOR || step->type > INDIGO_SWITCH_VECTOR)
+		return;
+	json_buffer message = { NULL, 0, 0 };
+	char text[INDIGO_VALUE_SIZE];
+	snprintf(text, sizeof(text), "{ \"%s\": { \"device\": ", tags[step->type]);
+	json_append(&message, text);
+	json_string(&message, step->device);
+	json_append(&message, ", \"name\": ");
+	json_string(&message, step->property);
+	json_append(&message, ", \"items\": [ ");
+	for (int i = 0; i < step->count; i++) {
+		json_append(&message, i > 0 ? ", { \"name\": " : "{ \"name\": ");
+		json_string(&message, step->items[i]);
+		json_append(&message, ", \"value\": ");
+		if (step->type == INDIGO_TEXT_VECTOR) {
+			json_string(&message, step->values[i]);
+		} else if (step->type == INDIGO_NUMBER_VECTOR) {
+			snprintf(text, sizeof(text), "%.10g", atof(step->values[i]));
+			json_append(&message, text);
+		} else {
+			json_append(&message, switch_value(step->values[i]) ? "true" : "false");
+		}
+		json_append(&message, " }");
+	}
+	json_append(&message, " ] } }");
+	json_send_message(connection, &message);
+	free(message.data);
+}
+
+// -------------------------------------------------------------------------------- workload
+
+static void *connection_writer(load_connection *connection) {
+	// connections are spread evenly over the request period, so load is the same on each run
+	double period = 1.0 / rate;
+	double start = now() + period * connection->index / connection_count;
+	for (int i = 0; i < request_count; i++) {
+		sleep_until(start + i * period);
+		load_step *step = steps + (i % step_count);
+		if (!wait_for_step_type(step)) {
+			connection->timeouts++;
+			continue;
+		}
+		pthread_mutex_lock(&connection->mutex);
+		if (connection->closed) {
+			pthread_mutex_unlock(&connection->mutex);
+			connection->errors += request_count - i;
+			break;
+		}
+		connection->waiting = (int)(step - steps);
+		connection->completed = false;
+		pthread_mutex_unlock(&connection->mutex);
+		double sent = now();
+		if (connection->protocol == LOAD_XML)
+			xml_send(connection, step);
+		else
+			json_send(connection, step);
+		struct timespec deadline;
+		deadline_after(&deadline, timeout);
+		pthread_mutex_lock(&connection->mutex);
+		int result = 0;
+		while (!connection->completed && !connection->closed && result == 0)
+			result = pthread_cond_timedwait(&connection->cond, &connection->mutex, &deadline);
+		connection->waiting = -1;
+		if (connection->completed) {
+			connection->latencies[connection->requests++] = now() - sent;
+			if (connection->state == INDIGO_ALERT_STATE)
+				connection->errors++;
+		} else if (connection->closed) {
+			connection->errors++;
+		} else {
+			connection->timeouts++;
+		}
+		pthread_mutex_unlock(&connection->mutex);
+	}
+	return NULL;
+}
+
+static void report(const char *label, bool *selected, double seconds) {
+	int requests = 0, errors = 0, timeouts = 0, count = 0;
+	long blob_bytes = 0;
+	for (int i = 0; i < connection_count; i++) {
+		if (selected[connections[i].protocol]) {
+			requests += connections[i].requests;
+			errors += connections[i].errors;
+			timeouts += connections[i].timeouts;
+			blob_bytes += connections[i].blob_bytes;
+			count++;
+		}
+	}
+	if (count == 0)
+		return;
+	double *latencies = malloc((requests + 1) * sizeof(double));
+	int index = 0;
+	for (int i = 0; i < connection_count; i++) {
+		if (selected[connections[i].protocol]) {
+			memcpy(latencies + index, connections[i].latencies, connections[i].requests * sizeof(double));
+			index += connections[i].requests;
+		}
+	}
+	qsort(latencies, requests, sizeof(double), compare_doubles);
+	double p50 = 0, p90 = 0, p99 = 0, max = 0;
+	if (requests > 0) {
+		p50 = latencies[requests * 50 / 100];
+		p90 = latencies[requests * 90 / 100];
+		p99 = latencies[requests * 99 / 100];
+		max = latencies[requests - 1];
+	}
+	printf("%-6s %11d %9d %7d %8d %10.1f %9.3f %9.3f %9.3f %9.3f %12ld\n", label, count, requests, errors, timeouts, requests / seconds, p50 * 1e3, p90 * 1e3, p99 * 1e3, max * 1e3, blob_bytes);
+	free(latencies);
+}
+
+static void print_help(const char *name) {
+	printf("usage: %s [options] device.property.item=value[;item=value;..] ...\n", name);
+	printf("options:\n"
+	       "       -h  | --help\n"
+	       "       -v  | --enable-log\n"
+	       "       -vv | --enable-debug\n"
+	       "       -vvv| --enable-trace\n"
+	       "       -r  | --remote-server host[:port]   (default: localhost)\n"
+	       "       -p  | --port port                   (default: 7624)\n"
+	       "       -c  | --connections count           (default: 10, max: %d)\n"
+	       "       -m  | --protocols xml,json,ws       (default: xml)\n"
+	       "       -n  | --requests count              (per connection, default: 100)\n"
+	       "       -R  | --rate requests               (per second and connection, default: 10)\n"
+	       "       -b  | --blobs never|also|url        (default: never, plain JSON gets URLs only)\n"
+	       "       -s  | --script file                 (one property string per line)\n"
+	       "       -t  | --timeout seconds             (default: 30)\n",
+	       MAX_CONNECTIONS
+	);
+}
+
+int main(int argc, const char * argv[]) {
+	indigo_main_argc = argc;
+	indigo_main_argv = argv;
+	if (argc < 2) {
+		print_help(argv[0]);
+		return 0;
+	}
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "-h") || !strcmp(argv[i], "--help")) {
+			print_help(argv[0]);
+			return 0;
+		} else if (!strncmp(argv[i], "-v", 2) || !strncmp(argv[i], "--enable-", 9)) {
+			continue;
+		} else if (argv[i][0] == '-' && i == argc - 1) {
+			fprintf(stderr, "No value specified for %s\n", argv[i]);
+			return 1;
+		} else if (!strcmp(argv[i], "-r") || !strcmp(argv[i], "--remote-server")) {
+			char port_str[100];
+			if (sscanf(argv[++i], "%254[^:]:%99s", hostname, port_str) > 1)
+				port = atoi(port_str);
+		} else if (!strcmp(argv[i], "-p") || !strcmp(argv[i], "--port")) {
+			port = atoi(argv[++i]);
+		} else if (!strcmp(argv[i], "-c") || !strcmp(argv[i], "--connections")) {
+			connection_count = atoi(argv[++i]);
+		} else if (!strcmp(argv[i], "-m") || !strcmp(argv[i], "--protocols")) {
+			const char *list = argv[++i];
+			for (int j = 0; j < LOAD_PROTOCOLS; j++) {
+				const char *found = strstr(list, protocol_names[j]);
+				protocols[j] = found != NULL && (found == list || found[-1] == ',') && (found[strlen(protocol_names[j])] == 0 || found[strlen(protocol_names[j])] == ',');
+			}
+		} else if (!strcmp(argv[i], "-n") || !strcmp(argv[i], "--requests")) {
+			request_count = atoi(argv[++i]);
+		} else if (!strcmp(argv[i], "-R") || !strcmp(argv[i], "--rate")) {
+			rate = atof(argv[++i]);
+		} else if (!strcmp(argv[i], "-t") || !strcmp(argv[i], "--timeout")) {
+			timeout = atof(argv[++i]);
+		} else if (!strcmp(argv[i], "-b") || !strcmp(argv[i], "--blobs")) {
+			i++;
+			if (!strcasecmp(argv[i], "also"))
+				blob_mode = INDIGO_ENABLE_BLOB_ALSO;
+			else if (!strcasecmp(argv[i], "url"))
+				blob_mode = INDIGO_ENABLE_BLOB_URL;
+			else
+				blob_mode = INDIGO_ENABLE_BLOB_NEVER;
+		} else if (!strcmp(argv[i], "-s") || !strcmp(argv[i], "--script")) {
+			if (!load_script(argv[++i]))
+				return 1;
+		} else if (argv[i][0] == '-') {
+			fprintf(stderr, "Unknown option %s\n", argv[i]);
+			return 1;
+		} else if (!add_step(argv[i])) {
+			return 1;
+		}
+	}
+	if (port <= 0) {
+		fprintf(stderr, "Invalid port specified\n");
+		return 1;
+	}
+	if (connection_count <= 0 || connection_count > MAX_CONNECTIONS) {
+		fprintf(stderr, "Invalid connection count specified\n");
+		return 1;
+	}
+	if (request_count <= 0 || rate <= 0 || timeout <= 0) {
+		fprintf(stderr, "Invalid request count, rate or timeout specified\n");
+		return 1;
+	}
+	if (step_count == 0) {
+		fprintf(stderr, "No property string specified\n");
+		return 1;
+	}
+	load_protocol enabled[LOAD_PROTOCOLS];
+	int enabled_count = 0;
+	for (int i = 0; i < LOAD_PROTOCOLS; i++) {
+		if (protocols[i])
+			enabled[enabled_count++] = i;
+	}
+	if (enabled_count == 0) {
+		fprintf(stderr, "No valid protocol specified\n");
+		return 1;
+	}
+	signal(SIGPIPE, SIG_IGN);
+	indigo_start();
+	indigo_attach_client(&load_client);
+	for (int i = 0; i < connection_count; i++) {
+		load_connection *connection = connections + i;
+		connection->index = i;
+		connection->protocol = enabled[i % enabled_count];
+		connection->waiting = -1;
+		connection->latencies = malloc(request_count * sizeof(double));
+		snprintf(connection->name, INDIGO_NAME_SIZE, CONNECTION_PREFIX "%04d", i);
+		pthread_mutex_init(&connection->mutex, NULL);
+		pthread_cond_init(&connection->cond, NULL);
+		connection->socket = indigo_open_tcp(hostname, port);
+		if (connection->socket < 0) {
+			fprintf(stderr, "Can't connect to %s:%d (%s)\n", hostname, port, strerror(errno));
+			return 1;
+		}
+		// indigo_open_tcp() sets 5s timeout, but connections are idle between requests
+		struct timeval no_timeout = { 0, 0 };
+		setsockopt(connection->socket, SOL_SOCKET, SO_RCVTIMEO, &no_timeout, sizeof(no_timeout));
+		bool result = connection->protocol == LOAD_XML ? xml_open(connection) : json_open(connection);
+		if (!result) {
+			fprintf(stderr, "Can't open %s connection #%d\n", protocol_names[connection->protocol], i);
+			return 1;
+		}
+	}
+	double start = now();
+	for (int i = 0; i < connection_count; i++)
+		pthread_create(&connections[i].writer, NULL, (void *(*)(void *))connection_writer, connections + i);
+	for (int i = 0; i < connection_count; i++)
+		pthread_join(connections[i].writer, NULL);
+	double seconds = now() - start;
+	printf("%-6s %11s %9s %7s %8s %10s %9s %9s %9s %9s %12s\n", "proto", "connections", "requests", "errors", "timeouts", "req/s", "p50 ms", "p90 ms", "p99 ms", "max ms", "blob bytes");
+	for (int i = 0; i < LOAD_PROTOCOLS; i++) {
+		bool selected[LOAD_PROTOCOLS] = { false };
+		selected[i] = true;
+		report(protocol_names[i], selected, seconds);
+	}
+	if (enabled_count > 1)
+		report("total", protocols, seconds);
+	for (int i = 0; i < connection_count; i++)
+		shutdown(connections[i].socket, SHUT_RDWR);
+	indigo_detach_client(&load_client);
+	indigo_stop();
+	return 0;
+}